@@ -0,0 +1,194 @@
+/*
+ * main.c
+ *
+ * TX throughput benchmark for the UART transport. The framework opens the
+ * slave side of a pseudo terminal, a reader thread drains the master side
+ * and counts what actually arrives. Three write paths are compared:
+ *
+ *  legacy : the former rpcTransportWrite loop, 8 byte write() calls each
+ *           followed by tcflush(TCOFLUSH)
+ *  full   : rpcSendFrame, one write per frame
+ *  paced  : rpcSendFrame with rpcTransportSetPacing(8, 0)
+ *
+ * A pty has no baud rate, so the numbers measure the host side cost of a
+ * frame. On a real 115200 baud link the wire caps the rate at ~250 frames/s
+ * for these frames, and the legacy path stays well below that.
+ *
+ * usage: txBench.bin [seconds per run, default 2] [payload length, default 32]
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+
+#include "rpc.h"
+#include "rpcTransport.h"
+#include "mtParser.h"
+
+#include "dbgPrint.h"
+
+// AREQ that no subsystem answers, keeps the SREQ table out of the loop
+#define BENCH_CMD0 (MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS)
+#define BENCH_CMD1 (0x7F)
+
+static int masterFd;
+static volatile int readerStop;
+static volatile uint64_t bytesRx;
+
+static void *readerTask(void *argument __attribute__((unused)))
+{
+	uint8_t buf[4096];
+
+	while (!readerStop)
+	{
+		ssize_t n = read(masterFd, buf, sizeof(buf));
+		if (n > 0)
+		{
+			bytesRx += n;
+		}
+	}
+	return NULL;
+}
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// previous rpcTransportWrite body, kept here as the baseline
+static void legacyWrite(int fd, uint8_t *buf, uint8_t len)
+{
+	int remain = len;
+	int offset = 0;
+
+	while (remain > 0)
+	{
+		int sub = (remain >= 8 ? 8 : remain);
+		if (write(fd, buf + offset, sub) < 0)
+		{
+			return;
+		}
+		tcflush(fd, TCOFLUSH);
+		remain -= 8;
+		offset += 8;
+	}
+}
+
+static void legacySendFrame(int fd, uint8_t *payload, uint8_t len)
+{
+	uint8_t buf[RPC_MAX_LEN];
+	uint8_t fcs = 0;
+	uint8_t i;
+
+	buf[0] = MT_RPC_SOF;
+	buf[1] = len;
+	buf[2] = BENCH_CMD0;
+	buf[3] = BENCH_CMD1;
+	memcpy(&buf[4], payload, len);
+	for (i = 1; i < len + 4; i++)
+	{
+		fcs ^= buf[i];
+	}
+	buf[len + 4] = fcs;
+
+	legacyWrite(fd, buf, len + 5);
+}
+
+static void runBench(const char *name, int fd, int legacy, double seconds,
+        uint8_t *payload, uint8_t len)
+{
+	uint64_t frames = 0;
+	uint64_t expected;
+	double start, elapsed;
+
+	// let the reader empty the pty before counting
+	usleep(100000);
+	bytesRx = 0;
+
+	start = nowSec();
+	do
+	{
+		int i;
+
+		for (i = 0; i < 64; i++)
+		{
+			if (legacy)
+			{
+				legacySendFrame(fd, payload, len);
+			}
+			else
+			{
+				rpcSendFrame(BENCH_CMD0, BENCH_CMD1, payload, len);
+			}
+		}
+		frames += 64;
+		elapsed = nowSec() - start;
+	} while (elapsed < seconds);
+
+	usleep(200000);
+	expected = frames * (len + 5);
+	printf("%-7s %10.0f frames/s %8.2f us/frame  received %llu/%llu bytes"
+	        " (%.1f%% lost)\n", name, frames / elapsed,
+	        elapsed * 1e6 / frames, (unsigned long long) bytesRx,
+	        (unsigned long long) expected,
+	        100.0 * (double) (expected - (bytesRx < expected ? bytesRx : expected))
+	                / expected);
+}
+
+int main(int argc, char* argv[])
+{
+	double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+	uint8_t len = (argc > 2) ? atoi(argv[2]) : 32;
+	uint8_t payload[RPC_MAX_LEN];
+	struct termios tio;
+	pthread_t readerThread;
+	int fd;
+
+	if (len > RPC_MAX_LEN - RPC_UART_HDR_LEN - RPC_UART_FCS_LEN)
+	{
+		len = RPC_MAX_LEN - RPC_UART_HDR_LEN - RPC_UART_FCS_LEN;
+	}
+	memset(payload, 0x55, sizeof(payload));
+
+	masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((masterFd < 0) || grantpt(masterFd) || unlockpt(masterFd))
+	{
+		perror("posix_openpt");
+		return -1;
+	}
+	tcgetattr(masterFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(masterFd, TCSANOW, &tio);
+
+	fd = rpcOpen(ptsname(masterFd));
+	if (fd < 0)
+	{
+		return -1;
+	}
+	rpcInitMq();
+
+	pthread_create(&readerThread, NULL, readerTask, NULL);
+
+	printf("%d byte payload, %.1fs per run\n", len, seconds);
+	runBench("legacy", fd, 1, seconds, payload, len);
+	runBench("full", fd, 0, seconds, payload, len);
+	rpcTransportSetPacing(8, 0);
+	runBench("paced", fd, 0, seconds, payload, len);
+	rpcTransportSetPacing(0, 0);
+
+	readerStop = 1;
+	rpcSendFrame(BENCH_CMD0, BENCH_CMD1, payload, len);
+	pthread_join(readerThread, NULL);
+	rpcClose();
+
+	return 0;
+}
@@ -44,323 +44,519 @@
 #include <stdlib.h>
 
 #include "mtAf.h"
+#include "mtAfReasm.h"
+#include "mtAfTrack.h"
+#include "mtZdoAddr.h"
 #include "mtParser.h"
+#include "mtCodec.h"
 #include "rpc.h"
 #include "dbgPrint.h"
 
 /*********************************************************************
  * MACROS
  */
-#define HI_UINT16(a) (((a) >> 8) & 0xFF)
-#define LO_UINT16(a) ((a) & 0xFF)
+// payload bytes before the data of AF_INCOMING_MSG and AF_INCOMING_MSG_EXT
+#define AF_INCOMING_MSG_HDR_LEN        17
+#define AF_INCOMING_MSG_EXT_HDR_LEN    27
 
 /*********************************************************************
  * LOCAL VARIABLE
  */
 static mtAfCb_t mtAfCbs;
-extern uint8_t srspRpcBuff[RPC_MAX_LEN];
-extern uint8_t srspRpcLen;
 
 /*********************************************************************
- * LOCAL FUNCTIONS
+ * COMMAND LAYOUTS
+ *
+ * Wire format of the requests and callbacks packed and unpacked by
+ * mtCodec.c
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 
-uint8_t afRegister(RegisterFormat_t *req)
+// requests
+static const mtField_t registerFields[] =
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 9 + (req->AppNumInClusters * 2)
-	        + (req->AppNumOutClusters * 2);
-	uint8_t *cmd = malloc(cmdLen);
+	MT_U8(RegisterFormat_t, EndPoint),
+	MT_U16(RegisterFormat_t, AppProfId),
+	MT_U16(RegisterFormat_t, AppDeviceId),
+	MT_U8(RegisterFormat_t, AppDevVer),
+	MT_U8(RegisterFormat_t, LatencyReq),
+	MT_U8(RegisterFormat_t, AppNumInClusters),
+	MT_LIST_U16(RegisterFormat_t, AppInClusterList, AppNumInClusters),
+	MT_U8(RegisterFormat_t, AppNumOutClusters),
+	MT_LIST_U16(RegisterFormat_t, AppOutClusterList, AppNumOutClusters)
+};
+static const mtCmdDesc_t registerDesc =
+        MT_DESC(RegisterFormat_t, registerFields);
+
+static const mtField_t dataRequestFields[] =
+{
+	MT_U16(DataRequestFormat_t, DstAddr),
+	MT_U8(DataRequestFormat_t, DstEndpoint),
+	MT_U8(DataRequestFormat_t, SrcEndpoint),
+	MT_U16(DataRequestFormat_t, ClusterID),
+	MT_U8(DataRequestFormat_t, TransID),
+	MT_U8(DataRequestFormat_t, Options),
+	MT_U8(DataRequestFormat_t, Radius),
+	MT_U8(DataRequestFormat_t, Len),
+	MT_LIST_U8(DataRequestFormat_t, Data, Len)
+};
+static const mtCmdDesc_t dataRequestDesc =
+        MT_DESC(DataRequestFormat_t, dataRequestFields);
+
+// Data is the last field, the header descriptor leaves it out
+static const mtField_t dataRequestExtFields[] =
+{
+	MT_U8(DataRequestExtFormat_t, DstAddrMode),
+	MT_BYTES(DataRequestExtFormat_t, DstAddr),
+	MT_U8(DataRequestExtFormat_t, DstEndpoint),
+	MT_U16(DataRequestExtFormat_t, DstPanID),
+	MT_U8(DataRequestExtFormat_t, SrcEndpoint),
+	MT_U16(DataRequestExtFormat_t, ClusterId),
+	MT_U8(DataRequestExtFormat_t, TransId),
+	MT_U8(DataRequestExtFormat_t, Options),
+	MT_U8(DataRequestExtFormat_t, Radius),
+	MT_U16(DataRequestExtFormat_t, Len),
+	MT_LIST_U8_LEN16(DataRequestExtFormat_t, Data, Len)
+};
+static const mtCmdDesc_t dataRequestExtDesc =
+        MT_DESC(DataRequestExtFormat_t, dataRequestExtFields);
+static const mtCmdDesc_t dataRequestExtHdrDesc =
+{
+	dataRequestExtFields,
+	(sizeof(dataRequestExtFields) / sizeof(mtField_t)) - 1,
+	sizeof(DataRequestExtFormat_t),
+	0
+};
 
-	if (cmd)
-	{
+static const mtField_t dataRequestSrcRtgFields[] =
+{
+	MT_U16(DataRequestSrcRtgFormat_t, DstAddr),
+	MT_U8(DataRequestSrcRtgFormat_t, DstEndpoint),
+	MT_U8(DataRequestSrcRtgFormat_t, SrcEndpoint),
+	MT_U16(DataRequestSrcRtgFormat_t, ClusterID),
+	MT_U8(DataRequestSrcRtgFormat_t, TransID),
+	MT_U8(DataRequestSrcRtgFormat_t, Options),
+	MT_U8(DataRequestSrcRtgFormat_t, Radius),
+	MT_U8(DataRequestSrcRtgFormat_t, RelayCount),
+	MT_LIST_U16(DataRequestSrcRtgFormat_t, RelayList, RelayCount),
+	MT_U8(DataRequestSrcRtgFormat_t, Len),
+	MT_LIST_U8(DataRequestSrcRtgFormat_t, Data, Len)
+};
+static const mtCmdDesc_t dataRequestSrcRtgDesc =
+        MT_DESC(DataRequestSrcRtgFormat_t, dataRequestSrcRtgFields);
+
+// the data length is the command itself
+static const mtField_t interPanCtlFields[] =
+{
+	MT_U8(InterPanCtlFormat_t, Command),
+	MT_LIST_U8(InterPanCtlFormat_t, Data, Command)
+};
+static const mtCmdDesc_t interPanCtlDesc =
+        MT_DESC(InterPanCtlFormat_t, interPanCtlFields);
 
-		int idx;
+static const mtField_t dataStoreFields[] =
+{
+	MT_U16(DataStoreFormat_t, Index),
+	MT_U8(DataStoreFormat_t, Length),
+	MT_LIST_U8(DataStoreFormat_t, Data, Length)
+};
+static const mtCmdDesc_t dataStoreDesc =
+        MT_DESC(DataStoreFormat_t, dataStoreFields);
+
+static const mtField_t dataRetrieveFields[] =
+{
+	MT_BYTES(DataRetrieveFormat_t, TimeStamp),
+	MT_U16(DataRetrieveFormat_t, Index),
+	MT_U8(DataRetrieveFormat_t, Length)
+};
+static const mtCmdDesc_t dataRetrieveDesc =
+        MT_DESC(DataRetrieveFormat_t, dataRetrieveFields);
+
+static const mtField_t apsfConfigSetFields[] =
+{
+	MT_U8(ApsfConfigSetFormat_t, Endpoint),
+	MT_U8(ApsfConfigSetFormat_t, FrameDelay),
+	MT_U8(ApsfConfigSetFormat_t, WindowSize)
+};
+static const mtCmdDesc_t apsfConfigSetDesc =
+        MT_DESC(ApsfConfigSetFormat_t, apsfConfigSetFields);
+
+// responses
+static const mtField_t dataRetrieveSrspFields[] =
+{
+	MT_U8(DataRetrieveSrspFormat_t, Status),
+	MT_U8(DataRetrieveSrspFormat_t, Length),
+	MT_LIST_U8(DataRetrieveSrspFormat_t, Data, Length)
+};
+static const mtCmdDesc_t dataRetrieveSrspDesc =
+        MT_DESC(DataRetrieveSrspFormat_t, dataRetrieveSrspFields);
+
+// callbacks, the incoming message layouts stop before the data
+static const mtField_t dataConfirmFields[] =
+{
+	MT_U8(DataConfirmFormat_t, Status),
+	MT_U8(DataConfirmFormat_t, Endpoint),
+	MT_U8(DataConfirmFormat_t, TransId)
+};
+static const mtCmdDesc_t dataConfirmDesc =
+        MT_DESC(DataConfirmFormat_t, dataConfirmFields);
+
+static const mtField_t incomingMsgViewFields[] =
+{
+	MT_U16(IncomingMsgView_t, GroupId),
+	MT_U16(IncomingMsgView_t, ClusterId),
+	MT_U16(IncomingMsgView_t, SrcAddr),
+	MT_U8(IncomingMsgView_t, SrcEndpoint),
+	MT_U8(IncomingMsgView_t, DstEndpoint),
+	MT_U8(IncomingMsgView_t, WasBroadcast),
+	MT_U8(IncomingMsgView_t, LinkQuality),
+	MT_U8(IncomingMsgView_t, SecurityUse),
+	MT_U32(IncomingMsgView_t, TimeStamp),
+	MT_U8(IncomingMsgView_t, TransSeqNum),
+	MT_U8(IncomingMsgView_t, Len)
+};
+static const mtCmdDesc_t incomingMsgViewDesc =
+        MT_DESC(IncomingMsgView_t, incomingMsgViewFields);
+
+static const mtField_t incomingMsgExtViewFields[] =
+{
+	MT_U16(IncomingMsgExtView_t, GroupId),
+	MT_U16(IncomingMsgExtView_t, ClusterId),
+	MT_U8(IncomingMsgExtView_t, SrcAddrMode),
+	MT_U64(IncomingMsgExtView_t, SrcAddr),
+	MT_U8(IncomingMsgExtView_t, SrcEndpoint),
+	MT_U16(IncomingMsgExtView_t, SrcPanId),
+	MT_U8(IncomingMsgExtView_t, DstEndpoint),
+	MT_U8(IncomingMsgExtView_t, WasBroadcast),
+	MT_U8(IncomingMsgExtView_t, LinkQuality),
+	MT_U8(IncomingMsgExtView_t, SecurityUse),
+	MT_U32(IncomingMsgExtView_t, TimeStamp),
+	MT_U8(IncomingMsgExtView_t, TransSeqNum),
+	MT_U16(IncomingMsgExtView_t, Len)
+};
+static const mtCmdDesc_t incomingMsgExtViewDesc =
+        MT_DESC(IncomingMsgExtView_t, incomingMsgExtViewFields);
+
+static const mtField_t reflectErrorFields[] =
+{
+	MT_U8(ReflectErrorFormat_t, Status),
+	MT_U8(ReflectErrorFormat_t, Endpoint),
+	MT_U8(ReflectErrorFormat_t, TransId),
+	MT_U8(ReflectErrorFormat_t, DstAddrMode),
+	MT_U16(ReflectErrorFormat_t, DstAddr)
+};
+static const mtCmdDesc_t reflectErrorDesc =
+        MT_DESC(ReflectErrorFormat_t, reflectErrorFields);
 
-		cmd[cmInd++] = req->EndPoint;
-		cmd[cmInd++] = (uint8_t)(req->AppProfId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->AppProfId >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->AppDeviceId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->AppDeviceId >> 8) & 0xFF);
-		cmd[cmInd++] = req->AppDevVer;
-		cmd[cmInd++] = req->LatencyReq;
-		cmd[cmInd++] = req->AppNumInClusters;
-		for (idx = 0; idx < req->AppNumInClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->AppInClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->AppInClusterList[idx] >> 8) & 0xFF);
-		}
-		cmd[cmInd++] = req->AppNumOutClusters;
-		for (idx = 0; idx < req->AppNumOutClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->AppOutClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->AppOutClusterList[idx] >> 8) & 0xFF);
-		}
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_REGISTER, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+uint8_t afRegister(RegisterFormat_t *req)
+{
+	return mtSendReq(&registerDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_REGISTER, req);
+}
+
+/*********************************************************************
+ * @fn      decodeAfRegisterSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeAfRegisterSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        RegisterSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processAfRegisterSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfRegisterSrsp)
 	{
-		uint8_t msgIdx = 2;
 		RegisterSrspFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (decodeAfRegisterSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfRegisterSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtAfCbs.pfnAfRegisterSrsp(&rsp);
 	}
 }
 
 uint8_t afDataRequest(DataRequestFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 10 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->DstEndpoint;
-		cmd[cmInd++] = req->SrcEndpoint;
-		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
-		cmd[cmInd++] = req->TransID;
-		cmd[cmInd++] = req->Options;
-		cmd[cmInd++] = req->Radius;
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Data[idx];
+	return afDataRequestCb(req, 0, NULL, NULL);
+}
 
-		}
+/*********************************************************************
+ * @fn      afDataRequestCb
+ *
+ * @brief   afDataRequest() with a completion callback for its SRSP, see
+ *          rpcFrameSendCb(). The SRSP still goes to pfnAfDataRequestSrsp.
+ *
+ * @param   req - request
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t afDataRequestCb(DataRequestFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
+	uint8_t status;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST, cmd, cmdLen);
-		free(cmd);
-		return status;
+	afTrackSend(req->SrcEndpoint, req->TransID, req->DstAddr, req->ClusterID);
+	status = mtSendReqCb(&dataRequestDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_DATA_REQUEST, req, timeoutMs, cb, cbArg);
+	if (status != MT_RPC_SUCCESS)
+	{
+		afTrackCancel(req->SrcEndpoint, req->TransID);
 	}
-	else
+	return status;
+}
+
+/*********************************************************************
+ * @fn      decodeAfDataRequestSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeAfDataRequestSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        DataRequestSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processAfDataRequestSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfDataRequestSrsp)
 	{
-		uint8_t msgIdx = 2;
 		DataRequestSrspFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (decodeAfDataRequestSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfDataRequestSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtAfCbs.pfnAfDataRequestSrsp(&rsp);
 	}
 }
 
 uint8_t afDataRequestExt(DataRequestExtFormat_t *req)
+{
+	return afDataRequestExtCb(req, 0, NULL, NULL);
+}
+
+/*********************************************************************
+ * @fn      afDataRequestExtCb
+ *
+ * @brief   afDataRequestExt() with a completion callback for its SRSP. A
+ *          Len larger than Data sends the header only: the ZNP allocates
+ *          its huge buffer, to be filled with afDataStore() and sent by a
+ *          zero length store, see afDataRequestStream().
+ *
+ * @param   req - request
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t afDataRequestExtCb(DataRequestExtFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
 {
 	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 20 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = req->DstAddrMode;
-		memcpy((cmd + cmInd), req->DstAddr, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->DstEndpoint;
-		cmd[cmInd++] = (uint8_t)(req->DstPanID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstPanID >> 8) & 0xFF);
-		cmd[cmInd++] = req->SrcEndpoint;
-		cmd[cmInd++] = (uint8_t)(req->ClusterId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ClusterId >> 8) & 0xFF);
-		cmd[cmInd++] = req->TransId;
-		cmd[cmInd++] = req->Options;
-		cmd[cmInd++] = req->Radius;
-		cmd[cmInd++] = (uint8_t)(req->Len & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Len >> 8) & 0xFF);
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Data[idx];
-		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST_EXT, cmd, cmdLen);
-		free(cmd);
-		return status;
+	// a 64 bit destination is accounted under 0xFFFE, unknown
+	afTrackSend(req->SrcEndpoint, req->TransId,
+	        (req->DstAddrMode == Addr64Bit) ? 0xFFFE :
+	                (uint16_t) (req->DstAddr[0] | (req->DstAddr[1] << 8)),
+	        req->ClusterId);
+	status = mtSendReqCb(
+	        (req->Len > sizeof(req->Data)) ?
+	                &dataRequestExtHdrDesc : &dataRequestExtDesc,
+	        (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF), MT_AF_DATA_REQUEST_EXT, req,
+	        timeoutMs, cb, cbArg);
+	if (status != MT_RPC_SUCCESS)
+	{
+		afTrackCancel(req->SrcEndpoint, req->TransId);
 	}
-	else
+	return status;
+}
+
+/*********************************************************************
+ * @fn      decodeAfDataRequestExtSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeAfDataRequestExtSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        DataRequestExtSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processAfDataRequestExtSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfDataRequestExtSrsp)
 	{
-		uint8_t msgIdx = 2;
 		DataRequestExtSrspFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (decodeAfDataRequestExtSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfDataRequestExtSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtAfCbs.pfnAfDataRequestExtSrsp(&rsp);
 	}
 }
 
 uint8_t afDataRequestSrcRtg(DataRequestSrcRtgFormat_t *req)
 {
 	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11 + (req->RelayCount * 2) + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->DstEndpoint;
-		cmd[cmInd++] = req->SrcEndpoint;
-		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
-		cmd[cmInd++] = req->TransID;
-		cmd[cmInd++] = req->Options;
-		cmd[cmInd++] = req->Radius;
-		cmd[cmInd++] = req->RelayCount;
-		for (idx = 0; idx < req->RelayCount; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->RelayList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->RelayList[idx] >> 8) & 0xFF);
-		}
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Data[idx];
-		}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_REQUEST_SRC_RTG, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+	afTrackSend(req->SrcEndpoint, req->TransID, req->DstAddr, req->ClusterID);
+	status = mtSendReq(&dataRequestSrcRtgDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_DATA_REQUEST_SRC_RTG, req);
+	if (status != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		afTrackCancel(req->SrcEndpoint, req->TransID);
 	}
+	return status;
 }
 
-uint8_t afInterPanCtl(InterPanCtlFormat_t *req)
+/*********************************************************************
+ * @fn      processAfDataRequestSrcRtgSrsp
+ *
+ * @brief   AF_DATA_REQUEST_SRC_RTG SRSP, the outcome is reported by the
+ *          AF_DATA_CONFIRM
+ *
+ * @param    rpcBuff - Buffer from rpc layer, contains command data
+ * @param    rpcLen - Length of rpcBuff
+ *
+ * @return
+ */
+static void processAfDataRequestSrcRtgSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1 + req->Command;
-	uint8_t *cmd = malloc(cmdLen);
+	StatusSrspFormat_t rsp;
 
-	if (cmd)
+	if ((mtDecodeStatusSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+	        && (rsp.Status != MT_RPC_SUCCESS))
 	{
+		LOG_DBG("AF_DATA_REQUEST_SRC_RTG refused: %02X", rsp.Status);
+	}
+}
 
-		int idx;
-
-		cmd[cmInd++] = req->Command;
-		for (idx = 0; idx < req->Command; idx++)
-		{
-			cmd[cmInd++] = req->Data[idx];
-		}
+uint8_t afInterPanCtl(InterPanCtlFormat_t *req)
+{
+	return mtSendReq(&interPanCtlDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_INTER_PAN_CTL, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_INTER_PAN_CTL, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeAfInterPanCtlSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeAfInterPanCtlSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        InterPanCtlSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processAfInterPanCtlSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfInterPanCtlSrsp)
 	{
-		uint8_t msgIdx = 2;
 		InterPanCtlSrspFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (decodeAfInterPanCtlSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfInterPanCtlSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtAfCbs.pfnAfInterPanCtlSrsp(&rsp);
 	}
 }
 
 uint8_t afDataStore(DataStoreFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3 + req->Length;
-	uint8_t *cmd = malloc(cmdLen);
+	return afDataStoreCb(req, 0, NULL, NULL);
+}
 
-	if (cmd)
-	{
+/*********************************************************************
+ * @fn      afDataStoreCb
+ *
+ * @brief   afDataStore() with a completion callback for its SRSP, see
+ *          rpcFrameSendCb().
+ *
+ * @param   req - request
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t afDataStoreCb(DataStoreFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
+	return mtSendReqCb(&dataStoreDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_DATA_STORE, req, timeoutMs, cb, cbArg);
+}
 
-		int idx;
+static void processDataStoreSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	if (mtAfCbs.pfnAfDataStoreSrsp)
+	{
+		StatusSrspFormat_t rsp;
 
-		cmd[cmInd++] = (uint8_t)(req->Index & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Index >> 8) & 0xFF);
-		cmd[cmInd++] = req->Length;
-		for (idx = 0; idx < req->Length; idx++)
+		if (mtDecodeStatusSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			cmd[cmInd++] = req->Data[idx];
+			mtAfCbs.pfnAfDataStoreSrsp(&rsp);
 		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_STORE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
 	}
 }
 
@@ -368,108 +564,216 @@ static void processDataConfirm(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfDataConfirm)
 	{
-		uint8_t msgIdx = 2;
 		DataConfirmFormat_t rsp;
-		if (rpcLen < 3)
+
+		if (mtDecode(&dataConfirmDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfDataConfirm(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.Endpoint = rpcBuff[msgIdx++];
-		rsp.TransId = rpcBuff[msgIdx++];
+	}
+}
 
-		mtAfCbs.pfnAfDataConfirm(&rsp);
+/*********************************************************************
+ * @fn      decodeIncomingMsgView
+ *
+ * @brief   Decodes the header of an AF_INCOMING_MSG in place, Data points
+ *          into rpcBuff.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   msg - Decoded message.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeIncomingMsgView(uint8_t *rpcBuff, uint8_t rpcLen,
+        IncomingMsgView_t *msg)
+{
+	if (mtDecode(&incomingMsgViewDesc, rpcBuff, rpcLen, msg) != MT_RPC_SUCCESS)
+	{
+		return MT_RPC_ERR_LENGTH;
 	}
+	msg->Data = &rpcBuff[2 + AF_INCOMING_MSG_HDR_LEN];
+
+	return MT_CHECK_LEN(rpcBuff, rpcLen, AF_INCOMING_MSG_HDR_LEN + msg->Len);
 }
 
 static void processIncomingMsg(uint8_t *rpcBuff, uint8_t rpcLen)
 {
+	IncomingMsgView_t view;
+
+	if (!mtAfCbs.pfnAfIncomingMsgView && !mtAfCbs.pfnAfIncomingMsg
+	        && !zdoAddrEnabled())
+	{
+		return;
+	}
+	if (decodeIncomingMsgView(rpcBuff, rpcLen, &view) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+	if (zdoAddrEnabled())
+	{
+		zdoAddrSeenNwk(view.SrcAddr);
+	}
+	if (!mtAfCbs.pfnAfIncomingMsgView && !mtAfCbs.pfnAfIncomingMsg)
+	{
+		return;
+	}
+
+	if (mtAfCbs.pfnAfIncomingMsgView)
+	{
+		mtAfCbs.pfnAfIncomingMsgView(&view);
+	}
 	if (mtAfCbs.pfnAfIncomingMsg)
 	{
-		uint8_t msgIdx = 2;
 		IncomingMsgFormat_t rsp;
-		if (rpcLen < 17)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.GroupId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ClusterId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.SrcEndpoint = rpcBuff[msgIdx++];
-		rsp.DstEndpoint = rpcBuff[msgIdx++];
-		rsp.WasBroadcast = rpcBuff[msgIdx++];
-		rsp.LinkQuality = rpcBuff[msgIdx++];
-		rsp.SecurityUse = rpcBuff[msgIdx++];
-		rsp.TimeStamp = 0;
-		uint8_t i;
-		for (i = 0; i < 4; i++)
-			rsp.TimeStamp |= ((uint32_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.TransSeqNum = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 17)
+
+		rsp.GroupId = view.GroupId;
+		rsp.ClusterId = view.ClusterId;
+		rsp.SrcAddr = view.SrcAddr;
+		rsp.SrcEndpoint = view.SrcEndpoint;
+		rsp.DstEndpoint = view.DstEndpoint;
+		rsp.WasBroadcast = view.WasBroadcast;
+		rsp.LinkQuality = view.LinkQuality;
+		rsp.SecurityUse = view.SecurityUse;
+		rsp.TimeStamp = view.TimeStamp;
+		rsp.TransSeqNum = view.TransSeqNum;
+		rsp.Len = view.Len;
+		if (rsp.Len > sizeof(rsp.Data))
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.Data[i] = rpcBuff[msgIdx++];
-			}
+			LOG_WARN("AF_INCOMING_MSG of %d bytes truncated", rsp.Len);
+			rsp.Len = sizeof(rsp.Data);
 		}
+		memcpy(rsp.Data, view.Data, rsp.Len);
+
 		mtAfCbs.pfnAfIncomingMsg(&rsp);
 	}
 }
 
+/*********************************************************************
+ * @fn      decodeIncomingMsgExtView
+ *
+ * @brief   Decodes the header of an AF_INCOMING_MSG_EXT in place, Data
+ *          points into rpcBuff. Messages too large for a frame carry no
+ *          data, Data is NULL and AF_DATA_RETRIEVE fetches it.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   msg - Decoded message.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeIncomingMsgExtView(uint8_t *rpcBuff, uint8_t rpcLen,
+        IncomingMsgExtView_t *msg)
+{
+	if (mtDecode(&incomingMsgExtViewDesc, rpcBuff, rpcLen, msg)
+	        != MT_RPC_SUCCESS)
+	{
+		return MT_RPC_ERR_LENGTH;
+	}
+
+	// only the bytes of the address mode are meaningful
+	if (msg->SrcAddrMode == 2)
+	{
+		msg->SrcAddr &= 0xFFFF;
+	}
+	else if (msg->SrcAddrMode != 3)
+	{
+		msg->SrcAddr = 0;
+	}
+
+	if (msg->Len <= rpcLen - AF_INCOMING_MSG_EXT_HDR_LEN - 3)
+	{
+		msg->Data = &rpcBuff[2 + AF_INCOMING_MSG_EXT_HDR_LEN];
+	}
+	else
+	{
+		msg->Data = NULL;
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
 static void processIncomingMsgExt(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtAfCbs.pfnAfIncomingMsgExt)
+	IncomingMsgExtView_t view;
+
+	if (!mtAfCbs.pfnAfIncomingMsgExtView && !mtAfCbs.pfnAfIncomingMsgExt
+	        && !zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
-		IncomingMsgExtFormat_t rsp;
-		if (rpcLen < 27)
+		return;
+	}
+	if (decodeIncomingMsgExtView(rpcBuff, rpcLen, &view) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+	if (zdoAddrEnabled())
+	{
+		if (view.SrcAddrMode == afAddr16Bit)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			zdoAddrSeenNwk((uint16_t) view.SrcAddr);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.GroupId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ClusterId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.SrcAddrMode = rpcBuff[msgIdx++];
-		rsp.SrcAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
+		else if (view.SrcAddrMode == afAddr64Bit)
 		{
-			if ((rsp.SrcAddrMode == 2 && i < 2) || rsp.SrcAddrMode == 3)
-			{
-				rsp.SrcAddr |= ((uint64_t) rpcBuff[msgIdx]) << (i * 8);
-			}
-			msgIdx++;
+			zdoAddrSeenIeee(view.SrcAddr);
 		}
+	}
+	if (!mtAfCbs.pfnAfIncomingMsgExtView && !mtAfCbs.pfnAfIncomingMsgExt)
+	{
+		return;
+	}
 
-		rsp.SrcEndpoint = rpcBuff[msgIdx++];
-		rsp.SrcPanId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.DstEndpoint = rpcBuff[msgIdx++];
-		rsp.WasBroadcast = rpcBuff[msgIdx++];
-		rsp.LinkQuality = rpcBuff[msgIdx++];
-		rsp.SecurityUse = rpcBuff[msgIdx++];
-		rsp.TimeStamp = 0;
-		for (i = 0; i < 4; i++)
-			rsp.TimeStamp |= ((uint32_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.TransSeqNum = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-        msgIdx++;
-		uint32_t ind;
-		for (ind = 0; ind < rsp.Len; ind++)
+	// data left in the ZNP is fetched first, the message comes back
+	// complete through afIncomingMsgExtDeliver()
+	if ((view.Data == NULL) && (view.Len > 0)
+	        && (afReasmStart(&view) == MT_RPC_SUCCESS))
+	{
+		return;
+	}
+
+	afIncomingMsgExtDeliver(&view);
+}
+
+/*********************************************************************
+ * @fn      afIncomingMsgExtDeliver
+ *
+ * @brief   Pass an AF_INCOMING_MSG_EXT to the registered callbacks. The
+ *          copying callback gets at most sizeof(Data) bytes and Len is
+ *          the number of bytes copied.
+ *
+ * @param   view - message, Data is NULL if it was not retrieved
+ */
+void afIncomingMsgExtDeliver(const IncomingMsgExtView_t *view)
+{
+	if (mtAfCbs.pfnAfIncomingMsgExtView)
+	{
+		mtAfCbs.pfnAfIncomingMsgExtView(view);
+	}
+	if (mtAfCbs.pfnAfIncomingMsgExt)
+	{
+		IncomingMsgExtFormat_t rsp;
+		uint16_t len = view->Data ? view->Len : 0;
+
+		rsp.GroupId = view->GroupId;
+		rsp.ClusterId = view->ClusterId;
+		rsp.SrcAddrMode = view->SrcAddrMode;
+		rsp.SrcAddr = view->SrcAddr;
+		rsp.SrcEndpoint = view->SrcEndpoint;
+		rsp.SrcPanId = view->SrcPanId;
+		rsp.DstEndpoint = view->DstEndpoint;
+		rsp.WasBroadcast = view->WasBroadcast;
+		rsp.LinkQuality = view->LinkQuality;
+		rsp.SecurityUse = view->SecurityUse;
+		rsp.TimeStamp = view->TimeStamp;
+		rsp.TransSeqNum = view->TransSeqNum;
+		if (len > sizeof(rsp.Data))
+		{
+			LOG_WARN("AF_INCOMING_MSG_EXT of %d bytes truncated", len);
+			len = sizeof(rsp.Data);
+		}
+		rsp.Len = (uint8_t) len;
+		if (len)
 		{
-			rsp.Data[ind] = rpcBuff[msgIdx++];
+			memcpy(rsp.Data, view->Data, len);
 		}
 
 		mtAfCbs.pfnAfIncomingMsgExt(&rsp);
@@ -478,104 +782,82 @@ static void processIncomingMsgExt(uint8_t *rpcBuff, uint8_t rpcLen)
 
 uint8_t afDataRetrieve(DataRetrieveFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 7;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
+	return afDataRetrieveCb(req, 0, NULL, NULL);
+}
 
-		memcpy((cmd + cmInd), req->TimeStamp, 4);
-		cmInd += 4;
-		cmd[cmInd++] = (uint8_t)(req->Index & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Index >> 8) & 0xFF);
-		cmd[cmInd++] = req->Length;
+/*********************************************************************
+ * @fn      afDataRetrieveCb
+ *
+ * @brief   afDataRetrieve() with a completion callback for its SRSP, see
+ *          rpcFrameSendCb().
+ *
+ * @param   req - request
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t afDataRetrieveCb(DataRetrieveFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
+	return mtSendReqCb(&dataRetrieveDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_DATA_RETRIEVE, req, timeoutMs, cb, cbArg);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_DATA_RETRIEVE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeDataRetrieveSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeDataRetrieveSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        DataRetrieveSrspFormat_t *rsp)
+{
+	return mtDecode(&dataRetrieveSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 static void processDataRetrieveSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
+	if (rpcSrspHidden())
+	{
+		// retrieve of a reassembly, deliver the messages it completed
+		afReasmPoll();
+		return;
+	}
+
 	if (mtAfCbs.pfnAfDataRetrieveSrsp)
 	{
-		uint8_t msgIdx = 2;
 		DataRetrieveSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.Length = rpcBuff[msgIdx++];
-		if (rpcLen > 2)
+		if (decodeDataRetrieveSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Length; i++)
-			{
-				rsp.Data[i] = rpcBuff[msgIdx++];
-			}
+			mtAfCbs.pfnAfDataRetrieveSrsp(&rsp);
 		}
-		mtAfCbs.pfnAfDataRetrieveSrsp(&rsp);
 	}
 }
 
 uint8_t afApsfConfigSet(ApsfConfigSetFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Endpoint;
-		cmd[cmInd++] = req->FrameDelay;
-		cmd[cmInd++] = req->WindowSize;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
-		MT_AF_APSF_CONFIG_SET, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&apsfConfigSetDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_AF),
+	        MT_AF_APSF_CONFIG_SET, req);
 }
 
 static void processReflectError(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtAfCbs.pfnAfReflectError)
 	{
-		uint8_t msgIdx = 2;
 		ReflectErrorFormat_t rsp;
-		if (rpcLen < 6)
+
+		if (mtDecode(&reflectErrorDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtAfCbs.pfnAfReflectError(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.Endpoint = rpcBuff[msgIdx++];
-		rsp.TransId = rpcBuff[msgIdx++];
-		rsp.DstAddrMode = rpcBuff[msgIdx++];
-		rsp.DstAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtAfCbs.pfnAfReflectError(&rsp);
 	}
 }
 
@@ -591,100 +873,54 @@ static void processReflectError(uint8_t *rpcBuff, uint8_t rpcLen)
 void afRegisterCallbacks(mtAfCb_t cbs)
 {
 	memcpy(&mtAfCbs, &cbs, sizeof(mtAfCb_t));
+	mtUpdateInterest(MT_RPC_SYS_AF, afHandlerTable, &mtAfCbs);
 }
 
-/*************************************************************************************************
- * @fn      afProcess()
- *
- * @brief   read and process the RPC Af message from the ZB SoC
- *
- * @param   rpcLen has the size of the frame: cmd0 + cmd1 + payload + FCS
+/*********************************************************************
+ * HANDLER TABLE
  *
- * @return
- *************************************************************************************************/
-void afProcess(uint8_t *rpcBuff, uint8_t rpcLen)
+ * Incoming AF commands, installed in the MT dispatch table by mtProcess()
+ */
+const mtHandlerEntry_t afHandlerTable[] =
 {
-	LOG_DBG("afProcess: processing CMD0:%x, CMD1:%x",
-	        rpcBuff[0], rpcBuff[1]);
-
-	//process the synchronous SRSP from SREQ
-	if ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-	{
-		processSrsp(rpcBuff, rpcLen);
-	}
-	else
-	{
-		//Read CMD1 and processes the specific SREQ
-		switch (rpcBuff[1])
-		{
-		case MT_AF_DATA_CONFIRM:
-			LOG_DBG("afProcess: MT_AF_DATA_CONFIRM");
-			processDataConfirm(rpcBuff, rpcLen);
-			break;
-		case MT_AF_INCOMING_MSG:
-			LOG_DBG("afProcess: MT_AF_INCOMING_MSG");
-			processIncomingMsg(rpcBuff, rpcLen);
-			break;
-		case MT_AF_INCOMING_MSG_EXT:
-			LOG_DBG(
-			        "afProcess: MT_AF_INCOMING_MSG_EXT");
-			processIncomingMsgExt(rpcBuff, rpcLen);
-			break;
-		case MT_AF_REFLECT_ERROR:
-			LOG_DBG("afProcess: MT_AF_REFLECT_ERROR");
-			processReflectError(rpcBuff, rpcLen);
-			break;
-		default:
-			LOG_ERR(
-			        "processRpcAf: CMD0:%x, CMD1:%x, not handled", rpcBuff[0],
-			        rpcBuff[1]);
-			break;
-		}
-	}
-}
+	{ MT_RPC_CMD_AREQ, MT_AF_DATA_CONFIRM, processDataConfirm,
+	        MT_CB(mtAfCb_t, pfnAfDataConfirm) },
+	{ MT_RPC_CMD_AREQ, MT_AF_INCOMING_MSG, processIncomingMsg,
+	        MT_CB(mtAfCb_t, pfnAfIncomingMsg) },
+	{ MT_RPC_CMD_AREQ, MT_AF_INCOMING_MSG, processIncomingMsg,
+	        MT_CB(mtAfCb_t, pfnAfIncomingMsgView) },
+	{ MT_RPC_CMD_AREQ, MT_AF_INCOMING_MSG_EXT, processIncomingMsgExt,
+	        MT_CB(mtAfCb_t, pfnAfIncomingMsgExt) },
+	{ MT_RPC_CMD_AREQ, MT_AF_INCOMING_MSG_EXT, processIncomingMsgExt,
+	        MT_CB(mtAfCb_t, pfnAfIncomingMsgExtView) },
+	{ MT_RPC_CMD_AREQ, MT_AF_REFLECT_ERROR, processReflectError,
+	        MT_CB(mtAfCb_t, pfnAfReflectError) },
+	{ MT_RPC_CMD_SRSP, MT_AF_REGISTER, processAfRegisterSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_DATA_REQUEST, processAfDataRequestSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_DATA_REQUEST_EXT, processAfDataRequestExtSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_DATA_REQUEST_SRC_RTG,
+	        processAfDataRequestSrcRtgSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_INTER_PAN_CTL, processAfInterPanCtlSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_DATA_RETRIEVE, processDataRetrieveSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_AF_DATA_STORE, processDataStoreSrsp, 0 },
+	{ 0, 0, NULL, 0 }
+};
 
 /*********************************************************************
- * @fn      processSrsp
- *
- * @brief  Generic function for processing the SRSP and copying it to
- *         local buffer for SREQ function to deal with
+ * SYNCHRONOUS REQUESTS
  *
- * @param
+ * xxxSync() sends the SREQ, waits up to timeoutMs (0 for the default)
+ * for its SRSP and decodes it into rsp. The SRSP is not passed to the
+ * registered callbacks.
  *
- * @return
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT, MT_RPC_ERR_BUSY or
+ *          MT_RPC_ERR_TRANSPORT
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	//copies sresp to local buffer
-	memcpy(srspRpcBuff, rpcBuff, rpcLen);
-	//srspRpcLen = rpcLen;
-	switch (rpcBuff[1])
-	{
-        case MT_AF_REGISTER:
-            LOG_DBG("afProcess: MT_AF_REGISTER");
-            processAfRegisterSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_AF_DATA_REQUEST:
-            LOG_DBG("afProcess: MT_AF_DATA_REQUEST");
-            processAfDataRequestSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_AF_DATA_REQUEST_EXT:
-            LOG_DBG("afProcess: MT_AF_DATA_REQUEST_EXT");
-            processAfDataRequestExtSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_AF_INTER_PAN_CTL:
-            LOG_DBG("afProcess: MT_AF_INTER_PAN_CTL");
-            processAfInterPanCtlSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_AF_DATA_RETRIEVE:
-            LOG_DBG("afProcess: MT_AF_DATA_RETRIEVE");
-            processDataRetrieveSrsp(rpcBuff, rpcLen);
-            break;
-        default:
-            LOG_WARN("processSrsp: unsupported message [%x:%x]", rpcBuff[0],
-                    rpcBuff[1]);
-            break;
-	}
-
-}
-
+MT_SYNC_REQ(afRegister, RegisterFormat_t, RegisterSrspFormat_t, decodeAfRegisterSrsp)
+MT_SYNC_REQ(afDataRequest, DataRequestFormat_t, DataRequestSrspFormat_t, decodeAfDataRequestSrsp)
+MT_SYNC_REQ(afDataRequestExt, DataRequestExtFormat_t, DataRequestExtSrspFormat_t, decodeAfDataRequestExtSrsp)
+MT_SYNC_REQ(afDataRequestSrcRtg, DataRequestSrcRtgFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(afInterPanCtl, InterPanCtlFormat_t, InterPanCtlSrspFormat_t, decodeAfInterPanCtlSrsp)
+MT_SYNC_REQ(afDataStore, DataStoreFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(afDataRetrieve, DataRetrieveFormat_t, DataRetrieveSrspFormat_t, decodeDataRetrieveSrsp)
+MT_SYNC_REQ(afApsfConfigSet, ApsfConfigSetFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include "mtParser.h"
 
 typedef uint16_t cId_t;
 // Simple Description Format Structure
@@ -134,6 +135,7 @@ typedef struct
 #define afStatus_INVALID_PARAMETER           0x02
 #define afStatus_MEM_FAIL                    0x10
 #define afStatus_NO_ROUTE                    0xCD
+#define afStatus_MAC_NO_ACK                  0xE9
 #define afStatus_DUPLICATE									 0xB8
 
 typedef struct
@@ -266,6 +268,44 @@ typedef struct
 	uint8_t Data[99];
 } IncomingMsgExtFormat_t;
 
+// AF_INCOMING_MSG decoded in place: Data points into the received frame
+// and is only valid until the callback returns
+typedef struct
+{
+	uint16_t GroupId;
+	uint16_t ClusterId;
+	uint16_t SrcAddr;
+	uint8_t SrcEndpoint;
+	uint8_t DstEndpoint;
+	uint8_t WasBroadcast;
+	uint8_t LinkQuality;
+	uint8_t SecurityUse;
+	uint32_t TimeStamp;
+	uint8_t TransSeqNum;
+	uint8_t Len;
+	const uint8_t *Data;
+} IncomingMsgView_t;
+
+// AF_INCOMING_MSG_EXT decoded in place, see IncomingMsgView_t. Data of
+// a message too long for a frame is in a reassembly buffer, see mtAfReasm.h
+typedef struct
+{
+	uint16_t GroupId;
+	uint16_t ClusterId;
+	uint8_t SrcAddrMode;
+	uint64_t SrcAddr;
+	uint8_t SrcEndpoint;
+	uint16_t SrcPanId;
+	uint8_t DstEndpoint;
+	uint8_t WasBroadcast;
+	uint8_t LinkQuality;
+	uint8_t SecurityUse;
+	uint32_t TimeStamp;
+	uint8_t TransSeqNum;
+	uint16_t Len;
+	const uint8_t *Data;
+} IncomingMsgExtView_t;
+
 typedef struct
 {
 	uint8_t TimeStamp[4];
@@ -302,9 +342,12 @@ typedef uint8_t (*mtAfDataRequestExtSrspCb_t)(DataRequestExtSrspFormat_t *msg);
 typedef uint8_t (*mtAfDataConfirmCb_t)(DataConfirmFormat_t *msg);
 typedef uint8_t (*mtAfIncomingMsgCb_t)(IncomingMsgFormat_t *msg);
 typedef uint8_t (*mtAfIncomingMsgExt_t)(IncomingMsgExtFormat_t *msg);
+typedef uint8_t (*mtAfIncomingMsgViewCb_t)(const IncomingMsgView_t *msg);
+typedef uint8_t (*mtAfIncomingMsgExtViewCb_t)(const IncomingMsgExtView_t *msg);
 typedef uint8_t (*mtAfDataRetrieveSrspCb_t)(DataRetrieveSrspFormat_t *msg);
 typedef uint8_t (*mtAfReflectErrorCb_t)(ReflectErrorFormat_t *msg);
 typedef uint8_t (*mtAfInterPanCtlCb_t)(InterPanCtlSrspFormat_t *msg);
+typedef uint8_t (*mtAfDataStoreSrspCb_t)(StatusSrspFormat_t *msg);
 
 typedef struct
 {
@@ -317,18 +360,48 @@ typedef struct
 	mtAfDataRetrieveSrspCb_t pfnAfDataRetrieveSrsp;	    //MT_AF_DATA_RETRIEVE
 	mtAfReflectErrorCb_t pfnAfReflectError;			    //MT_AF_REFLECT_ERROR
     mtAfInterPanCtlCb_t pfnAfInterPanCtlSrsp;
+	mtAfIncomingMsgViewCb_t pfnAfIncomingMsgView;        //MT_AF_INCOMING_MSG, no copy
+	mtAfIncomingMsgExtViewCb_t pfnAfIncomingMsgExtView;  //MT_AF_INCOMING_MSG_EXT, no copy
+	mtAfDataStoreSrspCb_t pfnAfDataStoreSrsp;            //MT_AF_DATA_STORE
 } mtAfCb_t;
 
 void afRegisterCallbacks(mtAfCb_t cbs);
-void afProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+extern const mtHandlerEntry_t afHandlerTable[];
 uint8_t afRegister(RegisterFormat_t *req);
 uint8_t afDataRequest(DataRequestFormat_t *req);
+uint8_t afDataRequestCb(DataRequestFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t afDataRequestExt(DataRequestExtFormat_t *req);
+uint8_t afDataRequestExtCb(DataRequestExtFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t afDataRequestSrcRtg(DataRequestSrcRtgFormat_t *req);
 uint8_t afInterPanCtl(InterPanCtlFormat_t *req);
 uint8_t afDataStore(DataStoreFormat_t *req);
+uint8_t afDataStoreCb(DataStoreFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t afDataRetrieve(DataRetrieveFormat_t *req);
+uint8_t afDataRetrieveCb(DataRetrieveFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t afApsfConfigSet(ApsfConfigSetFormat_t *req);
+void afIncomingMsgExtDeliver(const IncomingMsgExtView_t *view);
+
+// synchronous variants, return the decoded SRSP
+uint8_t afRegisterSync(RegisterFormat_t *req,
+        RegisterSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afDataRequestSync(DataRequestFormat_t *req,
+        DataRequestSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afDataRequestExtSync(DataRequestExtFormat_t *req,
+        DataRequestExtSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afDataRequestSrcRtgSync(DataRequestSrcRtgFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afInterPanCtlSync(InterPanCtlFormat_t *req,
+        InterPanCtlSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afDataStoreSync(DataStoreFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afDataRetrieveSync(DataRetrieveFormat_t *req,
+        DataRetrieveSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t afApsfConfigSetSync(ApsfConfigSetFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
 
 //uint8_t afRegisterExtended(SimpleDescriptionFormat_t *simpleDesc);
 //uint8_t afDataRequest(afAddrType_t *dstAddr, uint8_t srcEP, uint16_t cID,
@@ -0,0 +1,401 @@
+/*
+ * mtAfBatch.c
+ *
+ * Pipelined sending of many AF_DATA_REQUESTs, see mtAfBatch.h. Every
+ * request in the window takes a slot. The SRSP callback moves the slot
+ * on to wait for its AF_DATA_CONFIRM, which a message subscriber matches
+ * by endpoint and TransID. The thread running the batch reaps completed
+ * slots, refills the window and dispatches the message queue meanwhile.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtAfBatch.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define AF_BATCH_POLL_MS    (1)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef enum
+{
+	AF_BATCH_FREE,
+	AF_BATCH_SRSP,      // sent, waiting for the SRSP
+	AF_BATCH_CONFIRM,   // SRSP ok, waiting for AF_DATA_CONFIRM
+	AF_BATCH_DONE       // status known, to be reported
+} afBatchState_t;
+
+typedef struct
+{
+	uint8_t state;      // afBatchState_t
+	uint8_t status;
+	uint8_t endpoint;
+	uint8_t transId;
+	uint16_t index;     // message in the caller's array
+	uint64_t deadline;  // AF_BATCH_CONFIRM: confirm timeout
+} afBatchSlot_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t afBatchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t afBatchCond = PTHREAD_COND_INITIALIZER;
+static uint8_t afBatchActive;
+static uint32_t afBatchConfirmTimeoutMs;
+static afBatchSlot_t afBatchSlots[AF_BATCH_MAX_WINDOW];
+static uint16_t afBatchDone;   // slots in AF_BATCH_DONE
+
+// next TransID handed out, kept across batches
+static uint8_t afBatchTransId;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afBatchNowMs
+ *
+ * @brief   monotonic time in ms, used for the confirm deadlines
+ */
+static uint64_t afBatchNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      afBatchComplete
+ *
+ * @brief   Record the outcome of a slot and wake the batch thread. Called
+ *          with afBatchLock held.
+ */
+static void afBatchComplete(afBatchSlot_t *slot, uint8_t status)
+{
+	slot->status = status;
+	slot->state = AF_BATCH_DONE;
+	afBatchDone++;
+	pthread_cond_signal(&afBatchCond);
+}
+
+/*********************************************************************
+ * @fn      afBatchSrsp
+ *
+ * @brief   SRSP callback of a batch request. A request the ZNP refused is
+ *          complete, the others wait for their confirm.
+ */
+static void afBatchSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	afBatchSlot_t *slot = (afBatchSlot_t *) cbArg;
+
+	pthread_mutex_lock(&afBatchLock);
+	if (slot->state == AF_BATCH_SRSP)
+	{
+		if (status != MT_RPC_SUCCESS)
+		{
+			afBatchComplete(slot, status);
+		}
+		else if (MT_CHECK_LEN(srsp, srspLen, 1) != MT_RPC_SUCCESS)
+		{
+			afBatchComplete(slot, MT_RPC_ERR_LENGTH);
+		}
+		else if (srsp[2] != afStatus_SUCCESS)
+		{
+			afBatchComplete(slot, srsp[2]);
+		}
+		else
+		{
+			slot->state = AF_BATCH_CONFIRM;
+			slot->deadline = afBatchNowMs() + afBatchConfirmTimeoutMs;
+		}
+	}
+	pthread_mutex_unlock(&afBatchLock);
+}
+
+/*********************************************************************
+ * @fn      afBatchConfirm
+ *
+ * @brief   AF_DATA_CONFIRM subscriber, completes the slot with the same
+ *          endpoint and TransID. Confirms of other requests are ignored.
+ */
+static void afBatchConfirm(uint8_t *rpcBuff, uint8_t rpcLen,
+        void *cbArg __attribute__((unused)))
+{
+	uint8_t idx;
+
+	// Status, Endpoint, TransId
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 3) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&afBatchLock);
+	for (idx = 0; afBatchActive && (idx < AF_BATCH_MAX_WINDOW); idx++)
+	{
+		afBatchSlot_t *slot = &afBatchSlots[idx];
+
+		if ((slot->state == AF_BATCH_CONFIRM) && (slot->endpoint == rpcBuff[3])
+		        && (slot->transId == rpcBuff[4]))
+		{
+			afBatchComplete(slot, rpcBuff[2]);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&afBatchLock);
+}
+
+/*********************************************************************
+ * @fn      afBatchNextTransId
+ *
+ * @brief   Next TransID not in use by a slot of endpoint. Called with
+ *          afBatchLock held, the window is smaller than the ID space.
+ */
+static uint8_t afBatchNextTransId(uint8_t endpoint)
+{
+	uint8_t idx;
+
+	for (;;)
+	{
+		uint8_t transId = afBatchTransId++;
+
+		for (idx = 0; idx < AF_BATCH_MAX_WINDOW; idx++)
+		{
+			if ((afBatchSlots[idx].state != AF_BATCH_FREE)
+			        && (afBatchSlots[idx].endpoint == endpoint)
+			        && (afBatchSlots[idx].transId == transId))
+			{
+				break;
+			}
+		}
+		if (idx == AF_BATCH_MAX_WINDOW)
+		{
+			return transId;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      afBatchWait
+ *
+ * @brief   Let the batch make progress: read the transport if no thread
+ *          does, dispatch the queued messages, then wait a little for a
+ *          completion. Called with afBatchLock held.
+ */
+static void afBatchWait(void)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&afBatchLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&afBatchLock);
+	if (afBatchDone)
+	{
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += AF_BATCH_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&afBatchCond, &afBatchLock, &ts);
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afDataRequestBatch
+ *
+ * @brief   Send count AF_DATA_REQUESTs, keeping up to cfg->window of them
+ *          waiting for their AF_DATA_CONFIRM, and return once every one
+ *          has completed. The TransID of each request is assigned here so
+ *          that confirms can be matched, the one in reqs is ignored.
+ *          Runs in the thread that dispatches the message queue: while
+ *          waiting it reads the transport if no thread does and
+ *          dispatches the queued messages, so the registered callbacks
+ *          keep running. cfg->cb is called from this thread. One batch
+ *          runs at a time.
+ *
+ * @param   reqs - requests
+ * @param   count - number of requests
+ * @param   cfg - window, timeouts and completion callback, NULL for the
+ *          defaults
+ * @param   results - count outcomes, can be NULL
+ *
+ * @return  number of messages confirmed with afStatus_SUCCESS, -1 if
+ *          another batch is running or the subscription failed
+ */
+int32_t afDataRequestBatch(const DataRequestFormat_t *reqs, uint16_t count,
+        const afBatchConfig_t *cfg, afBatchResult_t *results)
+{
+	afBatchConfig_t conf;
+	uint16_t next = 0, inFlight = 0, idx;
+	int32_t delivered = 0;
+
+	memset(&conf, 0, sizeof(conf));
+	if (cfg)
+	{
+		conf = *cfg;
+	}
+	if ((conf.window == 0) || (conf.window > AF_BATCH_MAX_WINDOW))
+	{
+		conf.window = (conf.window == 0) ?
+		        AF_BATCH_DEFAULT_WINDOW : AF_BATCH_MAX_WINDOW;
+	}
+	if (results)
+	{
+		memset(results, 0, count * sizeof(afBatchResult_t));
+	}
+
+	pthread_mutex_lock(&afBatchLock);
+	if (afBatchActive)
+	{
+		pthread_mutex_unlock(&afBatchLock);
+		LOG_ERR("A batch is already running");
+		return -1;
+	}
+	afBatchActive = 1;
+	afBatchConfirmTimeoutMs = conf.confirmTimeoutMs ?
+	        conf.confirmTimeoutMs : AF_BATCH_CONFIRM_TIMEOUT_MS;
+	memset(afBatchSlots, 0, sizeof(afBatchSlots));
+	afBatchDone = 0;
+	pthread_mutex_unlock(&afBatchLock);
+
+	if (mtSubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM, afBatchConfirm, NULL)
+	        != MT_RPC_SUCCESS)
+	{
+		pthread_mutex_lock(&afBatchLock);
+		afBatchActive = 0;
+		pthread_mutex_unlock(&afBatchLock);
+		return -1;
+	}
+
+	pthread_mutex_lock(&afBatchLock);
+	while ((next < count) || (inFlight > 0))
+	{
+		uint8_t busy = 0;
+		uint64_t now = afBatchNowMs();
+
+		// report the completed messages and time out lost confirms
+		for (idx = 0; idx < AF_BATCH_MAX_WINDOW; idx++)
+		{
+			afBatchSlot_t *slot = &afBatchSlots[idx];
+			uint16_t index;
+			uint8_t status;
+
+			if ((slot->state == AF_BATCH_CONFIRM) && (slot->deadline <= now))
+			{
+				LOG_WARN("No AF_DATA_CONFIRM for ep %d trans %d",
+				        slot->endpoint, slot->transId);
+				afBatchComplete(slot, MT_RPC_ERR_TIMEOUT);
+			}
+			if (slot->state != AF_BATCH_DONE)
+			{
+				continue;
+			}
+
+			index = slot->index;
+			status = slot->status;
+			if (results)
+			{
+				results[index].status = status;
+				results[index].transId = slot->transId;
+				results[index].done = 1;
+			}
+			if (status == afStatus_SUCCESS)
+			{
+				delivered++;
+			}
+			slot->state = AF_BATCH_FREE;
+			afBatchDone--;
+			inFlight--;
+
+			if (conf.cb)
+			{
+				pthread_mutex_unlock(&afBatchLock);
+				conf.cb(index, status, conf.cbArg);
+				pthread_mutex_lock(&afBatchLock);
+			}
+		}
+
+		// fill the window
+		while ((next < count) && (inFlight < conf.window) && !busy)
+		{
+			DataRequestFormat_t req;
+			afBatchSlot_t *slot = NULL;
+			uint8_t status;
+
+			for (idx = 0; idx < AF_BATCH_MAX_WINDOW; idx++)
+			{
+				if (afBatchSlots[idx].state == AF_BATCH_FREE)
+				{
+					slot = &afBatchSlots[idx];
+					break;
+				}
+			}
+
+			req = reqs[next];
+			req.TransID = afBatchNextTransId(req.SrcEndpoint);
+			slot->state = AF_BATCH_SRSP;
+			slot->endpoint = req.SrcEndpoint;
+			slot->transId = req.TransID;
+			slot->index = next;
+			inFlight++;
+
+			// unlocked, the SRSP callback may run before this returns
+			pthread_mutex_unlock(&afBatchLock);
+			status = afDataRequestCb(&req, conf.srspTimeoutMs, afBatchSrsp,
+			        slot);
+			pthread_mutex_lock(&afBatchLock);
+
+			if (status == MT_RPC_ERR_BUSY)
+			{
+				// SREQ table or SRSP lane full, retry once some complete
+				slot->state = AF_BATCH_FREE;
+				inFlight--;
+				busy = 1;
+			}
+			else
+			{
+				if (status != MT_RPC_SUCCESS)
+				{
+					afBatchComplete(slot, status);
+				}
+				next++;
+			}
+		}
+
+		if ((next < count) || (inFlight > 0))
+		{
+			afBatchWait();
+		}
+	}
+	afBatchActive = 0;
+	pthread_mutex_unlock(&afBatchLock);
+
+	mtUnsubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM, afBatchConfirm, NULL);
+
+	return delivered;
+}
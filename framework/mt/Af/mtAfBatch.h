@@ -0,0 +1,65 @@
+/*
+ * mtAfBatch.h
+ *
+ * Pipelined sending of many AF_DATA_REQUESTs. Up to a window of requests
+ * wait for their AF_DATA_CONFIRM at once, each confirm is matched to its
+ * request by source endpoint and TransID.
+ */
+
+#ifndef MTAFBATCH_H
+#define MTAFBATCH_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define AF_BATCH_MAX_WINDOW            (128)
+#define AF_BATCH_DEFAULT_WINDOW        (8)
+#define AF_BATCH_CONFIRM_TIMEOUT_MS    (10000)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// completion of message index, status is the AF_DATA_CONFIRM status, the
+// SRSP status if it was not afStatus_SUCCESS, or MT_RPC_ERR_TIMEOUT and
+// the other host side errors
+typedef void (*afBatchCb_t)(uint16_t index, uint8_t status, void *cbArg);
+
+typedef struct
+{
+	uint8_t window;            // requests awaiting a confirm, 0 for the default
+	uint32_t srspTimeoutMs;    // 0 for the default SRSP timeout
+	uint32_t confirmTimeoutMs; // SRSP -> confirm, 0 for the default
+	afBatchCb_t cb;            // can be NULL
+	void *cbArg;               // passed back to cb
+} afBatchConfig_t;
+
+// outcome of one message, valid once done is set
+typedef struct
+{
+	uint8_t done;
+	uint8_t status;
+	uint8_t transId;           // TransID the request was sent with
+} afBatchResult_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t afDataRequestBatch(const DataRequestFormat_t *reqs, uint16_t count,
+        const afBatchConfig_t *cfg, afBatchResult_t *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTAFBATCH_H */
@@ -0,0 +1,476 @@
+/*
+ * mtAfReasm.c
+ *
+ * Reassembly of AF messages larger than a frame, see mtAfReasm.h. The
+ * retrieves of a message are pipelined: the SRSP callback of one, called
+ * by the thread reading the transport, copies its chunk and sends the
+ * next. Retrieves are sent with afReasmLock held so that they go out in
+ * the order their SRSPs are matched. The complete message is delivered
+ * from the thread dispatching the message queue, when the SRSP of its
+ * last retrieve is dispatched. The SRSPs of the retrieves are hidden
+ * from the AF_DATA_RETRIEVE SRSP callback of the application.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <string.h>
+
+#include "mtAfReasm.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+enum
+{
+	AF_REASM_FREE,
+	AF_REASM_ACTIVE,   // retrieving the data
+	AF_REASM_DONE,     // data complete, to be delivered
+	AF_REASM_DELIVER   // in the callbacks
+};
+
+typedef struct afReasmSlot afReasmSlot_t;
+
+// one AF_DATA_RETRIEVE awaiting its SRSP
+typedef struct
+{
+	afReasmSlot_t *slot;
+	uint16_t index;
+	uint8_t len;
+	uint8_t inUse;
+} afReasmReq_t;
+
+struct afReasmSlot
+{
+	uint8_t state;
+	uint8_t status;        // first failure
+	uint8_t outstanding;   // retrieves awaiting their SRSP
+	uint16_t next;         // first byte not requested yet
+	uint16_t received;
+	IncomingMsgExtView_t msg;
+	afReasmReq_t reqs[AF_REASM_MAX_WINDOW];
+	uint8_t data[AF_REASM_MAX_LEN];
+};
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t afReasmLock = PTHREAD_MUTEX_INITIALIZER;
+static afReasmConfig_t afReasmConf = { AF_REASM_MAX_CHUNK,
+        AF_REASM_DEFAULT_WINDOW, 0 };
+static afReasmStats_t afReasmStats;
+static uint8_t afReasmInflight;
+static uint16_t afReasmQueued;   // SRSPs queued, each calls afReasmPoll()
+static afReasmSlot_t afReasmPool[AF_REASM_POOL_SIZE];
+// time stamps of the ZNP buffers whose free was refused, sent again with
+// the next retrieves
+static uint32_t afReasmUnfreed[AF_REASM_POOL_SIZE];
+static uint8_t afReasmUnfreedCnt;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void afReasmSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg);
+
+/*********************************************************************
+ * @fn      afReasmSend
+ *
+ * @brief   Send one AF_DATA_RETRIEVE of a message
+ *
+ * @param   timeStamp - time stamp of the message, identifies the ZNP
+ *          buffer
+ * @param   index - first byte
+ * @param   len - bytes, 0 frees the ZNP buffer
+ * @param   cbArg - request passed to the SRSP callback, NULL if the SRSP
+ *          is not waited for
+ *
+ * @return  status
+ */
+static uint8_t afReasmSend(uint32_t timeStamp, uint16_t index, uint8_t len,
+        afReasmReq_t *cbArg)
+{
+	DataRetrieveFormat_t req;
+
+	req.TimeStamp[0] = (uint8_t) timeStamp;
+	req.TimeStamp[1] = (uint8_t) (timeStamp >> 8);
+	req.TimeStamp[2] = (uint8_t) (timeStamp >> 16);
+	req.TimeStamp[3] = (uint8_t) (timeStamp >> 24);
+	req.Index = index;
+	req.Length = len;
+
+	// a callback is always given, a NULL one could take the SRSP of a
+	// synchronous request armed by another thread
+	return afDataRetrieveCb(&req, afReasmConf.srspTimeoutMs, afReasmSrsp,
+	        cbArg);
+}
+
+/*********************************************************************
+ * @fn      afReasmFree
+ *
+ * @brief   Free a ZNP buffer with a zero length retrieve. A free refused
+ *          for a full queue is kept to be sent again while an SRSP of
+ *          the reassembly is still to come. Called with afReasmLock held.
+ *
+ * @param   timeStamp - time stamp of the message
+ *
+ * @return  0 if the free was refused and kept, else 1
+ */
+static uint8_t afReasmFree(uint32_t timeStamp)
+{
+	uint8_t status = afReasmSend(timeStamp, 0, 0, NULL);
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		return 1;
+	}
+	if ((status == MT_RPC_ERR_BUSY)
+	        && ((afReasmInflight > 0) || (afReasmQueued > 0))
+	        && (afReasmUnfreedCnt < AF_REASM_POOL_SIZE))
+	{
+		afReasmUnfreed[afReasmUnfreedCnt++] = timeStamp;
+		return 0;
+	}
+
+	// the ZNP frees it on its own timeout
+	LOG_WARN("Buffer of AF message %08X not freed", timeStamp);
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      afReasmRelease
+ *
+ * @brief   Free the ZNP buffer of a message and its slot. Called with
+ *          afReasmLock held once no retrieve is outstanding.
+ *
+ * @param   slot - message
+ * @param   state - AF_REASM_DONE to keep the data for delivery, else
+ *          AF_REASM_FREE
+ */
+static void afReasmRelease(afReasmSlot_t *slot, uint8_t state)
+{
+	afReasmFree(slot->msg.TimeStamp);
+	slot->state = state;
+}
+
+/*********************************************************************
+ * @fn      afReasmFill
+ *
+ * @brief   Send the retrieves of a message until its window or the
+ *          in flight budget is full. Called with afReasmLock held.
+ *
+ * @param   slot - message
+ */
+static void afReasmFill(afReasmSlot_t *slot)
+{
+	while ((slot->status == MT_RPC_SUCCESS) && (slot->next < slot->msg.Len)
+	        && (slot->outstanding < afReasmConf.window)
+	        && (afReasmInflight < AF_REASM_MAX_INFLIGHT))
+	{
+		afReasmReq_t *req = slot->reqs;
+		uint8_t status;
+
+		while (req->inUse)
+		{
+			req++;
+		}
+		req->slot = slot;
+		req->index = slot->next;
+		req->len = ((slot->msg.Len - slot->next) > afReasmConf.chunkLen) ?
+		        afReasmConf.chunkLen : (slot->msg.Len - slot->next);
+		req->inUse = 1;
+		slot->outstanding++;
+		afReasmInflight++;
+
+		status = afReasmSend(slot->msg.TimeStamp, req->index, req->len, req);
+		if (status == MT_RPC_SUCCESS)
+		{
+			slot->next += req->len;
+		}
+		else
+		{
+			req->inUse = 0;
+			slot->outstanding--;
+			afReasmInflight--;
+			// a refused retrieve is retried from the SRSP callback or when
+			// a queued SRSP is dispatched, fail if none will come
+			if ((status != MT_RPC_ERR_BUSY)
+			        || ((afReasmInflight == 0) && (afReasmQueued == 0)))
+			{
+				slot->status = status;
+			}
+			break;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      afReasmService
+ *
+ * @brief   Keep the retrieves of every message going and release the
+ *          messages that completed or failed. Called with afReasmLock
+ *          held.
+ */
+static void afReasmService(void)
+{
+	uint8_t idx;
+
+	// frees refused earlier, in order, until one is refused again
+	while (afReasmUnfreedCnt > 0)
+	{
+		uint32_t timeStamp = afReasmUnfreed[0];
+
+		afReasmUnfreedCnt--;
+		memmove(&afReasmUnfreed[0], &afReasmUnfreed[1],
+		        afReasmUnfreedCnt * sizeof(afReasmUnfreed[0]));
+		if (!afReasmFree(timeStamp))
+		{
+			break;
+		}
+	}
+
+	for (idx = 0; idx < AF_REASM_POOL_SIZE; idx++)
+	{
+		afReasmSlot_t *slot = &afReasmPool[idx];
+
+		if (slot->state != AF_REASM_ACTIVE)
+		{
+			continue;
+		}
+		afReasmFill(slot);
+		if (slot->outstanding > 0)
+		{
+			continue;
+		}
+		if (slot->status != MT_RPC_SUCCESS)
+		{
+			LOG_ERR("AF_DATA_RETRIEVE of %08X failed at %d of %d bytes: %02X",
+			        slot->msg.TimeStamp, slot->received, slot->msg.Len,
+			        slot->status);
+			afReasmStats.failed++;
+			afReasmRelease(slot, AF_REASM_FREE);
+		}
+		else if (slot->received == slot->msg.Len)
+		{
+			afReasmRelease(slot, AF_REASM_DONE);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      afReasmSrsp
+ *
+ * @brief   SRSP callback of the retrieves, copies the chunk and sends
+ *          the next retrieves
+ */
+static void afReasmSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	afReasmReq_t *req = (afReasmReq_t *) cbArg;
+	afReasmSlot_t *slot;
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		// the SRSP is queued, not for the application
+		rpcSrspHide();
+		pthread_mutex_lock(&afReasmLock);
+		afReasmQueued++;
+		pthread_mutex_unlock(&afReasmLock);
+	}
+
+	if (req == NULL)
+	{
+		// zero length retrieve freeing a ZNP buffer
+		return;
+	}
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		// status, length and data
+		if (MT_CHECK_LEN(srsp, srspLen, 1) != MT_RPC_SUCCESS)
+		{
+			status = MT_RPC_ERR_LENGTH;
+		}
+		else if (srsp[2] != MT_RPC_SUCCESS)
+		{
+			status = srsp[2];
+		}
+		else if ((srsp[3] != req->len)
+		        || (MT_CHECK_LEN(srsp, srspLen, 2 + req->len)
+		                != MT_RPC_SUCCESS))
+		{
+			status = MT_RPC_ERR_LENGTH;
+		}
+	}
+
+	pthread_mutex_lock(&afReasmLock);
+	slot = req->slot;
+	if (status == MT_RPC_SUCCESS)
+	{
+		memcpy(&slot->data[req->index], &srsp[4], req->len);
+		slot->received += req->len;
+		afReasmStats.bytes += req->len;
+		afReasmStats.retrieves++;
+	}
+	else if (slot->status == MT_RPC_SUCCESS)
+	{
+		slot->status = status;
+	}
+	req->inUse = 0;
+	slot->outstanding--;
+	afReasmInflight--;
+
+	afReasmService();
+	pthread_mutex_unlock(&afReasmLock);
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afReasmConfigure
+ *
+ * @brief   Set the chunk size, window and SRSP timeout of the retrieves.
+ *          Takes effect with the next retrieve sent.
+ *
+ * @param   cfg - new configuration, NULL for the defaults
+ */
+void afReasmConfigure(const afReasmConfig_t *cfg)
+{
+	pthread_mutex_lock(&afReasmLock);
+	memset(&afReasmConf, 0, sizeof(afReasmConf));
+	if (cfg)
+	{
+		afReasmConf = *cfg;
+	}
+	if ((afReasmConf.chunkLen == 0)
+	        || (afReasmConf.chunkLen > AF_REASM_MAX_CHUNK))
+	{
+		afReasmConf.chunkLen = AF_REASM_MAX_CHUNK;
+	}
+	if (afReasmConf.window == 0)
+	{
+		afReasmConf.window = AF_REASM_DEFAULT_WINDOW;
+	}
+	else if (afReasmConf.window > AF_REASM_MAX_WINDOW)
+	{
+		afReasmConf.window = AF_REASM_MAX_WINDOW;
+	}
+	pthread_mutex_unlock(&afReasmLock);
+}
+
+/*********************************************************************
+ * @fn      afReasmGetStats
+ *
+ * @brief   Copy the reassembly counters.
+ */
+void afReasmGetStats(afReasmStats_t *stats)
+{
+	pthread_mutex_lock(&afReasmLock);
+	*stats = afReasmStats;
+	pthread_mutex_unlock(&afReasmLock);
+}
+
+/*********************************************************************
+ * @fn      afReasmStart
+ *
+ * @brief   Start retrieving the data of an AF_INCOMING_MSG_EXT that came
+ *          without it. Called by the AF_INCOMING_MSG_EXT handler.
+ *
+ * @param   msg - message header
+ *
+ * @return  MT_RPC_SUCCESS if the message will be delivered once complete,
+ *          else it is to be delivered now without data and the ZNP keeps
+ *          the buffer for the application
+ */
+uint8_t afReasmStart(const IncomingMsgExtView_t *msg)
+{
+	afReasmSlot_t *slot = NULL;
+	uint8_t status = MT_RPC_SUCCESS;
+	uint8_t idx;
+
+	pthread_mutex_lock(&afReasmLock);
+	for (idx = 0; (idx < AF_REASM_POOL_SIZE) && (msg->Len <= AF_REASM_MAX_LEN);
+	        idx++)
+	{
+		if (afReasmPool[idx].state == AF_REASM_FREE)
+		{
+			slot = &afReasmPool[idx];
+			break;
+		}
+	}
+	if (slot == NULL)
+	{
+		LOG_WARN("No buffer for AF message %08X of %d bytes", msg->TimeStamp,
+		        msg->Len);
+		afReasmStats.noBuffer++;
+		pthread_mutex_unlock(&afReasmLock);
+		return MT_RPC_ERR_BUSY;
+	}
+
+	memset(slot->reqs, 0, sizeof(slot->reqs));
+	slot->msg = *msg;
+	slot->msg.Data = slot->data;
+	slot->status = MT_RPC_SUCCESS;
+	slot->outstanding = 0;
+	slot->next = 0;
+	slot->received = 0;
+	slot->state = AF_REASM_ACTIVE;
+
+	afReasmFill(slot);
+	if ((slot->outstanding == 0) && (slot->status != MT_RPC_SUCCESS))
+	{
+		// nothing went out and no SRSP will drive the retrieval, else it
+		// starts when the retrieves of other messages free the budget
+		status = slot->status;
+		LOG_ERR("AF_DATA_RETRIEVE of %08X not sent: %02X", msg->TimeStamp,
+		        status);
+		afReasmStats.failed++;
+		slot->state = AF_REASM_FREE;
+	}
+	pthread_mutex_unlock(&afReasmLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      afReasmPoll
+ *
+ * @brief   Deliver the messages whose data is complete and resend the
+ *          retrieves refused for a full queue. Called when the
+ *          AF_DATA_RETRIEVE SRSP of a reassembly is dispatched.
+ */
+void afReasmPoll(void)
+{
+	uint8_t idx;
+
+	pthread_mutex_lock(&afReasmLock);
+	if (afReasmQueued > 0)
+	{
+		afReasmQueued--;
+	}
+	afReasmService();
+	for (idx = 0; idx < AF_REASM_POOL_SIZE; idx++)
+	{
+		afReasmSlot_t *slot = &afReasmPool[idx];
+
+		if (slot->state == AF_REASM_DONE)
+		{
+			// Data stays valid until the callbacks return
+			slot->state = AF_REASM_DELIVER;
+			pthread_mutex_unlock(&afReasmLock);
+			afIncomingMsgExtDeliver(&slot->msg);
+			pthread_mutex_lock(&afReasmLock);
+			afReasmStats.messages++;
+			slot->state = AF_REASM_FREE;
+		}
+	}
+	pthread_mutex_unlock(&afReasmLock);
+}
@@ -0,0 +1,79 @@
+/*
+ * mtAfReasm.h
+ *
+ * Receiving AF messages larger than a frame. The ZNP keeps their data and
+ * sends an AF_INCOMING_MSG_EXT without it. The host fetches the data with
+ * pipelined AF_DATA_RETRIEVEs into a pooled buffer, frees the ZNP buffer
+ * with a zero length retrieve and delivers the complete message to the
+ * AF_INCOMING_MSG_EXT callbacks. This happens automatically, the
+ * application only sees complete messages.
+ */
+
+#ifndef MTAFREASM_H
+#define MTAFREASM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// messages being retrieved at once
+#ifndef AF_REASM_POOL_SIZE
+#define AF_REASM_POOL_SIZE         (4)
+#endif
+// longest message retrieved, longer ones are delivered without data
+#ifndef AF_REASM_MAX_LEN
+#define AF_REASM_MAX_LEN           (4096)
+#endif
+
+// data bytes of the largest AF_DATA_RETRIEVE SRSP
+#define AF_REASM_MAX_CHUNK         (248)
+#define AF_REASM_DEFAULT_WINDOW    (4)
+#define AF_REASM_MAX_WINDOW        (8)
+// retrieves awaiting their SRSP over all messages, half the SRSP lane
+#define AF_REASM_MAX_INFLIGHT      (8)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t chunkLen;          // bytes per retrieve, 0 for AF_REASM_MAX_CHUNK
+	uint8_t window;            // retrieves awaiting their SRSP per message,
+	                           // 0 for the default
+	uint32_t srspTimeoutMs;    // 0 for the default SRSP timeout
+} afReasmConfig_t;
+
+typedef struct
+{
+	uint32_t messages;         // messages delivered complete
+	uint32_t bytes;            // data bytes retrieved
+	uint32_t retrieves;        // AF_DATA_RETRIEVEs acknowledged
+	uint32_t failed;           // retrieves that failed, message dropped
+	uint32_t noBuffer;         // delivered without data: pool full or too long
+} afReasmStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void afReasmConfigure(const afReasmConfig_t *cfg);
+void afReasmGetStats(afReasmStats_t *stats);
+
+// hooks of the mtAf message handlers
+uint8_t afReasmStart(const IncomingMsgExtView_t *msg);
+void afReasmPoll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTAFREASM_H */
@@ -0,0 +1,552 @@
+/*
+ * mtAfRoute.c
+ *
+ * Source route cache, see mtAfRoute.h. Routes are kept in a dense array
+ * indexed by destination with an open addressing hash table. Messages
+ * sent through a route are remembered under their TransID until their
+ * AF_DATA_CONFIRM, taken from a subscriber, tells whether the route
+ * still works.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtAfRoute.h"
+#include "mtZdo.h"
+#include "mtParser.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// NWK addresses above this are broadcast or invalid
+#define AF_ROUTE_MAX_NWK_ADDR   (0xFFF7)
+
+// AF_DATA_REQUEST_SRC_RTG payload besides the relays and data
+#define AF_ROUTE_REQ_HDR_LEN    (11)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// message sent through a route, awaiting its AF_DATA_CONFIRM
+typedef struct
+{
+	uint8_t inUse;
+	uint8_t endpoint;
+	uint16_t dstAddr;
+	uint64_t sentMs;
+} afRouteSent_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t afRouteLock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint8_t afRouteActive;
+static afRouteConfig_t afRouteConf;
+static afRouteStats_t afRouteStats;
+
+static afRoute_t *afRouteEntries;
+static uint32_t afRouteCount;
+// slots holding an entry index + 1
+static uint32_t *afRouteIndex;
+static uint32_t afRouteMask;
+
+// by TransID
+static afRouteSent_t afRouteSent[256];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afRouteNowMs
+ *
+ * @brief   monotonic time in ms
+ */
+static uint64_t afRouteNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      afRouteHome
+ *
+ * @brief   first slot probed for a destination
+ */
+static uint32_t afRouteHome(uint16_t dstAddr)
+{
+	return (uint32_t) ((dstAddr * 2654435761u) >> 16) & afRouteMask;
+}
+
+/*********************************************************************
+ * @fn      afRouteProbe
+ *
+ * @brief   Slot of a destination: the one holding it, else the empty slot
+ *          where it goes. Called with afRouteLock held.
+ */
+static uint32_t afRouteProbe(uint16_t dstAddr)
+{
+	uint32_t pos = afRouteHome(dstAddr);
+
+	while (afRouteIndex[pos]
+	        && (afRouteEntries[afRouteIndex[pos] - 1].dstAddr != dstAddr))
+	{
+		pos = (pos + 1) & afRouteMask;
+	}
+
+	return pos;
+}
+
+/*********************************************************************
+ * @fn      afRouteFind
+ *
+ * @brief   Route of a destination. Called with afRouteLock held.
+ *
+ * @return  its index, -1 if none
+ */
+static int32_t afRouteFind(uint16_t dstAddr)
+{
+	uint32_t slot = afRouteIndex[afRouteProbe(dstAddr)];
+
+	return slot ? (int32_t) (slot - 1) : -1;
+}
+
+/*********************************************************************
+ * @fn      afRouteDrop
+ *
+ * @brief   Remove a route, the last one takes its place. The index entries
+ *          probed after it move back so that no lookup stops early.
+ *          Called with afRouteLock held.
+ */
+static void afRouteDrop(uint32_t idx)
+{
+	uint32_t hole = afRouteProbe(afRouteEntries[idx].dstAddr);
+	uint32_t pos = hole;
+	uint32_t last = afRouteCount - 1;
+
+	for (;;)
+	{
+		uint32_t home;
+
+		pos = (pos + 1) & afRouteMask;
+		if (afRouteIndex[pos] == 0)
+		{
+			break;
+		}
+
+		// an entry may fill the hole if the hole lies between its home
+		// slot and its slot
+		home = afRouteHome(afRouteEntries[afRouteIndex[pos] - 1].dstAddr);
+		if (((pos - home) & afRouteMask) >= ((pos - hole) & afRouteMask))
+		{
+			afRouteIndex[hole] = afRouteIndex[pos];
+			hole = pos;
+		}
+	}
+	afRouteIndex[hole] = 0;
+
+	if (idx != last)
+	{
+		afRouteEntries[idx] = afRouteEntries[last];
+		afRouteIndex[afRouteProbe(afRouteEntries[idx].dstAddr)] = idx + 1;
+	}
+	afRouteCount--;
+}
+
+/*********************************************************************
+ * @fn      afRouteFresh
+ *
+ * @brief   Route of a destination that may still be used, an expired one
+ *          is dropped. Called with afRouteLock held.
+ *
+ * @return  its index, -1 if none
+ */
+static int32_t afRouteFresh(uint16_t dstAddr)
+{
+	int32_t idx = afRouteFind(dstAddr);
+
+	if ((idx >= 0) && (afRouteNowMs() - afRouteEntries[idx].updatedMs
+	        > afRouteConf.maxAgeMs))
+	{
+		afRouteDrop(idx);
+		afRouteStats.expired++;
+		idx = -1;
+	}
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      afRouteConfirm
+ *
+ * @brief   AF_DATA_CONFIRM subscriber: drops the route of a message that
+ *          could not be delivered through it, unless a newer route record
+ *          replaced it meanwhile.
+ */
+static void afRouteConfirm(uint8_t *rpcBuff, uint8_t rpcLen,
+        void *cbArg __attribute__((unused)))
+{
+	afRouteSent_t *sent;
+	uint8_t status;
+	int32_t idx;
+
+	// Status, Endpoint, TransId
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 3) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+	status = rpcBuff[2];
+
+	pthread_mutex_lock(&afRouteLock);
+	sent = &afRouteSent[rpcBuff[4]];
+	if (afRouteActive && sent->inUse && (sent->endpoint == rpcBuff[3]))
+	{
+		sent->inUse = 0;
+		if ((status == afStatus_NO_ROUTE) || (status == afStatus_MAC_NO_ACK))
+		{
+			idx = afRouteFind(sent->dstAddr);
+			if ((idx >= 0) && (afRouteEntries[idx].updatedMs <= sent->sentMs))
+			{
+				LOG_INF("Source route to %04X failed, status %02X",
+				        sent->dstAddr, status);
+				afRouteDrop(idx);
+				afRouteStats.invalidations++;
+			}
+		}
+	}
+	pthread_mutex_unlock(&afRouteLock);
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afRouteEnable
+ *
+ * @brief   Start caching the source routes reported by the ZNP. Called
+ *          again, it applies the new maximum age, the capacity is kept
+ *          until the cache is disabled.
+ *
+ * @param   cfg - configuration, NULL for the defaults
+ *
+ * @return  MT_RPC_SUCCESS, AF_ROUTE_ERR_NO_MEMORY, MT_RPC_ERR_BUSY if the
+ *          confirm subscription failed
+ */
+uint8_t afRouteEnable(const afRouteConfig_t *cfg)
+{
+	uint32_t capacity = (cfg && cfg->capacity) ?
+	        cfg->capacity : AF_ROUTE_DEFAULT_CAPACITY;
+	uint32_t size = 1;
+	uint8_t status;
+
+	pthread_mutex_lock(&afRouteLock);
+	afRouteConf.maxAgeMs = (cfg && cfg->maxAgeMs) ?
+	        cfg->maxAgeMs : AF_ROUTE_MAX_AGE_MS;
+	if (afRouteActive)
+	{
+		pthread_mutex_unlock(&afRouteLock);
+		return MT_RPC_SUCCESS;
+	}
+
+	// index at most half full
+	while (size < capacity * 2)
+	{
+		size *= 2;
+	}
+	afRouteEntries = malloc(capacity * sizeof(afRoute_t));
+	afRouteIndex = calloc(size, sizeof(uint32_t));
+	if (!afRouteEntries || !afRouteIndex)
+	{
+		free(afRouteEntries);
+		free(afRouteIndex);
+		afRouteEntries = NULL;
+		afRouteIndex = NULL;
+		pthread_mutex_unlock(&afRouteLock);
+		LOG_ERR("No memory for %u routes", capacity);
+		return AF_ROUTE_ERR_NO_MEMORY;
+	}
+
+	status = mtSubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM, afRouteConfirm,
+	        NULL);
+	if (status != MT_RPC_SUCCESS)
+	{
+		free(afRouteEntries);
+		free(afRouteIndex);
+		afRouteEntries = NULL;
+		afRouteIndex = NULL;
+		pthread_mutex_unlock(&afRouteLock);
+		return status;
+	}
+
+	afRouteConf.capacity = capacity;
+	afRouteMask = size - 1;
+	afRouteCount = 0;
+	memset(afRouteSent, 0, sizeof(afRouteSent));
+	afRouteActive = 1;
+	pthread_mutex_unlock(&afRouteLock);
+
+	mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, MT_ZDO_SRC_RTG_IND, 1);
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      afRouteDisable
+ *
+ * @brief   Stop caching and forget the routes.
+ */
+void afRouteDisable(void)
+{
+	pthread_mutex_lock(&afRouteLock);
+	if (!afRouteActive)
+	{
+		pthread_mutex_unlock(&afRouteLock);
+		return;
+	}
+	afRouteActive = 0;
+	mtUnsubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM, afRouteConfirm, NULL);
+	free(afRouteEntries);
+	free(afRouteIndex);
+	afRouteEntries = NULL;
+	afRouteIndex = NULL;
+	afRouteCount = 0;
+	pthread_mutex_unlock(&afRouteLock);
+
+	mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, MT_ZDO_SRC_RTG_IND, 0);
+}
+
+/*********************************************************************
+ * @fn      afRouteEnabled
+ *
+ * @brief   Tell whether the message handlers must feed the cache
+ */
+uint8_t afRouteEnabled(void)
+{
+	return atomic_load_explicit(&afRouteActive, memory_order_relaxed);
+}
+
+/*********************************************************************
+ * @fn      afRouteGetStats
+ *
+ * @brief   Read the cache counters.
+ *
+ * @param   stats - filled with the counters
+ */
+void afRouteGetStats(afRouteStats_t *stats)
+{
+	pthread_mutex_lock(&afRouteLock);
+	*stats = afRouteStats;
+	stats->routes = afRouteCount;
+	pthread_mutex_unlock(&afRouteLock);
+}
+
+/*********************************************************************
+ * @fn      afRouteGet
+ *
+ * @brief   Read the cached route to a destination.
+ *
+ * @param   dstAddr - destination NWK address
+ * @param   route - copy of the route
+ *
+ * @return  MT_RPC_SUCCESS, AF_ROUTE_NOT_FOUND
+ */
+uint8_t afRouteGet(uint16_t dstAddr, afRoute_t *route)
+{
+	uint8_t status = AF_ROUTE_NOT_FOUND;
+	int32_t idx;
+
+	pthread_mutex_lock(&afRouteLock);
+	if (afRouteActive)
+	{
+		idx = afRouteFresh(dstAddr);
+		if (idx >= 0)
+		{
+			*route = afRouteEntries[idx];
+			status = MT_RPC_SUCCESS;
+		}
+	}
+	pthread_mutex_unlock(&afRouteLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      afRouteUpdate
+ *
+ * @brief   Record the route to a destination, from a ZDO_SRC_RTG_IND or
+ *          the application. A route over AF_ROUTE_MAX_RELAYS relays drops
+ *          the cached one, as it is outdated.
+ *
+ * @param   dstAddr - destination NWK address
+ * @param   relayCount - number of relays, 0 for a neighbor
+ * @param   relays - relay list, the one next to the destination first
+ */
+void afRouteUpdate(uint16_t dstAddr, uint8_t relayCount,
+        const uint16_t *relays)
+{
+	afRoute_t *route;
+	int32_t idx;
+
+	if (dstAddr > AF_ROUTE_MAX_NWK_ADDR)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&afRouteLock);
+	if (!afRouteActive)
+	{
+		pthread_mutex_unlock(&afRouteLock);
+		return;
+	}
+
+	idx = afRouteFind(dstAddr);
+	if (relayCount > AF_ROUTE_MAX_RELAYS)
+	{
+		if (idx >= 0)
+		{
+			afRouteDrop(idx);
+		}
+		afRouteStats.tooLong++;
+		pthread_mutex_unlock(&afRouteLock);
+		return;
+	}
+
+	if (idx < 0)
+	{
+		if (afRouteCount == afRouteConf.capacity)
+		{
+			uint32_t oldest = 0, i;
+
+			for (i = 1; i < afRouteCount; i++)
+			{
+				if (afRouteEntries[i].updatedMs
+				        < afRouteEntries[oldest].updatedMs)
+				{
+					oldest = i;
+				}
+			}
+			afRouteDrop(oldest);
+			afRouteStats.evictions++;
+		}
+
+		idx = afRouteCount++;
+		afRouteEntries[idx].dstAddr = dstAddr;
+		afRouteIndex[afRouteProbe(dstAddr)] = idx + 1;
+	}
+	route = &afRouteEntries[idx];
+	route->relayCount = relayCount;
+	memcpy(route->relays, relays, relayCount * sizeof(uint16_t));
+	route->updatedMs = afRouteNowMs();
+	afRouteStats.updates++;
+	pthread_mutex_unlock(&afRouteLock);
+}
+
+/*********************************************************************
+ * @fn      afRouteRemove
+ *
+ * @brief   Forget the route to a destination, e.g. once it left the
+ *          network.
+ *
+ * @param   dstAddr - destination NWK address
+ */
+void afRouteRemove(uint16_t dstAddr)
+{
+	int32_t idx;
+
+	pthread_mutex_lock(&afRouteLock);
+	if (afRouteActive)
+	{
+		idx = afRouteFind(dstAddr);
+		if (idx >= 0)
+		{
+			afRouteDrop(idx);
+		}
+	}
+	pthread_mutex_unlock(&afRouteLock);
+}
+
+/*********************************************************************
+ * @fn      afDataRequestRouted
+ *
+ * @brief   Send an AF_DATA_REQUEST through the cached route to its
+ *          destination, as an AF_DATA_REQUEST_SRC_RTG. Without a fresh
+ *          route, or if the relays and data do not fit a frame, it is sent
+ *          as is and the ZNP finds a route itself. Either way the
+ *          AF_DATA_CONFIRM arrives as usual.
+ *
+ * @param   req - request
+ *
+ * @return  status of afDataRequestSrcRtg() or afDataRequest()
+ */
+uint8_t afDataRequestRouted(DataRequestFormat_t *req)
+{
+	DataRequestSrcRtgFormat_t srcRtg;
+	afRouteSent_t *sent = NULL;
+	uint8_t status;
+	int32_t idx = -1;
+
+	pthread_mutex_lock(&afRouteLock);
+	if (afRouteActive)
+	{
+		idx = afRouteFresh(req->DstAddr);
+	}
+	if ((idx >= 0) && (AF_ROUTE_REQ_HDR_LEN
+	        + (2 * afRouteEntries[idx].relayCount) + req->Len
+	        <= RPC_MAX_PAYLOAD_LEN))
+	{
+		srcRtg.RelayCount = afRouteEntries[idx].relayCount;
+		memcpy(srcRtg.RelayList, afRouteEntries[idx].relays,
+		        srcRtg.RelayCount * sizeof(uint16_t));
+
+		sent = &afRouteSent[req->TransID];
+		sent->inUse = 1;
+		sent->endpoint = req->SrcEndpoint;
+		sent->dstAddr = req->DstAddr;
+		sent->sentMs = afRouteNowMs();
+		afRouteStats.routed++;
+	}
+	else if (afRouteActive)
+	{
+		afRouteStats.unrouted++;
+	}
+	pthread_mutex_unlock(&afRouteLock);
+
+	if (sent == NULL)
+	{
+		return afDataRequest(req);
+	}
+
+	srcRtg.DstAddr = req->DstAddr;
+	srcRtg.DstEndpoint = req->DstEndpoint;
+	srcRtg.SrcEndpoint = req->SrcEndpoint;
+	srcRtg.ClusterID = req->ClusterID;
+	srcRtg.TransID = req->TransID;
+	srcRtg.Options = req->Options;
+	srcRtg.Radius = req->Radius;
+	srcRtg.Len = req->Len;
+	memcpy(srcRtg.Data, req->Data, req->Len);
+
+	status = afDataRequestSrcRtg(&srcRtg);
+	if (status != MT_RPC_SUCCESS)
+	{
+		pthread_mutex_lock(&afRouteLock);
+		sent->inUse = 0;
+		pthread_mutex_unlock(&afRouteLock);
+	}
+
+	return status;
+}
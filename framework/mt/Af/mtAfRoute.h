@@ -0,0 +1,91 @@
+/*
+ * mtAfRoute.h
+ *
+ * Host side cache of source routes. A ZNP acting as a many-to-one
+ * concentrator reports the route record of every device with a
+ * ZDO_SRC_RTG_IND; while enabled, the cache keeps the relay list under the
+ * destination NWK address. afDataRequestRouted() sends through the cached
+ * route with AF_DATA_REQUEST_SRC_RTG, so the ZNP needs no route discovery.
+ * A route expires after maxAgeMs and is dropped when a message sent
+ * through it is confirmed with afStatus_NO_ROUTE or afStatus_MAC_NO_ACK.
+ */
+
+#ifndef MTAFROUTE_H
+#define MTAFROUTE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define AF_ROUTE_DEFAULT_CAPACITY   (1024)
+// longer routes are not cached
+#ifndef AF_ROUTE_MAX_RELAYS
+#define AF_ROUTE_MAX_RELAYS         (16)
+#endif
+// route record -> expiry
+#define AF_ROUTE_MAX_AGE_MS         (300000)
+
+// status besides the MT_RPC_ERR_* codes
+#define AF_ROUTE_ERR_NO_MEMORY      (0x90)
+#define AF_ROUTE_NOT_FOUND          (0x91)  // not in the cache, or expired
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t capacity;         // routes, 0 for AF_ROUTE_DEFAULT_CAPACITY.
+	                           // The oldest one is replaced
+	uint32_t maxAgeMs;         // 0 for AF_ROUTE_MAX_AGE_MS
+} afRouteConfig_t;
+
+typedef struct
+{
+	uint16_t dstAddr;
+	uint8_t relayCount;
+	uint16_t relays[AF_ROUTE_MAX_RELAYS]; // as in ZDO_SRC_RTG_IND, the
+	                           // relay next to the destination first
+	uint64_t updatedMs;        // monotonic time of the last route record
+} afRoute_t;
+
+typedef struct
+{
+	uint32_t routes;
+	uint32_t updates;          // route records cached
+	uint32_t tooLong;          // route records over AF_ROUTE_MAX_RELAYS
+	uint32_t routed;           // messages sent through a cached route
+	uint32_t unrouted;         // sent without, no fresh route cached
+	uint32_t expired;          // routes dropped for their age
+	uint32_t invalidations;    // dropped on a failed confirm
+	uint32_t evictions;        // replaced for lack of room
+} afRouteStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t afRouteEnable(const afRouteConfig_t *cfg);
+void afRouteDisable(void);
+uint8_t afRouteEnabled(void);
+void afRouteGetStats(afRouteStats_t *stats);
+
+uint8_t afRouteGet(uint16_t dstAddr, afRoute_t *route);
+void afRouteUpdate(uint16_t dstAddr, uint8_t relayCount,
+        const uint16_t *relays);
+void afRouteRemove(uint16_t dstAddr);
+uint8_t afDataRequestRouted(DataRequestFormat_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTAFROUTE_H */
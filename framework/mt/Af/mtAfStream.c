@@ -0,0 +1,382 @@
+/*
+ * mtAfStream.c
+ *
+ * Sending AF messages larger than a frame, see mtAfStream.h. The stores
+ * are pipelined: up to a window of them wait for their SRSP while the
+ * next ones are written. The ZNP answers SREQs in order, so the n-th
+ * SRSP acknowledges the n-th store.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtAfStream.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define AF_STREAM_POLL_MS    (1)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint16_t outstanding;  // SREQs awaiting their SRSP
+	uint16_t acked;        // SREQs acknowledged with success
+	uint8_t status;        // first failure
+} afStreamCtx_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t afStreamLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t afStreamCond = PTHREAD_COND_INITIALIZER;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afStreamNowUs
+ *
+ * @brief   monotonic time in us
+ */
+static uint64_t afStreamNowUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*********************************************************************
+ * @fn      afStreamSrsp
+ *
+ * @brief   SRSP callback of the request and of the stores
+ */
+static void afStreamSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	afStreamCtx_t *ctx = (afStreamCtx_t *) cbArg;
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		status = (MT_CHECK_LEN(srsp, srspLen, 1) != MT_RPC_SUCCESS) ?
+		        MT_RPC_ERR_LENGTH : srsp[2];
+	}
+
+	pthread_mutex_lock(&afStreamLock);
+	ctx->outstanding--;
+	if (status == MT_RPC_SUCCESS)
+	{
+		ctx->acked++;
+	}
+	else if (ctx->status == MT_RPC_SUCCESS)
+	{
+		ctx->status = status;
+	}
+	pthread_cond_signal(&afStreamCond);
+	pthread_mutex_unlock(&afStreamLock);
+}
+
+/*********************************************************************
+ * @fn      afStreamWait
+ *
+ * @brief   Let the SRSPs come in: read the transport if no thread does,
+ *          dispatch the queued messages, then wait a little for an SRSP.
+ *          Called with afStreamLock held.
+ *
+ * @param   ctx - stream
+ * @param   acked - SRSPs already seen by the caller
+ */
+static void afStreamWait(afStreamCtx_t *ctx, uint16_t acked)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&afStreamLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&afStreamLock);
+	if ((ctx->acked != acked) || (ctx->status != MT_RPC_SUCCESS)
+	        || (ctx->outstanding == 0))
+	{
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += AF_STREAM_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&afStreamCond, &afStreamLock, &ts);
+}
+
+/*********************************************************************
+ * @fn      afStreamSendOne
+ *
+ * @brief   Send one SREQ of the stream, again while the SRSP lane is
+ *          full, and wait for its SRSP
+ *
+ * @return  its status
+ */
+static uint8_t afStreamSendOne(afStreamCtx_t *ctx, DataRequestExtFormat_t *req,
+        DataStoreFormat_t *store, uint32_t timeoutMs)
+{
+	uint8_t status;
+
+	pthread_mutex_lock(&afStreamLock);
+	do
+	{
+		ctx->outstanding++;
+		pthread_mutex_unlock(&afStreamLock);
+
+		status = req ? afDataRequestExtCb(req, timeoutMs, afStreamSrsp, ctx) :
+		        afDataStoreCb(store, timeoutMs, afStreamSrsp, ctx);
+
+		pthread_mutex_lock(&afStreamLock);
+		if (status != MT_RPC_SUCCESS)
+		{
+			ctx->outstanding--;
+		}
+		if (status == MT_RPC_ERR_BUSY)
+		{
+			// the queued SRSPs of the stores fill the lane, dispatch them
+			afStreamWait(ctx, ctx->acked);
+		}
+	} while (status == MT_RPC_ERR_BUSY);
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		while (ctx->outstanding)
+		{
+			afStreamWait(ctx, ctx->acked);
+		}
+		status = ctx->status;
+	}
+	pthread_mutex_unlock(&afStreamLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      afStreamStore
+ *
+ * @brief   Fill the ZNP huge buffer with pipelined AF_DATA_STOREs
+ *
+ * @param   data - message
+ * @param   len - its length
+ * @param   conf - chunk size, window and progress callback
+ * @param   stored - bytes acknowledged by the ZNP
+ *
+ * @return  MT_RPC_SUCCESS, else the first failure
+ */
+static uint8_t afStreamStore(const uint8_t *data, uint16_t len,
+        const afStreamConfig_t *conf, uint32_t *stored)
+{
+	afStreamCtx_t ctx;
+	DataStoreFormat_t store;
+	uint32_t next = 0, reported = 0;
+	uint16_t acked = 0;
+	uint8_t status;
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	pthread_mutex_lock(&afStreamLock);
+	while ((ctx.status == MT_RPC_SUCCESS)
+	        && ((next < len) || (ctx.outstanding > 0)))
+	{
+		uint8_t busy = 0;
+
+		while ((next < len) && (ctx.outstanding < conf->window) && !busy)
+		{
+			store.Index = next;
+			store.Length = ((len - next) > conf->chunkLen) ?
+			        conf->chunkLen : (len - next);
+			memcpy(store.Data, &data[next], store.Length);
+			ctx.outstanding++;
+
+			// unlocked, the SRSP callback may run before this returns
+			pthread_mutex_unlock(&afStreamLock);
+			status = afDataStoreCb(&store, conf->srspTimeoutMs, afStreamSrsp,
+			        &ctx);
+			pthread_mutex_lock(&afStreamLock);
+
+			if (status == MT_RPC_SUCCESS)
+			{
+				next += store.Length;
+			}
+			else
+			{
+				ctx.outstanding--;
+				if (status == MT_RPC_ERR_BUSY)
+				{
+					// retry once some stores are acknowledged
+					busy = 1;
+				}
+				else
+				{
+					ctx.status = status;
+				}
+			}
+		}
+
+		if (ctx.acked != acked)
+		{
+			acked = ctx.acked;
+			if (conf->progressCb)
+			{
+				reported = ((uint32_t) acked * conf->chunkLen > len) ?
+				        len : (uint32_t) acked * conf->chunkLen;
+				pthread_mutex_unlock(&afStreamLock);
+				conf->progressCb(reported, len, conf->cbArg);
+				pthread_mutex_lock(&afStreamLock);
+			}
+			continue;
+		}
+
+		if ((ctx.status == MT_RPC_SUCCESS) && (ctx.outstanding || busy))
+		{
+			afStreamWait(&ctx, acked);
+		}
+	}
+
+	// stores already written are still acknowledged on failure
+	while (ctx.outstanding)
+	{
+		afStreamWait(&ctx, ctx.acked);
+	}
+	status = ctx.status;
+	acked = ctx.acked;
+	pthread_mutex_unlock(&afStreamLock);
+
+	*stored = ((uint32_t) acked * conf->chunkLen > len) ?
+	        len : (uint32_t) acked * conf->chunkLen;
+	if ((status == MT_RPC_SUCCESS) && conf->progressCb
+	        && (reported != *stored))
+	{
+		conf->progressCb(*stored, len, conf->cbArg);
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afDataRequestStream
+ *
+ * @brief   Send an AF message of up to 64KB. Data that fits a frame goes
+ *          out with a single afDataRequestExt(). Longer data is announced
+ *          with its total length, written in chunks by up to cfg->window
+ *          pipelined AF_DATA_STOREs and sent by a zero length store. The
+ *          AF_DATA_CONFIRM of req->TransId arrives as usual. On failure
+ *          the ZNP keeps the partial buffer until the next huge request.
+ *          Runs in the thread that dispatches the message queue, like
+ *          afDataRequestBatch().
+ *
+ * @param   req - addressing and options, Len and Data are ignored
+ * @param   data - message
+ * @param   len - its length
+ * @param   cfg - chunk size, window and progress callback, NULL for the
+ *          defaults
+ * @param   stats - throughput, can be NULL
+ *
+ * @return  MT_RPC_SUCCESS once the ZNP accepted the message, else the
+ *          first failure: an afStatus or MT_RPC_ERR_* code
+ */
+uint8_t afDataRequestStream(const DataRequestExtFormat_t *req,
+        const uint8_t *data, uint16_t len, const afStreamConfig_t *cfg,
+        afStreamStats_t *stats)
+{
+	afStreamConfig_t conf;
+	afStreamCtx_t ctx;
+	DataRequestExtFormat_t hdr;
+	uint64_t start = afStreamNowUs();
+	uint32_t stored = 0;
+	uint8_t status;
+
+	memset(&conf, 0, sizeof(conf));
+	if (cfg)
+	{
+		conf = *cfg;
+	}
+	if ((conf.chunkLen == 0) || (conf.chunkLen > AF_STREAM_MAX_CHUNK))
+	{
+		conf.chunkLen = AF_STREAM_MAX_CHUNK;
+	}
+	if (conf.window == 0)
+	{
+		conf.window = AF_STREAM_DEFAULT_WINDOW;
+	}
+	memset(&ctx, 0, sizeof(ctx));
+
+	hdr = *req;
+	hdr.Len = len;
+	if (len <= sizeof(hdr.Data))
+	{
+		// fits a frame, no huge buffer needed
+		memcpy(hdr.Data, data, len);
+		status = afStreamSendOne(&ctx, &hdr, NULL, conf.srspTimeoutMs);
+		if (status == MT_RPC_SUCCESS)
+		{
+			stored = len;
+		}
+	}
+	else
+	{
+		status = afStreamSendOne(&ctx, &hdr, NULL, conf.srspTimeoutMs);
+		if (status != MT_RPC_SUCCESS)
+		{
+			LOG_ERR("Huge AF request of %d bytes refused: %02X", len, status);
+		}
+		else
+		{
+			status = afStreamStore(data, len, &conf, &stored);
+			if (status == MT_RPC_SUCCESS)
+			{
+				DataStoreFormat_t store;
+
+				// zero length store: send the message
+				store.Index = 0;
+				store.Length = 0;
+				status = afStreamSendOne(&ctx, NULL, &store,
+				        conf.srspTimeoutMs);
+			}
+			else
+			{
+				LOG_ERR("AF_DATA_STORE failed at %u of %d bytes: %02X",
+				        stored, len, status);
+			}
+		}
+	}
+
+	if (stats)
+	{
+		uint64_t elapsed = afStreamNowUs() - start;
+
+		stats->bytes = stored;
+		stats->stores = (stored + conf.chunkLen - 1) / conf.chunkLen;
+		stats->elapsedUs = (elapsed > UINT32_MAX) ?
+		        UINT32_MAX : (uint32_t) elapsed;
+		stats->bytesPerSec = elapsed ?
+		        (uint32_t) (((uint64_t) stored * 1000000) / elapsed) : 0;
+	}
+
+	return status;
+}
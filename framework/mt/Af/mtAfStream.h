@@ -0,0 +1,65 @@
+/*
+ * mtAfStream.h
+ *
+ * Sending AF messages larger than a frame through the ZNP huge buffer:
+ * AF_DATA_REQUEST_EXT announces the total length, AF_DATA_STOREs fill
+ * the buffer and a zero length store sends the message.
+ */
+
+#ifndef MTAFSTREAM_H
+#define MTAFSTREAM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtAf.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// data bytes of the largest AF_DATA_STORE
+#define AF_STREAM_MAX_CHUNK        (247)
+#define AF_STREAM_DEFAULT_WINDOW   (4)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// called after each store acknowledged by the ZNP
+typedef void (*afStreamProgressCb_t)(uint32_t stored, uint32_t total,
+        void *cbArg);
+
+typedef struct
+{
+	uint8_t chunkLen;          // bytes per store, 0 for AF_STREAM_MAX_CHUNK
+	uint8_t window;            // stores awaiting their SRSP, 0 for the default
+	uint32_t srspTimeoutMs;    // 0 for the default SRSP timeout
+	afStreamProgressCb_t progressCb; // can be NULL
+	void *cbArg;               // passed back to progressCb
+} afStreamConfig_t;
+
+typedef struct
+{
+	uint32_t bytes;            // data bytes stored
+	uint16_t stores;           // AF_DATA_STOREs acknowledged
+	uint32_t elapsedUs;        // request to send trigger
+	uint32_t bytesPerSec;      // bytes / elapsedUs
+} afStreamStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t afDataRequestStream(const DataRequestExtFormat_t *req,
+        const uint8_t *data, uint16_t len, const afStreamConfig_t *cfg,
+        afStreamStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTAFSTREAM_H */
@@ -0,0 +1,658 @@
+/*
+ * mtAfTrack.c
+ *
+ * Host side tracking of AF data requests, see mtAfTrack.h. Requests in
+ * flight live in an open addressing table keyed on endpoint and TransID.
+ * Confirms are taken from an AF_DATA_CONFIRM subscriber, lost ones are
+ * expired by afTrackPoll().
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtAfTrack.h"
+#include "mtAf.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t inUse;
+	uint8_t endpoint;
+	uint8_t transId;
+	uint16_t dstAddr;
+	uint16_t clusterId;
+	uint64_t sentUs;
+} afTrackEntry_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t afTrackLock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint8_t afTrackEnabled;
+static uint32_t afTrackTimeoutMs;
+
+static afTrackEntry_t afTrackInflight[AF_TRACK_MAX_INFLIGHT];
+static uint16_t afTrackInflightCnt;
+
+static afTrackStats_t afTrackDests[AF_TRACK_MAX_DESTS];
+static uint64_t afTrackDestUsedUs[AF_TRACK_MAX_DESTS]; // 0: free
+static afTrackStats_t afTrackTotal;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afTrackNowUs
+ *
+ * @brief   monotonic time in us
+ */
+static uint64_t afTrackNowUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/*********************************************************************
+ * @fn      afTrackHash
+ *
+ * @brief   Home slot of an endpoint and TransID in the in-flight table
+ */
+static uint16_t afTrackHash(uint8_t endpoint, uint8_t transId)
+{
+	uint32_t key = ((uint32_t) endpoint << 8) | transId;
+
+	return (uint16_t) ((key * 2654435761u) >> 16) & (AF_TRACK_MAX_INFLIGHT - 1);
+}
+
+/*********************************************************************
+ * @fn      afTrackFind
+ *
+ * @brief   Slot of a request in flight, -1 if it is not tracked
+ */
+static int32_t afTrackFind(uint8_t endpoint, uint8_t transId)
+{
+	uint16_t idx = afTrackHash(endpoint, transId);
+	uint16_t n;
+
+	for (n = 0; n < AF_TRACK_MAX_INFLIGHT; n++)
+	{
+		afTrackEntry_t *e = &afTrackInflight[idx];
+
+		if (!e->inUse)
+		{
+			break;
+		}
+		if ((e->endpoint == endpoint) && (e->transId == transId))
+		{
+			return idx;
+		}
+		idx = (idx + 1) & (AF_TRACK_MAX_INFLIGHT - 1);
+	}
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      afTrackRemove
+ *
+ * @brief   Free a slot of the in-flight table, moving back the entries
+ *          that probed past it so that lookups still find them.
+ */
+static void afTrackRemove(uint16_t idx)
+{
+	uint16_t next = idx;
+
+	afTrackInflight[idx].inUse = 0;
+	afTrackInflightCnt--;
+
+	for (;;)
+	{
+		uint16_t home;
+
+		next = (next + 1) & (AF_TRACK_MAX_INFLIGHT - 1);
+		if (!afTrackInflight[next].inUse)
+		{
+			return;
+		}
+		home = afTrackHash(afTrackInflight[next].endpoint,
+		        afTrackInflight[next].transId);
+		// move it if its home slot is not within (idx, next]
+		if (((next - home) & (AF_TRACK_MAX_INFLIGHT - 1))
+		        >= ((next - idx) & (AF_TRACK_MAX_INFLIGHT - 1)))
+		{
+			afTrackInflight[idx] = afTrackInflight[next];
+			afTrackInflight[next].inUse = 0;
+			idx = next;
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      afTrackBucket
+ *
+ * @brief   Histogram bucket of a delay: 4 buckets per power of 2
+ */
+static uint8_t afTrackBucket(uint32_t us)
+{
+	uint8_t msb;
+
+	if (us < 4)
+	{
+		return us;
+	}
+	msb = 31 - __builtin_clz(us);
+
+	return ((msb - 1) * 4) + ((us >> (msb - 2)) & 3);
+}
+
+/*********************************************************************
+ * @fn      afTrackDest
+ *
+ * @brief   Statistics of a destination and cluster. When create is set,
+ *          a missing entry is added, replacing the least recently
+ *          updated one if the table is full.
+ *
+ * @return  entry, NULL if it does not exist and create is not set
+ */
+static afTrackStats_t *afTrackDest(uint16_t dstAddr, uint16_t clusterId,
+        uint8_t create, uint64_t now)
+{
+	uint16_t idx, victim = 0;
+
+	for (idx = 0; idx < AF_TRACK_MAX_DESTS; idx++)
+	{
+		if (afTrackDestUsedUs[idx] && (afTrackDests[idx].dstAddr == dstAddr)
+		        && (afTrackDests[idx].clusterId == clusterId))
+		{
+			afTrackDestUsedUs[idx] = now;
+			return &afTrackDests[idx];
+		}
+		if (afTrackDestUsedUs[idx] < afTrackDestUsedUs[victim])
+		{
+			victim = idx;
+		}
+	}
+	if (!create)
+	{
+		return NULL;
+	}
+
+	memset(&afTrackDests[victim], 0, sizeof(afTrackStats_t));
+	afTrackDests[victim].dstAddr = dstAddr;
+	afTrackDests[victim].clusterId = clusterId;
+	afTrackDestUsedUs[victim] = now;
+
+	return &afTrackDests[victim];
+}
+
+/*********************************************************************
+ * @fn      afTrackRecord
+ *
+ * @brief   Account for the confirm of a request, or its loss when us is
+ *          NULL
+ */
+static void afTrackRecord(afTrackStats_t *stats, uint8_t status,
+        const uint32_t *us)
+{
+	if (us == NULL)
+	{
+		stats->timeouts++;
+		return;
+	}
+
+	if (status == afStatus_SUCCESS)
+	{
+		stats->confirmed++;
+	}
+	else
+	{
+		stats->failed++;
+	}
+	if ((stats->confirmed + stats->failed == 1) || (*us < stats->minUs))
+	{
+		stats->minUs = *us;
+	}
+	if (*us > stats->maxUs)
+	{
+		stats->maxUs = *us;
+	}
+	stats->sumUs += *us;
+	stats->hist[afTrackBucket(*us)]++;
+}
+
+/*********************************************************************
+ * @fn      afTrackComplete
+ *
+ * @brief   Remove a request from the in-flight table and account for it
+ *          in its destination and in the total. Called with afTrackLock
+ *          held.
+ */
+static void afTrackComplete(uint16_t idx, uint8_t status, const uint32_t *us,
+        uint64_t now)
+{
+	afTrackEntry_t *e = &afTrackInflight[idx];
+	afTrackStats_t *dest = afTrackDest(e->dstAddr, e->clusterId, 0, now);
+
+	if (dest)
+	{
+		afTrackRecord(dest, status, us);
+	}
+	afTrackRecord(&afTrackTotal, status, us);
+	afTrackRemove(idx);
+}
+
+/*********************************************************************
+ * @fn      afTrackConfirm
+ *
+ * @brief   AF_DATA_CONFIRM subscriber
+ */
+static void afTrackConfirm(uint8_t *rpcBuff, uint8_t rpcLen,
+        void *cbArg __attribute__((unused)))
+{
+	uint64_t now = afTrackNowUs();
+	int32_t idx;
+
+	// Status, Endpoint, TransId
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 3) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&afTrackLock);
+	idx = afTrackFind(rpcBuff[3], rpcBuff[4]);
+	if (idx >= 0)
+	{
+		uint64_t delay = now - afTrackInflight[idx].sentUs;
+		uint32_t us = (delay > UINT32_MAX) ? UINT32_MAX : (uint32_t) delay;
+
+		afTrackComplete(idx, rpcBuff[2], &us, now);
+	}
+	pthread_mutex_unlock(&afTrackLock);
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      afTrackEnable
+ *
+ * @brief   Start tracking the AF data requests sent from now on. Called
+ *          again, it only applies the new configuration.
+ *
+ * @param   cfg - configuration, NULL for the defaults
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_BUSY if the confirm subscription
+ *          failed
+ */
+uint8_t afTrackEnable(const afTrackConfig_t *cfg)
+{
+	uint32_t timeoutMs = (cfg && cfg->confirmTimeoutMs) ?
+	        cfg->confirmTimeoutMs : AF_TRACK_CONFIRM_TIMEOUT_MS;
+	uint8_t status = MT_RPC_SUCCESS;
+
+	pthread_mutex_lock(&afTrackLock);
+	afTrackTimeoutMs = timeoutMs;
+	if (!afTrackEnabled)
+	{
+		status = mtSubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM,
+		        afTrackConfirm, NULL);
+		if (status == MT_RPC_SUCCESS)
+		{
+			afTrackEnabled = 1;
+		}
+	}
+	pthread_mutex_unlock(&afTrackLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      afTrackDisable
+ *
+ * @brief   Stop tracking and forget the requests in flight. The
+ *          statistics are kept.
+ */
+void afTrackDisable(void)
+{
+	pthread_mutex_lock(&afTrackLock);
+	if (afTrackEnabled)
+	{
+		mtUnsubscribe(MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM, afTrackConfirm, NULL);
+		afTrackEnabled = 0;
+	}
+	memset(afTrackInflight, 0, sizeof(afTrackInflight));
+	afTrackInflightCnt = 0;
+	pthread_mutex_unlock(&afTrackLock);
+}
+
+/*********************************************************************
+ * @fn      afTrackReset
+ *
+ * @brief   Clear the statistics. Requests in flight stay tracked.
+ */
+void afTrackReset(void)
+{
+	pthread_mutex_lock(&afTrackLock);
+	memset(afTrackDests, 0, sizeof(afTrackDests));
+	memset(afTrackDestUsedUs, 0, sizeof(afTrackDestUsedUs));
+	memset(&afTrackTotal, 0, sizeof(afTrackTotal));
+	pthread_mutex_unlock(&afTrackLock);
+}
+
+/*********************************************************************
+ * @fn      afTrackPoll
+ *
+ * @brief   Expire the requests whose confirm is overdue. Each one is
+ *          reported through mtProcess() as an AF_DATA_CONFIRM with status
+ *          AF_TRACK_STATUS_TIMEOUT, so it reaches pfnAfDataConfirm and the
+ *          subscribers. The real confirm, if it arrives later, is passed
+ *          on as usual. Call it from the thread dispatching the message
+ *          queue, afTrackNextTimeout() tells when.
+ */
+void afTrackPoll(void)
+{
+	uint8_t lost[AF_TRACK_MAX_INFLIGHT][2];
+	uint16_t cnt = 0, idx = 0, n;
+	uint64_t now = afTrackNowUs();
+	uint64_t timeoutUs;
+
+	pthread_mutex_lock(&afTrackLock);
+	timeoutUs = (uint64_t) afTrackTimeoutMs * 1000;
+	while (afTrackInflightCnt && (idx < AF_TRACK_MAX_INFLIGHT))
+	{
+		afTrackEntry_t *e = &afTrackInflight[idx];
+
+		if (e->inUse && (now - e->sentUs >= timeoutUs))
+		{
+			LOG_WARN("No AF_DATA_CONFIRM for ep %d trans %d", e->endpoint,
+			        e->transId);
+			lost[cnt][0] = e->endpoint;
+			lost[cnt][1] = e->transId;
+			cnt++;
+			// an entry may move into idx, look at it again
+			afTrackComplete(idx, AF_TRACK_STATUS_TIMEOUT, NULL, now);
+			continue;
+		}
+		idx++;
+	}
+	pthread_mutex_unlock(&afTrackLock);
+
+	for (n = 0; n < cnt; n++)
+	{
+		uint8_t rpcBuff[6];
+
+		rpcBuff[0] = MT_RPC_CMD_AREQ | MT_RPC_SYS_AF;
+		rpcBuff[1] = MT_AF_DATA_CONFIRM;
+		rpcBuff[2] = AF_TRACK_STATUS_TIMEOUT;
+		rpcBuff[3] = lost[n][0];
+		rpcBuff[4] = lost[n][1];
+		rpcBuff[5] = 0;
+		mtProcess(rpcBuff, sizeof(rpcBuff));
+	}
+}
+
+/*********************************************************************
+ * @fn      afTrackNextTimeout
+ *
+ * @brief   Time until the earliest confirm deadline
+ *
+ * @return  timeout in ms, -1 if no request is in flight
+ */
+int32_t afTrackNextTimeout(void)
+{
+	uint64_t now = afTrackNowUs();
+	uint64_t first = 0;
+	uint64_t deadline;
+	uint16_t idx;
+
+	pthread_mutex_lock(&afTrackLock);
+	for (idx = 0; afTrackInflightCnt && (idx < AF_TRACK_MAX_INFLIGHT); idx++)
+	{
+		if (afTrackInflight[idx].inUse
+		        && ((first == 0) || (afTrackInflight[idx].sentUs < first)))
+		{
+			first = afTrackInflight[idx].sentUs;
+		}
+	}
+	deadline = first + (uint64_t) afTrackTimeoutMs * 1000;
+	pthread_mutex_unlock(&afTrackLock);
+
+	if (first == 0)
+	{
+		return -1;
+	}
+	return (deadline > now) ? (int32_t) ((deadline - now + 999) / 1000) : 0;
+}
+
+/*********************************************************************
+ * @fn      afTrackGetStats
+ *
+ * @brief   Copy the statistics of a destination and cluster
+ *
+ * @param   dstAddr - destination short address
+ * @param   clusterId - cluster
+ * @param   stats - destination
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if nothing was sent there
+ */
+uint8_t afTrackGetStats(uint16_t dstAddr, uint16_t clusterId,
+        afTrackStats_t *stats)
+{
+	uint16_t idx;
+
+	pthread_mutex_lock(&afTrackLock);
+	for (idx = 0; idx < AF_TRACK_MAX_DESTS; idx++)
+	{
+		if (afTrackDestUsedUs[idx] && (afTrackDests[idx].dstAddr == dstAddr)
+		        && (afTrackDests[idx].clusterId == clusterId))
+		{
+			*stats = afTrackDests[idx];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&afTrackLock);
+
+	return (idx < AF_TRACK_MAX_DESTS) ? MT_RPC_SUCCESS : MT_RPC_ERR_PARAMETER;
+}
+
+/*********************************************************************
+ * @fn      afTrackGetTotal
+ *
+ * @brief   Copy the statistics of every request tracked, dstAddr and
+ *          clusterId are 0
+ */
+void afTrackGetTotal(afTrackStats_t *stats)
+{
+	pthread_mutex_lock(&afTrackLock);
+	*stats = afTrackTotal;
+	pthread_mutex_unlock(&afTrackLock);
+}
+
+/*********************************************************************
+ * @fn      afTrackGetAll
+ *
+ * @brief   Copy the statistics of every destination and cluster
+ *
+ * @param   stats - destination array
+ * @param   max - its size
+ *
+ * @return  number of entries copied
+ */
+uint16_t afTrackGetAll(afTrackStats_t *stats, uint16_t max)
+{
+	uint16_t idx, cnt = 0;
+
+	pthread_mutex_lock(&afTrackLock);
+	for (idx = 0; (idx < AF_TRACK_MAX_DESTS) && (cnt < max); idx++)
+	{
+		if (afTrackDestUsedUs[idx])
+		{
+			stats[cnt++] = afTrackDests[idx];
+		}
+	}
+	pthread_mutex_unlock(&afTrackLock);
+
+	return cnt;
+}
+
+/*********************************************************************
+ * @fn      afTrackPercentile
+ *
+ * @brief   Delay below which pct percent of the confirms arrived. The
+ *          bucket width bounds the error to about 12%.
+ *
+ * @param   stats - statistics from afTrackGetStats() and friends
+ * @param   pct - percentile, 0 to 100
+ *
+ * @return  delay in us, 0 if no confirm was received
+ */
+uint32_t afTrackPercentile(const afTrackStats_t *stats, uint8_t pct)
+{
+	uint64_t count = (uint64_t) stats->confirmed + stats->failed;
+	uint64_t rank, seen = 0;
+	uint8_t b;
+
+	if (count == 0)
+	{
+		return 0;
+	}
+	if (pct > 100)
+	{
+		pct = 100;
+	}
+	rank = (count * pct + 99) / 100;
+	if (rank == 0)
+	{
+		return stats->minUs;
+	}
+
+	for (b = 0; b < AF_TRACK_BUCKETS; b++)
+	{
+		seen += stats->hist[b];
+		if (seen >= rank)
+		{
+			uint64_t low, width, mid;
+
+			if (b < 4)
+			{
+				low = b;
+				width = 1;
+			}
+			else
+			{
+				uint8_t shift = (b / 4) - 1;
+
+				low = (uint64_t) (4 + (b % 4)) << shift;
+				width = (uint64_t) 1 << shift;
+			}
+			mid = low + (width / 2);
+			if (mid < stats->minUs)
+			{
+				return stats->minUs;
+			}
+			return (mid > stats->maxUs) ? stats->maxUs : (uint32_t) mid;
+		}
+	}
+
+	return stats->maxUs;
+}
+
+/*********************************************************************
+ * @fn      afTrackSend
+ *
+ * @brief   Hook of the mtAf send functions, called before a request is
+ *          written. A request still in flight under the same endpoint and
+ *          TransID is counted as lost.
+ */
+void afTrackSend(uint8_t endpoint, uint8_t transId, uint16_t dstAddr,
+        uint16_t clusterId)
+{
+	uint64_t now;
+	afTrackStats_t *dest;
+	int32_t idx;
+
+	if (!afTrackEnabled)
+	{
+		return;
+	}
+
+	now = afTrackNowUs();
+	pthread_mutex_lock(&afTrackLock);
+	idx = afTrackFind(endpoint, transId);
+	if (idx >= 0)
+	{
+		afTrackComplete(idx, AF_TRACK_STATUS_TIMEOUT, NULL, now);
+	}
+	if (afTrackInflightCnt == AF_TRACK_MAX_INFLIGHT)
+	{
+		pthread_mutex_unlock(&afTrackLock);
+		LOG_WARN("AF tracker full, ep %d trans %d not tracked", endpoint,
+		        transId);
+		return;
+	}
+
+	idx = afTrackHash(endpoint, transId);
+	while (afTrackInflight[idx].inUse)
+	{
+		idx = (idx + 1) & (AF_TRACK_MAX_INFLIGHT - 1);
+	}
+	afTrackInflight[idx].inUse = 1;
+	afTrackInflight[idx].endpoint = endpoint;
+	afTrackInflight[idx].transId = transId;
+	afTrackInflight[idx].dstAddr = dstAddr;
+	afTrackInflight[idx].clusterId = clusterId;
+	afTrackInflight[idx].sentUs = now;
+	afTrackInflightCnt++;
+
+	dest = afTrackDest(dstAddr, clusterId, 1, now);
+	dest->sent++;
+	afTrackTotal.sent++;
+	pthread_mutex_unlock(&afTrackLock);
+}
+
+/*********************************************************************
+ * @fn      afTrackCancel
+ *
+ * @brief   Hook of the mtAf send functions, forgets a request that could
+ *          not be sent
+ */
+void afTrackCancel(uint8_t endpoint, uint8_t transId)
+{
+	afTrackStats_t *dest;
+	int32_t idx;
+
+	if (!afTrackEnabled)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&afTrackLock);
+	idx = afTrackFind(endpoint, transId);
+	if (idx >= 0)
+	{
+		dest = afTrackDest(afTrackInflight[idx].dstAddr,
+		        afTrackInflight[idx].clusterId, 0, afTrackNowUs());
+		if (dest)
+		{
+			dest->sent--;
+		}
+		afTrackTotal.sent--;
+		afTrackRemove(idx);
+	}
+	pthread_mutex_unlock(&afTrackLock);
+}
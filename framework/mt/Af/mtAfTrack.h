@@ -0,0 +1,88 @@
+/*
+ * mtAfTrack.h
+ *
+ * Host side tracking of AF data requests. Every request sent while the
+ * tracker is enabled is kept in flight under its endpoint and TransID
+ * until its AF_DATA_CONFIRM arrives, and the delay is recorded per
+ * destination and cluster in a log bucket histogram. A request whose
+ * confirm does not arrive in time is reported with a synthetic confirm.
+ * Delays are taken when the confirm is dispatched from the message queue,
+ * so they include the time it waited there.
+ */
+
+#ifndef MTAFTRACK_H
+#define MTAFTRACK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// requests awaiting their confirm, a power of 2
+#define AF_TRACK_MAX_INFLIGHT        (256)
+// destination and cluster pairs with their own histogram
+#ifndef AF_TRACK_MAX_DESTS
+#define AF_TRACK_MAX_DESTS           (64)
+#endif
+#define AF_TRACK_CONFIRM_TIMEOUT_MS  (10000)
+
+// latency buckets, 4 per power of 2 of microseconds
+#define AF_TRACK_BUCKETS             (124)
+
+// status of the synthetic AF_DATA_CONFIRM of a lost confirm
+#define AF_TRACK_STATUS_TIMEOUT      (0x80)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t confirmTimeoutMs; // 0 for AF_TRACK_CONFIRM_TIMEOUT_MS
+} afTrackConfig_t;
+
+typedef struct
+{
+	uint16_t dstAddr;
+	uint16_t clusterId;
+	uint32_t sent;           // requests tracked
+	uint32_t confirmed;      // confirms with afStatus_SUCCESS
+	uint32_t failed;         // confirms with another status
+	uint32_t timeouts;       // confirms that never arrived
+	uint32_t minUs;          // shortest request -> confirm delay
+	uint32_t maxUs;          // longest
+	uint64_t sumUs;          // of every confirm received
+	uint32_t hist[AF_TRACK_BUCKETS];
+} afTrackStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t afTrackEnable(const afTrackConfig_t *cfg);
+void afTrackDisable(void);
+void afTrackReset(void);
+void afTrackPoll(void);
+int32_t afTrackNextTimeout(void);
+uint8_t afTrackGetStats(uint16_t dstAddr, uint16_t clusterId,
+        afTrackStats_t *stats);
+void afTrackGetTotal(afTrackStats_t *stats);
+uint16_t afTrackGetAll(afTrackStats_t *stats, uint16_t max);
+uint32_t afTrackPercentile(const afTrackStats_t *stats, uint8_t pct);
+
+// hooks of the mtAf send functions
+void afTrackSend(uint8_t endpoint, uint8_t transId, uint16_t dstAddr,
+        uint16_t clusterId);
+void afTrackCancel(uint8_t endpoint, uint8_t transId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTAFTRACK_H */
@@ -46,6 +46,7 @@
 #include "mtSapi.h"
 #include "mtSys.h"
 #include "mtParser.h"
+#include "mtCodec.h"
 #include "rpc.h"
 
 #include "dbgPrint.h"
@@ -54,13 +55,167 @@
  * LOCAL VARIABLES
  */
 static mtSapiCb_t mtSapiCbs;
-extern uint8_t srspRpcBuff[RPC_MAX_LEN];
-extern uint8_t srspRpcLen;
+
+/*********************************************************************
+ * COMMAND LAYOUTS
+ *
+ * Wire format of the requests and callbacks packed and unpacked by
+ * mtCodec.c
+ */
+
+// requests
+static const mtField_t appRegisterReqFields[] =
+{
+	MT_U8(AppRegisterReqFormat_t, AppEndpoint),
+	MT_U16(AppRegisterReqFormat_t, AppProfileId),
+	MT_U16(AppRegisterReqFormat_t, DeviceId),
+	MT_U8(AppRegisterReqFormat_t, DeviceVersion),
+	MT_U8(AppRegisterReqFormat_t, Unused),
+	MT_U8(AppRegisterReqFormat_t, InputCommandsNum),
+	MT_LIST_U16(AppRegisterReqFormat_t, InputCommandsList, InputCommandsNum),
+	MT_U8(AppRegisterReqFormat_t, OutputCommandsNum),
+	MT_LIST_U16(AppRegisterReqFormat_t, OutputCommandsList, OutputCommandsNum)
+};
+static const mtCmdDesc_t appRegisterReqDesc =
+        MT_DESC(AppRegisterReqFormat_t, appRegisterReqFields);
+
+static const mtField_t permitJoiningReqFields[] =
+{
+	MT_U16(PermitJoiningReqFormat_t, Destination),
+	MT_U8(PermitJoiningReqFormat_t, Timeout)
+};
+static const mtCmdDesc_t permitJoiningReqDesc =
+        MT_DESC(PermitJoiningReqFormat_t, permitJoiningReqFields);
+
+static const mtField_t bindDeviceFields[] =
+{
+	MT_U8(BindDeviceFormat_t, Create),
+	MT_U16(BindDeviceFormat_t, CommandId),
+	MT_BYTES(BindDeviceFormat_t, DstIeee)
+};
+static const mtCmdDesc_t bindDeviceDesc =
+        MT_DESC(BindDeviceFormat_t, bindDeviceFields);
+
+static const mtField_t allowBindFields[] =
+{
+	MT_U8(AllowBindFormat_t, Timeout)
+};
+static const mtCmdDesc_t allowBindDesc =
+        MT_DESC(AllowBindFormat_t, allowBindFields);
+
+static const mtField_t sendDataReqFields[] =
+{
+	MT_U16(SendDataReqFormat_t, Destination),
+	MT_U16(SendDataReqFormat_t, CommandId),
+	MT_U8(SendDataReqFormat_t, Handle),
+	MT_U8(SendDataReqFormat_t, Ack),
+	MT_U8(SendDataReqFormat_t, Radius),
+	MT_U8(SendDataReqFormat_t, Len),
+	MT_LIST_U8(SendDataReqFormat_t, Data, Len)
+};
+static const mtCmdDesc_t sendDataReqDesc =
+        MT_DESC(SendDataReqFormat_t, sendDataReqFields);
+
+static const mtField_t findDeviceReqFields[] =
+{
+	MT_BYTES(FindDeviceReqFormat_t, SearchKey)
+};
+static const mtCmdDesc_t findDeviceReqDesc =
+        MT_DESC(FindDeviceReqFormat_t, findDeviceReqFields);
+
+static const mtField_t writeConfigurationFields[] =
+{
+	MT_U8(WriteConfigurationFormat_t, ConfigId),
+	MT_U8(WriteConfigurationFormat_t, Len),
+	MT_LIST_U8(WriteConfigurationFormat_t, Value, Len)
+};
+static const mtCmdDesc_t writeConfigurationDesc =
+        MT_DESC(WriteConfigurationFormat_t, writeConfigurationFields);
+
+static const mtField_t getDeviceInfoFields[] =
+{
+	MT_U8(GetDeviceInfoFormat_t, Param)
+};
+static const mtCmdDesc_t getDeviceInfoDesc =
+        MT_DESC(GetDeviceInfoFormat_t, getDeviceInfoFields);
+
+static const mtField_t readConfigurationFields[] =
+{
+	MT_U8(ReadConfigurationFormat_t, ConfigId)
+};
+static const mtCmdDesc_t readConfigurationDesc =
+        MT_DESC(ReadConfigurationFormat_t, readConfigurationFields);
+
+// responses
+static const mtField_t readConfigurationSrspFields[] =
+{
+	MT_U8(ReadConfigurationSrspFormat_t, Status),
+	MT_U8(ReadConfigurationSrspFormat_t, ConfigId),
+	MT_U8(ReadConfigurationSrspFormat_t, Len),
+	MT_LIST_U8(ReadConfigurationSrspFormat_t, Value, Len)
+};
+static const mtCmdDesc_t readConfigurationSrspDesc =
+        MT_DESC(ReadConfigurationSrspFormat_t, readConfigurationSrspFields);
+
+static const mtField_t getDeviceInfoSrspFields[] =
+{
+	MT_U8(GetDeviceInfoSrspFormat_t, Param),
+	MT_BYTES(GetDeviceInfoSrspFormat_t, Value)
+};
+static const mtCmdDesc_t getDeviceInfoSrspDesc =
+        MT_DESC(GetDeviceInfoSrspFormat_t, getDeviceInfoSrspFields);
+
+// callbacks
+static const mtField_t findDeviceCnfFields[] =
+{
+	MT_U16(FindDeviceCnfFormat_t, SearchKey),
+	MT_U64(FindDeviceCnfFormat_t, Result)
+};
+static const mtCmdDesc_t findDeviceCnfDesc =
+        MT_DESC(FindDeviceCnfFormat_t, findDeviceCnfFields);
+
+static const mtField_t sendDataCnfFields[] =
+{
+	MT_U8(SendDataCnfFormat_t, Handle),
+	MT_U8(SendDataCnfFormat_t, Status)
+};
+static const mtCmdDesc_t sendDataCnfDesc =
+        MT_DESC(SendDataCnfFormat_t, sendDataCnfFields);
+
+static const mtField_t receiveDataIndFields[] =
+{
+	MT_U16(ReceiveDataIndFormat_t, Source),
+	MT_U16(ReceiveDataIndFormat_t, Command),
+	MT_U16(ReceiveDataIndFormat_t, Len),
+	MT_LIST_U8_LEN16(ReceiveDataIndFormat_t, Data, Len)
+};
+static const mtCmdDesc_t receiveDataIndDesc =
+        MT_DESC(ReceiveDataIndFormat_t, receiveDataIndFields);
+
+static const mtField_t allowBindCnfFields[] =
+{
+	MT_U16(AllowBindCnfFormat_t, Source)
+};
+static const mtCmdDesc_t allowBindCnfDesc =
+        MT_DESC(AllowBindCnfFormat_t, allowBindCnfFields);
+
+static const mtField_t bindCnfFields[] =
+{
+	MT_U16(BindCnfFormat_t, CommandId),
+	MT_U8(BindCnfFormat_t, Status)
+};
+static const mtCmdDesc_t bindCnfDesc = MT_DESC(BindCnfFormat_t, bindCnfFields);
+
+static const mtField_t startCnfFields[] =
+{
+	MT_U8(StartCnfFormat_t, Status)
+};
+static const mtCmdDesc_t startCnfDesc =
+        MT_DESC(StartCnfFormat_t, startCnfFields);
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processStartCnf(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processBindCnf(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processAllowBindCnf(uint8_t *rpcBuff, uint8_t rpcLen);
@@ -105,48 +260,8 @@ uint8_t zbSystemReset(void)
  */
 uint8_t zbAppRegisterReq(AppRegisterReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 9 + (req->InputCommandsNum * 2)
-	        + (req->OutputCommandsNum * 2);
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = req->AppEndpoint;
-		cmd[cmInd++] = (uint8_t)(req->AppProfileId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->AppProfileId >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->DeviceId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DeviceId >> 8) & 0xFF);
-		cmd[cmInd++] = req->DeviceVersion;
-		cmd[cmInd++] = req->Unused;
-		cmd[cmInd++] = req->InputCommandsNum;
-		for (idx = 0; idx < req->InputCommandsNum; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->InputCommandsList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->InputCommandsList[idx] >> 8) & 0xFF);
-		}
-		cmd[cmInd++] = req->OutputCommandsNum;
-		for (idx = 0; idx < req->OutputCommandsNum; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->OutputCommandsList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)(
-			        (req->OutputCommandsList[idx] >> 8) & 0xFF);
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_APP_REGISTER_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&appRegisterReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_APP_REGISTER_REQ, req);
 }
 
 /*********************************************************************
@@ -180,28 +295,8 @@ uint8_t zbStartReq()
  */
 uint8_t zbPermitJoiningReq(PermitJoiningReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->Destination & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Destination >> 8) & 0xFF);
-		cmd[cmInd++] = req->Timeout;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_PERMIT_JOINING_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&permitJoiningReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_PERMIT_JOINING_REQ, req);
 }
 
 /*********************************************************************
@@ -215,31 +310,8 @@ uint8_t zbPermitJoiningReq(PermitJoiningReqFormat_t *req)
  */
 uint8_t zbBindDevice(BindDeviceFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Create;
-		cmd[cmInd++] = (uint8_t)(req->CommandId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->CommandId >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->DstIeee, 8);
-		cmInd += 8;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_BIND_DEVICE, cmd, cmdLen);
-
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&bindDeviceDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_BIND_DEVICE, req);
 }
 
 /*********************************************************************
@@ -254,26 +326,8 @@ uint8_t zbBindDevice(BindDeviceFormat_t *req)
  */
 uint8_t zbAllowBind(AllowBindFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Timeout;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_ALLOW_BIND, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&allowBindDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_ALLOW_BIND, req);
 }
 
 /*********************************************************************
@@ -289,39 +343,8 @@ uint8_t zbAllowBind(AllowBindFormat_t *req)
  */
 uint8_t zbSendDataReq(SendDataReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->Destination & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Destination >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->CommandId & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->CommandId >> 8) & 0xFF);
-		cmd[cmInd++] = req->Handle;
-		cmd[cmInd++] = req->Ack;
-		cmd[cmInd++] = req->Radius;
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Data[idx];
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_SEND_DATA_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&sendDataReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_SEND_DATA_REQ, req);
 }
 
 /*********************************************************************
@@ -335,27 +358,8 @@ uint8_t zbSendDataReq(SendDataReqFormat_t *req)
  */
 uint8_t zbFindDeviceReq(FindDeviceReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->SearchKey, 8);
-		cmInd += 8;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_FIND_DEVICE_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&findDeviceReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_FIND_DEVICE_REQ, req);
 }
 
 /*********************************************************************
@@ -369,33 +373,8 @@ uint8_t zbFindDeviceReq(FindDeviceReqFormat_t *req)
  */
 uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = req->ConfigId;
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Value[idx];
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_WRITE_CONFIGURATION, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&writeConfigurationDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_WRITE_CONFIGURATION, req);
 }
 
 /*********************************************************************
@@ -409,26 +388,8 @@ uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req)
  */
 uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Param;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_GET_DEVICE_INFO, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&getDeviceInfoDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_GET_DEVICE_INFO, req);
 }
 
 /*********************************************************************
@@ -443,26 +404,25 @@ uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req)
  */
 uint8_t zbReadConfiguration(ReadConfigurationFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->ConfigId;
+	return mtSendReq(&readConfigurationDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
+	        MT_SAPI_READ_CONFIGURATION, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SAPI),
-		MT_SAPI_READ_CONFIGURATION, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeReadConfigurationSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeReadConfigurationSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        ReadConfigurationSrspFormat_t *rsp)
+{
+	return mtDecode(&readConfigurationSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -481,29 +441,32 @@ static void processReadConfigurationSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiReadConfigurationSrsp)
 	{
-		uint8_t msgIdx = 2;
 		ReadConfigurationSrspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.ConfigId = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 3)
+		if (decodeReadConfigurationSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.Value[i] = rpcBuff[msgIdx++];
-			}
+			mtSapiCbs.pfnSapiReadConfigurationSrsp(&rsp);
 		}
-		mtSapiCbs.pfnSapiReadConfigurationSrsp(&rsp);
 	}
 }
 
+/*********************************************************************
+ * @fn      decodeGetDeviceInfoSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeGetDeviceInfoSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        GetDeviceInfoSrspFormat_t *rsp)
+{
+	return mtDecode(&getDeviceInfoSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processGetDeviceInfoSrsp
  *
@@ -520,22 +483,12 @@ static void processGetDeviceInfoSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiGetDeviceInfoSrsp)
 	{
-		uint8_t msgIdx = 2;
 		GetDeviceInfoSrspFormat_t rsp;
-		if (rpcLen < 9)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Param = rpcBuff[msgIdx++];
-		uint8_t i;
-		for (i = 0; i < 8; i++)
+		if (decodeGetDeviceInfoSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			rsp.Value[i] = rpcBuff[msgIdx++];
+			mtSapiCbs.pfnSapiGetDeviceInfoSrsp(&rsp);
 		}
-
-		mtSapiCbs.pfnSapiGetDeviceInfoSrsp(&rsp);
 	}
 }
 
@@ -555,22 +508,12 @@ static void processFindDeviceCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiFindDeviceCnf)
 	{
-		uint8_t msgIdx = 2;
 		FindDeviceCnfFormat_t rsp;
-		if (rpcLen < 11)
+
+		if (mtDecode(&findDeviceCnfDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtSapiCbs.pfnSapiFindDeviceCnf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SearchKey = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Result = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.Result |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-
-		mtSapiCbs.pfnSapiFindDeviceCnf(&rsp);
 	}
 }
 
@@ -590,18 +533,12 @@ static void processSendDataCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiSendDataCnf)
 	{
-		uint8_t msgIdx = 2;
 		SendDataCnfFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (mtDecode(&sendDataCnfDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtSapiCbs.pfnSapiSendDataCnf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Handle = rpcBuff[msgIdx++];
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtSapiCbs.pfnSapiSendDataCnf(&rsp);
 	}
 }
 
@@ -621,29 +558,12 @@ static void processReceiveDataInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiReceiveDataInd)
 	{
-		uint8_t msgIdx = 2;
 		ReceiveDataIndFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Source = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Command = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Len = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		if (rpcLen > 6)
+
+		if (mtDecode(&receiveDataIndDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.Data[i] = rpcBuff[msgIdx++];
-			}
+			mtSapiCbs.pfnSapiReceiveDataInd(&rsp);
 		}
-		mtSapiCbs.pfnSapiReceiveDataInd(&rsp);
 	}
 }
 
@@ -662,18 +582,12 @@ static void processAllowBindCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiAllowBindCnf)
 	{
-		uint8_t msgIdx = 2;
 		AllowBindCnfFormat_t rsp;
-		if (rpcLen < 2)
+
+		if (mtDecode(&allowBindCnfDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtSapiCbs.pfnSapiAllowBindCnf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Source = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSapiCbs.pfnSapiAllowBindCnf(&rsp);
 	}
 }
 
@@ -692,19 +606,12 @@ static void processBindCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiBindCnf)
 	{
-		uint8_t msgIdx = 2;
 		BindCnfFormat_t rsp;
-		if (rpcLen < 3)
+
+		if (mtDecode(&bindCnfDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtSapiCbs.pfnSapiBindCnf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.CommandId = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtSapiCbs.pfnSapiBindCnf(&rsp);
 	}
 }
 
@@ -723,112 +630,39 @@ static void processStartCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSapiCbs.pfnSapiStartCnf)
 	{
-		uint8_t msgIdx = 2;
 		StartCnfFormat_t rsp;
-		if (rpcLen < 1)
+
+		if (mtDecode(&startCnfDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtSapiCbs.pfnSapiStartCnf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtSapiCbs.pfnSapiStartCnf(&rsp);
 	}
 }
 
 /*********************************************************************
- * @fn      processSrsp
- *
- * @brief  Generic function for processing the SRSP and copying it to
- *         local buffer for SREQ function to deal with
+ * HANDLER TABLE
  *
- * @param
- *
- * @return
+ * Incoming SAPI commands, installed in the MT dispatch table by mtProcess()
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+const mtHandlerEntry_t sapiHandlerTable[] =
 {
-	//copies sresp to local buffer
-	memcpy(srspRpcBuff, rpcBuff, rpcLen);
-	//srspRpcLen = rpcLen;
-	switch (rpcBuff[1])
-	{
-	case MT_SAPI_READ_CONFIGURATION:
-		LOG_DBG(
-		        "sapiProcess: MT_SAPI_READ_CONFIGURATION");
-		processReadConfigurationSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SAPI_GET_DEVICE_INFO:
-		LOG_DBG(
-		        "sapiProcess: MT_SAPI_GET_DEVICE_INFO");
-		processGetDeviceInfoSrsp(rpcBuff, rpcLen);
-		break;
-	default:
-		LOG_WARN("processSrsp: unsupported message  [%x:%x]", rpcBuff[0], rpcBuff[1]);
-		break;
-	}
-
-}
-/*************************************************************************************************
- * @fn      sapiProcess()
- *
- * @brief   read and process the RPC ZDO message from the ZB SoC
- *
- * @param   none
- *
- * @return  length of current Rx Buffer
- ***********************************************************************************************/
-void sapiProcess(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	LOG_DBG("sapiProcess: processing CMD0:%x, CMD1:%x",
-	        rpcBuff[0], rpcBuff[1]);
-
-//process the synchronous SRSP from SREQ
-	if ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-	{
-		processSrsp(rpcBuff, rpcLen);
-	}
-	else
-	{
-		//Read CMD1 and processes the specific SREQ
-		switch (rpcBuff[1])
-		{
-		case MT_SAPI_FIND_DEVICE_CNF:
-			LOG_DBG(
-			        "sapiProcess: MT_SAPI_FIND_DEVICE_CNF");
-			processFindDeviceCnf(rpcBuff, rpcLen);
-			break;
-		case MT_SAPI_SEND_DATA_CNF:
-			LOG_DBG(
-			        "sapiProcess: MT_SAPI_SEND_DATA_CNF");
-			processSendDataCnf(rpcBuff, rpcLen);
-			break;
-		case MT_SAPI_RECEIVE_DATA_IND:
-			LOG_DBG(
-			        "sapiProcess: MT_SAPI_RECEIVE_DATA_IND");
-			processReceiveDataInd(rpcBuff, rpcLen);
-			break;
-		case MT_SAPI_ALLOW_BIND_CNF:
-			LOG_DBG(
-			        "sapiProcess: MT_SAPI_ALLOW_BIND_CNF");
-			processAllowBindCnf(rpcBuff, rpcLen);
-			break;
-		case MT_SAPI_BIND_CNF:
-			LOG_DBG("sapiProcess: MT_SAPI_BIND_CNF");
-			processBindCnf(rpcBuff, rpcLen);
-			break;
-		case MT_SAPI_START_CNF:
-			LOG_DBG("sapiProcess: MT_SAPI_START_CNF");
-			processStartCnf(rpcBuff, rpcLen);
-			break;
-
-		default:
-			LOG_WARN("sapiProcess: CMD0:%x, CMD1:%x, not handled", rpcBuff[0], rpcBuff[1]);
-			break;
-		}
-	}
-}
+	{ MT_RPC_CMD_AREQ, MT_SAPI_FIND_DEVICE_CNF, processFindDeviceCnf,
+	        MT_CB(mtSapiCb_t, pfnSapiFindDeviceCnf) },
+	{ MT_RPC_CMD_AREQ, MT_SAPI_SEND_DATA_CNF, processSendDataCnf,
+	        MT_CB(mtSapiCb_t, pfnSapiSendDataCnf) },
+	{ MT_RPC_CMD_AREQ, MT_SAPI_RECEIVE_DATA_IND, processReceiveDataInd,
+	        MT_CB(mtSapiCb_t, pfnSapiReceiveDataInd) },
+	{ MT_RPC_CMD_AREQ, MT_SAPI_ALLOW_BIND_CNF, processAllowBindCnf,
+	        MT_CB(mtSapiCb_t, pfnSapiAllowBindCnf) },
+	{ MT_RPC_CMD_AREQ, MT_SAPI_BIND_CNF, processBindCnf,
+	        MT_CB(mtSapiCb_t, pfnSapiBindCnf) },
+	{ MT_RPC_CMD_AREQ, MT_SAPI_START_CNF, processStartCnf,
+	        MT_CB(mtSapiCb_t, pfnSapiStartCnf) },
+	{ MT_RPC_CMD_SRSP, MT_SAPI_READ_CONFIGURATION, processReadConfigurationSrsp,
+	        0 },
+	{ MT_RPC_CMD_SRSP, MT_SAPI_GET_DEVICE_INFO, processGetDeviceInfoSrsp, 0 },
+	{ 0, 0, NULL, 0 }
+};
 
 /*********************************************************************
  * @fn      sapiRegisterCallbacks
@@ -842,5 +676,26 @@ void sapiProcess(uint8_t *rpcBuff, uint8_t rpcLen)
 void sapiRegisterCallbacks(mtSapiCb_t cbs)
 {
 	memcpy(&mtSapiCbs, &cbs, sizeof(mtSapiCb_t));
+	mtUpdateInterest(MT_RPC_SYS_SAPI, sapiHandlerTable, &mtSapiCbs);
 }
 
+/*********************************************************************
+ * SYNCHRONOUS REQUESTS
+ *
+ * xxxSync() sends the SREQ, waits up to timeoutMs (0 for the default)
+ * for its SRSP and decodes it into rsp. The SRSP is not passed to the
+ * registered callbacks.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT, MT_RPC_ERR_BUSY or
+ *          MT_RPC_ERR_TRANSPORT
+ */
+MT_SYNC_REQ(zbAppRegisterReq, AppRegisterReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ_VOID(zbStartReq, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbPermitJoiningReq, PermitJoiningReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbBindDevice, BindDeviceFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbAllowBind, AllowBindFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbSendDataReq, SendDataReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbFindDeviceReq, FindDeviceReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbWriteConfiguration, WriteConfigurationFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zbGetDeviceInfo, GetDeviceInfoFormat_t, GetDeviceInfoSrspFormat_t, decodeGetDeviceInfoSrsp)
+MT_SYNC_REQ(zbReadConfiguration, ReadConfigurationFormat_t, ReadConfigurationSrspFormat_t, decodeReadConfigurationSrsp)
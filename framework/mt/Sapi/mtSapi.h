@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include "mtParser.h"
 #include "mtAf.h"
 
 /***************************************************************************************************
@@ -212,7 +213,7 @@ typedef struct
 }mtSapiCb_t;
 
 void sapiRegisterCallbacks(mtSapiCb_t cbs);
-void sapiProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+extern const mtHandlerEntry_t sapiHandlerTable[];
 uint8_t zbSystemReset ( void );
 uint8_t zbAppRegisterReq(AppRegisterReqFormat_t *req);
 uint8_t zbStartReq(void);
@@ -225,6 +226,27 @@ uint8_t zbWriteConfiguration(WriteConfigurationFormat_t *req);
 uint8_t zbGetDeviceInfo(GetDeviceInfoFormat_t *req);
 uint8_t zbReadConfiguration(ReadConfigurationFormat_t *req);
 
+// synchronous variants, return the decoded SRSP
+uint8_t zbAppRegisterReqSync(AppRegisterReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbStartReqSync(StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbPermitJoiningReqSync(PermitJoiningReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbBindDeviceSync(BindDeviceFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbAllowBindSync(AllowBindFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbSendDataReqSync(SendDataReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbFindDeviceReqSync(FindDeviceReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbWriteConfigurationSync(WriteConfigurationFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbGetDeviceInfoSync(GetDeviceInfoFormat_t *req,
+        GetDeviceInfoSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zbReadConfigurationSync(ReadConfigurationFormat_t *req,
+        ReadConfigurationSrspFormat_t *rsp, uint32_t timeoutMs);
+
 #ifdef __cplusplus
 }
 #endif
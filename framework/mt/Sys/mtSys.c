@@ -45,26 +45,281 @@
 
 #include "mtSys.h"
 #include "mtParser.h"
+#include "mtCodec.h"
 #include "rpc.h"
 #include "dbgPrint.h"
 
 /*********************************************************************
- * MACROS
+ * LOCAL VARIABLE
  */
-#define HI_UINT16(a) (((a) >> 8) & 0xFF)
-#define LO_UINT16(a) ((a) & 0xFF)
+static mtSysCb_t mtSysCbs;
 
 /*********************************************************************
- * LOCAL VARIABLE
+ * COMMAND LAYOUTS
+ *
+ * Wire format of the requests and callbacks packed and unpacked by
+ * mtCodec.c
  */
-static mtSysCb_t mtSysCbs;
-extern uint8_t srspRpcBuff[RPC_MAX_LEN];
-extern uint8_t srspRpcLen;
+
+// requests
+static const mtField_t setExtAddrFields[] =
+{
+	MT_BYTES(SetExtAddrFormat_t, ExtAddr)
+};
+static const mtCmdDesc_t setExtAddrDesc =
+        MT_DESC(SetExtAddrFormat_t, setExtAddrFields);
+
+static const mtField_t ramReadFields[] =
+{
+	MT_U16(RamReadFormat_t, Address),
+	MT_U8(RamReadFormat_t, Len)
+};
+static const mtCmdDesc_t ramReadDesc = MT_DESC(RamReadFormat_t, ramReadFields);
+
+static const mtField_t ramWriteFields[] =
+{
+	MT_U16(RamWriteFormat_t, Address),
+	MT_U8(RamWriteFormat_t, Len),
+	MT_LIST_U8(RamWriteFormat_t, Value, Len)
+};
+static const mtCmdDesc_t ramWriteDesc =
+        MT_DESC(RamWriteFormat_t, ramWriteFields);
+
+static const mtField_t resetReqFields[] =
+{
+	MT_U8(ResetReqFormat_t, Type)
+};
+static const mtCmdDesc_t resetReqDesc =
+        MT_DESC(ResetReqFormat_t, resetReqFields);
+
+static const mtField_t osalNvReadFields[] =
+{
+	MT_U16(OsalNvReadFormat_t, Id),
+	MT_U8(OsalNvReadFormat_t, Offset)
+};
+static const mtCmdDesc_t osalNvReadDesc =
+        MT_DESC(OsalNvReadFormat_t, osalNvReadFields);
+
+static const mtField_t osalNvWriteFields[] =
+{
+	MT_U16(OsalNvWriteFormat_t, Id),
+	MT_U8(OsalNvWriteFormat_t, Offset),
+	MT_U8(OsalNvWriteFormat_t, Len),
+	MT_LIST_U8(OsalNvWriteFormat_t, Value, Len)
+};
+static const mtCmdDesc_t osalNvWriteDesc =
+        MT_DESC(OsalNvWriteFormat_t, osalNvWriteFields);
+
+static const mtField_t osalNvItemInitFields[] =
+{
+	MT_U16(OsalNvItemInitFormat_t, Id),
+	MT_U16(OsalNvItemInitFormat_t, ItemLen),
+	MT_U8(OsalNvItemInitFormat_t, InitLen),
+	MT_LIST_U8(OsalNvItemInitFormat_t, InitData, InitLen)
+};
+static const mtCmdDesc_t osalNvItemInitDesc =
+        MT_DESC(OsalNvItemInitFormat_t, osalNvItemInitFields);
+
+static const mtField_t osalNvDeleteFields[] =
+{
+	MT_U16(OsalNvDeleteFormat_t, Id),
+	MT_U16(OsalNvDeleteFormat_t, ItemLen)
+};
+static const mtCmdDesc_t osalNvDeleteDesc =
+        MT_DESC(OsalNvDeleteFormat_t, osalNvDeleteFields);
+
+static const mtField_t osalNvLengthFields[] =
+{
+	MT_U16(OsalNvLengthFormat_t, Id)
+};
+static const mtCmdDesc_t osalNvLengthDesc =
+        MT_DESC(OsalNvLengthFormat_t, osalNvLengthFields);
+
+static const mtField_t osalStartTimerFields[] =
+{
+	MT_U8(OsalStartTimerFormat_t, Id),
+	MT_U16(OsalStartTimerFormat_t, Timeout)
+};
+static const mtCmdDesc_t osalStartTimerDesc =
+        MT_DESC(OsalStartTimerFormat_t, osalStartTimerFields);
+
+static const mtField_t osalStopTimerFields[] =
+{
+	MT_U8(OsalStopTimerFormat_t, Id)
+};
+static const mtCmdDesc_t osalStopTimerDesc =
+        MT_DESC(OsalStopTimerFormat_t, osalStopTimerFields);
+
+static const mtField_t stackTuneFields[] =
+{
+	MT_U8(StackTuneFormat_t, Operation),
+	MT_U8(StackTuneFormat_t, Value)
+};
+static const mtCmdDesc_t stackTuneDesc =
+        MT_DESC(StackTuneFormat_t, stackTuneFields);
+
+static const mtField_t adcReadFields[] =
+{
+	MT_U8(AdcReadFormat_t, Channel),
+	MT_U8(AdcReadFormat_t, Resolution)
+};
+static const mtCmdDesc_t adcReadDesc = MT_DESC(AdcReadFormat_t, adcReadFields);
+
+static const mtField_t gpioFields[] =
+{
+	MT_U8(GpioFormat_t, Operation),
+	MT_U8(GpioFormat_t, Value)
+};
+static const mtCmdDesc_t gpioDesc = MT_DESC(GpioFormat_t, gpioFields);
+
+static const mtField_t setTimeFields[] =
+{
+	MT_BYTES(SetTimeFormat_t, UTCTime),
+	MT_U8(SetTimeFormat_t, Hour),
+	MT_U8(SetTimeFormat_t, Minute),
+	MT_U8(SetTimeFormat_t, Second),
+	MT_U8(SetTimeFormat_t, Month),
+	MT_U8(SetTimeFormat_t, Day),
+	MT_U16(SetTimeFormat_t, Year)
+};
+static const mtCmdDesc_t setTimeDesc = MT_DESC(SetTimeFormat_t, setTimeFields);
+
+static const mtField_t setTxPowerFields[] =
+{
+	MT_U8(SetTxPowerFormat_t, TxPower)
+};
+static const mtCmdDesc_t setTxPowerDesc =
+        MT_DESC(SetTxPowerFormat_t, setTxPowerFields);
+
+// responses
+static const mtField_t pingSrspFields[] =
+{
+	MT_U16(PingSrspFormat_t, Capabilities)
+};
+static const mtCmdDesc_t pingSrspDesc =
+        MT_DESC(PingSrspFormat_t, pingSrspFields);
+
+static const mtField_t getExtAddrSrspFields[] =
+{
+	MT_U64(GetExtAddrSrspFormat_t, ExtAddr)
+};
+static const mtCmdDesc_t getExtAddrSrspDesc =
+        MT_DESC(GetExtAddrSrspFormat_t, getExtAddrSrspFields);
+
+static const mtField_t ramReadSrspFields[] =
+{
+	MT_U8(RamReadSrspFormat_t, Status),
+	MT_U8(RamReadSrspFormat_t, Len),
+	MT_LIST_U8(RamReadSrspFormat_t, Value, Len)
+};
+static const mtCmdDesc_t ramReadSrspDesc =
+        MT_DESC(RamReadSrspFormat_t, ramReadSrspFields);
+
+static const mtField_t versionSrspFields[] =
+{
+	MT_U8(VersionSrspFormat_t, TransportRev),
+	MT_U8(VersionSrspFormat_t, Product),
+	MT_U8(VersionSrspFormat_t, MajorRel),
+	MT_U8(VersionSrspFormat_t, MinorRel),
+	MT_U8(VersionSrspFormat_t, MaintRel)
+};
+static const mtCmdDesc_t versionSrspDesc =
+        MT_DESC(VersionSrspFormat_t, versionSrspFields);
+
+static const mtField_t osalNvReadSrspFields[] =
+{
+	MT_U8(OsalNvReadSrspFormat_t, Status),
+	MT_U8(OsalNvReadSrspFormat_t, Len),
+	MT_LIST_U8(OsalNvReadSrspFormat_t, Value, Len)
+};
+static const mtCmdDesc_t osalNvReadSrspDesc =
+        MT_DESC(OsalNvReadSrspFormat_t, osalNvReadSrspFields);
+
+static const mtField_t osalNvWriteSrspFields[] =
+{
+	MT_U8(OsalNvWriteSrspFormat_t, Status)
+};
+static const mtCmdDesc_t osalNvWriteSrspDesc =
+        MT_DESC(OsalNvWriteSrspFormat_t, osalNvWriteSrspFields);
+
+static const mtField_t osalNvLengthSrspFields[] =
+{
+	MT_U16(OsalNvLengthSrspFormat_t, ItemLen)
+};
+static const mtCmdDesc_t osalNvLengthSrspDesc =
+        MT_DESC(OsalNvLengthSrspFormat_t, osalNvLengthSrspFields);
+
+static const mtField_t stackTuneSrspFields[] =
+{
+	MT_U8(StackTuneSrspFormat_t, Value)
+};
+static const mtCmdDesc_t stackTuneSrspDesc =
+        MT_DESC(StackTuneSrspFormat_t, stackTuneSrspFields);
+
+static const mtField_t adcReadSrspFields[] =
+{
+	MT_U16(AdcReadSrspFormat_t, Value)
+};
+static const mtCmdDesc_t adcReadSrspDesc =
+        MT_DESC(AdcReadSrspFormat_t, adcReadSrspFields);
+
+static const mtField_t gpioSrspFields[] =
+{
+	MT_U8(GpioSrspFormat_t, Value)
+};
+static const mtCmdDesc_t gpioSrspDesc =
+        MT_DESC(GpioSrspFormat_t, gpioSrspFields);
+
+static const mtField_t randomSrspFields[] =
+{
+	MT_U16(RandomSrspFormat_t, Value)
+};
+static const mtCmdDesc_t randomSrspDesc =
+        MT_DESC(RandomSrspFormat_t, randomSrspFields);
+
+static const mtField_t getTimeSrspFields[] =
+{
+	MT_U32(GetTimeSrspFormat_t, UTCTime),
+	MT_U8(GetTimeSrspFormat_t, Hour),
+	MT_U8(GetTimeSrspFormat_t, Minute),
+	MT_U8(GetTimeSrspFormat_t, Second),
+	MT_U8(GetTimeSrspFormat_t, Month),
+	MT_U8(GetTimeSrspFormat_t, Day),
+	MT_U16(GetTimeSrspFormat_t, Year)
+};
+static const mtCmdDesc_t getTimeSrspDesc =
+        MT_DESC(GetTimeSrspFormat_t, getTimeSrspFields);
+
+static const mtField_t setTxPowerSrspFields[] =
+{
+	MT_U8(SetTxPowerSrspFormat_t, TxPower)
+};
+static const mtCmdDesc_t setTxPowerSrspDesc =
+        MT_DESC(SetTxPowerSrspFormat_t, setTxPowerSrspFields);
+
+// callbacks
+static const mtField_t resetIndFields[] =
+{
+	MT_U8(ResetIndFormat_t, Reason),
+	MT_U8(ResetIndFormat_t, TransportRev),
+	MT_U8(ResetIndFormat_t, ProductId),
+	MT_U8(ResetIndFormat_t, MajorRel),
+	MT_U8(ResetIndFormat_t, MinorRel),
+	MT_U8(ResetIndFormat_t, HwRev)
+};
+static const mtCmdDesc_t resetIndDesc =
+        MT_DESC(ResetIndFormat_t, resetIndFields);
+
+static const mtField_t osalTimerExpiredFields[] =
+{
+	MT_U8(OsalTimerExpiredFormat_t, Id)
+};
+static const mtCmdDesc_t osalTimerExpiredDesc =
+        MT_DESC(OsalTimerExpiredFormat_t, osalTimerExpiredFields);
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processResetInd(uint8_t *rpcBuff, uint8_t rpcLen);
 
 /*********************************************************************
@@ -86,6 +341,23 @@ uint8_t sysPing()
 	return status;
 }
 
+/*********************************************************************
+ * @fn      decodePingSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodePingSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        PingSrspFormat_t *rsp)
+{
+	return mtDecode(&pingSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processPingSrsp
  *
@@ -101,19 +373,12 @@ static void processPingSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysPingSrsp)
 	{
-		uint8_t msgIdx = 2;
 		PingSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodePingSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysPingSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Capabilities = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSysCbs.pfnSysPingSrsp(&rsp);
 	}
 }
 
@@ -128,27 +393,8 @@ static void processPingSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysSetExtAddr(SetExtAddrFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->ExtAddr, 8);
-		cmInd += 8;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_SET_EXTADDR, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&setExtAddrDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_SET_EXTADDR, req);
 }
 
 /*********************************************************************
@@ -169,6 +415,23 @@ uint8_t sysGetExtAddr()
 	return status;
 }
 
+/*********************************************************************
+ * @fn      decodeGetExtAddrSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeGetExtAddrSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        GetExtAddrSrspFormat_t *rsp)
+{
+	return mtDecode(&getExtAddrSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processGetExtAddrSrsp
  *
@@ -182,21 +445,12 @@ static void processGetExtAddrSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysGetExtAddrSrsp)
 	{
-		uint8_t msgIdx = 2;
 		GetExtAddrSrspFormat_t rsp;
-		if (rpcLen < 8)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeGetExtAddrSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysGetExtAddrSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.ExtAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.ExtAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-
-		mtSysCbs.pfnSysGetExtAddrSrsp(&rsp);
 	}
 }
 
@@ -211,28 +465,25 @@ static void processGetExtAddrSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysRamRead(RamReadFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->Address & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Address >> 8) & 0xFF);
-		cmd[cmInd++] = req->Len;
+	return mtSendReq(&ramReadDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_RAM_READ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_RAM_READ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeRamReadSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeRamReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        RamReadSrspFormat_t *rsp)
+{
+	return mtDecode(&ramReadSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -250,26 +501,12 @@ static void processRamReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysRamReadSrsp)
 	{
-		uint8_t msgIdx = 2;
 		RamReadSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 2)
+		if (decodeRamReadSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.Value[i] = rpcBuff[msgIdx++];
-			}
+			mtSysCbs.pfnSysRamReadSrsp(&rsp);
 		}
-		mtSysCbs.pfnSysRamReadSrsp(&rsp);
 	}
 }
 
@@ -284,34 +521,8 @@ static void processRamReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysRamWrite(RamWriteFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->Address & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Address >> 8) & 0xFF);
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Value[idx];
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_RAM_WRITE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&ramWriteDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_RAM_WRITE, req);
 }
 
 /*********************************************************************
@@ -325,26 +536,8 @@ uint8_t sysRamWrite(RamWriteFormat_t *req)
  */
 uint8_t sysResetReq(ResetReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Type;
-
-		status = rpcSendFrame((MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS),
-		MT_SYS_RESET_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&resetReqDesc, (MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_RESET_REQ, req);
 }
 
 /*********************************************************************
@@ -362,23 +555,12 @@ static void processResetInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysResetInd)
 	{
-		uint8_t msgIdx = 2;
 		ResetIndFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&resetIndDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysResetInd(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Reason = rpcBuff[msgIdx++];
-		rsp.TransportRev = rpcBuff[msgIdx++];
-		rsp.ProductId = rpcBuff[msgIdx++];
-		rsp.MajorRel = rpcBuff[msgIdx++];
-		rsp.MinorRel = rpcBuff[msgIdx++];
-		rsp.HwRev = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysResetInd(&rsp);
 	}
 }
 
@@ -401,6 +583,23 @@ uint8_t sysVersion()
 	return status;
 }
 
+/*********************************************************************
+ * @fn      decodeVersionSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeVersionSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        VersionSrspFormat_t *rsp)
+{
+	return mtDecode(&versionSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processVersionSrsp
  *
@@ -416,22 +615,12 @@ static void processVersionSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysVersionSrsp)
 	{
-		uint8_t msgIdx = 2;
 		VersionSrspFormat_t rsp;
-		if (rpcLen < 5)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeVersionSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysVersionSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.TransportRev = rpcBuff[msgIdx++];
-		rsp.Product = rpcBuff[msgIdx++];
-		rsp.MajorRel = rpcBuff[msgIdx++];
-		rsp.MinorRel = rpcBuff[msgIdx++];
-		rsp.MaintRel = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysVersionSrsp(&rsp);
 	}
 }
 
@@ -447,28 +636,25 @@ static void processVersionSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysOsalNvRead(OsalNvReadFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
-		cmd[cmInd++] = req->Offset;
+	return mtSendReq(&osalNvReadDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_NV_READ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_READ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeOsalNvReadSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeOsalNvReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        OsalNvReadSrspFormat_t *rsp)
+{
+	return mtDecode(&osalNvReadSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -486,26 +672,12 @@ static void processOsalNvReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysOsalNvReadSrsp)
 	{
-		uint8_t msgIdx = 2;
 		OsalNvReadSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 2)
+		if (decodeOsalNvReadSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.Value[i] = rpcBuff[msgIdx++];
-			}
+			mtSysCbs.pfnSysOsalNvReadSrsp(&rsp);
 		}
-		mtSysCbs.pfnSysOsalNvReadSrsp(&rsp);
 	}
 }
 
@@ -520,35 +692,25 @@ static void processOsalNvReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysOsalNvWrite(OsalNvWriteFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
-		cmd[cmInd++] = req->Offset;
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->Value[idx];
-		}
+	return mtSendReq(&osalNvWriteDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_NV_WRITE, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_WRITE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeOsalNvWriteSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeOsalNvWriteSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        OsalNvWriteSrspFormat_t *rsp)
+{
+	return mtDecode(&osalNvWriteSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -566,16 +728,12 @@ static void processOsalNvWriteSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysOsalNvWriteSrsp)
 	{
-		uint8_t msgIdx = 2;
 		OsalNvWriteSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeOsalNvWriteSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysOsalNvWriteSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtSysCbs.pfnSysOsalNvWriteSrsp(&rsp);
 	}
 }
 
@@ -591,36 +749,8 @@ static void processOsalNvWriteSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 5 + req->InitLen;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->ItemLen & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ItemLen >> 8) & 0xFF);
-		cmd[cmInd++] = req->InitLen;
-		for (idx = 0; idx < req->InitLen; idx++)
-		{
-			cmd[cmInd++] = req->InitData[idx];
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_ITEM_INIT, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&osalNvItemInitDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_NV_ITEM_INIT, req);
 }
 
 /*********************************************************************
@@ -635,29 +765,8 @@ uint8_t sysOsalNvItemInit(OsalNvItemInitFormat_t *req)
  */
 uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->ItemLen & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ItemLen >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_DELETE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&osalNvDeleteDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_NV_DELETE, req);
 }
 
 /*********************************************************************
@@ -672,27 +781,25 @@ uint8_t sysOsalNvDelete(OsalNvDeleteFormat_t *req)
  */
 uint8_t sysOsalNvLength(OsalNvLengthFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->Id & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Id >> 8) & 0xFF);
+	return mtSendReq(&osalNvLengthDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_NV_LENGTH, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_NV_LENGTH, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeOsalNvLengthSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeOsalNvLengthSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        OsalNvLengthSrspFormat_t *rsp)
+{
+	return mtDecode(&osalNvLengthSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -710,19 +817,12 @@ static void processOsalNvLengthSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysOsalNvLengthSrsp)
 	{
-		uint8_t msgIdx = 2;
 		OsalNvLengthSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeOsalNvLengthSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysOsalNvLengthSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.ItemLen = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSysCbs.pfnSysOsalNvLengthSrsp(&rsp);
 	}
 }
 
@@ -739,28 +839,8 @@ static void processOsalNvLengthSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysOsalStartTimer(OsalStartTimerFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Id;
-		cmd[cmInd++] = (uint8_t)(req->Timeout & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Timeout >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_START_TIMER, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&osalStartTimerDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_START_TIMER, req);
 }
 
 /*********************************************************************
@@ -774,26 +854,8 @@ uint8_t sysOsalStartTimer(OsalStartTimerFormat_t *req)
  */
 uint8_t sysOsalStopTimer(OsalStopTimerFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Id;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_OSAL_STOP_TIMER, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&osalStopTimerDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_OSAL_STOP_TIMER, req);
 }
 
 /*********************************************************************
@@ -810,18 +872,12 @@ static void processOsalTimerExpired(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysOsalTimerExpired)
 	{
-		uint8_t msgIdx = 2;
 		OsalTimerExpiredFormat_t rsp;
-		if (rpcLen < 1)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&osalTimerExpiredDesc, rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysOsalTimerExpired(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Id = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysOsalTimerExpired(&rsp);
 	}
 }
 
@@ -836,27 +892,25 @@ static void processOsalTimerExpired(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysStackTune(StackTuneFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Operation;
-		cmd[cmInd++] = req->Value;
+	return mtSendReq(&stackTuneDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_STACK_TUNE, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_STACK_TUNE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeStackTuneSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeStackTuneSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        StackTuneSrspFormat_t *rsp)
+{
+	return mtDecode(&stackTuneSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -874,18 +928,12 @@ static void processStackTuneSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysStackTuneSrsp)
 	{
-		uint8_t msgIdx = 2;
 		StackTuneSrspFormat_t rsp;
-		if (rpcLen < 1)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeStackTuneSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysStackTuneSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Value = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysStackTuneSrsp(&rsp);
 	}
 }
 
@@ -900,27 +948,25 @@ static void processStackTuneSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysAdcRead(AdcReadFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Channel;
-		cmd[cmInd++] = req->Resolution;
+	return mtSendReq(&adcReadDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_ADC_READ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_ADC_READ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeAdcReadSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeAdcReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        AdcReadSrspFormat_t *rsp)
+{
+	return mtDecode(&adcReadSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -938,19 +984,12 @@ static void processAdcReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysAdcReadSrsp)
 	{
-		uint8_t msgIdx = 2;
 		AdcReadSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeAdcReadSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysAdcReadSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Value = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSysCbs.pfnSysAdcReadSrsp(&rsp);
 	}
 }
 
@@ -965,27 +1004,25 @@ static void processAdcReadSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysGpio(GpioFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Operation;
-		cmd[cmInd++] = req->Value;
+	return mtSendReq(&gpioDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_GPIO, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_GPIO, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeGpioSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeGpioSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        GpioSrspFormat_t *rsp)
+{
+	return mtDecode(&gpioSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -1003,18 +1040,12 @@ static void processGpioSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysGpioSrsp)
 	{
-		uint8_t msgIdx = 2;
 		GpioSrspFormat_t rsp;
-		if (rpcLen < 1)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeGpioSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysGpioSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Value = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysGpioSrsp(&rsp);
 	}
 }
 
@@ -1036,6 +1067,23 @@ uint8_t sysRandom()
 	return status;
 }
 
+/*********************************************************************
+ * @fn      decodeRandomSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeRandomSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        RandomSrspFormat_t *rsp)
+{
+	return mtDecode(&randomSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processRandomSrsp
  *
@@ -1051,19 +1099,12 @@ static void processRandomSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysRandomSrsp)
 	{
-		uint8_t msgIdx = 2;
 		RandomSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeRandomSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysRandomSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Value = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSysCbs.pfnSysRandomSrsp(&rsp);
 	}
 }
 
@@ -1080,34 +1121,8 @@ static void processRandomSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysSetTime(SetTimeFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->UTCTime, 4);
-		cmInd += 4;
-		cmd[cmInd++] = req->Hour;
-		cmd[cmInd++] = req->Minute;
-		cmd[cmInd++] = req->Second;
-		cmd[cmInd++] = req->Month;
-		cmd[cmInd++] = req->Day;
-		cmd[cmInd++] = (uint8_t)(req->Year & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->Year >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_SET_TIME, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&setTimeDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_SET_TIME, req);
 }
 
 /*********************************************************************
@@ -1128,6 +1143,23 @@ uint8_t sysGetTime()
 	return status;
 }
 
+/*********************************************************************
+ * @fn      decodeGetTimeSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeGetTimeSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        GetTimeSrspFormat_t *rsp)
+{
+	return mtDecode(&getTimeSrspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processGetTimeSrsp
  *
@@ -1143,28 +1175,12 @@ static void processGetTimeSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysGetTimeSrsp)
 	{
-		uint8_t msgIdx = 2;
 		GetTimeSrspFormat_t rsp;
-		if (rpcLen < 11)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeGetTimeSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysGetTimeSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.UTCTime = 0;
-		uint8_t i;
-		for (i = 0; i < 4; i++)
-			rsp.UTCTime |= ((uint32_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.Hour = rpcBuff[msgIdx++];
-		rsp.Minute = rpcBuff[msgIdx++];
-		rsp.Second = rpcBuff[msgIdx++];
-		rsp.Month = rpcBuff[msgIdx++];
-		rsp.Day = rpcBuff[msgIdx++];
-		rsp.Year = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtSysCbs.pfnSysGetTimeSrsp(&rsp);
 	}
 }
 
@@ -1179,26 +1195,25 @@ static void processGetTimeSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t sysSetTxPower(SetTxPowerFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->TxPower;
+	return mtSendReq(&setTxPowerDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
+	        MT_SYS_SET_TX_POWER, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS),
-		MT_SYS_SET_TX_POWER, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+/*********************************************************************
+ * @fn      decodeSetTxPowerSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeSetTxPowerSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        SetTxPowerSrspFormat_t *rsp)
+{
+	return mtDecode(&setTxPowerSrspDesc, rpcBuff, rpcLen, rsp);
 }
 
 /*********************************************************************
@@ -1216,18 +1231,12 @@ static void processSetTxPowerSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtSysCbs.pfnSysSetTxPowerSrsp)
 	{
-		uint8_t msgIdx = 2;
 		SetTxPowerSrspFormat_t rsp;
-		if (rpcLen < 1)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeSetTxPowerSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtSysCbs.pfnSysSetTxPowerSrsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.TxPower = rpcBuff[msgIdx++];
-
-		mtSysCbs.pfnSysSetTxPowerSrsp(&rsp);
 	}
 }
 
@@ -1242,123 +1251,63 @@ static void processSetTxPowerSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 void sysRegisterCallbacks(mtSysCb_t cbs)
 {
 	memcpy(&mtSysCbs, &cbs, sizeof(mtSysCb_t));
+	mtUpdateInterest(MT_RPC_SYS_SYS, sysHandlerTable, &mtSysCbs);
 }
 
 /*********************************************************************
- * @fn      processSrsp
- *
- * @brief  Generic function for processing the SRSP and copying it to
- *         local buffer for SREQ function to deal with
+ * HANDLER TABLE
  *
- * @param
- *
-
+ * Incoming SYS commands, installed in the MT dispatch table by mtProcess()
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+const mtHandlerEntry_t sysHandlerTable[] =
 {
-	//copies sresp to local buffer
-	memcpy(srspRpcBuff, rpcBuff, rpcLen);
-	//srspRpcLen = rpcLen;
-	switch (rpcBuff[1])
-	{
-	case MT_SYS_PING:
-		LOG_DBG("sysProcess: MT_SYS_PING");
-		processPingSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_GET_EXTADDR:
-		LOG_DBG("sysProcess: MT_SYS_GET_EXTADDR");
-		processGetExtAddrSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_RAM_READ:
-		LOG_DBG("sysProcess: MT_SYS_RAM_READ");
-		processRamReadSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_VERSION:
-		LOG_DBG("sysProcess: MT_SYS_VERSION");
-		processVersionSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_OSAL_NV_READ:
-		LOG_DBG("sysProcess: MT_SYS_OSAL_NV_READ");
-		processOsalNvReadSrsp(rpcBuff, rpcLen);
-        break;
-	case MT_SYS_OSAL_NV_WRITE:
-		LOG_DBG("sysProcess: MT_SYS_OSAL_NV_WRITE");
-		processOsalNvWriteSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_OSAL_NV_LENGTH:
-		LOG_DBG("sysProcess: MT_SYS_OSAL_NV_LENGTH");
-		processOsalNvLengthSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_STACK_TUNE:
-		LOG_DBG("sysProcess: MT_SYS_STACK_TUNE");
-		processStackTuneSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_ADC_READ:
-		LOG_DBG("sysProcess: MT_SYS_ADC_READ");
-		processAdcReadSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_GPIO:
-		LOG_DBG("sysProcess: MT_SYS_GPIO");
-		processGpioSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_RANDOM:
-		LOG_DBG("sysProcess: MT_SYS_RANDOM");
-		processRandomSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_GET_TIME:
-		LOG_DBG("sysProcess: MT_SYS_GET_TIME");
-		processGetTimeSrsp(rpcBuff, rpcLen);
-		break;
-	case MT_SYS_SET_TX_POWER:
-		LOG_DBG("sysProcess: MT_SYS_SET_TX_POWER");
-		processSetTxPowerSrsp(rpcBuff, rpcLen);
-		break;
-	default:
-		LOG_WARN("processSrsp: unsupported SYS message : %d (0x%02X)", rpcBuff[1], rpcBuff[1]);
-		break;
-	}
-
-}
+	{ MT_RPC_CMD_AREQ, MT_SYS_RESET_IND, processResetInd,
+	        MT_CB(mtSysCb_t, pfnSysResetInd) },
+	{ MT_RPC_CMD_AREQ, MT_SYS_OSAL_TIMER_EXPIRED, processOsalTimerExpired,
+	        MT_CB(mtSysCb_t, pfnSysOsalTimerExpired) },
+	{ MT_RPC_CMD_SRSP, MT_SYS_PING, processPingSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_GET_EXTADDR, processGetExtAddrSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_RAM_READ, processRamReadSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_VERSION, processVersionSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_OSAL_NV_READ, processOsalNvReadSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_OSAL_NV_WRITE, processOsalNvWriteSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_OSAL_NV_LENGTH, processOsalNvLengthSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_STACK_TUNE, processStackTuneSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_ADC_READ, processAdcReadSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_GPIO, processGpioSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_RANDOM, processRandomSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_GET_TIME, processGetTimeSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_SYS_SET_TX_POWER, processSetTxPowerSrsp, 0 },
+	{ 0, 0, NULL, 0 }
+};
 
-/*************************************************************************************************
- * @fn      sysProcess()
- *
- * @brief   read and process the RPC Sys message from the ZB SoC
+/*********************************************************************
+ * SYNCHRONOUS REQUESTS
  *
- * @param   rpcLen has the size of the frame: cmd0 + cmd1 + payload + FCS
+ * xxxSync() sends the SREQ, waits up to timeoutMs (0 for the default)
+ * for its SRSP and decodes it into rsp. The SRSP is not passed to the
+ * registered callbacks.
  *
-
- *************************************************************************************************/
-void sysProcess(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	LOG_DBG("sysProcess: processing CMD0:%x, CMD1:%x",
-	        rpcBuff[0], rpcBuff[1]);
-
-	//process the synchronous SRSP from SREQ
-	if ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-	{
-		processSrsp(rpcBuff, rpcLen);
-	}
-	else
-	{
-		//Read CMD1 and processes the specific SREQ
-		switch (rpcBuff[1])
-		{
-		case MT_SYS_RESET_IND:
-			LOG_DBG("sysProcess: MT_SYS_RESET_IND");
-			processResetInd(rpcBuff, rpcLen);
-			break;
-		case MT_SYS_OSAL_TIMER_EXPIRED:
-			LOG_DBG(
-			        "sysProcess: MT_SYS_OSAL_TIMER_EXPIRED");
-			processOsalTimerExpired(rpcBuff, rpcLen);
-			break;
-		default:
-			LOG_ERR(
-			        "processRpcSys: CMD0:%x, CMD1:%x, not handled",
-			        rpcBuff[0], rpcBuff[1]);
-			break;
-		}
-	}
-}
-
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT, MT_RPC_ERR_BUSY or
+ *          MT_RPC_ERR_TRANSPORT
+ */
+MT_SYNC_REQ_VOID(sysPing, PingSrspFormat_t, decodePingSrsp)
+MT_SYNC_REQ(sysSetExtAddr, SetExtAddrFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ_VOID(sysGetExtAddr, GetExtAddrSrspFormat_t, decodeGetExtAddrSrsp)
+MT_SYNC_REQ(sysRamRead, RamReadFormat_t, RamReadSrspFormat_t, decodeRamReadSrsp)
+MT_SYNC_REQ(sysRamWrite, RamWriteFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ_VOID(sysVersion, VersionSrspFormat_t, decodeVersionSrsp)
+MT_SYNC_REQ(sysOsalNvRead, OsalNvReadFormat_t, OsalNvReadSrspFormat_t, decodeOsalNvReadSrsp)
+MT_SYNC_REQ(sysOsalNvWrite, OsalNvWriteFormat_t, OsalNvWriteSrspFormat_t, decodeOsalNvWriteSrsp)
+MT_SYNC_REQ(sysOsalNvItemInit, OsalNvItemInitFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(sysOsalNvDelete, OsalNvDeleteFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(sysOsalNvLength, OsalNvLengthFormat_t, OsalNvLengthSrspFormat_t, decodeOsalNvLengthSrsp)
+MT_SYNC_REQ(sysOsalStartTimer, OsalStartTimerFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(sysOsalStopTimer, OsalStopTimerFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(sysStackTune, StackTuneFormat_t, StackTuneSrspFormat_t, decodeStackTuneSrsp)
+MT_SYNC_REQ(sysAdcRead, AdcReadFormat_t, AdcReadSrspFormat_t, decodeAdcReadSrsp)
+MT_SYNC_REQ(sysGpio, GpioFormat_t, GpioSrspFormat_t, decodeGpioSrsp)
+MT_SYNC_REQ_VOID(sysRandom, RandomSrspFormat_t, decodeRandomSrsp)
+MT_SYNC_REQ(sysSetTime, SetTimeFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ_VOID(sysGetTime, GetTimeSrspFormat_t, decodeGetTimeSrsp)
+MT_SYNC_REQ(sysSetTxPower, SetTxPowerFormat_t, SetTxPowerSrspFormat_t, decodeSetTxPowerSrsp)
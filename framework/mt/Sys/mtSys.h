@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include "mtParser.h"
 
 /***************************************************************************************************
  * SYS COMMANDS
@@ -127,7 +128,8 @@ extern "C"
 #define ZCD_NV_APS_USE_INSECURE_JOIN      0x0048
 #define ZCD_NV_COMMISSIONED_NWK_ADDR      0x0049
 
-#define ZCD_NV_APS_NONMEMBER_RADIUS       0x004B     // Multicast non_member radius#define ZCD_NV_APS_LINK_KEY_TABLE         0x004C
+#define ZCD_NV_APS_NONMEMBER_RADIUS       0x004B     // Multicast non_member radius
+#define ZCD_NV_APS_LINK_KEY_TABLE         0x004C
 #define ZCD_NV_APS_DUPREJ_TIMEOUT_INC     0x004D
 #define ZCD_NV_APS_DUPREJ_TIMEOUT_COUNT   0x004E
 #define ZCD_NV_APS_DUPREJ_TABLE_SIZE      0x004F
@@ -207,11 +209,13 @@ extern "C"
 
 // NV Items Reserved for APS Link Key Table entries
 // 0x0201 - 0x02FF
-#define ZCD_NV_APS_LINK_KEY_DATA_START    0x0201     // APS key data#define ZCD_NV_APS_LINK_KEY_DATA_END      0x02FF
+#define ZCD_NV_APS_LINK_KEY_DATA_START    0x0201     // APS key data
+#define ZCD_NV_APS_LINK_KEY_DATA_END      0x02FF
 
 // NV Items Reserved for Master Key Table entries
 // 0x0301 - 0x03FF
-#define ZCD_NV_MASTER_KEY_DATA_START      0x0301     // Master key data#define ZCD_NV_MASTER_KEY_DATA_END        0x03FF
+#define ZCD_NV_MASTER_KEY_DATA_START      0x0301     // Master key data
+#define ZCD_NV_MASTER_KEY_DATA_END        0x03FF
 
 // NV Items Reserved for applications (user applications)
 // 0x0401 � 0x0FFF
@@ -480,7 +484,7 @@ typedef struct
                 (uint8_t)((uint32_t)(((var)>>((ByteNum) * 8)) & 0x00FF))
 
 void sysRegisterCallbacks(mtSysCb_t cbs);
-void sysProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+extern const mtHandlerEntry_t sysHandlerTable[];
 //uint8_t sysNvWrite(uint16_t NvItemId, uint8_t offset, uint8_t *data,
 //		uint8_t dataLen);
 //uint8_t sysNvRead(uint16_t NvItemId, uint8_t offset, uint8_t *data,
@@ -508,6 +512,43 @@ uint8_t sysSetTime(SetTimeFormat_t *req);
 uint8_t sysGetTime(void);
 uint8_t sysSetTxPower(SetTxPowerFormat_t *req);
 
+// synchronous variants, return the decoded SRSP
+uint8_t sysPingSync(PingSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysSetExtAddrSync(SetExtAddrFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysGetExtAddrSync(GetExtAddrSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysRamReadSync(RamReadFormat_t *req,
+        RamReadSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysRamWriteSync(RamWriteFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysVersionSync(VersionSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalNvReadSync(OsalNvReadFormat_t *req,
+        OsalNvReadSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalNvWriteSync(OsalNvWriteFormat_t *req,
+        OsalNvWriteSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalNvItemInitSync(OsalNvItemInitFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalNvDeleteSync(OsalNvDeleteFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalNvLengthSync(OsalNvLengthFormat_t *req,
+        OsalNvLengthSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalStartTimerSync(OsalStartTimerFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysOsalStopTimerSync(OsalStopTimerFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysStackTuneSync(StackTuneFormat_t *req,
+        StackTuneSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysAdcReadSync(AdcReadFormat_t *req,
+        AdcReadSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysGpioSync(GpioFormat_t *req,
+        GpioSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysRandomSync(RandomSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysSetTimeSync(SetTimeFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysGetTimeSync(GetTimeSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t sysSetTxPowerSync(SetTxPowerFormat_t *req,
+        SetTxPowerSrspFormat_t *rsp, uint32_t timeoutMs);
+
 uint8_t sysReset(uint8_t resetType);
 
 #ifdef __cplusplus
@@ -52,13 +52,10 @@
  * LOCAL VARIABLE
  */
 static mtUtilCb_t mtUtilCbs;
-extern uint8_t srspRpcBuff[RPC_MAX_LEN];
-extern uint8_t srspRpcLen;
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 
 /*********************************************************************
  * @fn      utilCallbackSubCmd
@@ -74,7 +71,8 @@ uint8_t utilCallbackSubCmd(CallbackSubCmdFormat_t *req)
 	uint8_t status;
 	uint8_t cmInd = 0;
 	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
+	rpcFrame_t frame;
+	uint8_t *cmd = rpcFrameInit(&frame, cmdLen);
 
 	if (cmd)
 	{
@@ -83,18 +81,41 @@ uint8_t utilCallbackSubCmd(CallbackSubCmdFormat_t *req)
 		cmd[cmInd++] = (uint8_t)((req->SubsystemId >> 8) & 0xFF);
 		cmd[cmInd++] = req->Action;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_UTIL),
-		MT_UTIL_CALLBACK_SUB_CMD, cmd, cmdLen);
-		free(cmd);
+		status = rpcFrameSend(&frame, (MT_RPC_CMD_SREQ | MT_RPC_SYS_UTIL),
+		MT_UTIL_CALLBACK_SUB_CMD, cmdLen);
 		return status;
 	}
 	else
 	{
-		LOG_ERR("Memory for cmd was not allocated");
+		LOG_ERR("Command too long for a frame");
 		return 1;
 	}
 }
 
+/*********************************************************************
+ * @fn      decodeCallbackSubCmdSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeCallbackSubCmdSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        CallbackSubCmdSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
+	{
+		return MT_RPC_ERR_LENGTH;
+	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
+}
+
 /*********************************************************************
  * @fn      processCallbackSubCmdSrsp
  *
@@ -110,16 +131,12 @@ static void processCallbackSubCmdSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtUtilCbs.pfnUtilCallbackSubCmdSrsp)
 	{
-		uint8_t msgIdx = 2;
 		CallbackSubCmdSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeCallbackSubCmdSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtUtilCbs.pfnUtilCallbackSubCmdSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtUtilCbs.pfnUtilCallbackSubCmdSrsp(&rsp);
 	}
 }
 
@@ -134,63 +151,28 @@ static void processCallbackSubCmdSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 void utilRegisterCallbacks(mtUtilCb_t cbs)
 {
 	memcpy(&mtUtilCbs, &cbs, sizeof(mtUtilCb_t));
+	mtUpdateInterest(MT_RPC_SYS_UTIL, utilHandlerTable, &mtUtilCbs);
 }
 
 /*********************************************************************
- * @fn      processSrsp
+ * HANDLER TABLE
  *
- * @brief  Generic function for processing the SRSP and copying it to
- *         local buffer for SREQ function to deal with
- *
- * @param
- *
-
+ * Incoming UTIL commands, installed in the MT dispatch table by mtProcess()
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+const mtHandlerEntry_t utilHandlerTable[] =
 {
-	//copies sresp to local buffer
-	memcpy(srspRpcBuff, rpcBuff, rpcLen);
-	//srspRpcLen = rpcLen;
-    switch (rpcBuff[1])
-    {
-        case MT_UTIL_CALLBACK_SUB_CMD:
-            LOG_DBG("utilProcess: MT_UTIL_CALLBACK_SUB_CMD");
-            processCallbackSubCmdSrsp(rpcBuff, rpcLen);
-            break;
-        default:
-            LOG_WARN("processSrsp: unsupported UTIL message : %d (0x%02X)", rpcBuff[1], rpcBuff[1]);
-            break;
-    }
+	{ MT_RPC_CMD_SRSP, MT_UTIL_CALLBACK_SUB_CMD, processCallbackSubCmdSrsp, 0 },
+	{ 0, 0, NULL, 0 }
+};
 
-}
-
-/*************************************************************************************************
- * @fn      utilProcess()
- *
- * @brief   read and process the RPC Util message from the ZB SoC
+/*********************************************************************
+ * SYNCHRONOUS REQUESTS
  *
- * @param   rpcLen has the size of the frame: cmd0 + cmd1 + payload + FCS
+ * xxxSync() sends the SREQ, waits up to timeoutMs (0 for the default)
+ * for its SRSP and decodes it into rsp. The SRSP is not passed to the
+ * registered callbacks.
  *
-
- *************************************************************************************************/
-void utilProcess(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	LOG_DBG("Processing CMD0:%x, CMD1:%x", rpcBuff[0], rpcBuff[1]);
-
-	//process the synchronous SRSP from SREQ
-    if ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-    {
-        processSrsp(rpcBuff, rpcLen);
-    }
-    else
-    {
-        //Read CMD1 and processes the specific SREQ
-        switch (rpcBuff[1])
-        {
-            default:
-                LOG_ERR("CMD0:%x, CMD1:%x, not handled", rpcBuff[0], rpcBuff[1]);
-                break;
-        }
-    }
-}
-
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT, MT_RPC_ERR_BUSY or
+ *          MT_RPC_ERR_TRANSPORT
+ */
+MT_SYNC_REQ(utilCallbackSubCmd, CallbackSubCmdFormat_t, CallbackSubCmdSrspFormat_t, decodeCallbackSubCmdSrsp)
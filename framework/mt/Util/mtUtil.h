@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include "mtParser.h"
 
 /***************************************************************************************************
  * UTIL COMMANDS
@@ -119,9 +120,13 @@ typedef struct
                 (uint8_t)((uint32_t)(((var)>>((ByteNum) * 8)) & 0x00FF))
 
 void utilRegisterCallbacks(mtUtilCb_t cbs);
-void utilProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+extern const mtHandlerEntry_t utilHandlerTable[];
 uint8_t utilCallbackSubCmd(CallbackSubCmdFormat_t *req);
 
+// synchronous variants, return the decoded SRSP
+uint8_t utilCallbackSubCmdSync(CallbackSubCmdFormat_t *req,
+        CallbackSubCmdSrspFormat_t *rsp, uint32_t timeoutMs);
+
 #ifdef __cplusplus
 }
 #endif
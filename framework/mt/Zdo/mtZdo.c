@@ -46,6 +46,10 @@
 #include "mtZdo.h"
 #include "mtSys.h"
 #include "mtParser.h"
+#include "mtCodec.h"
+#include "mtZdoAddr.h"
+#include "mtZdoDisc.h"
+#include "mtAfRoute.h"
 #include "rpc.h"
 #include "hostConsole.h"
 #include "dbgPrint.h"
@@ -59,13 +63,667 @@
  * LOCAL VARIABLES
  */
 static mtZdoCb_t mtZdoCbs;
-extern uint8_t srspRpcBuff[RPC_MAX_LEN];
-extern uint8_t srspRpcLen;
+
+/*********************************************************************
+ * COMMAND LAYOUTS
+ *
+ * Wire format of the requests and callbacks packed and unpacked by
+ * mtCodec.c
+ */
+
+// list elements
+static const mtField_t networkListItemFields[] =
+{
+	MT_U64(NetworkListItemFormat_t, PanID),
+	MT_U8(NetworkListItemFormat_t, LogicalChannel),
+	MT_U8(NetworkListItemFormat_t, StackProf_ZigVer),
+	MT_U8(NetworkListItemFormat_t, BeacOrd_SupFramOrd),
+	MT_U8(NetworkListItemFormat_t, PermitJoin)
+};
+static const mtCmdDesc_t networkListItemDesc =
+        MT_ELEM_DESC(NetworkListItemFormat_t, networkListItemFields, 12);
+
+static const mtField_t neighborLqiListItemFields[] =
+{
+	MT_U64(NeighborLqiListItemFormat_t, ExtendedPanID),
+	MT_U64(NeighborLqiListItemFormat_t, ExtendedAddress),
+	MT_U16(NeighborLqiListItemFormat_t, NetworkAddress),
+	MT_U8(NeighborLqiListItemFormat_t, DevTyp_RxOnWhenIdle_Relat),
+	MT_U8(NeighborLqiListItemFormat_t, PermitJoining),
+	MT_U8(NeighborLqiListItemFormat_t, Depth),
+	MT_U8(NeighborLqiListItemFormat_t, LQI)
+};
+static const mtCmdDesc_t neighborLqiListItemDesc =
+        MT_ELEM_DESC(NeighborLqiListItemFormat_t, neighborLqiListItemFields, 22);
+
+static const mtField_t routingTableListItemFields[] =
+{
+	MT_U16(RoutingTableListItemFormat_t, DstAddr),
+	MT_U8(RoutingTableListItemFormat_t, Status),
+	MT_U16(RoutingTableListItemFormat_t, NextHop)
+};
+static const mtCmdDesc_t routingTableListItemDesc =
+        MT_ELEM_DESC(RoutingTableListItemFormat_t, routingTableListItemFields, 5);
+
+static const mtField_t bindingTableListItemFields[] =
+{
+	MT_U64(BindingTableListItemFormat_t, SrcIEEEAddr),
+	MT_U8(BindingTableListItemFormat_t, SrcEndpoint),
+	MT_U8(BindingTableListItemFormat_t, ClusterID),
+	MT_U8(BindingTableListItemFormat_t, DstAddrMode),
+	MT_U64(BindingTableListItemFormat_t, DstIEEEAddr),
+	MT_U8(BindingTableListItemFormat_t, DstEndpoint)
+};
+static const mtCmdDesc_t bindingTableListItemDesc =
+        MT_ELEM_DESC(BindingTableListItemFormat_t, bindingTableListItemFields, 20);
+
+static const mtField_t beaconListItemFields[] =
+{
+	MT_U16(BeaconListItemFormat_t, SrcAddr),
+	MT_U16(BeaconListItemFormat_t, PanId),
+	MT_U8(BeaconListItemFormat_t, LogicalChannel),
+	MT_U8(BeaconListItemFormat_t, PermitJoining),
+	MT_U8(BeaconListItemFormat_t, RouterCap),
+	MT_U8(BeaconListItemFormat_t, DevCap),
+	MT_U8(BeaconListItemFormat_t, ProtocolVer),
+	MT_U8(BeaconListItemFormat_t, StackProf),
+	MT_U8(BeaconListItemFormat_t, Lqi),
+	MT_U8(BeaconListItemFormat_t, Depth),
+	MT_U8(BeaconListItemFormat_t, UpdateId),
+	MT_U64(BeaconListItemFormat_t, ExtendedPanId)
+};
+static const mtCmdDesc_t beaconListItemDesc =
+        MT_ELEM_DESC(BeaconListItemFormat_t, beaconListItemFields, 21);
+
+// requests
+static const mtField_t nwkAddrReqFields[] =
+{
+	MT_BYTES(NwkAddrReqFormat_t, IEEEAddress),
+	MT_U8(NwkAddrReqFormat_t, ReqType),
+	MT_U8(NwkAddrReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t nwkAddrReqDesc =
+        MT_DESC(NwkAddrReqFormat_t, nwkAddrReqFields);
+
+static const mtField_t ieeeAddrReqFields[] =
+{
+	MT_U16(IeeeAddrReqFormat_t, ShortAddr),
+	MT_U8(IeeeAddrReqFormat_t, ReqType),
+	MT_U8(IeeeAddrReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t ieeeAddrReqDesc =
+        MT_DESC(IeeeAddrReqFormat_t, ieeeAddrReqFields);
+
+static const mtField_t nodeDescReqFields[] =
+{
+	MT_U16(NodeDescReqFormat_t, DstAddr),
+	MT_U16(NodeDescReqFormat_t, NwkAddrOfInterest)
+};
+static const mtCmdDesc_t nodeDescReqDesc =
+        MT_DESC(NodeDescReqFormat_t, nodeDescReqFields);
+
+static const mtField_t powerDescReqFields[] =
+{
+	MT_U16(PowerDescReqFormat_t, DstAddr),
+	MT_U16(PowerDescReqFormat_t, NwkAddrOfInterest)
+};
+static const mtCmdDesc_t powerDescReqDesc =
+        MT_DESC(PowerDescReqFormat_t, powerDescReqFields);
+
+static const mtField_t simpleDescReqFields[] =
+{
+	MT_U16(SimpleDescReqFormat_t, DstAddr),
+	MT_U16(SimpleDescReqFormat_t, NwkAddrOfInterest),
+	MT_U8(SimpleDescReqFormat_t, Endpoint)
+};
+static const mtCmdDesc_t simpleDescReqDesc =
+        MT_DESC(SimpleDescReqFormat_t, simpleDescReqFields);
+
+static const mtField_t activeEpReqFields[] =
+{
+	MT_U16(ActiveEpReqFormat_t, DstAddr),
+	MT_U16(ActiveEpReqFormat_t, NwkAddrOfInterest)
+};
+static const mtCmdDesc_t activeEpReqDesc =
+        MT_DESC(ActiveEpReqFormat_t, activeEpReqFields);
+
+static const mtField_t matchDescReqFields[] =
+{
+	MT_U16(MatchDescReqFormat_t, DstAddr),
+	MT_U16(MatchDescReqFormat_t, NwkAddrOfInterest),
+	MT_U16(MatchDescReqFormat_t, ProfileID),
+	MT_U8(MatchDescReqFormat_t, NumInClusters),
+	MT_LIST_U16(MatchDescReqFormat_t, InClusterList, NumInClusters),
+	MT_U8(MatchDescReqFormat_t, NumOutClusters),
+	MT_LIST_U16(MatchDescReqFormat_t, OutClusterList, NumOutClusters)
+};
+static const mtCmdDesc_t matchDescReqDesc =
+        MT_DESC(MatchDescReqFormat_t, matchDescReqFields);
+
+static const mtField_t complexDescReqFields[] =
+{
+	MT_U16(ComplexDescReqFormat_t, DstAddr),
+	MT_U16(ComplexDescReqFormat_t, NwkAddrOfInterest)
+};
+static const mtCmdDesc_t complexDescReqDesc =
+        MT_DESC(ComplexDescReqFormat_t, complexDescReqFields);
+
+static const mtField_t userDescReqFields[] =
+{
+	MT_U16(UserDescReqFormat_t, DstAddr),
+	MT_U16(UserDescReqFormat_t, NwkAddrOfInterest)
+};
+static const mtCmdDesc_t userDescReqDesc =
+        MT_DESC(UserDescReqFormat_t, userDescReqFields);
+
+static const mtField_t deviceAnnceFields[] =
+{
+	MT_U16(DeviceAnnceFormat_t, NWKAddr),
+	MT_BYTES(DeviceAnnceFormat_t, IEEEAddr),
+	MT_U8(DeviceAnnceFormat_t, Capabilities)
+};
+static const mtCmdDesc_t deviceAnnceDesc =
+        MT_DESC(DeviceAnnceFormat_t, deviceAnnceFields);
+
+static const mtField_t userDescSetFields[] =
+{
+	MT_U16(UserDescSetFormat_t, DstAddr),
+	MT_U16(UserDescSetFormat_t, NwkAddrOfInterest),
+	MT_U8(UserDescSetFormat_t, Len),
+	MT_LIST_U8(UserDescSetFormat_t, UserDescriptor, Len)
+};
+static const mtCmdDesc_t userDescSetDesc =
+        MT_DESC(UserDescSetFormat_t, userDescSetFields);
+
+static const mtField_t serverDiscReqFields[] =
+{
+	MT_U16(ServerDiscReqFormat_t, ServerMask)
+};
+static const mtCmdDesc_t serverDiscReqDesc =
+        MT_DESC(ServerDiscReqFormat_t, serverDiscReqFields);
+
+static const mtField_t endDeviceBindReqFields[] =
+{
+	MT_U16(EndDeviceBindReqFormat_t, DstAddr),
+	MT_U16(EndDeviceBindReqFormat_t, LocalCoordinator),
+	MT_BYTES(EndDeviceBindReqFormat_t, CoordinatorIEEE),
+	MT_U8(EndDeviceBindReqFormat_t, EndPoint),
+	MT_U16(EndDeviceBindReqFormat_t, ProfileID),
+	MT_U8(EndDeviceBindReqFormat_t, NumInClusters),
+	MT_LIST_U16(EndDeviceBindReqFormat_t, InClusterList, NumInClusters),
+	MT_U8(EndDeviceBindReqFormat_t, NumOutClusters),
+	MT_LIST_U16(EndDeviceBindReqFormat_t, OutClusterList, NumOutClusters)
+};
+static const mtCmdDesc_t endDeviceBindReqDesc =
+        MT_DESC(EndDeviceBindReqFormat_t, endDeviceBindReqFields);
+
+static const mtField_t mgmtNwkDiscReqFields[] =
+{
+	MT_U16(MgmtNwkDiscReqFormat_t, DstAddr),
+	MT_BYTES(MgmtNwkDiscReqFormat_t, ScanChannels),
+	MT_U8(MgmtNwkDiscReqFormat_t, ScanDuration),
+	MT_U8(MgmtNwkDiscReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t mgmtNwkDiscReqDesc =
+        MT_DESC(MgmtNwkDiscReqFormat_t, mgmtNwkDiscReqFields);
+
+static const mtField_t mgmtLqiReqFields[] =
+{
+	MT_U16(MgmtLqiReqFormat_t, DstAddr),
+	MT_U8(MgmtLqiReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t mgmtLqiReqDesc =
+        MT_DESC(MgmtLqiReqFormat_t, mgmtLqiReqFields);
+
+static const mtField_t mgmtRtgReqFields[] =
+{
+	MT_U16(MgmtRtgReqFormat_t, DstAddr),
+	MT_U8(MgmtRtgReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t mgmtRtgReqDesc =
+        MT_DESC(MgmtRtgReqFormat_t, mgmtRtgReqFields);
+
+static const mtField_t mgmtBindReqFields[] =
+{
+	MT_U16(MgmtBindReqFormat_t, DstAddr),
+	MT_U8(MgmtBindReqFormat_t, StartIndex)
+};
+static const mtCmdDesc_t mgmtBindReqDesc =
+        MT_DESC(MgmtBindReqFormat_t, mgmtBindReqFields);
+
+static const mtField_t mgmtLeaveReqFields[] =
+{
+	MT_U16(MgmtLeaveReqFormat_t, DstAddr),
+	MT_BYTES(MgmtLeaveReqFormat_t, DeviceAddr),
+	MT_U8(MgmtLeaveReqFormat_t, RemoveChildre_Rejoin)
+};
+static const mtCmdDesc_t mgmtLeaveReqDesc =
+        MT_DESC(MgmtLeaveReqFormat_t, mgmtLeaveReqFields);
+
+static const mtField_t mgmtDirectJoinReqFields[] =
+{
+	MT_U16(MgmtDirectJoinReqFormat_t, DstAddr),
+	MT_BYTES(MgmtDirectJoinReqFormat_t, DeviceAddr),
+	MT_U8(MgmtDirectJoinReqFormat_t, CapInfo)
+};
+static const mtCmdDesc_t mgmtDirectJoinReqDesc =
+        MT_DESC(MgmtDirectJoinReqFormat_t, mgmtDirectJoinReqFields);
+
+static const mtField_t mgmtPermitJoinReqFields[] =
+{
+	MT_U8(MgmtPermitJoinReqFormat_t, AddrMode),
+	MT_U16(MgmtPermitJoinReqFormat_t, DstAddr),
+	MT_U8(MgmtPermitJoinReqFormat_t, Duration),
+	MT_U8(MgmtPermitJoinReqFormat_t, TCSignificance)
+};
+static const mtCmdDesc_t mgmtPermitJoinReqDesc =
+        MT_DESC(MgmtPermitJoinReqFormat_t, mgmtPermitJoinReqFields);
+
+static const mtField_t mgmtNwkUpdateReqFields[] =
+{
+	MT_U16(MgmtNwkUpdateReqFormat_t, DstAddr),
+	MT_U8(MgmtNwkUpdateReqFormat_t, DstAddrMode),
+	MT_BYTES(MgmtNwkUpdateReqFormat_t, ChannelMask),
+	MT_U8(MgmtNwkUpdateReqFormat_t, ScanDuration),
+	MT_U8(MgmtNwkUpdateReqFormat_t, ScanCount),
+	MT_U16(MgmtNwkUpdateReqFormat_t, NwkManagerAddr)
+};
+static const mtCmdDesc_t mgmtNwkUpdateReqDesc =
+        MT_DESC(MgmtNwkUpdateReqFormat_t, mgmtNwkUpdateReqFields);
+
+static const mtField_t startupFromAppFields[] =
+{
+	MT_U16(StartupFromAppFormat_t, StartDelay)
+};
+static const mtCmdDesc_t startupFromAppDesc =
+        MT_DESC(StartupFromAppFormat_t, startupFromAppFields);
+
+static const mtField_t extRouteDiscFields[] =
+{
+	MT_U16(ExtRouteDiscFormat_t, DstAddr),
+	MT_U8(ExtRouteDiscFormat_t, Options),
+	MT_U8(ExtRouteDiscFormat_t, Radius)
+};
+static const mtCmdDesc_t extRouteDiscDesc =
+        MT_DESC(ExtRouteDiscFormat_t, extRouteDiscFields);
+
+static const mtField_t autoFindDestinationFields[] =
+{
+	MT_U8(AutoFindDestinationFormat_t, Endpoint)
+};
+static const mtCmdDesc_t autoFindDestinationDesc =
+        MT_DESC(AutoFindDestinationFormat_t, autoFindDestinationFields);
+
+static const mtField_t setLinkKeyFields[] =
+{
+	MT_U16(SetLinkKeyFormat_t, ShortAddr),
+	MT_BYTES(SetLinkKeyFormat_t, IEEEaddr),
+	MT_BYTES(SetLinkKeyFormat_t, LinkKeyData)
+};
+static const mtCmdDesc_t setLinkKeyDesc =
+        MT_DESC(SetLinkKeyFormat_t, setLinkKeyFields);
+
+static const mtField_t removeLinkKeyFields[] =
+{
+	MT_BYTES(RemoveLinkKeyFormat_t, IEEEaddr)
+};
+static const mtCmdDesc_t removeLinkKeyDesc =
+        MT_DESC(RemoveLinkKeyFormat_t, removeLinkKeyFields);
+
+static const mtField_t getLinkKeyFields[] =
+{
+	MT_BYTES(GetLinkKeyFormat_t, IEEEaddr)
+};
+static const mtCmdDesc_t getLinkKeyDesc =
+        MT_DESC(GetLinkKeyFormat_t, getLinkKeyFields);
+
+static const mtField_t nwkDiscoveryReqFields[] =
+{
+	MT_BYTES(NwkDiscoveryReqFormat_t, ScanChannels),
+	MT_U8(NwkDiscoveryReqFormat_t, ScanDuration)
+};
+static const mtCmdDesc_t nwkDiscoveryReqDesc =
+        MT_DESC(NwkDiscoveryReqFormat_t, nwkDiscoveryReqFields);
+
+static const mtField_t joinReqFields[] =
+{
+	MT_U8(JoinReqFormat_t, LogicalChannel),
+	MT_U16(JoinReqFormat_t, PanID),
+	MT_BYTES(JoinReqFormat_t, ExtendedPanID),
+	MT_U16(JoinReqFormat_t, ChosenParent),
+	MT_U8(JoinReqFormat_t, ParentDepth),
+	MT_U8(JoinReqFormat_t, StackProfile)
+};
+static const mtCmdDesc_t joinReqDesc = MT_DESC(JoinReqFormat_t, joinReqFields);
+
+static const mtField_t msgCbRegisterFields[] =
+{
+	MT_U16(MsgCbRegisterFormat_t, ClusterID)
+};
+static const mtCmdDesc_t msgCbRegisterDesc =
+        MT_DESC(MsgCbRegisterFormat_t, msgCbRegisterFields);
+
+static const mtField_t msgCbRemoveFields[] =
+{
+	MT_U16(MsgCbRemoveFormat_t, ClusterID)
+};
+static const mtCmdDesc_t msgCbRemoveDesc =
+        MT_DESC(MsgCbRemoveFormat_t, msgCbRemoveFields);
+
+// callbacks
+static const mtField_t nwkAddrRspFields[] =
+{
+	MT_U8(NwkAddrRspFormat_t, Status),
+	MT_U64(NwkAddrRspFormat_t, IEEEAddr),
+	MT_U16(NwkAddrRspFormat_t, NwkAddr),
+	MT_U8(NwkAddrRspFormat_t, StartIndex),
+	MT_U8(NwkAddrRspFormat_t, NumAssocDev),
+	MT_LIST_U16(NwkAddrRspFormat_t, AssocDevList, NumAssocDev)
+};
+static const mtCmdDesc_t nwkAddrRspDesc =
+        MT_DESC(NwkAddrRspFormat_t, nwkAddrRspFields);
+
+static const mtField_t ieeeAddrRspFields[] =
+{
+	MT_U8(IeeeAddrRspFormat_t, Status),
+	MT_U64(IeeeAddrRspFormat_t, IEEEAddr),
+	MT_U16(IeeeAddrRspFormat_t, NwkAddr),
+	MT_U8(IeeeAddrRspFormat_t, StartIndex),
+	MT_U8(IeeeAddrRspFormat_t, NumAssocDev),
+	MT_LIST_U16(IeeeAddrRspFormat_t, AssocDevList, NumAssocDev)
+};
+static const mtCmdDesc_t ieeeAddrRspDesc =
+        MT_DESC(IeeeAddrRspFormat_t, ieeeAddrRspFields);
+
+static const mtField_t nodeDescRspFields[] =
+{
+	MT_U16(NodeDescRspFormat_t, SrcAddr),
+	MT_U8(NodeDescRspFormat_t, Status),
+	MT_U16(NodeDescRspFormat_t, NwkAddr),
+	MT_U8(NodeDescRspFormat_t, LoTy_ComDescAv_UsrDesAv),
+	MT_U8(NodeDescRspFormat_t, APSFlg_FrqBnd),
+	MT_U8(NodeDescRspFormat_t, MACCapFlg),
+	MT_U16(NodeDescRspFormat_t, ManufacturerCode),
+	MT_U8(NodeDescRspFormat_t, MaxBufferSize),
+	MT_U16(NodeDescRspFormat_t, MaxTransferSize),
+	MT_U16(NodeDescRspFormat_t, ServerMask),
+	MT_U16(NodeDescRspFormat_t, MaxOutTransferSize),
+	MT_U8(NodeDescRspFormat_t, DescriptorCapabilities)
+};
+static const mtCmdDesc_t nodeDescRspDesc =
+        MT_DESC(NodeDescRspFormat_t, nodeDescRspFields);
+
+static const mtField_t powerDescRspFields[] =
+{
+	MT_U16(PowerDescRspFormat_t, SrcAddr),
+	MT_U8(PowerDescRspFormat_t, Status),
+	MT_U16(PowerDescRspFormat_t, NwkAddr),
+	MT_U8(PowerDescRspFormat_t, CurrntPwrMode_AvalPwrSrcs),
+	MT_U8(PowerDescRspFormat_t, CurrntPwrSrc_CurrntPwrSrcLvl)
+};
+static const mtCmdDesc_t powerDescRspDesc =
+        MT_DESC(PowerDescRspFormat_t, powerDescRspFields);
+
+static const mtField_t simpleDescRspFields[] =
+{
+	MT_U16(SimpleDescRspFormat_t, SrcAddr),
+	MT_U8(SimpleDescRspFormat_t, Status),
+	MT_U16(SimpleDescRspFormat_t, NwkAddr),
+	MT_U8(SimpleDescRspFormat_t, Len),
+	MT_OPTIONAL,
+	MT_U8(SimpleDescRspFormat_t, Endpoint),
+	MT_U16(SimpleDescRspFormat_t, ProfileID),
+	MT_U16(SimpleDescRspFormat_t, DeviceID),
+	MT_U8(SimpleDescRspFormat_t, DeviceVersion),
+	MT_U8(SimpleDescRspFormat_t, NumInClusters),
+	MT_LIST_U16(SimpleDescRspFormat_t, InClusterList, NumInClusters),
+	MT_U8(SimpleDescRspFormat_t, NumOutClusters),
+	MT_LIST_U16(SimpleDescRspFormat_t, OutClusterList, NumOutClusters)
+};
+static const mtCmdDesc_t simpleDescRspDesc =
+        MT_DESC(SimpleDescRspFormat_t, simpleDescRspFields);
+
+static const mtField_t activeEpRspFields[] =
+{
+	MT_U16(ActiveEpRspFormat_t, SrcAddr),
+	MT_U8(ActiveEpRspFormat_t, Status),
+	MT_U16(ActiveEpRspFormat_t, NwkAddr),
+	MT_U8(ActiveEpRspFormat_t, ActiveEPCount),
+	MT_LIST_U8(ActiveEpRspFormat_t, ActiveEPList, ActiveEPCount)
+};
+static const mtCmdDesc_t activeEpRspDesc =
+        MT_DESC(ActiveEpRspFormat_t, activeEpRspFields);
+
+static const mtField_t matchDescRspFields[] =
+{
+	MT_U16(MatchDescRspFormat_t, SrcAddr),
+	MT_U8(MatchDescRspFormat_t, Status),
+	MT_U16(MatchDescRspFormat_t, NwkAddr),
+	MT_U8(MatchDescRspFormat_t, MatchLength),
+	MT_LIST_U8(MatchDescRspFormat_t, MatchList, MatchLength)
+};
+static const mtCmdDesc_t matchDescRspDesc =
+        MT_DESC(MatchDescRspFormat_t, matchDescRspFields);
+
+static const mtField_t complexDescRspFields[] =
+{
+	MT_U16(ComplexDescRspFormat_t, SrcAddr),
+	MT_U8(ComplexDescRspFormat_t, Status),
+	MT_U16(ComplexDescRspFormat_t, NwkAddr),
+	MT_U8(ComplexDescRspFormat_t, ComplexLength),
+	MT_LIST_U8(ComplexDescRspFormat_t, ComplexList, ComplexLength)
+};
+static const mtCmdDesc_t complexDescRspDesc =
+        MT_DESC(ComplexDescRspFormat_t, complexDescRspFields);
+
+static const mtField_t userDescRspFields[] =
+{
+	MT_U16(UserDescRspFormat_t, SrcAddr),
+	MT_U8(UserDescRspFormat_t, Status),
+	MT_U16(UserDescRspFormat_t, NwkAddr),
+	MT_U8(UserDescRspFormat_t, Len),
+	MT_LIST_U8(UserDescRspFormat_t, CUserDescriptor, Len)
+};
+static const mtCmdDesc_t userDescRspDesc =
+        MT_DESC(UserDescRspFormat_t, userDescRspFields);
+
+static const mtField_t userDescConfFields[] =
+{
+	MT_U16(UserDescConfFormat_t, SrcAddr),
+	MT_U8(UserDescConfFormat_t, Status),
+	MT_U16(UserDescConfFormat_t, NwkAddr)
+};
+static const mtCmdDesc_t userDescConfDesc =
+        MT_DESC(UserDescConfFormat_t, userDescConfFields);
+
+static const mtField_t serverDiscRspFields[] =
+{
+	MT_U16(ServerDiscRspFormat_t, SrcAddr),
+	MT_U8(ServerDiscRspFormat_t, Status),
+	MT_U16(ServerDiscRspFormat_t, ServerMask)
+};
+static const mtCmdDesc_t serverDiscRspDesc =
+        MT_DESC(ServerDiscRspFormat_t, serverDiscRspFields);
+
+static const mtField_t endDeviceBindRspFields[] =
+{
+	MT_U16(EndDeviceBindRspFormat_t, SrcAddr),
+	MT_U8(EndDeviceBindRspFormat_t, Status)
+};
+static const mtCmdDesc_t endDeviceBindRspDesc =
+        MT_DESC(EndDeviceBindRspFormat_t, endDeviceBindRspFields);
+
+static const mtField_t bindRspFields[] =
+{
+	MT_U16(BindRspFormat_t, SrcAddr),
+	MT_U8(BindRspFormat_t, Status)
+};
+static const mtCmdDesc_t bindRspDesc = MT_DESC(BindRspFormat_t, bindRspFields);
+
+static const mtField_t unbindRspFields[] =
+{
+	MT_U16(UnbindRspFormat_t, SrcAddr),
+	MT_U8(UnbindRspFormat_t, Status)
+};
+static const mtCmdDesc_t unbindRspDesc =
+        MT_DESC(UnbindRspFormat_t, unbindRspFields);
+
+static const mtField_t mgmtNwkDiscRspFields[] =
+{
+	MT_U16(MgmtNwkDiscRspFormat_t, SrcAddr),
+	MT_U8(MgmtNwkDiscRspFormat_t, Status),
+	MT_U8(MgmtNwkDiscRspFormat_t, NetworkCount),
+	MT_U8(MgmtNwkDiscRspFormat_t, StartIndex),
+	MT_U8(MgmtNwkDiscRspFormat_t, NetworkListCount),
+	MT_LIST(MgmtNwkDiscRspFormat_t, NetworkList, NetworkListCount, networkListItemDesc)
+};
+static const mtCmdDesc_t mgmtNwkDiscRspDesc =
+        MT_DESC(MgmtNwkDiscRspFormat_t, mgmtNwkDiscRspFields);
+
+static const mtField_t mgmtLqiRspFields[] =
+{
+	MT_U16(MgmtLqiRspFormat_t, SrcAddr),
+	MT_U8(MgmtLqiRspFormat_t, Status),
+	MT_U8(MgmtLqiRspFormat_t, NeighborTableEntries),
+	MT_U8(MgmtLqiRspFormat_t, StartIndex),
+	MT_U8(MgmtLqiRspFormat_t, NeighborLqiListCount),
+	MT_LIST(MgmtLqiRspFormat_t, NeighborLqiList, NeighborLqiListCount, neighborLqiListItemDesc)
+};
+static const mtCmdDesc_t mgmtLqiRspDesc =
+        MT_DESC(MgmtLqiRspFormat_t, mgmtLqiRspFields);
+
+static const mtField_t mgmtRtgRspFields[] =
+{
+	MT_U16(MgmtRtgRspFormat_t, SrcAddr),
+	MT_U8(MgmtRtgRspFormat_t, Status),
+	MT_U8(MgmtRtgRspFormat_t, RoutingTableEntries),
+	MT_U8(MgmtRtgRspFormat_t, StartIndex),
+	MT_U8(MgmtRtgRspFormat_t, RoutingTableListCount),
+	MT_LIST(MgmtRtgRspFormat_t, RoutingTableList, RoutingTableListCount, routingTableListItemDesc)
+};
+static const mtCmdDesc_t mgmtRtgRspDesc =
+        MT_DESC(MgmtRtgRspFormat_t, mgmtRtgRspFields);
+
+static const mtField_t mgmtBindRspFields[] =
+{
+	MT_U16(MgmtBindRspFormat_t, SrcAddr),
+	MT_U8(MgmtBindRspFormat_t, Status),
+	MT_U8(MgmtBindRspFormat_t, BindingTableEntries),
+	MT_U8(MgmtBindRspFormat_t, StartIndex),
+	MT_U8(MgmtBindRspFormat_t, BindingTableListCount),
+	MT_LIST(MgmtBindRspFormat_t, BindingTableList, BindingTableListCount, bindingTableListItemDesc)
+};
+static const mtCmdDesc_t mgmtBindRspDesc =
+        MT_DESC(MgmtBindRspFormat_t, mgmtBindRspFields);
+
+static const mtField_t mgmtLeaveRspFields[] =
+{
+	MT_U16(MgmtLeaveRspFormat_t, SrcAddr),
+	MT_U8(MgmtLeaveRspFormat_t, Status)
+};
+static const mtCmdDesc_t mgmtLeaveRspDesc =
+        MT_DESC(MgmtLeaveRspFormat_t, mgmtLeaveRspFields);
+
+static const mtField_t mgmtDirectJoinRspFields[] =
+{
+	MT_U16(MgmtDirectJoinRspFormat_t, SrcAddr),
+	MT_U8(MgmtDirectJoinRspFormat_t, Status)
+};
+static const mtCmdDesc_t mgmtDirectJoinRspDesc =
+        MT_DESC(MgmtDirectJoinRspFormat_t, mgmtDirectJoinRspFields);
+
+static const mtField_t mgmtPermitJoinRspFields[] =
+{
+	MT_U16(MgmtPermitJoinRspFormat_t, SrcAddr),
+	MT_U8(MgmtPermitJoinRspFormat_t, Status)
+};
+static const mtCmdDesc_t mgmtPermitJoinRspDesc =
+        MT_DESC(MgmtPermitJoinRspFormat_t, mgmtPermitJoinRspFields);
+
+static const mtField_t endDeviceAnnceIndFields[] =
+{
+	MT_U16(EndDeviceAnnceIndFormat_t, SrcAddr),
+	MT_U16(EndDeviceAnnceIndFormat_t, NwkAddr),
+	MT_U64(EndDeviceAnnceIndFormat_t, IEEEAddr),
+	MT_U8(EndDeviceAnnceIndFormat_t, Capabilities)
+};
+static const mtCmdDesc_t endDeviceAnnceIndDesc =
+        MT_DESC(EndDeviceAnnceIndFormat_t, endDeviceAnnceIndFields);
+
+static const mtField_t matchDescRspSentFields[] =
+{
+	MT_U16(MatchDescRspSentFormat_t, NwkAddr),
+	MT_U8(MatchDescRspSentFormat_t, NumInClusters),
+	MT_LIST_U16(MatchDescRspSentFormat_t, InClusterList, NumInClusters),
+	MT_U8(MatchDescRspSentFormat_t, NumOutClusters),
+	MT_LIST_U16(MatchDescRspSentFormat_t, OutClusterList, NumOutClusters)
+};
+static const mtCmdDesc_t matchDescRspSentDesc =
+        MT_DESC(MatchDescRspSentFormat_t, matchDescRspSentFields);
+
+static const mtField_t statusErrorRspFields[] =
+{
+	MT_U16(StatusErrorRspFormat_t, SrcAddr),
+	MT_U8(StatusErrorRspFormat_t, Status)
+};
+static const mtCmdDesc_t statusErrorRspDesc =
+        MT_DESC(StatusErrorRspFormat_t, statusErrorRspFields);
+
+static const mtField_t srcRtgIndFields[] =
+{
+	MT_U16(SrcRtgIndFormat_t, DstAddr),
+	MT_U8(SrcRtgIndFormat_t, RelayCount),
+	MT_LIST_U16(SrcRtgIndFormat_t, RelayList, RelayCount)
+};
+static const mtCmdDesc_t srcRtgIndDesc =
+        MT_DESC(SrcRtgIndFormat_t, srcRtgIndFields);
+
+static const mtField_t beaconNotifyIndFields[] =
+{
+	MT_U8(BeaconNotifyIndFormat_t, BeaconCount),
+	MT_LIST(BeaconNotifyIndFormat_t, BeaconList, BeaconCount, beaconListItemDesc)
+};
+static const mtCmdDesc_t beaconNotifyIndDesc =
+        MT_DESC(BeaconNotifyIndFormat_t, beaconNotifyIndFields);
+
+static const mtField_t joinCnfFields[] =
+{
+	MT_U8(JoinCnfFormat_t, Status),
+	MT_U16(JoinCnfFormat_t, DevAddr),
+	MT_U16(JoinCnfFormat_t, ParentAddr)
+};
+static const mtCmdDesc_t joinCnfDesc = MT_DESC(JoinCnfFormat_t, joinCnfFields);
+
+static const mtField_t nwkDiscoveryCnfFields[] =
+{
+	MT_U8(NwkDiscoveryCnfFormat_t, Status)
+};
+static const mtCmdDesc_t nwkDiscoveryCnfDesc =
+        MT_DESC(NwkDiscoveryCnfFormat_t, nwkDiscoveryCnfFields);
+
+static const mtField_t leaveIndFields[] =
+{
+	MT_U16(LeaveIndFormat_t, SrcAddr),
+	MT_U64(LeaveIndFormat_t, ExtAddr),
+	MT_U8(LeaveIndFormat_t, Request),
+	MT_U8(LeaveIndFormat_t, Remove),
+	MT_U8(LeaveIndFormat_t, Rejoin)
+};
+static const mtCmdDesc_t leaveIndDesc =
+        MT_DESC(LeaveIndFormat_t, leaveIndFields);
+
+static const mtField_t tcDevIndFields[] =
+{
+	MT_U16(TcDevIndFormat_t, SrcNwkAddr),
+	MT_U64(TcDevIndFormat_t, ExtAddr),
+	MT_U16(TcDevIndFormat_t, ParentNwkAddr)
+};
+static const mtCmdDesc_t tcDevIndDesc =
+        MT_DESC(TcDevIndFormat_t, tcDevIndFields);
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processStateChange(uint8_t *rpcBuff, uint8_t rpcLen);
 static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen);
 
@@ -100,29 +758,8 @@ static void processStateChange(uint8_t *rpcBuff, uint8_t rpcLen __attribute__((u
  */
 uint8_t zdoNwkAddrReq(NwkAddrReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 10;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->IEEEAddress, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->ReqType;
-		cmd[cmInd++] = req->StartIndex;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NWK_ADDR_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&nwkAddrReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_NWK_ADDR_REQ, req);
 }
 
 /*********************************************************************
@@ -136,29 +773,8 @@ uint8_t zdoNwkAddrReq(NwkAddrReqFormat_t *req)
  */
 uint8_t zdoIeeeAddrReq(IeeeAddrReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->ShortAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ShortAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->ReqType;
-		cmd[cmInd++] = req->StartIndex;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_IEEE_ADDR_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&ieeeAddrReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_IEEE_ADDR_REQ, req);
 }
 
 /*********************************************************************
@@ -172,47 +788,45 @@ uint8_t zdoIeeeAddrReq(IeeeAddrReqFormat_t *req)
  */
 uint8_t zdoNodeDescReq(NodeDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
+	return mtSendReq(&nodeDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_NODE_DESC_REQ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NODE_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeNodeDescReqSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeNodeDescReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        NodeDescReqSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
-uint8_t processNodeDescReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+static void processNodeDescReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-    if(mtZdoCbs.pfnZdoNodeDescReqSrsp)
-    {
-		uint8_t msgIdx = 2;
+	if(mtZdoCbs.pfnZdoNodeDescReqSrsp)
+	{
 		NodeDescReqSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeNodeDescReqSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoNodeDescReqSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoNodeDescReqSrsp(&rsp);
-    }
-    return 0;
+	}
 }
 
 /*********************************************************************
@@ -226,29 +840,8 @@ uint8_t processNodeDescReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t zdoPowerDescReq(PowerDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_POWER_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&powerDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_POWER_DESC_REQ, req);
 }
 
 /*********************************************************************
@@ -262,30 +855,8 @@ uint8_t zdoPowerDescReq(PowerDescReqFormat_t *req)
  */
 uint8_t zdoSimpleDescReq(SimpleDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 5;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-		cmd[cmInd++] = req->Endpoint;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SIMPLE_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&simpleDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_SIMPLE_DESC_REQ, req);
 }
 
 /*********************************************************************
@@ -299,47 +870,45 @@ uint8_t zdoSimpleDescReq(SimpleDescReqFormat_t *req)
  */
 uint8_t zdoActiveEpReq(ActiveEpReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
+	return mtSendReq(&activeEpReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_ACTIVE_EP_REQ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_ACTIVE_EP_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeActiveEpReqSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeActiveEpReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        ActiveEpReqSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
-uint8_t processActiveEpReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+static void processActiveEpReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-    if(mtZdoCbs.pfnZdoActiveEpReqSrsp)
-    {
-		uint8_t msgIdx = 2;
+	if(mtZdoCbs.pfnZdoActiveEpReqSrsp)
+	{
 		ActiveEpReqSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeActiveEpReqSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoActiveEpReqSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoActiveEpReqSrsp(&rsp);
-    }
-    return 0;
+	}
 }
 
 /*********************************************************************
@@ -353,45 +922,8 @@ uint8_t processActiveEpReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t zdoMatchDescReq(MatchDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8 + (req->NumInClusters * 2) + (req->NumOutClusters * 2);
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->ProfileID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ProfileID >> 8) & 0xFF);
-		cmd[cmInd++] = req->NumInClusters;
-		for (idx = 0; idx < req->NumInClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->InClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->InClusterList[idx] >> 8) & 0xFF);
-		}
-		cmd[cmInd++] = req->NumOutClusters;
-		for (idx = 0; idx < req->NumOutClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->OutClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->OutClusterList[idx] >> 8) & 0xFF);
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MATCH_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&matchDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MATCH_DESC_REQ, req);
 }
 
 /*********************************************************************
@@ -405,29 +937,8 @@ uint8_t zdoMatchDescReq(MatchDescReqFormat_t *req)
  */
 uint8_t zdoComplexDescReq(ComplexDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_COMPLEX_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&complexDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_COMPLEX_DESC_REQ, req);
 }
 
 /*********************************************************************
@@ -441,29 +952,8 @@ uint8_t zdoComplexDescReq(ComplexDescReqFormat_t *req)
  */
 uint8_t zdoUserDescReq(UserDescReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_USER_DESC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&userDescReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_USER_DESC_REQ, req);
 }
 
 /*********************************************************************
@@ -477,30 +967,32 @@ uint8_t zdoUserDescReq(UserDescReqFormat_t *req)
  */
 uint8_t zdoDeviceAnnce(DeviceAnnceFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->NWKAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NWKAddr >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->IEEEAddr, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->Capabilities;
+	return mtSendReq(&deviceAnnceDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_DEVICE_ANNCE, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_DEVICE_ANNCE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeDeviceAnnceSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeDeviceAnnceSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        DeviceAnnceSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 /*********************************************************************
@@ -514,16 +1006,12 @@ static void processDeviceAnnceSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoDeviceAnnceSrsp)
 	{
-		uint8_t msgIdx = 2;
 		DeviceAnnceSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeDeviceAnnceSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoDeviceAnnceSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoDeviceAnnceSrsp(&rsp);
 	}
 }
 
@@ -538,36 +1026,8 @@ static void processDeviceAnnceSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t zdoUserDescSet(UserDescSetFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 5 + req->Len;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->NwkAddrOfInterest & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkAddrOfInterest >> 8) & 0xFF);
-		cmd[cmInd++] = req->Len;
-		for (idx = 0; idx < req->Len; idx++)
-		{
-			cmd[cmInd++] = req->UserDescriptor[idx];
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_USER_DESC_SET, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&userDescSetDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_USER_DESC_SET, req);
 }
 
 /*********************************************************************
@@ -581,27 +1041,8 @@ uint8_t zdoUserDescSet(UserDescSetFormat_t *req)
  */
 uint8_t zdoServerDiscReq(ServerDiscReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->ServerMask & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ServerMask >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SERVER_DISC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&serverDiscReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_SERVER_DISC_REQ, req);
 }
 
 /*********************************************************************
@@ -615,48 +1056,8 @@ uint8_t zdoServerDiscReq(ServerDiscReqFormat_t *req)
  */
 uint8_t zdoEndDeviceBindReq(EndDeviceBindReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 17 + (req->NumInClusters * 2) + (req->NumOutClusters * 2);
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		int idx;
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = (uint8_t)(req->LocalCoordinator & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->LocalCoordinator >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->CoordinatorIEEE, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->EndPoint;
-		cmd[cmInd++] = (uint8_t)(req->ProfileID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ProfileID >> 8) & 0xFF);
-		cmd[cmInd++] = req->NumInClusters;
-		for (idx = 0; idx < req->NumInClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->InClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->InClusterList[idx] >> 8) & 0xFF);
-		}
-		cmd[cmInd++] = req->NumOutClusters;
-		for (idx = 0; idx < req->NumOutClusters; idx++)
-		{
-			cmd[cmInd++] = (uint8_t)(req->OutClusterList[idx] & 0xFF);
-			cmd[cmInd++] = (uint8_t)((req->OutClusterList[idx] >> 8) & 0xFF);
-		}
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_END_DEVICE_BIND_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&endDeviceBindReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_END_DEVICE_BIND_REQ, req);
 }
 
 /*********************************************************************
@@ -670,12 +1071,30 @@ uint8_t zdoEndDeviceBindReq(EndDeviceBindReqFormat_t *req)
  */
 uint8_t zdoBindReq(BindReqFormat_t *req)
 {
-	uint8_t status;
+	return zdoBindReqCb(req, 0, NULL, NULL);
+}
+
+/*********************************************************************
+ * @fn      zdoBindReqCb
+ *
+ * @brief   zdoBindReq() with a completion callback for the SRSP
+ *
+ * @param   req - Pointer to outgoing command structure
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t zdoBindReqCb(const BindReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
 	uint8_t addrmd = (req->DstAddrMode == 3 ? 8 : 2);
 	uint8_t cmInd = 0;
 	uint8_t endP = (req->DstAddrMode == 3 ? 1 : 0);
 	uint32_t cmdLen = 14 + addrmd + endP;
-	uint8_t *cmd = malloc(cmdLen);
+	rpcFrame_t frame;
+	uint8_t *cmd = rpcFrameInit(&frame, cmdLen);
 
 	if (cmd)
 	{
@@ -693,14 +1112,12 @@ uint8_t zdoBindReq(BindReqFormat_t *req)
 		if (endP)
 			cmd[cmInd++] = req->DstEndpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_BIND_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
+		return rpcFrameSendCb(&frame, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+		MT_ZDO_BIND_REQ, cmdLen, timeoutMs, cb, cbArg);
 	}
 	else
 	{
-		LOG_ERR("Memory for cmd was not allocated");
+		LOG_ERR("Command too long for a frame");
 		return 1;
 	}
 }
@@ -716,12 +1133,30 @@ uint8_t zdoBindReq(BindReqFormat_t *req)
  */
 uint8_t zdoUnbindReq(UnbindReqFormat_t *req)
 {
-	uint8_t status;
+	return zdoUnbindReqCb(req, 0, NULL, NULL);
+}
+
+/*********************************************************************
+ * @fn      zdoUnbindReqCb
+ *
+ * @brief   zdoUnbindReq() with a completion callback for the SRSP
+ *
+ * @param   req - Pointer to outgoing command structure
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t zdoUnbindReqCb(const UnbindReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
 	uint8_t cmInd = 0;
 	uint8_t addrmd = (req->DstAddrMode == 3 ? 8 : 2);
 	uint8_t endP = (req->DstAddrMode == 3 ? 1 : 0);
-	uint32_t cmdLen = 16;
-	uint8_t *cmd = malloc(cmdLen);
+	uint32_t cmdLen = 14 + addrmd + endP;
+	rpcFrame_t frame;
+	uint8_t *cmd = rpcFrameInit(&frame, cmdLen);
 
 	if (cmd)
 	{
@@ -739,18 +1174,83 @@ uint8_t zdoUnbindReq(UnbindReqFormat_t *req)
 		if (endP)
 			cmd[cmInd++] = req->DstEndpoint;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_UNBIND_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
+		return rpcFrameSendCb(&frame, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+		MT_ZDO_UNBIND_REQ, cmdLen, timeoutMs, cb, cbArg);
 	}
 	else
 	{
-		LOG_ERR("Memory for cmd was not allocated");
+		LOG_ERR("Command too long for a frame");
 		return 1;
 	}
 }
 
+/*********************************************************************
+ * @fn      zdoSendReqCb
+ *
+ * @brief   Send a ZDP request given by its command ID, with a completion
+ *          callback for the SRSP. Lets a caller such as the mtZdoSched
+ *          queue hold requests of several types.
+ *
+ * @param   cmd1 - MT_ZDO_xxx_REQ, a ZDP request to one device
+ * @param   req - Pointer to the outgoing command structure of cmd1
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status, MT_RPC_ERR_PARAMETER if cmd1 is not supported
+ */
+uint8_t zdoSendReqCb(uint8_t cmd1, const void *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
+	const mtCmdDesc_t *desc;
+
+	switch (cmd1)
+	{
+	case MT_ZDO_IEEE_ADDR_REQ:
+		desc = &ieeeAddrReqDesc;
+		break;
+	case MT_ZDO_NODE_DESC_REQ:
+		desc = &nodeDescReqDesc;
+		break;
+	case MT_ZDO_POWER_DESC_REQ:
+		desc = &powerDescReqDesc;
+		break;
+	case MT_ZDO_SIMPLE_DESC_REQ:
+		desc = &simpleDescReqDesc;
+		break;
+	case MT_ZDO_ACTIVE_EP_REQ:
+		desc = &activeEpReqDesc;
+		break;
+	case MT_ZDO_MATCH_DESC_REQ:
+		desc = &matchDescReqDesc;
+		break;
+	case MT_ZDO_BIND_REQ:
+		return zdoBindReqCb(req, timeoutMs, cb, cbArg);
+	case MT_ZDO_UNBIND_REQ:
+		return zdoUnbindReqCb(req, timeoutMs, cb, cbArg);
+	case MT_ZDO_MGMT_LQI_REQ:
+		desc = &mgmtLqiReqDesc;
+		break;
+	case MT_ZDO_MGMT_RTG_REQ:
+		desc = &mgmtRtgReqDesc;
+		break;
+	case MT_ZDO_MGMT_BIND_REQ:
+		desc = &mgmtBindReqDesc;
+		break;
+	case MT_ZDO_MGMT_LEAVE_REQ:
+		desc = &mgmtLeaveReqDesc;
+		break;
+	case MT_ZDO_MGMT_PERMIT_JOIN_REQ:
+		desc = &mgmtPermitJoinReqDesc;
+		break;
+	default:
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	return mtSendReqCb(desc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO), cmd1, req,
+	        timeoutMs, cb, cbArg);
+}
+
 /*********************************************************************
  * @fn      zdoMgmtNwkDiscReq
  *
@@ -762,31 +1262,8 @@ uint8_t zdoUnbindReq(UnbindReqFormat_t *req)
  */
 uint8_t zdoMgmtNwkDiscReq(MgmtNwkDiscReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->ScanChannels, 4);
-		cmInd += 4;
-		cmd[cmInd++] = req->ScanDuration;
-		cmd[cmInd++] = req->StartIndex;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_NWK_DISC_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtNwkDiscReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_NWK_DISC_REQ, req);
 }
 
 /*********************************************************************
@@ -800,27 +1277,48 @@ uint8_t zdoMgmtNwkDiscReq(MgmtNwkDiscReqFormat_t *req)
  */
 uint8_t zdoMgmtLqiReq(MgmtLqiReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
+	return zdoMgmtLqiReqCb(req, 0, NULL, NULL);
+}
 
-	if (cmd)
-	{
+/*********************************************************************
+ * @fn      zdoMgmtLqiReqCb
+ *
+ * @brief   zdoMgmtLqiReq() with a completion callback for its SRSP, see
+ *          rpcFrameSendCb().
+ *
+ * @param   req - Pointer to outgoing command structure
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status
+ */
+uint8_t zdoMgmtLqiReqCb(MgmtLqiReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg)
+{
+	return mtSendReqCb(&mgmtLqiReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_LQI_REQ, req, timeoutMs, cb, cbArg);
+}
 
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->StartIndex;
+/*********************************************************************
+ * @fn      processZdpReqSrsp
+ *
+ * @brief   SRSP of a ZDP request sent with a callback, which already got
+ *          the status: zdoMgmtLqiReqCb(), zdoSendReqCb()
+ *
+ * @param    rpcBuff - Buffer from rpc layer, contains command data
+ * @param    rpcLen - Length of rpcBuff
+ *
+ * @return
+ */
+static void processZdpReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	StatusSrspFormat_t rsp;
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_LQI_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+	if ((mtDecodeStatusSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+	        && (rsp.Status != MT_RPC_SUCCESS))
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		LOG_DBG("ZDO request %02X refused: %02X", rpcBuff[1], rsp.Status);
 	}
 }
 
@@ -835,28 +1333,8 @@ uint8_t zdoMgmtLqiReq(MgmtLqiReqFormat_t *req)
  */
 uint8_t zdoMgmtRtgReq(MgmtRtgReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->StartIndex;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_RTG_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtRtgReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_RTG_REQ, req);
 }
 
 /*********************************************************************
@@ -870,28 +1348,8 @@ uint8_t zdoMgmtRtgReq(MgmtRtgReqFormat_t *req)
  */
 uint8_t zdoMgmtBindReq(MgmtBindReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 3;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->StartIndex;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_BIND_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtBindReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_BIND_REQ, req);
 }
 
 /*********************************************************************
@@ -905,30 +1363,8 @@ uint8_t zdoMgmtBindReq(MgmtBindReqFormat_t *req)
  */
 uint8_t zdoMgmtLeaveReq(MgmtLeaveReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->DeviceAddr, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->RemoveChildre_Rejoin;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_LEAVE_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtLeaveReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_LEAVE_REQ, req);
 }
 
 /*********************************************************************
@@ -942,30 +1378,8 @@ uint8_t zdoMgmtLeaveReq(MgmtLeaveReqFormat_t *req)
  */
 uint8_t zdoMgmtDirectJoinReq(MgmtDirectJoinReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->DeviceAddr, 8);
-		cmInd += 8;
-		cmd[cmInd++] = req->CapInfo;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_DIRECT_JOIN_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtDirectJoinReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_DIRECT_JOIN_REQ, req);
 }
 
 /*********************************************************************
@@ -979,46 +1393,44 @@ uint8_t zdoMgmtDirectJoinReq(MgmtDirectJoinReqFormat_t *req)
  */
 uint8_t zdoMgmtPermitJoinReq(MgmtPermitJoinReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 5;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->AddrMode;
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->Duration;
-		cmd[cmInd++] = req->TCSignificance;
+	return mtSendReq(&mgmtPermitJoinReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_PERMIT_JOIN_REQ, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_PERMIT_JOIN_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodePermitJoinReqSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodePermitJoinReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        PermitJoinReqSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processPermitJoinReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoPermitJoinReqSrsp)
 	{
-		uint8_t msgIdx = 2;
 		PermitJoinReqSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodePermitJoinReqSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoPermitJoinReqSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoPermitJoinReqSrsp(&rsp);
 	}
 }
 
@@ -1033,34 +1445,8 @@ static void processPermitJoinReqSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t zdoMgmtNwkUpdateReq(MgmtNwkUpdateReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 11;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->DstAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->DstAddr >> 8) & 0xFF);
-		cmd[cmInd++] = req->DstAddrMode;
-		memcpy((cmd + cmInd), req->ChannelMask, 4);
-		cmInd += 4;
-		cmd[cmInd++] = req->ScanDuration;
-		cmd[cmInd++] = req->ScanCount;
-		cmd[cmInd++] = (uint8_t)(req->NwkManagerAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->NwkManagerAddr >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MGMT_NWK_UPDATE_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&mgmtNwkUpdateReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MGMT_NWK_UPDATE_REQ, req);
 }
 
 /*********************************************************************
@@ -1074,67 +1460,75 @@ uint8_t zdoMgmtNwkUpdateReq(MgmtNwkUpdateReqFormat_t *req)
  */
 uint8_t zdoStartupFromApp(StartupFromAppFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = LO_UINT16(req->StartDelay);
-		cmd[cmInd++] = HI_UINT16(req->StartDelay);
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&startupFromAppDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_STARTUP_FROM_APP, req);
 }
 
 uint8_t zdoExtRouteDisc(ExtRouteDiscFormat_t *req)
 {
-	uint8_t status;
-	uint32_t cmdLen = 4;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-        memcpy(cmd, &(req->DstAddr), sizeof(uint16_t));
-        cmd[2] = req->Options;
-        cmd[3] = req->Radius;
+	return mtSendReq(&extRouteDiscDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_EXT_ROUTE_DISC, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_EXT_ROUTE_DISC, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeExtRouteDiscSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeExtRouteDiscSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        ExtRouteDiscSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 static void processExtRouteDiscSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoExtRouteDiscSrsp)
 	{
-		uint8_t msgIdx = 2;
 		ExtRouteDiscSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeExtRouteDiscSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoExtRouteDiscSrsp(&rsp);
 		}
+	}
+}
 
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoExtRouteDiscSrsp(&rsp);
+/*********************************************************************
+ * @fn      decodeStartupFromAppSrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeStartupFromAppSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        StartupFromAppSrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 1) != MT_RPC_SUCCESS)
+	{
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	return MT_RPC_SUCCESS;
 }
 
 /*********************************************************************
@@ -1151,16 +1545,12 @@ static void processStartupFromAppSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoStartupFromAppSrsp)
 	{
-		uint8_t msgIdx = 2;
 		StartupFromAppSrspFormat_t rsp;
-		if (rpcLen < 2)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeStartupFromAppSrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoStartupFromAppSrsp(&rsp);
 		}
-
-		rsp.Status = rpcBuff[msgIdx++];
-		mtZdoCbs.pfnZdoStartupFromAppSrsp(&rsp);
 	}
 }
 
@@ -1175,26 +1565,8 @@ static void processStartupFromAppSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 uint8_t zdoAutoFindDestination(AutoFindDestinationFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 1;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->Endpoint;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_AUTO_FIND_DESTINATION, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&autoFindDestinationDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_AUTO_FIND_DESTINATION, req);
 }
 
 /*********************************************************************
@@ -1208,31 +1580,8 @@ uint8_t zdoAutoFindDestination(AutoFindDestinationFormat_t *req)
  */
 uint8_t zdoSetLinkKey(SetLinkKeyFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 26;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->ShortAddr & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ShortAddr >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->IEEEaddr, 8);
-		cmInd += 8;
-		memcpy((cmd + cmInd), req->LinkKeyData, 16);
-		cmInd += 16;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_SET_LINK_KEY, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&setLinkKeyDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_SET_LINK_KEY, req);
 }
 
 /*********************************************************************
@@ -1246,27 +1595,8 @@ uint8_t zdoSetLinkKey(SetLinkKeyFormat_t *req)
  */
 uint8_t zdoRemoveLinkKey(RemoveLinkKeyFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->IEEEaddr, 8);
-		cmInd += 8;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_REMOVE_LINK_KEY, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&removeLinkKeyDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_REMOVE_LINK_KEY, req);
 }
 
 /*********************************************************************
@@ -1280,27 +1610,8 @@ uint8_t zdoRemoveLinkKey(RemoveLinkKeyFormat_t *req)
  */
 uint8_t zdoGetLinkKey(GetLinkKeyFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 8;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->IEEEaddr, 8);
-		cmInd += 8;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_GET_LINK_KEY, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&getLinkKeyDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_GET_LINK_KEY, req);
 }
 
 /*********************************************************************
@@ -1314,28 +1625,8 @@ uint8_t zdoGetLinkKey(GetLinkKeyFormat_t *req)
  */
 uint8_t zdoNwkDiscoveryReq(NwkDiscoveryReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 5;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		memcpy((cmd + cmInd), req->ScanChannels, 4);
-		cmInd += 4;
-		cmd[cmInd++] = req->ScanDuration;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_NWK_DISCOVERY_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&nwkDiscoveryReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_NWK_DISCOVERY_REQ, req);
 }
 
 /*********************************************************************
@@ -1349,34 +1640,8 @@ uint8_t zdoNwkDiscoveryReq(NwkDiscoveryReqFormat_t *req)
  */
 uint8_t zdoJoinReq(JoinReqFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 15;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = req->LogicalChannel;
-		cmd[cmInd++] = (uint8_t)(req->PanID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->PanID >> 8) & 0xFF);
-		memcpy((cmd + cmInd), req->ExtendedPanID, 8);
-		cmInd += 8;
-		cmd[cmInd++] = (uint8_t)(req->ChosenParent & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ChosenParent >> 8) & 0xFF);
-		cmd[cmInd++] = req->ParentDepth;
-		cmd[cmInd++] = req->StackProfile;
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_JOIN_REQ, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&joinReqDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_JOIN_REQ, req);
 }
 
 /*********************************************************************
@@ -1390,27 +1655,8 @@ uint8_t zdoJoinReq(JoinReqFormat_t *req)
  */
 uint8_t zdoMsgCbRegister(MsgCbRegisterFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
-
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MSG_CB_REGISTER, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
-	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
-	}
+	return mtSendReq(&msgCbRegisterDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MSG_CB_REGISTER, req);
 }
 
 /*********************************************************************
@@ -1424,27 +1670,38 @@ uint8_t zdoMsgCbRegister(MsgCbRegisterFormat_t *req)
  */
 uint8_t zdoMsgCbRemove(MsgCbRemoveFormat_t *req)
 {
-	uint8_t status;
-	uint8_t cmInd = 0;
-	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
-
-	if (cmd)
-	{
-
-		cmd[cmInd++] = (uint8_t)(req->ClusterID & 0xFF);
-		cmd[cmInd++] = (uint8_t)((req->ClusterID >> 8) & 0xFF);
+	return mtSendReq(&msgCbRemoveDesc, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+	        MT_ZDO_MSG_CB_REMOVE, req);
+}
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_MSG_CB_REMOVE, cmd, cmdLen);
-		free(cmd);
-		return status;
-	}
-	else
+/*********************************************************************
+ * @fn      decodeGetLinkKeySrsp
+ *
+ * @brief   Parses the SRSP into its command specific structure.
+ *
+ * @param   rpcBuff - Incoming buffer.
+ * @param   rpcLen - Length of incoming buffer.
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the frame is too short
+ */
+static uint8_t decodeGetLinkKeySrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        GetLinkKeySrspFormat_t *rsp)
+{
+	uint8_t msgIdx = 2;
+	if (MT_CHECK_LEN(rpcBuff, rpcLen, 25) != MT_RPC_SUCCESS)
 	{
-		LOG_ERR("Memory for cmd was not allocated");
-		return 1;
+		return MT_RPC_ERR_LENGTH;
 	}
+
+	rsp->Status = rpcBuff[msgIdx++];
+	rsp->IEEEAddr = 0;
+	uint8_t i;
+	for (i = 0; i < 8; i++)
+		rsp->IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
+	memcpy(rsp->LinkKeyData, &rpcBuff[msgIdx], 16);
+	msgIdx += 16;
+	return MT_RPC_SUCCESS;
 }
 
 /*********************************************************************
@@ -1461,24 +1718,12 @@ static void processGetLinkKey(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoGetLinkKey)
 	{
-		uint8_t msgIdx = 2;
 		GetLinkKeySrspFormat_t rsp;
-		if (rpcLen < 25)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (decodeGetLinkKeySrsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoGetLinkKey(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.IEEEAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-		memcpy(rsp.LinkKeyData, &rpcBuff[msgIdx], 16);
-		msgIdx += 16;
-
-		mtZdoCbs.pfnZdoGetLinkKey(&rsp);
 	}
 }
 
@@ -1494,37 +1739,19 @@ static void processGetLinkKey(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoNwkAddrRsp)
+	if (mtZdoCbs.pfnZdoNwkAddrRsp || zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
 		NwkAddrRspFormat_t rsp;
-		if (rpcLen < 13)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.IEEEAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.NumAssocDev = rpcBuff[msgIdx++];
-		if (rpcLen > 13)
+		if (mtDecode(&nwkAddrRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.NumAssocDev; i++)
+			zdoAddrRsp(rsp.Status, rsp.NwkAddr, rsp.IEEEAddr);
+			if (mtZdoCbs.pfnZdoNwkAddrRsp)
 			{
-				rsp.AssocDevList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
+				mtZdoCbs.pfnZdoNwkAddrRsp(&rsp);
 			}
 		}
-		mtZdoCbs.pfnZdoNwkAddrRsp(&rsp);
 	}
 }
 
@@ -1540,38 +1767,20 @@ static void processNwkAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processIeeeAddrRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoIeeeAddrRsp)
+	if (mtZdoCbs.pfnZdoIeeeAddrRsp || zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
 		IeeeAddrRspFormat_t rsp;
-		if (rpcLen < 13)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.IEEEAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.NumAssocDev = rpcBuff[msgIdx++];
-		rsp.StartIndex = (rsp.NumAssocDev == 0 ? 0 : rsp.StartIndex);
-		if (rpcLen > 13)
+		if (mtDecode(&ieeeAddrRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.NumAssocDev; i++)
+			zdoAddrRsp(rsp.Status, rsp.NwkAddr, rsp.IEEEAddr);
+			rsp.StartIndex = (rsp.NumAssocDev == 0 ? 0 : rsp.StartIndex);
+			if (mtZdoCbs.pfnZdoIeeeAddrRsp)
 			{
-				rsp.AssocDevList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
+				mtZdoCbs.pfnZdoIeeeAddrRsp(&rsp);
 			}
 		}
-		mtZdoCbs.pfnZdoIeeeAddrRsp(&rsp);
 	}
 }
 
@@ -1589,38 +1798,13 @@ static void processNodeDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoNodeDescRsp)
 	{
-		uint8_t msgIdx = 2;
 		NodeDescRspFormat_t rsp;
-		if (rpcLen < 18)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&nodeDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoNodeDescRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.LoTy_ComDescAv_UsrDesAv = rpcBuff[msgIdx++];
-		rsp.APSFlg_FrqBnd = rpcBuff[msgIdx++];
-		rsp.MACCapFlg = rpcBuff[msgIdx++];
-		rsp.ManufacturerCode = BUILD_UINT16(rpcBuff[msgIdx],
-		        rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.MaxBufferSize = rpcBuff[msgIdx++];
-		rsp.MaxTransferSize = BUILD_UINT16(rpcBuff[msgIdx],
-		        rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ServerMask = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.MaxOutTransferSize = BUILD_UINT16(rpcBuff[msgIdx],
-		        rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.DescriptorCapabilities = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoNodeDescRsp(&rsp);
 	}
 }
 
@@ -1638,24 +1822,13 @@ static void processPowerDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoPowerDescRsp)
 	{
-		uint8_t msgIdx = 2;
 		PowerDescRspFormat_t rsp;
-		if (rpcLen < 7)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&powerDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoPowerDescRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.CurrntPwrMode_AvalPwrSrcs = rpcBuff[msgIdx++];
-		rsp.CurrntPwrSrc_CurrntPwrSrcLvl = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoPowerDescRsp(&rsp);
 	}
 }
 
@@ -1671,48 +1844,34 @@ static void processPowerDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processSimpleDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoSimpleDescRsp)
+	if (mtZdoCbs.pfnZdoSimpleDescRsp || zdoDiscEnabled())
 	{
-		uint8_t msgIdx = 2;
 		SimpleDescRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&simpleDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			rsp.Endpoint = rpcBuff[msgIdx++];
-			rsp.ProfileID = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-			msgIdx += 2;
-			rsp.DeviceID = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-			msgIdx += 2;
-			rsp.DeviceVersion = rpcBuff[msgIdx++];
-			rsp.NumInClusters = rpcBuff[msgIdx++];
-			uint32_t i;
-			for (i = 0; i < rsp.NumInClusters; i++)
+			if (zdoDiscEnabled())
 			{
-				rsp.InClusterList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
+				zdoDiscDesc_t desc;
+
+				desc.endpoint = rsp.Endpoint;
+				desc.profileId = rsp.ProfileID;
+				desc.deviceId = rsp.DeviceID;
+				desc.deviceVersion = rsp.DeviceVersion;
+				desc.numInClusters = rsp.NumInClusters;
+				memcpy(desc.inClusters, rsp.InClusterList,
+				        sizeof(desc.inClusters));
+				desc.numOutClusters = rsp.NumOutClusters;
+				memcpy(desc.outClusters, rsp.OutClusterList,
+				        sizeof(desc.outClusters));
+				zdoDiscSimpleDescRsp(rsp.Status, rsp.NwkAddr, &desc);
 			}
-			rsp.NumOutClusters = rpcBuff[msgIdx++];
-			for (i = 0; i < rsp.NumOutClusters; i++)
+			if (mtZdoCbs.pfnZdoSimpleDescRsp)
 			{
-				rsp.OutClusterList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
+				mtZdoCbs.pfnZdoSimpleDescRsp(&rsp);
 			}
 		}
-		mtZdoCbs.pfnZdoSimpleDescRsp(&rsp);
 	}
 }
 
@@ -1728,32 +1887,20 @@ static void processSimpleDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processActiveEpRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoActiveEpRsp)
+	if (mtZdoCbs.pfnZdoActiveEpRsp || zdoDiscEnabled())
 	{
-		uint8_t msgIdx = 2;
-		ActiveEpRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ActiveEPCount = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		ActiveEpRspFormat_t rsp;
+
+		if (mtDecode(&activeEpRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.ActiveEPCount; i++)
+			zdoDiscActiveEpRsp(rsp.Status, rsp.NwkAddr, rsp.ActiveEPCount,
+			        rsp.ActiveEPList);
+			if (mtZdoCbs.pfnZdoActiveEpRsp)
 			{
-				rsp.ActiveEPList[i] = rpcBuff[msgIdx++];
+				mtZdoCbs.pfnZdoActiveEpRsp(&rsp);
 			}
 		}
-		mtZdoCbs.pfnZdoActiveEpRsp(&rsp);
 	}
 }
 
@@ -1771,30 +1918,13 @@ static void processMatchDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMatchDescRsp)
 	{
-		uint8_t msgIdx = 2;
 		MatchDescRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.MatchLength = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&matchDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.MatchLength; i++)
-			{
-				rsp.MatchList[i] = rpcBuff[msgIdx++];
-			}
+			mtZdoCbs.pfnZdoMatchDescRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoMatchDescRsp(&rsp);
 	}
 }
 
@@ -1812,30 +1942,13 @@ static void processComplexDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoComplexDescRsp)
 	{
-		uint8_t msgIdx = 2;
 		ComplexDescRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ComplexLength = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&complexDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.ComplexLength; i++)
-			{
-				rsp.ComplexList[i] = rpcBuff[msgIdx++];
-			}
+			mtZdoCbs.pfnZdoComplexDescRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoComplexDescRsp(&rsp);
 	}
 }
 
@@ -1853,30 +1966,13 @@ static void processUserDescRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoUserDescRsp)
 	{
-		uint8_t msgIdx = 2;
 		UserDescRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Len = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&userDescRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.Len; i++)
-			{
-				rsp.CUserDescriptor[i] = rpcBuff[msgIdx++];
-			}
+			mtZdoCbs.pfnZdoUserDescRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoUserDescRsp(&rsp);
 	}
 }
 
@@ -1894,22 +1990,13 @@ static void processUserDescConf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoUserDescConf)
 	{
-		uint8_t msgIdx = 2;
 		UserDescConfFormat_t rsp;
-		if (rpcLen < 5)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&userDescConfDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoUserDescConf(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtZdoCbs.pfnZdoUserDescConf(&rsp);
 	}
 }
 
@@ -1927,22 +2014,13 @@ static void processServerDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoServerDiscRsp)
 	{
-		uint8_t msgIdx = 2;
 		ServerDiscRspFormat_t rsp;
-		if (rpcLen < 5)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&serverDiscRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoServerDiscRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.ServerMask = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtZdoCbs.pfnZdoServerDiscRsp(&rsp);
 	}
 }
 
@@ -1960,20 +2038,13 @@ static void processEndDeviceBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoEndDeviceBindRsp)
 	{
-		uint8_t msgIdx = 2;
 		EndDeviceBindRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&endDeviceBindRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoEndDeviceBindRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoEndDeviceBindRsp(&rsp);
 	}
 }
 
@@ -1991,20 +2062,13 @@ static void processBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoBindRsp)
 	{
-		uint8_t msgIdx = 2;
 		BindRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&bindRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoBindRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoBindRsp(&rsp);
 	}
 }
 
@@ -2022,20 +2086,13 @@ static void processUnbindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoUnbindRsp)
 	{
-		uint8_t msgIdx = 2;
 		UnbindRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&unbindRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoUnbindRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoUnbindRsp(&rsp);
 	}
 }
 
@@ -2053,41 +2110,34 @@ static void processMgmtNwkDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtNwkDiscRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtNwkDiscRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NetworkCount = rpcBuff[msgIdx++];
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.NetworkListCount = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&mgmtNwkDiscRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.NetworkListCount; i++)
-			{
-				rsp.NetworkList[i].PanID = 0;
-				uint8_t ind;
-				for (ind = 0; ind < 8; ind++)
-					rsp.NetworkList[i].PanID |= ((uint64_t) rpcBuff[msgIdx++])
-					        << (ind * 8);
-				rsp.NetworkList[i].LogicalChannel = rpcBuff[msgIdx++];
-				rsp.NetworkList[i].StackProf_ZigVer = rpcBuff[msgIdx++];
-				rsp.NetworkList[i].BeacOrd_SupFramOrd = rpcBuff[msgIdx++];
-				rsp.NetworkList[i].PermitJoin = rpcBuff[msgIdx++];
-			}
+			mtZdoCbs.pfnZdoMgmtNwkDiscRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoMgmtNwkDiscRsp(&rsp);
 	}
 }
 
+/*********************************************************************
+ * @fn      zdoDecodeMgmtLqiRsp
+ *
+ * @brief   Decode a ZDO_MGMT_LQI_RSP frame, for the modules that
+ *          subscribe to it with mtSubscribe().
+ *
+ * @param   rpcBuff - Cmd0, Cmd1 and payload of the frame
+ * @param   rpcLen - Cmd0 + Cmd1 + payload + FCS
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH for a malformed frame
+ */
+uint8_t zdoDecodeMgmtLqiRsp(const uint8_t *rpcBuff, uint8_t rpcLen,
+        MgmtLqiRspFormat_t *rsp)
+{
+	return mtDecode(&mgmtLqiRspDesc, rpcBuff, rpcLen, rsp);
+}
+
 /*********************************************************************
  * @fn      processMgmtLqiRsp
  *
@@ -2100,51 +2150,25 @@ static void processMgmtNwkDiscRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processMgmtLqiRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoMgmtLqiRsp)
+	if (mtZdoCbs.pfnZdoMgmtLqiRsp || zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
 		MgmtLqiRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
+		uint8_t i;
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.NeighborTableEntries = rpcBuff[msgIdx++];
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.NeighborLqiListCount = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (zdoDecodeMgmtLqiRsp(rpcBuff, rpcLen, &rsp) == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.NeighborLqiListCount; i++)
+			for (i = 0; zdoAddrEnabled() && (i < rsp.NeighborLqiListCount);
+			        i++)
 			{
-
-				rsp.NeighborLqiList[i].ExtendedPanID = 0;
-				uint8_t ind;
-				for (ind = 0; ind < 8; ind++)
-					rsp.NeighborLqiList[i].ExtendedPanID |=
-					        ((uint64_t) rpcBuff[msgIdx++]) << (ind * 8);
-				rsp.NeighborLqiList[i].ExtendedAddress = 0;
-				for (ind = 0; ind < 8; ind++)
-					rsp.NeighborLqiList[i].ExtendedAddress |=
-					        ((uint64_t) rpcBuff[msgIdx++]) << (ind * 8);
-				rsp.NeighborLqiList[i].NetworkAddress = BUILD_UINT16(
-				        rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
-				rsp.NeighborLqiList[i].DevTyp_RxOnWhenIdle_Relat =
-				        rpcBuff[msgIdx++];
-				rsp.NeighborLqiList[i].PermitJoining = rpcBuff[msgIdx++];
-				rsp.NeighborLqiList[i].Depth = rpcBuff[msgIdx++];
-				rsp.NeighborLqiList[i].LQI = rpcBuff[msgIdx++];
-
+				zdoAddrUpdate(rsp.NeighborLqiList[i].NetworkAddress,
+				        rsp.NeighborLqiList[i].ExtendedAddress,
+				        ZDO_ADDR_SRC_NEIGHBOR);
+			}
+			if (mtZdoCbs.pfnZdoMgmtLqiRsp)
+			{
+				mtZdoCbs.pfnZdoMgmtLqiRsp(&rsp);
 			}
 		}
-		MgmtLqiRspFormat_t *copyy = &rsp;
-		mtZdoCbs.pfnZdoMgmtLqiRsp(copyy);
 	}
 }
 
@@ -2162,36 +2186,13 @@ static void processMgmtRtgRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtRtgRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtRtgRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.RoutingTableEntries = rpcBuff[msgIdx++];
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.RoutingTableListCount = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&mgmtRtgRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.RoutingTableListCount; i++)
-			{
-				rsp.RoutingTableList[i].DstAddr = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
-				rsp.RoutingTableList[i].Status = rpcBuff[msgIdx++];
-				rsp.RoutingTableList[i].NextHop = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
-			}
+			mtZdoCbs.pfnZdoMgmtRtgRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoMgmtRtgRsp(&rsp);
 	}
 }
 
@@ -2209,42 +2210,13 @@ static void processMgmtBindRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtBindRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtBindRspFormat_t rsp;
-		if (rpcLen < 6)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.BindingTableEntries = rpcBuff[msgIdx++];
-		rsp.StartIndex = rpcBuff[msgIdx++];
-		rsp.BindingTableListCount = rpcBuff[msgIdx++];
-		if (rpcLen > 6)
+		if (mtDecode(&mgmtBindRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.BindingTableListCount; i++)
-			{
-				rsp.BindingTableList[i].SrcIEEEAddr = 0;
-				uint8_t i;
-				for (i = 0; i < 8; i++)
-					rsp.BindingTableList[i].SrcIEEEAddr |=
-					        ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-				rsp.BindingTableList[i].SrcEndpoint = rpcBuff[msgIdx++];
-				rsp.BindingTableList[i].ClusterID = rpcBuff[msgIdx++];
-				rsp.BindingTableList[i].DstAddrMode = rpcBuff[msgIdx++];
-				rsp.BindingTableList[i].DstIEEEAddr = 0;
-				for (i = 0; i < 8; i++)
-					rsp.BindingTableList[i].DstIEEEAddr |=
-					        ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-				rsp.BindingTableList[i].DstEndpoint = rpcBuff[msgIdx++];
-			}
+			mtZdoCbs.pfnZdoMgmtBindRsp(&rsp);
 		}
-		mtZdoCbs.pfnZdoMgmtBindRsp(&rsp);
 	}
 }
 
@@ -2262,20 +2234,13 @@ static void processMgmtLeaveRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtLeaveRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtLeaveRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&mgmtLeaveRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoMgmtLeaveRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoMgmtLeaveRsp(&rsp);
 	}
 }
 
@@ -2293,20 +2258,13 @@ static void processMgmtDirectJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtDirectJoinRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtDirectJoinRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&mgmtDirectJoinRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoMgmtDirectJoinRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoMgmtDirectJoinRsp(&rsp);
 	}
 }
 
@@ -2324,20 +2282,13 @@ static void processMgmtPermitJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMgmtPermitJoinRsp)
 	{
-		uint8_t msgIdx = 2;
 		MgmtPermitJoinRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&mgmtPermitJoinRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoMgmtPermitJoinRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoMgmtPermitJoinRsp(&rsp);
 	}
 }
 
@@ -2353,28 +2304,21 @@ static void processMgmtPermitJoinRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processEndDeviceAnnceInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoEndDeviceAnnceInd)
+	if (mtZdoCbs.pfnZdoEndDeviceAnnceInd || zdoAddrEnabled()
+	        || zdoDiscEnabled())
 	{
-		uint8_t msgIdx = 2;
 		EndDeviceAnnceIndFormat_t rsp;
-		if (rpcLen < 13)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&endDeviceAnnceIndDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			zdoAddrUpdate(rsp.NwkAddr, rsp.IEEEAddr, ZDO_ADDR_SRC_ANNCE);
+			zdoDiscAnnce(rsp.NwkAddr, rsp.IEEEAddr, rsp.Capabilities);
+			if (mtZdoCbs.pfnZdoEndDeviceAnnceInd)
+			{
+				mtZdoCbs.pfnZdoEndDeviceAnnceInd(&rsp);
+			}
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.IEEEAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
-			rsp.IEEEAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
-		rsp.Capabilities = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoEndDeviceAnnceInd(&rsp);
 	}
 }
 
@@ -2392,34 +2336,13 @@ static void processMatchDescRspSent(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoMatchDescRspSent)
 	{
-		uint8_t msgIdx = 2;
 		MatchDescRspSentFormat_t rsp;
-		if (rpcLen < 4)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.NwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.NumInClusters = rpcBuff[msgIdx++];
-		uint32_t i;
-		for (i = 0; i < rsp.NumInClusters; i++)
+		if (mtDecode(&matchDescRspSentDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			rsp.InClusterList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-			        rpcBuff[msgIdx + 1]);
-			msgIdx += 2;
+			mtZdoCbs.pfnZdoMatchDescRspSent(&rsp);
 		}
-		rsp.NumOutClusters = rpcBuff[msgIdx++];
-		for (i = 0; i < rsp.NumOutClusters; i++)
-		{
-			rsp.OutClusterList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-			        rpcBuff[msgIdx + 1]);
-			msgIdx += 2;
-		}
-
-		mtZdoCbs.pfnZdoMatchDescRspSent(&rsp);
 	}
 }
 
@@ -2437,20 +2360,13 @@ static void processStatusErrorRsp(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoStatusErrorRsp)
 	{
-		uint8_t msgIdx = 2;
 		StatusErrorRspFormat_t rsp;
-		if (rpcLen < 3)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
 
+		if (mtDecode(&statusErrorRspDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
+		{
+			mtZdoCbs.pfnZdoStatusErrorRsp(&rsp);
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoStatusErrorRsp(&rsp);
 	}
 }
 
@@ -2466,29 +2382,19 @@ static void processStatusErrorRsp(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processSrcRtgInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoSrcRtgInd)
+	if (mtZdoCbs.pfnZdoSrcRtgInd || afRouteEnabled())
 	{
-		uint8_t msgIdx = 2;
 		SrcRtgIndFormat_t rsp;
-		if (rpcLen < 4)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.DstAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.RelayCount = rpcBuff[msgIdx++];
-		uint32_t i;
-		for (i = 0; i < rsp.RelayCount; i++)
+		if (mtDecode(&srcRtgIndDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			rsp.RelayList[i] = BUILD_UINT16(rpcBuff[msgIdx],
-			        rpcBuff[msgIdx + 1]);
-			msgIdx += 2;
+			afRouteUpdate(rsp.DstAddr, rsp.RelayCount, rsp.RelayList);
+			if (mtZdoCbs.pfnZdoSrcRtgInd)
+			{
+				mtZdoCbs.pfnZdoSrcRtgInd(&rsp);
+			}
 		}
-
-		mtZdoCbs.pfnZdoSrcRtgInd(&rsp);
 	}
 }
 /*********************************************************************
@@ -2505,45 +2411,13 @@ static void processBeaconNotifyInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoBeaconNotifyInd)
 	{
-		uint8_t msgIdx = 2;
 		BeaconNotifyIndFormat_t rsp;
-		if (rpcLen < 1)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-		}
-		LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.BeaconCount = rpcBuff[msgIdx++];
-		if (rpcLen > 1)
+		if (mtDecode(&beaconNotifyIndDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			uint32_t i;
-			for (i = 0; i < rsp.BeaconCount; i++)
-			{
-				rsp.BeaconList[i].SrcAddr = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
-				rsp.BeaconList[i].PanId = BUILD_UINT16(rpcBuff[msgIdx],
-				        rpcBuff[msgIdx + 1]);
-				msgIdx += 2;
-				rsp.BeaconList[i].LogicalChannel = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].PermitJoining = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].RouterCap = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].DevCap = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].ProtocolVer = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].StackProf = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].Lqi = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].Depth = rpcBuff[msgIdx++];
-				rsp.BeaconList[i].UpdateId = rpcBuff[msgIdx++];
-
-				rsp.BeaconList[i].ExtendedPanId = 0;
-				uint8_t ind;
-				for (ind = 0; ind < 8; ind++)
-					rsp.BeaconList[i].ExtendedPanId |=
-					        ((uint64_t) rpcBuff[msgIdx++]) << (ind * 8);
-
-			}
+			mtZdoCbs.pfnZdoBeaconNotifyInd(&rsp);
 		}
-		mtZdoCbs.pfnZdoBeaconNotifyInd(&rsp);
 	}
 }
 
@@ -2561,21 +2435,13 @@ static void processJoinCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoJoinCnf)
 	{
-		uint8_t msgIdx = 2;
 		JoinCnfFormat_t rsp;
-		if (rpcLen < 5)
+
+		if (mtDecode(&joinCnfDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtZdoCbs.pfnZdoJoinCnf(&rsp);
 		}
-		LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-		rsp.DevAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		rsp.ParentAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		mtZdoCbs.pfnZdoJoinCnf(&rsp);
 	}
 }
 
@@ -2593,17 +2459,13 @@ static void processNwkDiscoveryCnf(uint8_t *rpcBuff, uint8_t rpcLen)
 {
 	if (mtZdoCbs.pfnZdoNwkDiscoveryCnf)
 	{
-		uint8_t msgIdx = 2;
 		NwkDiscoveryCnfFormat_t rsp;
-		if (rpcLen < 1)
+
+		if (mtDecode(&nwkDiscoveryCnfDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
+			mtZdoCbs.pfnZdoNwkDiscoveryCnf(&rsp);
 		}
-		LOG_DBG("rpcLen = %d", rpcLen);
-
-		rsp.Status = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoNwkDiscoveryCnf(&rsp);
 	}
 }
 /*********************************************************************
@@ -2618,31 +2480,22 @@ static void processNwkDiscoveryCnf(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processLeaveInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoLeaveInd)
+	if (mtZdoCbs.pfnZdoLeaveInd || zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
 		LeaveIndFormat_t rsp;
-		if (rpcLen < 13)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
-		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-		
-		rsp.ExtAddr = 0;		
-		uint8_t i;
-		for (i = 0; i < 8; i++)
+		if (mtDecode(&leaveIndDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			rsp.ExtAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
+			if (!rsp.Rejoin)
+			{
+				zdoAddrRemove(rsp.ExtAddr);
+			}
+			if (mtZdoCbs.pfnZdoLeaveInd)
+			{
+				mtZdoCbs.pfnZdoLeaveInd(&rsp);
+			}
 		}
-		rsp.Request = rpcBuff[msgIdx++];
-		rsp.Remove = rpcBuff[msgIdx++];
-		rsp.Rejoin = rpcBuff[msgIdx++];
-
-		mtZdoCbs.pfnZdoLeaveInd(&rsp);
 	}
 }
 
@@ -2658,28 +2511,19 @@ static void processLeaveInd(uint8_t *rpcBuff, uint8_t rpcLen)
  */
 static void processTcDevInd(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-	if (mtZdoCbs.pfnZdoTcDevInd)
+	if (mtZdoCbs.pfnZdoTcDevInd || zdoAddrEnabled())
 	{
-		uint8_t msgIdx = 2;
 		TcDevIndFormat_t rsp;
-		if (rpcLen < 12)
-		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
-		}
 
-		rsp.SrcNwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-		msgIdx += 2;
-
-		rsp.ExtAddr = 0;
-		uint8_t i;
-		for (i = 0; i < 8; i++)
+		if (mtDecode(&tcDevIndDesc, rpcBuff, rpcLen, &rsp)
+		        == MT_RPC_SUCCESS)
 		{
-			rsp.ExtAddr |= ((uint64_t) rpcBuff[msgIdx++]) << (i * 8);
+			zdoAddrUpdate(rsp.SrcNwkAddr, rsp.ExtAddr, ZDO_ADDR_SRC_TC_DEV);
+			if (mtZdoCbs.pfnZdoTcDevInd)
+			{
+				mtZdoCbs.pfnZdoTcDevInd(&rsp);
+			}
 		}
-		rsp.ParentNwkAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
-
-		mtZdoCbs.pfnZdoTcDevInd(&rsp);
 	}
 }
 /*********************************************************************
@@ -2698,12 +2542,10 @@ static void processMsgCbIncoming(uint8_t *rpcBuff, uint8_t rpcLen)
 	{
 		uint8_t msgIdx = 2;
 		MsgCbIncomingFormat_t rsp;
-		if (rpcLen < 9)
+		if (MT_CHECK_LEN(rpcBuff, rpcLen, 21) != MT_RPC_SUCCESS)
 		{
-			LOG_WARN("MT_RPC_ERR_LENGTH");
-
+			return;
 		}
-		//LOG_DBG("rpcLen = %d", rpcLen);
 
 		rsp.SrcAddr = BUILD_UINT16(rpcBuff[msgIdx], rpcBuff[msgIdx + 1]);
 		msgIdx += 2;
@@ -2744,7 +2586,8 @@ uint8_t zdoInit(void)
 	uint8_t status;
 	// build the buffer
 	uint32_t cmdLen = 2;
-	uint8_t *cmd = malloc(cmdLen);
+	rpcFrame_t frame;
+	uint8_t *cmd = rpcFrameInit(&frame, cmdLen);
 
 	if (cmd)
 	{
@@ -2752,229 +2595,109 @@ uint8_t zdoInit(void)
 		cmd[0] = LO_UINT16(STARTDELAY);
 		cmd[1] = HI_UINT16(STARTDELAY);
 
-		status = rpcSendFrame((MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
-		MT_ZDO_STARTUP_FROM_APP, cmd, cmdLen);
-		free(cmd);
+		status = rpcFrameSend(&frame, (MT_RPC_CMD_SREQ | MT_RPC_SYS_ZDO),
+		MT_ZDO_STARTUP_FROM_APP, cmdLen);
 		return status;
 	}
 	else
 	{
-		LOG_ERR("Memory for cmd was not allocated");
+		LOG_ERR("Command too long for a frame");
 		return 1;
 	}
 }
 
-/*************************************************************************************************
- * @fn      zdoProcess()
- *
- * @brief   read and process the RPC ZDO message from the ZB SoC
- *
- * @param   none
- *
- * @return  length of current Rx Buffer
- ***********************************************************************************************/
-void zdoProcess(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	LOG_DBG("zdoProcess: processing CMD0:%x, CMD1:%x",
-	        rpcBuff[0], rpcBuff[1]);
-
-	//process the synchronous SRSP from SREQ
-	if ((rpcBuff[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
-	{
-		processSrsp(rpcBuff, rpcLen);
-	}
-	else
-	{
-        //Read CMD1 and processes the specific SREQ
-        switch (rpcBuff[1])
-        {
-            case MT_ZDO_STATE_CHANGE_IND:
-                LOG_DBG("MT_ZDO_STATE_CHANGE_IND");
-                processStateChange(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_NWK_ADDR_RSP:
-                LOG_DBG("MT_ZDO_NWK_ADDR_RSP");
-                processNwkAddrRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_IEEE_ADDR_RSP:
-                LOG_DBG("MT_ZDO_IEEE_ADDR_RSP");
-                processIeeeAddrRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_NODE_DESC_RSP:
-                LOG_DBG("MT_ZDO_NODE_DESC_RSP");
-                processNodeDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_POWER_DESC_RSP:
-                LOG_DBG("MT_ZDO_POWER_DESC_RSP");
-                processPowerDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_SIMPLE_DESC_RSP:
-                LOG_DBG("MT_ZDO_SIMPLE_DESC_RSP");
-                processSimpleDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_ACTIVE_EP_RSP:
-                LOG_DBG("MT_ZDO_ACTIVE_EP_RSP");
-                processActiveEpRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MATCH_DESC_RSP:
-                LOG_DBG("MT_ZDO_MATCH_DESC_RSP");
-                processMatchDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_COMPLEX_DESC_RSP:
-                LOG_DBG("MT_ZDO_COMPLEX_DESC_RSP");
-                processComplexDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_USER_DESC_RSP:
-                LOG_DBG("MT_ZDO_USER_DESC_RSP");
-                processUserDescRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_USER_DESC_CONF:
-                LOG_DBG("MT_ZDO_USER_DESC_CONF");
-                processUserDescConf(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_SERVER_DISC_RSP:
-                LOG_DBG("MT_ZDO_SERVER_DISC_RSP");
-                processServerDiscRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_END_DEVICE_BIND_RSP:
-                LOG_DBG("MT_ZDO_END_DEVICE_BIND_RSP");
-                processEndDeviceBindRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_BIND_RSP:
-                LOG_DBG("MT_ZDO_BIND_RSP");
-                processBindRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_UNBIND_RSP:
-                LOG_DBG("MT_ZDO_UNBIND_RSP");
-                processUnbindRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_NWK_DISC_RSP:
-                LOG_DBG("MT_ZDO_MGMT_NWK_DISC_RSP");
-                processMgmtNwkDiscRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_LQI_RSP:
-                LOG_DBG("zdoProcess: MT_ZDO_MGMT_LQI_RSP");
-                processMgmtLqiRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_RTG_RSP:
-                LOG_DBG("zdoProcess: MT_ZDO_MGMT_RTG_RSP");
-                processMgmtRtgRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_BIND_RSP:
-                LOG_DBG("MT_ZDO_MGMT_BIND_RSP");
-                processMgmtBindRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_LEAVE_RSP:
-                LOG_DBG("MT_ZDO_MGMT_LEAVE_RSP");
-                processMgmtLeaveRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_DIRECT_JOIN_RSP:
-                LOG_DBG("MT_ZDO_MGMT_DIRECT_JOIN_RSP");
-                processMgmtDirectJoinRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MGMT_PERMIT_JOIN_RSP:
-                LOG_DBG("MT_ZDO_MGMT_PERMIT_JOIN_RSP");
-                processMgmtPermitJoinRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_END_DEVICE_ANNCE_IND:
-                LOG_DBG("MT_ZDO_END_DEVICE_ANNCE_IND");
-                processEndDeviceAnnceInd(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MATCH_DESC_RSP_SENT:
-                LOG_DBG("MT_ZDO_MATCH_DESC_RSP_SENT");
-                processMatchDescRspSent(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_STATUS_ERROR_RSP:
-                LOG_DBG("MT_ZDO_STATUS_ERROR_RSP");
-                processStatusErrorRsp(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_SRC_RTG_IND:
-                LOG_DBG("MT_ZDO_SRC_RTG_IND");
-                processSrcRtgInd(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_BEACON_NOTIFY_IND:
-                LOG_DBG("MT_ZDO_BEACON_NOTIFY_IND");
-                processBeaconNotifyInd(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_JOIN_CNF:
-                LOG_DBG("MT_ZDO_JOIN_CNF");
-                processJoinCnf(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_NWK_DISCOVERY_CNF:
-                LOG_DBG("MT_ZDO_NWK_DISCOVERY_CNF");
-                processNwkDiscoveryCnf(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_LEAVE_IND:
-                LOG_DBG("MT_ZDO_LEAVE_IND");
-                processLeaveInd(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_TC_DEV_IND:
-                LOG_DBG("MT_ZDO_TC_DEV_IND");
-                processTcDevInd(rpcBuff, rpcLen);
-                break;
-            case MT_ZDO_MSG_CB_INCOMING:
-                LOG_DBG("MT_ZDO_MSG_CB_INCOMING");
-                processMsgCbIncoming(rpcBuff, rpcLen);
-                break;
-            default:
-                LOG_ERR("CMD0:%X, CMD1:%X, not handled", rpcBuff[0], rpcBuff[1]);
-                break;
-        }
-    }
-}
-/*********************************************************************
- * @fn      processSrsp
- *
- * @brief  Generic function for processing the SRSP and copying it to
- *         local buffer for SREQ function to deal with
- *
- * @param
- *
- * @return
- */
-static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
-{
-	//copies sresp to local buffer
-	memcpy(srspRpcBuff, rpcBuff, rpcLen);
-	//srspRpcLen = rpcLen;
-	switch (rpcBuff[1])
-	{
-        case MT_ZDO_ACTIVE_EP_REQ:
-            LOG_DBG("MT_ZDO_ACTIVE_EP_REQ");
-            processActiveEpReqSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_NODE_DESC_REQ:
-            LOG_DBG("MT_ZDO_NODE_DESC_REQ");
-            processNodeDescReqSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_GET_LINK_KEY:
-            LOG_DBG("MT_ZDO_GET_LINK_KEY");
-            processGetLinkKey(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_NWK_DISCOVERY_REQ:
-            LOG_DBG("MT_ZDO_NWK_DISCOVERY_SRSCP : %s", rpcBuff[2] ? "ERROR":"SUCCESS");
-            break;
-        case MT_ZDO_STARTUP_FROM_APP:
-            LOG_DBG("MT_ZDO_STARTUP_FROM_APP");
-            processStartupFromAppSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_DEVICE_ANNCE:
-            LOG_DBG("MT_ZDO_DEVICE_ANNCE");
-            processDeviceAnnceSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_EXT_ROUTE_DISC:
-            LOG_DBG("MT_ZDO_EXT_ROUTE_DISC");
-            processExtRouteDiscSrsp(rpcBuff, rpcLen);
-            break;
-        case MT_ZDO_MGMT_PERMIT_JOIN_REQ:
-            LOG_DBG("MT_ZDO_MGMT_PERMIT_JOIN_REQ");
-            processPermitJoinReqSrsp(rpcBuff, rpcLen);
-            break;
-        default:
-            LOG_WARN("processSrsp: unsupported ZDO message : %02X", rpcBuff[1], rpcBuff[1]);
-            break;
-	}
-}
+/*********************************************************************
+ * HANDLER TABLE
+ *
+ * Incoming ZDO commands, installed in the MT dispatch table by mtProcess()
+ */
+const mtHandlerEntry_t zdoHandlerTable[] =
+{
+	{ MT_RPC_CMD_AREQ, MT_ZDO_STATE_CHANGE_IND, processStateChange,
+	        MT_CB(mtZdoCb_t, pfnmtZdoStateChangeInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_NWK_ADDR_RSP, processNwkAddrRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoNwkAddrRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_IEEE_ADDR_RSP, processIeeeAddrRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoIeeeAddrRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_NODE_DESC_RSP, processNodeDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoNodeDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_POWER_DESC_RSP, processPowerDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoPowerDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_SIMPLE_DESC_RSP, processSimpleDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoSimpleDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_ACTIVE_EP_RSP, processActiveEpRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoActiveEpRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MATCH_DESC_RSP, processMatchDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMatchDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_COMPLEX_DESC_RSP, processComplexDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoComplexDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_USER_DESC_RSP, processUserDescRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoUserDescRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_USER_DESC_CONF, processUserDescConf,
+	        MT_CB(mtZdoCb_t, pfnZdoUserDescConf) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_SERVER_DISC_RSP, processServerDiscRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoServerDiscRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_END_DEVICE_BIND_RSP, processEndDeviceBindRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoEndDeviceBindRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_BIND_RSP, processBindRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoBindRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_UNBIND_RSP, processUnbindRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoUnbindRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_NWK_DISC_RSP, processMgmtNwkDiscRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtNwkDiscRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_LQI_RSP, processMgmtLqiRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtLqiRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_RTG_RSP, processMgmtRtgRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtRtgRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_BIND_RSP, processMgmtBindRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtBindRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_LEAVE_RSP, processMgmtLeaveRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtLeaveRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_DIRECT_JOIN_RSP, processMgmtDirectJoinRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtDirectJoinRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MGMT_PERMIT_JOIN_RSP, processMgmtPermitJoinRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoMgmtPermitJoinRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_END_DEVICE_ANNCE_IND, processEndDeviceAnnceInd,
+	        MT_CB(mtZdoCb_t, pfnZdoEndDeviceAnnceInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MATCH_DESC_RSP_SENT, processMatchDescRspSent,
+	        MT_CB(mtZdoCb_t, pfnZdoMatchDescRspSent) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_STATUS_ERROR_RSP, processStatusErrorRsp,
+	        MT_CB(mtZdoCb_t, pfnZdoStatusErrorRsp) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_SRC_RTG_IND, processSrcRtgInd,
+	        MT_CB(mtZdoCb_t, pfnZdoSrcRtgInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_BEACON_NOTIFY_IND, processBeaconNotifyInd,
+	        MT_CB(mtZdoCb_t, pfnZdoBeaconNotifyInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_JOIN_CNF, processJoinCnf,
+	        MT_CB(mtZdoCb_t, pfnZdoJoinCnf) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_NWK_DISCOVERY_CNF, processNwkDiscoveryCnf,
+	        MT_CB(mtZdoCb_t, pfnZdoNwkDiscoveryCnf) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_LEAVE_IND, processLeaveInd,
+	        MT_CB(mtZdoCb_t, pfnZdoLeaveInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_TC_DEV_IND, processTcDevInd,
+	        MT_CB(mtZdoCb_t, pfnZdoTcDevInd) },
+	{ MT_RPC_CMD_AREQ, MT_ZDO_MSG_CB_INCOMING, processMsgCbIncoming,
+	        MT_CB(mtZdoCb_t, pfnZdoMsgCbIncoming) },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_ACTIVE_EP_REQ, processActiveEpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_NODE_DESC_REQ, processNodeDescReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_GET_LINK_KEY, processGetLinkKey, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_NWK_DISCOVERY_REQ, processStartupFromAppSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_STARTUP_FROM_APP, processStartupFromAppSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_DEVICE_ANNCE, processDeviceAnnceSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_EXT_ROUTE_DISC, processExtRouteDiscSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MGMT_PERMIT_JOIN_REQ, processPermitJoinReqSrsp,
+	        0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_IEEE_ADDR_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_POWER_DESC_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_SIMPLE_DESC_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MATCH_DESC_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_BIND_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_UNBIND_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MGMT_LQI_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MGMT_RTG_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MGMT_BIND_REQ, processZdpReqSrsp, 0 },
+	{ MT_RPC_CMD_SRSP, MT_ZDO_MGMT_LEAVE_REQ, processZdpReqSrsp, 0 },
+	{ 0, 0, NULL, 0 }
+};
 
 /*********************************************************************
  * @fn      zbRegisterZdoCallbacks
@@ -2988,5 +2711,49 @@ static void processSrsp(uint8_t *rpcBuff, uint8_t rpcLen)
 void zdoRegisterCallbacks(mtZdoCb_t cbs)
 {
 	memcpy(&mtZdoCbs, &cbs, sizeof(mtZdoCb_t));
-}
-
+	mtUpdateInterest(MT_RPC_SYS_ZDO, zdoHandlerTable, &mtZdoCbs);
+}
+
+/*********************************************************************
+ * SYNCHRONOUS REQUESTS
+ *
+ * xxxSync() sends the SREQ, waits up to timeoutMs (0 for the default)
+ * for its SRSP and decodes it into rsp. The SRSP is not passed to the
+ * registered callbacks.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT, MT_RPC_ERR_BUSY or
+ *          MT_RPC_ERR_TRANSPORT
+ */
+MT_SYNC_REQ(zdoNwkAddrReq, NwkAddrReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoIeeeAddrReq, IeeeAddrReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoNodeDescReq, NodeDescReqFormat_t, NodeDescReqSrspFormat_t, decodeNodeDescReqSrsp)
+MT_SYNC_REQ(zdoPowerDescReq, PowerDescReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoSimpleDescReq, SimpleDescReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoActiveEpReq, ActiveEpReqFormat_t, ActiveEpReqSrspFormat_t, decodeActiveEpReqSrsp)
+MT_SYNC_REQ(zdoMatchDescReq, MatchDescReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoComplexDescReq, ComplexDescReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoUserDescReq, UserDescReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoDeviceAnnce, DeviceAnnceFormat_t, DeviceAnnceSrspFormat_t, decodeDeviceAnnceSrsp)
+MT_SYNC_REQ(zdoUserDescSet, UserDescSetFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoServerDiscReq, ServerDiscReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoEndDeviceBindReq, EndDeviceBindReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoBindReq, BindReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoUnbindReq, UnbindReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtNwkDiscReq, MgmtNwkDiscReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtLqiReq, MgmtLqiReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtRtgReq, MgmtRtgReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtBindReq, MgmtBindReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtLeaveReq, MgmtLeaveReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtDirectJoinReq, MgmtDirectJoinReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMgmtPermitJoinReq, MgmtPermitJoinReqFormat_t, PermitJoinReqSrspFormat_t, decodePermitJoinReqSrsp)
+MT_SYNC_REQ(zdoMgmtNwkUpdateReq, MgmtNwkUpdateReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoStartupFromApp, StartupFromAppFormat_t, StartupFromAppSrspFormat_t, decodeStartupFromAppSrsp)
+MT_SYNC_REQ(zdoAutoFindDestination, AutoFindDestinationFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoSetLinkKey, SetLinkKeyFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoRemoveLinkKey, RemoveLinkKeyFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoGetLinkKey, GetLinkKeyFormat_t, GetLinkKeySrspFormat_t, decodeGetLinkKeySrsp)
+MT_SYNC_REQ(zdoNwkDiscoveryReq, NwkDiscoveryReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoJoinReq, JoinReqFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMsgCbRegister, MsgCbRegisterFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoMsgCbRemove, MsgCbRemoveFormat_t, StatusSrspFormat_t, mtDecodeStatusSrsp)
+MT_SYNC_REQ(zdoExtRouteDisc, ExtRouteDiscFormat_t, ExtRouteDiscSrspFormat_t, decodeExtRouteDiscSrsp)
@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include "mtParser.h"
 
 /***************************************************************************************************
  * ZDO COMMANDS
@@ -866,14 +867,24 @@ uint8_t zdoServerDiscReq(ServerDiscReqFormat_t *req);
 uint8_t zdoEndDeviceBindReq(EndDeviceBindReqFormat_t *req);
 uint8_t zdoBindReq(BindReqFormat_t *req);
 uint8_t zdoUnbindReq(UnbindReqFormat_t *req);
+uint8_t zdoBindReqCb(const BindReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
+uint8_t zdoUnbindReqCb(const UnbindReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t zdoMgmtNwkDiscReq(MgmtNwkDiscReqFormat_t *req);
 uint8_t zdoMgmtLqiReq(MgmtLqiReqFormat_t *req);
+uint8_t zdoMgmtLqiReqCb(MgmtLqiReqFormat_t *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
+uint8_t zdoDecodeMgmtLqiRsp(const uint8_t *rpcBuff, uint8_t rpcLen,
+        MgmtLqiRspFormat_t *rsp);
 uint8_t zdoMgmtRtgReq(MgmtRtgReqFormat_t *req);
 uint8_t zdoMgmtBindReq(MgmtBindReqFormat_t *req);
 uint8_t zdoMgmtLeaveReq(MgmtLeaveReqFormat_t *req);
 uint8_t zdoMgmtDirectJoinReq(MgmtDirectJoinReqFormat_t *req);
 uint8_t zdoMgmtPermitJoinReq(MgmtPermitJoinReqFormat_t *req);
 uint8_t zdoMgmtNwkUpdateReq(MgmtNwkUpdateReqFormat_t *req);
+uint8_t zdoSendReqCb(uint8_t cmd1, const void *req, uint32_t timeoutMs,
+        rpcSrspCb_t cb, void *cbArg);
 uint8_t zdoStartupFromApp(StartupFromAppFormat_t *req);
 uint8_t zdoAutoFindDestination(AutoFindDestinationFormat_t *req);
 uint8_t zdoSetLinkKey(SetLinkKeyFormat_t *req);
@@ -885,7 +896,75 @@ uint8_t zdoMsgCbRegister(MsgCbRegisterFormat_t *req);
 uint8_t zdoMsgCbRemove(MsgCbRemoveFormat_t *req);
 uint8_t zdoExtRouteDisc(ExtRouteDiscFormat_t *req);
 
-void zdoProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+// synchronous variants, return the decoded SRSP
+uint8_t zdoNwkAddrReqSync(NwkAddrReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoIeeeAddrReqSync(IeeeAddrReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoNodeDescReqSync(NodeDescReqFormat_t *req,
+        NodeDescReqSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoPowerDescReqSync(PowerDescReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoSimpleDescReqSync(SimpleDescReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoActiveEpReqSync(ActiveEpReqFormat_t *req,
+        ActiveEpReqSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMatchDescReqSync(MatchDescReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoComplexDescReqSync(ComplexDescReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoUserDescReqSync(UserDescReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoDeviceAnnceSync(DeviceAnnceFormat_t *req,
+        DeviceAnnceSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoUserDescSetSync(UserDescSetFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoServerDiscReqSync(ServerDiscReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoEndDeviceBindReqSync(EndDeviceBindReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoBindReqSync(BindReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoUnbindReqSync(UnbindReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtNwkDiscReqSync(MgmtNwkDiscReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtLqiReqSync(MgmtLqiReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtRtgReqSync(MgmtRtgReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtBindReqSync(MgmtBindReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtLeaveReqSync(MgmtLeaveReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtDirectJoinReqSync(MgmtDirectJoinReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtPermitJoinReqSync(MgmtPermitJoinReqFormat_t *req,
+        PermitJoinReqSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMgmtNwkUpdateReqSync(MgmtNwkUpdateReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoStartupFromAppSync(StartupFromAppFormat_t *req,
+        StartupFromAppSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoAutoFindDestinationSync(AutoFindDestinationFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoSetLinkKeySync(SetLinkKeyFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoRemoveLinkKeySync(RemoveLinkKeyFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoGetLinkKeySync(GetLinkKeyFormat_t *req,
+        GetLinkKeySrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoNwkDiscoveryReqSync(NwkDiscoveryReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoJoinReqSync(JoinReqFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMsgCbRegisterSync(MsgCbRegisterFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoMsgCbRemoveSync(MsgCbRemoveFormat_t *req,
+        StatusSrspFormat_t *rsp, uint32_t timeoutMs);
+uint8_t zdoExtRouteDiscSync(ExtRouteDiscFormat_t *req,
+        ExtRouteDiscSrspFormat_t *rsp, uint32_t timeoutMs);
+
+extern const mtHandlerEntry_t zdoHandlerTable[];
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,873 @@
+/*
+ * mtZdoAddr.c
+ *
+ * NWK <-> IEEE address cache, see mtZdoAddr.h. The pairs are kept in a
+ * dense array indexed twice, by NWK and by IEEE address, with open
+ * addressing hash tables. A NWK address belongs to one pair only: a
+ * newer pair taking it over drops the older one.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtZdoAddr.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "mtParser.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define ZDO_ADDR_POLL_MS       (1)
+
+// NWK addresses above this are broadcast or invalid
+#define ZDO_ADDR_MAX_NWK_ADDR  (0xFFF7)
+
+// the two indexes
+#define ZDO_ADDR_BY_NWK        (0)
+#define ZDO_ADDR_BY_IEEE       (1)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// resolution waiting for its ZDO_xxx_ADDR_RSP
+typedef struct zdoAddrQuery
+{
+	struct zdoAddrQuery *next;
+	uint8_t byNwk;      // ZDO_IEEE_ADDR_REQ of nwkAddr, else
+	                    // ZDO_NWK_ADDR_REQ of ieeeAddr
+	uint16_t nwkAddr;
+	uint64_t ieeeAddr;
+	uint8_t done;
+	uint8_t status;
+} zdoAddrQuery_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t zdoAddrLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zdoAddrCond = PTHREAD_COND_INITIALIZER;
+static _Atomic uint8_t zdoAddrActive;
+static zdoAddrConfig_t zdoAddrConf;
+static zdoAddrStats_t zdoAddrStats;
+
+static zdoAddrEntry_t *zdoAddrEntries;
+static uint32_t zdoAddrCount;
+// [ZDO_ADDR_BY_xxx] slots holding an entry index + 1
+static uint32_t *zdoAddrIndex[2];
+static uint32_t zdoAddrMask;
+
+static zdoAddrQuery_t *zdoAddrQueries;
+
+// AREQs the cache learns from
+static const uint8_t zdoAddrFeeds[] =
+{
+	MT_ZDO_NWK_ADDR_RSP,
+	MT_ZDO_IEEE_ADDR_RSP,
+	MT_ZDO_END_DEVICE_ANNCE_IND,
+	MT_ZDO_TC_DEV_IND,
+	MT_ZDO_MGMT_LQI_RSP,
+	MT_ZDO_LEAVE_IND
+};
+// AF AREQs whose source address refreshes an entry
+static const uint8_t zdoAddrAfFeeds[] =
+{
+	MT_AF_INCOMING_MSG,
+	MT_AF_INCOMING_MSG_EXT
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoAddrNowMs
+ *
+ * @brief   monotonic time in ms, used for the last seen times
+ */
+static uint64_t zdoAddrNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrKey
+ *
+ * @brief   key of an entry in one of the indexes
+ */
+static uint64_t zdoAddrKey(uint32_t idx, uint8_t which)
+{
+	return (which == ZDO_ADDR_BY_IEEE) ?
+	        zdoAddrEntries[idx].ieeeAddr : zdoAddrEntries[idx].nwkAddr;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrHome
+ *
+ * @brief   first slot probed for a key
+ */
+static uint32_t zdoAddrHome(uint64_t key)
+{
+	return (uint32_t) ((key * 0x9E3779B97F4A7C15ull) >> 32) & zdoAddrMask;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrProbe
+ *
+ * @brief   Slot of a key: the one holding it, else the empty slot where it
+ *          goes. Called with zdoAddrLock held.
+ */
+static uint32_t zdoAddrProbe(uint8_t which, uint64_t key)
+{
+	uint32_t *index = zdoAddrIndex[which];
+	uint32_t pos = zdoAddrHome(key);
+
+	while (index[pos] && (zdoAddrKey(index[pos] - 1, which) != key))
+	{
+		pos = (pos + 1) & zdoAddrMask;
+	}
+
+	return pos;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrFind
+ *
+ * @brief   Entry of a key. Called with zdoAddrLock held.
+ *
+ * @return  its index, -1 if none
+ */
+static int32_t zdoAddrFind(uint8_t which, uint64_t key)
+{
+	uint32_t slot = zdoAddrIndex[which][zdoAddrProbe(which, key)];
+
+	return slot ? (int32_t) (slot - 1) : -1;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrUnindex
+ *
+ * @brief   Remove a key from an index, moving back the entries probed
+ *          after it so that no lookup stops early. Called with zdoAddrLock
+ *          held.
+ */
+static void zdoAddrUnindex(uint8_t which, uint64_t key)
+{
+	uint32_t *index = zdoAddrIndex[which];
+	uint32_t hole = zdoAddrProbe(which, key);
+	uint32_t pos = hole;
+
+	if (index[hole] == 0)
+	{
+		return;
+	}
+
+	for (;;)
+	{
+		uint32_t home;
+
+		pos = (pos + 1) & zdoAddrMask;
+		if (index[pos] == 0)
+		{
+			break;
+		}
+
+		// an entry may fill the hole if the hole lies between its home
+		// slot and its slot
+		home = zdoAddrHome(zdoAddrKey(index[pos] - 1, which));
+		if (((pos - home) & zdoAddrMask) >= ((pos - hole) & zdoAddrMask))
+		{
+			index[hole] = index[pos];
+			hole = pos;
+		}
+	}
+	index[hole] = 0;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrDrop
+ *
+ * @brief   Remove an entry, the last one takes its place. Called with
+ *          zdoAddrLock held.
+ */
+static void zdoAddrDrop(uint32_t idx)
+{
+	uint32_t last = zdoAddrCount - 1;
+	uint8_t which;
+
+	zdoAddrUnindex(ZDO_ADDR_BY_NWK, zdoAddrEntries[idx].nwkAddr);
+	zdoAddrUnindex(ZDO_ADDR_BY_IEEE, zdoAddrEntries[idx].ieeeAddr);
+
+	if (idx != last)
+	{
+		zdoAddrEntries[idx] = zdoAddrEntries[last];
+		for (which = ZDO_ADDR_BY_NWK; which <= ZDO_ADDR_BY_IEEE; which++)
+		{
+			zdoAddrIndex[which][zdoAddrProbe(which, zdoAddrKey(idx, which))] =
+			        idx + 1;
+		}
+	}
+	zdoAddrCount--;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrFresh
+ *
+ * @brief   Tell whether an entry may answer a lookup. Called with
+ *          zdoAddrLock held.
+ */
+static uint8_t zdoAddrFresh(int32_t idx)
+{
+	return (idx >= 0) && ((zdoAddrConf.maxAgeMs == 0)
+	        || (zdoAddrNowMs() - zdoAddrEntries[idx].lastSeenMs
+	                <= zdoAddrConf.maxAgeMs));
+}
+
+/*********************************************************************
+ * @fn      zdoAddrComplete
+ *
+ * @brief   Complete the resolutions waiting for an address. Called with
+ *          zdoAddrLock held.
+ */
+static void zdoAddrComplete(uint8_t status, uint16_t nwkAddr,
+        uint64_t ieeeAddr)
+{
+	zdoAddrQuery_t *q;
+
+	for (q = zdoAddrQueries; q; q = q->next)
+	{
+		if (!q->done && (q->byNwk ?
+		        (q->nwkAddr == nwkAddr) : (q->ieeeAddr == ieeeAddr)))
+		{
+			q->done = 1;
+			q->status = status;
+			if (status == MT_RPC_SUCCESS)
+			{
+				q->nwkAddr = nwkAddr;
+				q->ieeeAddr = ieeeAddr;
+			}
+		}
+	}
+	pthread_cond_broadcast(&zdoAddrCond);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrWait
+ *
+ * @brief   Let the response come in: read the transport if no thread
+ *          does, dispatch the queued messages, then wait a little for it.
+ *          Called with zdoAddrLock held.
+ */
+static void zdoAddrWait(const zdoAddrQuery_t *q)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&zdoAddrLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&zdoAddrLock);
+	if (q->done)
+	{
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += ZDO_ADDR_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&zdoAddrCond, &zdoAddrLock, &ts);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrQuery
+ *
+ * @brief   Send the address request of a resolution and wait for its
+ *          response, which fills the cache on the way.
+ *
+ * @return  MT_RPC_SUCCESS, the status of a failed SRSP or response,
+ *          MT_RPC_ERR_TIMEOUT without response
+ */
+static uint8_t zdoAddrQuery(zdoAddrQuery_t *q)
+{
+	StatusSrspFormat_t srsp;
+	zdoAddrQuery_t **p;
+	uint64_t deadline;
+	uint8_t status;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	q->next = zdoAddrQueries;
+	zdoAddrQueries = q;
+	zdoAddrStats.queries++;
+	deadline = zdoAddrNowMs() + zdoAddrConf.rspTimeoutMs;
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	if (q->byNwk)
+	{
+		IeeeAddrReqFormat_t req;
+
+		req.ShortAddr = q->nwkAddr;
+		req.ReqType = 0;
+		req.StartIndex = 0;
+		status = zdoIeeeAddrReqSync(&req, &srsp, 0);
+	}
+	else
+	{
+		NwkAddrReqFormat_t req;
+		uint8_t i;
+
+		for (i = 0; i < sizeof(req.IEEEAddress); i++)
+		{
+			req.IEEEAddress[i] = (uint8_t) (q->ieeeAddr >> (8 * i));
+		}
+		req.ReqType = 0;
+		req.StartIndex = 0;
+		status = zdoNwkAddrReqSync(&req, &srsp, 0);
+	}
+	if (status == MT_RPC_SUCCESS)
+	{
+		status = srsp.Status;
+	}
+
+	pthread_mutex_lock(&zdoAddrLock);
+	while ((status == MT_RPC_SUCCESS) && !q->done)
+	{
+		if (zdoAddrNowMs() >= deadline)
+		{
+			status = MT_RPC_ERR_TIMEOUT;
+			break;
+		}
+		zdoAddrWait(q);
+	}
+	if ((status == MT_RPC_SUCCESS) && q->done)
+	{
+		status = q->status;
+	}
+	if (status != MT_RPC_SUCCESS)
+	{
+		zdoAddrStats.queryFailures++;
+	}
+	for (p = &zdoAddrQueries; *p != q; p = &(*p)->next)
+		;
+	*p = q->next;
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoAddrEnable
+ *
+ * @brief   Start learning address pairs. The AREQs they come from are
+ *          queued from now on even without application callback. Called
+ *          again, it applies the new age and timeout, the capacity is
+ *          kept until the cache is disabled.
+ *
+ * @param   cfg - configuration, NULL for the defaults
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_ADDR_ERR_NO_MEMORY
+ */
+uint8_t zdoAddrEnable(const zdoAddrConfig_t *cfg)
+{
+	uint32_t capacity = (cfg && cfg->capacity) ?
+	        cfg->capacity : ZDO_ADDR_DEFAULT_CAPACITY;
+	uint32_t size = 1;
+	uint8_t i;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	zdoAddrConf.maxAgeMs = cfg ? cfg->maxAgeMs : 0;
+	zdoAddrConf.rspTimeoutMs = (cfg && cfg->rspTimeoutMs) ?
+	        cfg->rspTimeoutMs : ZDO_ADDR_RSP_TIMEOUT_MS;
+	if (zdoAddrActive)
+	{
+		pthread_mutex_unlock(&zdoAddrLock);
+		return MT_RPC_SUCCESS;
+	}
+
+	// indexes at most half full
+	while (size < capacity * 2)
+	{
+		size *= 2;
+	}
+	zdoAddrEntries = malloc(capacity * sizeof(zdoAddrEntry_t));
+	zdoAddrIndex[ZDO_ADDR_BY_NWK] = calloc(size, sizeof(uint32_t));
+	zdoAddrIndex[ZDO_ADDR_BY_IEEE] = calloc(size, sizeof(uint32_t));
+	if (!zdoAddrEntries || !zdoAddrIndex[ZDO_ADDR_BY_NWK]
+	        || !zdoAddrIndex[ZDO_ADDR_BY_IEEE])
+	{
+		free(zdoAddrEntries);
+		free(zdoAddrIndex[ZDO_ADDR_BY_NWK]);
+		free(zdoAddrIndex[ZDO_ADDR_BY_IEEE]);
+		zdoAddrEntries = NULL;
+		zdoAddrIndex[ZDO_ADDR_BY_NWK] = NULL;
+		zdoAddrIndex[ZDO_ADDR_BY_IEEE] = NULL;
+		pthread_mutex_unlock(&zdoAddrLock);
+		LOG_ERR("No memory for %u addresses", capacity);
+		return ZDO_ADDR_ERR_NO_MEMORY;
+	}
+	zdoAddrConf.capacity = capacity;
+	zdoAddrMask = size - 1;
+	zdoAddrCount = 0;
+	zdoAddrActive = 1;
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	for (i = 0; i < sizeof(zdoAddrFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, zdoAddrFeeds[i], 1);
+	}
+	for (i = 0; i < sizeof(zdoAddrAfFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF, zdoAddrAfFeeds[i], 1);
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrDisable
+ *
+ * @brief   Stop learning and forget the cached pairs. The statistics are
+ *          kept.
+ */
+void zdoAddrDisable(void)
+{
+	uint8_t i;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (!zdoAddrActive)
+	{
+		pthread_mutex_unlock(&zdoAddrLock);
+		return;
+	}
+	zdoAddrActive = 0;
+	free(zdoAddrEntries);
+	free(zdoAddrIndex[ZDO_ADDR_BY_NWK]);
+	free(zdoAddrIndex[ZDO_ADDR_BY_IEEE]);
+	zdoAddrEntries = NULL;
+	zdoAddrIndex[ZDO_ADDR_BY_NWK] = NULL;
+	zdoAddrIndex[ZDO_ADDR_BY_IEEE] = NULL;
+	zdoAddrCount = 0;
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	for (i = 0; i < sizeof(zdoAddrFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, zdoAddrFeeds[i], 0);
+	}
+	for (i = 0; i < sizeof(zdoAddrAfFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF, zdoAddrAfFeeds[i], 0);
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoAddrEnabled
+ *
+ * @brief   Tell whether the message handlers must feed the cache
+ */
+uint8_t zdoAddrEnabled(void)
+{
+	return atomic_load_explicit(&zdoAddrActive, memory_order_relaxed);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrGetStats
+ *
+ * @brief   Read the cache counters.
+ *
+ * @param   stats - filled with the counters
+ */
+void zdoAddrGetStats(zdoAddrStats_t *stats)
+{
+	pthread_mutex_lock(&zdoAddrLock);
+	*stats = zdoAddrStats;
+	stats->entries = zdoAddrCount;
+	pthread_mutex_unlock(&zdoAddrLock);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrGetIeee
+ *
+ * @brief   Look up the IEEE address of a NWK address in the cache only.
+ *
+ * @param   nwkAddr - device
+ * @param   ieeeAddr - its IEEE address
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_ADDR_NOT_FOUND
+ */
+uint8_t zdoAddrGetIeee(uint16_t nwkAddr, uint64_t *ieeeAddr)
+{
+	uint8_t status = ZDO_ADDR_NOT_FOUND;
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_NWK, nwkAddr);
+		if (zdoAddrFresh(idx))
+		{
+			*ieeeAddr = zdoAddrEntries[idx].ieeeAddr;
+			status = MT_RPC_SUCCESS;
+			zdoAddrStats.hits++;
+		}
+		else
+		{
+			zdoAddrStats.misses++;
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrGetNwk
+ *
+ * @brief   Look up the NWK address of an IEEE address in the cache only.
+ *
+ * @param   ieeeAddr - device
+ * @param   nwkAddr - its NWK address
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_ADDR_NOT_FOUND
+ */
+uint8_t zdoAddrGetNwk(uint64_t ieeeAddr, uint16_t *nwkAddr)
+{
+	uint8_t status = ZDO_ADDR_NOT_FOUND;
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_IEEE, ieeeAddr);
+		if (zdoAddrFresh(idx))
+		{
+			*nwkAddr = zdoAddrEntries[idx].nwkAddr;
+			status = MT_RPC_SUCCESS;
+			zdoAddrStats.hits++;
+		}
+		else
+		{
+			zdoAddrStats.misses++;
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrGetEntry
+ *
+ * @brief   Read the cache entry of a NWK address, whatever its age. Not
+ *          counted as a lookup.
+ *
+ * @param   nwkAddr - device
+ * @param   entry - copy of its entry
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_ADDR_NOT_FOUND
+ */
+uint8_t zdoAddrGetEntry(uint16_t nwkAddr, zdoAddrEntry_t *entry)
+{
+	uint8_t status = ZDO_ADDR_NOT_FOUND;
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_NWK, nwkAddr);
+		if (idx >= 0)
+		{
+			*entry = zdoAddrEntries[idx];
+			status = MT_RPC_SUCCESS;
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrResolveIeee
+ *
+ * @brief   IEEE address of a NWK address: from the cache, else asked to
+ *          the device with a ZDO_IEEE_ADDR_REQ. Runs in the thread that
+ *          dispatches the message queue, like afDataRequestBatch().
+ *
+ * @param   nwkAddr - device
+ * @param   ieeeAddr - its IEEE address
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if the cache is not
+ *          enabled, else the status of the failed request or response, or
+ *          MT_RPC_ERR_TIMEOUT
+ */
+uint8_t zdoAddrResolveIeee(uint16_t nwkAddr, uint64_t *ieeeAddr)
+{
+	zdoAddrQuery_t q;
+	uint8_t status;
+
+	if (!zdoAddrActive)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+	if (zdoAddrGetIeee(nwkAddr, ieeeAddr) == MT_RPC_SUCCESS)
+	{
+		return MT_RPC_SUCCESS;
+	}
+
+	memset(&q, 0, sizeof(q));
+	q.byNwk = 1;
+	q.nwkAddr = nwkAddr;
+	status = zdoAddrQuery(&q);
+	if (status == MT_RPC_SUCCESS)
+	{
+		*ieeeAddr = q.ieeeAddr;
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrResolveNwk
+ *
+ * @brief   NWK address of an IEEE address: from the cache, else asked to
+ *          the network with a ZDO_NWK_ADDR_REQ. Runs in the thread that
+ *          dispatches the message queue, like afDataRequestBatch().
+ *
+ * @param   ieeeAddr - device
+ * @param   nwkAddr - its NWK address
+ *
+ * @return  see zdoAddrResolveIeee()
+ */
+uint8_t zdoAddrResolveNwk(uint64_t ieeeAddr, uint16_t *nwkAddr)
+{
+	zdoAddrQuery_t q;
+	uint8_t status;
+
+	if (!zdoAddrActive)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+	if (zdoAddrGetNwk(ieeeAddr, nwkAddr) == MT_RPC_SUCCESS)
+	{
+		return MT_RPC_SUCCESS;
+	}
+
+	memset(&q, 0, sizeof(q));
+	q.ieeeAddr = ieeeAddr;
+	status = zdoAddrQuery(&q);
+	if (status == MT_RPC_SUCCESS)
+	{
+		*nwkAddr = q.nwkAddr;
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoAddrUpdate
+ *
+ * @brief   Record an address pair. A known IEEE address takes the new NWK
+ *          address. A NWK address known for another IEEE address has been
+ *          reassigned: the older pair is dropped. Without room, the least
+ *          recently seen pair is replaced.
+ *
+ * @param   nwkAddr - NWK address
+ * @param   ieeeAddr - IEEE address of the same device
+ * @param   source - ZDO_ADDR_SRC_xxx
+ */
+void zdoAddrUpdate(uint16_t nwkAddr, uint64_t ieeeAddr, uint8_t source)
+{
+	uint64_t now = zdoAddrNowMs();
+	zdoAddrEntry_t *entry;
+	int32_t idx, other;
+
+	if ((nwkAddr > ZDO_ADDR_MAX_NWK_ADDR) || (ieeeAddr == 0)
+	        || (ieeeAddr == UINT64_MAX))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (!zdoAddrActive)
+	{
+		pthread_mutex_unlock(&zdoAddrLock);
+		return;
+	}
+
+	other = zdoAddrFind(ZDO_ADDR_BY_NWK, nwkAddr);
+	if ((other >= 0) && (zdoAddrEntries[other].ieeeAddr != ieeeAddr))
+	{
+		LOG_WARN("NWK address %04X moved from %016llX to %016llX", nwkAddr,
+		        (unsigned long long) zdoAddrEntries[other].ieeeAddr,
+		        (unsigned long long) ieeeAddr);
+		zdoAddrDrop(other);
+		zdoAddrStats.conflicts++;
+	}
+
+	idx = zdoAddrFind(ZDO_ADDR_BY_IEEE, ieeeAddr);
+	if (idx >= 0)
+	{
+		entry = &zdoAddrEntries[idx];
+		if (entry->nwkAddr != nwkAddr)
+		{
+			zdoAddrUnindex(ZDO_ADDR_BY_NWK, entry->nwkAddr);
+			entry->nwkAddr = nwkAddr;
+			zdoAddrIndex[ZDO_ADDR_BY_NWK]
+			        [zdoAddrProbe(ZDO_ADDR_BY_NWK, nwkAddr)] = idx + 1;
+			zdoAddrStats.nwkChanges++;
+		}
+	}
+	else
+	{
+		if (zdoAddrCount == zdoAddrConf.capacity)
+		{
+			uint32_t oldest = 0, i;
+
+			for (i = 1; i < zdoAddrCount; i++)
+			{
+				if (zdoAddrEntries[i].lastSeenMs
+				        < zdoAddrEntries[oldest].lastSeenMs)
+				{
+					oldest = i;
+				}
+			}
+			zdoAddrDrop(oldest);
+			zdoAddrStats.evictions++;
+		}
+
+		idx = zdoAddrCount++;
+		entry = &zdoAddrEntries[idx];
+		entry->nwkAddr = nwkAddr;
+		entry->ieeeAddr = ieeeAddr;
+		zdoAddrIndex[ZDO_ADDR_BY_NWK]
+		        [zdoAddrProbe(ZDO_ADDR_BY_NWK, nwkAddr)] = idx + 1;
+		zdoAddrIndex[ZDO_ADDR_BY_IEEE]
+		        [zdoAddrProbe(ZDO_ADDR_BY_IEEE, ieeeAddr)] = idx + 1;
+	}
+	entry->lastSeenMs = now;
+	entry->source = source;
+	zdoAddrStats.updates++;
+
+	if (zdoAddrQueries)
+	{
+		zdoAddrComplete(MT_RPC_SUCCESS, nwkAddr, ieeeAddr);
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrRemove
+ *
+ * @brief   Forget a device, e.g. once it left the network.
+ *
+ * @param   ieeeAddr - device
+ */
+void zdoAddrRemove(uint64_t ieeeAddr)
+{
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_IEEE, ieeeAddr);
+		if (idx >= 0)
+		{
+			zdoAddrDrop(idx);
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrRsp
+ *
+ * @brief   ZDO_NWK_ADDR_RSP or ZDO_IEEE_ADDR_RSP decoded: records the
+ *          pair, or fails the resolutions of the requested address.
+ *
+ * @param   status - ZDP status of the response
+ * @param   nwkAddr - NWK address of the device
+ * @param   ieeeAddr - its IEEE address
+ */
+void zdoAddrRsp(uint8_t status, uint16_t nwkAddr, uint64_t ieeeAddr)
+{
+	if (status == MT_RPC_SUCCESS)
+	{
+		zdoAddrUpdate(nwkAddr, ieeeAddr, ZDO_ADDR_SRC_ADDR_RSP);
+		return;
+	}
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrQueries)
+	{
+		zdoAddrComplete(status, nwkAddr, ieeeAddr);
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrSeenNwk
+ *
+ * @brief   A message came from a NWK address: refresh its last seen time.
+ *
+ * @param   nwkAddr - source of the message
+ */
+void zdoAddrSeenNwk(uint16_t nwkAddr)
+{
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_NWK, nwkAddr);
+		if (idx >= 0)
+		{
+			zdoAddrEntries[idx].lastSeenMs = zdoAddrNowMs();
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+}
+
+/*********************************************************************
+ * @fn      zdoAddrSeenIeee
+ *
+ * @brief   A message came from an IEEE address: refresh its last seen
+ *          time.
+ *
+ * @param   ieeeAddr - source of the message
+ */
+void zdoAddrSeenIeee(uint64_t ieeeAddr)
+{
+	int32_t idx;
+
+	pthread_mutex_lock(&zdoAddrLock);
+	if (zdoAddrActive)
+	{
+		idx = zdoAddrFind(ZDO_ADDR_BY_IEEE, ieeeAddr);
+		if (idx >= 0)
+		{
+			zdoAddrEntries[idx].lastSeenMs = zdoAddrNowMs();
+		}
+	}
+	pthread_mutex_unlock(&zdoAddrLock);
+}
@@ -0,0 +1,103 @@
+/*
+ * mtZdoAddr.h
+ *
+ * Host side cache of NWK <-> IEEE address pairs. While enabled, it learns
+ * them from the traffic the framework decodes anyway: ZDO_NWK_ADDR_RSP,
+ * ZDO_IEEE_ADDR_RSP, ZDO_END_DEVICE_ANNCE_IND, ZDO_TC_DEV_IND and the
+ * neighbor entries of ZDO_MGMT_LQI_RSP. Incoming AF messages refresh the
+ * last seen time of their source. The resolve functions only send a ZDO
+ * address request when the cache misses.
+ */
+
+#ifndef MTZDOADDR_H
+#define MTZDOADDR_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ZDO_ADDR_DEFAULT_CAPACITY  (1024)
+// address request -> ZDO_xxx_ADDR_RSP
+#define ZDO_ADDR_RSP_TIMEOUT_MS    (5000)
+
+// status besides the MT_RPC_ERR_* codes
+#define ZDO_ADDR_ERR_NO_MEMORY     (0x90)
+#define ZDO_ADDR_NOT_FOUND         (0x91)  // not in the cache, or too old
+
+// zdoAddrEntry_t source
+#define ZDO_ADDR_SRC_APP           (0)  // zdoAddrUpdate() from the application
+#define ZDO_ADDR_SRC_ADDR_RSP      (1)  // ZDO_NWK_ADDR_RSP, ZDO_IEEE_ADDR_RSP
+#define ZDO_ADDR_SRC_ANNCE         (2)  // ZDO_END_DEVICE_ANNCE_IND
+#define ZDO_ADDR_SRC_TC_DEV        (3)  // ZDO_TC_DEV_IND
+#define ZDO_ADDR_SRC_NEIGHBOR      (4)  // ZDO_MGMT_LQI_RSP neighbor entry
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t capacity;         // entries, 0 for ZDO_ADDR_DEFAULT_CAPACITY.
+	                           // The least recently seen one is replaced
+	uint32_t maxAgeMs;         // entries not seen for longer miss, 0 to keep
+	                           // them until replaced
+	uint32_t rspTimeoutMs;     // 0 for ZDO_ADDR_RSP_TIMEOUT_MS
+} zdoAddrConfig_t;
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint64_t ieeeAddr;
+	uint64_t lastSeenMs;       // monotonic time of the last update or
+	                           // incoming message
+	uint8_t source;            // ZDO_ADDR_SRC_xxx of the last update
+} zdoAddrEntry_t;
+
+typedef struct
+{
+	uint32_t entries;
+	uint32_t hits;             // lookups answered from the cache
+	uint32_t misses;
+	uint32_t queries;          // address requests sent on a miss
+	uint32_t queryFailures;    // of which without a successful response
+	uint32_t updates;          // pairs learned or confirmed
+	uint32_t nwkChanges;       // known IEEE address seen with a new NWK address
+	uint32_t conflicts;        // NWK address taken over by another IEEE
+	                           // address, the older pair is dropped
+	uint32_t evictions;        // entries replaced for lack of room
+} zdoAddrStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t zdoAddrEnable(const zdoAddrConfig_t *cfg);
+void zdoAddrDisable(void);
+uint8_t zdoAddrEnabled(void);
+void zdoAddrGetStats(zdoAddrStats_t *stats);
+
+uint8_t zdoAddrGetIeee(uint16_t nwkAddr, uint64_t *ieeeAddr);
+uint8_t zdoAddrGetNwk(uint64_t ieeeAddr, uint16_t *nwkAddr);
+uint8_t zdoAddrGetEntry(uint16_t nwkAddr, zdoAddrEntry_t *entry);
+uint8_t zdoAddrResolveIeee(uint16_t nwkAddr, uint64_t *ieeeAddr);
+uint8_t zdoAddrResolveNwk(uint64_t ieeeAddr, uint16_t *nwkAddr);
+void zdoAddrUpdate(uint16_t nwkAddr, uint64_t ieeeAddr, uint8_t source);
+void zdoAddrRemove(uint64_t ieeeAddr);
+
+// hooks of the mtZdo and mtAf message handlers
+void zdoAddrRsp(uint8_t status, uint16_t nwkAddr, uint64_t ieeeAddr);
+void zdoAddrSeenNwk(uint16_t nwkAddr);
+void zdoAddrSeenIeee(uint64_t ieeeAddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTZDOADDR_H */
@@ -0,0 +1,1126 @@
+/*
+ * mtZdoDisc.c
+ *
+ * Service discovery cache, see mtZdoDisc.h. Devices are stored in a fixed
+ * array indexed by IEEE address with an open addressing hash table. They
+ * are never removed, a device to discover again only loses its endpoints.
+ *
+ * File layout, little endian: "ZDSC", version, device count (4 bytes),
+ * the devices, FNV-1a hash (4 bytes) of everything before. A device is
+ * IEEE address (8), NWK address (2), capabilities, endpoint count, then
+ * for each endpoint: endpoint, 1 if its descriptor follows, profile ID
+ * (2), device ID (2), device version, input cluster count and IDs (2
+ * each), output cluster count and IDs.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtZdoDisc.h"
+#include "mtZdoAddr.h"
+#include "mtZdo.h"
+#include "mtParser.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define ZDO_DISC_POLL_MS       (1)
+
+#define ZDO_DISC_FILE_VERSION  (1)
+#define ZDO_DISC_FILE_HDR_LEN  (9)
+// largest device record in the file
+#define ZDO_DISC_FILE_DEV_LEN  (12 + ZDO_DISC_MAX_ENDPOINTS \
+        * (10 + 4 * ZDO_DISC_MAX_CLUSTERS))
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// request waiting for its response
+typedef struct zdoDiscWaiter
+{
+	struct zdoDiscWaiter *next;
+	uint16_t nwkAddr;
+	uint8_t endpoint;   // simple descriptor of endpoint, 0: active endpoints
+	uint8_t done;
+	uint8_t status;
+} zdoDiscWaiter_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t zdoDiscLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zdoDiscCond = PTHREAD_COND_INITIALIZER;
+static _Atomic uint8_t zdoDiscActive;
+static zdoDiscConfig_t zdoDiscConf;
+static zdoDiscStats_t zdoDiscStats;
+
+static zdoDiscDevice_t *zdoDiscDevices;
+static uint32_t zdoDiscCount;
+// slots holding a device index + 1
+static uint32_t *zdoDiscIndex;
+static uint32_t zdoDiscMask;
+
+static zdoDiscWaiter_t *zdoDiscWaiters;
+
+// AREQs the cache learns from
+static const uint8_t zdoDiscFeeds[] =
+{
+	MT_ZDO_ACTIVE_EP_RSP,
+	MT_ZDO_SIMPLE_DESC_RSP,
+	MT_ZDO_END_DEVICE_ANNCE_IND
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoDiscHome
+ *
+ * @brief   first slot probed for an IEEE address
+ */
+static uint32_t zdoDiscHome(uint64_t ieeeAddr)
+{
+	return (uint32_t) ((ieeeAddr * 0x9E3779B97F4A7C15ull) >> 32) & zdoDiscMask;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscProbe
+ *
+ * @brief   Slot of an IEEE address: the one holding it, else the empty
+ *          slot where it goes. Called with zdoDiscLock held.
+ */
+static uint32_t zdoDiscProbe(uint64_t ieeeAddr)
+{
+	uint32_t pos = zdoDiscHome(ieeeAddr);
+
+	while (zdoDiscIndex[pos]
+	        && (zdoDiscDevices[zdoDiscIndex[pos] - 1].ieeeAddr != ieeeAddr))
+	{
+		pos = (pos + 1) & zdoDiscMask;
+	}
+
+	return pos;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscReset
+ *
+ * @brief   Forget what was discovered of a device. Called with
+ *          zdoDiscLock held.
+ */
+static void zdoDiscReset(zdoDiscDevice_t *dev)
+{
+	if (dev->epCount != ZDO_DISC_UNKNOWN)
+	{
+		zdoDiscStats.invalidations++;
+	}
+	dev->epCount = ZDO_DISC_UNKNOWN;
+	dev->descMask = 0;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscGetDevice
+ *
+ * @brief   Device of an IEEE address, added if room is left. Called with
+ *          zdoDiscLock held.
+ *
+ * @param   ieeeAddr - device
+ * @param   nwkAddr - its NWK address, for a new device
+ * @param   add - 1 to add a device not cached yet
+ *
+ * @return  the device, NULL if not cached
+ */
+static zdoDiscDevice_t *zdoDiscGetDevice(uint64_t ieeeAddr, uint16_t nwkAddr,
+        uint8_t add)
+{
+	uint32_t pos = zdoDiscProbe(ieeeAddr);
+	zdoDiscDevice_t *dev;
+
+	if (zdoDiscIndex[pos])
+	{
+		return &zdoDiscDevices[zdoDiscIndex[pos] - 1];
+	}
+	if (!add)
+	{
+		return NULL;
+	}
+	if (zdoDiscCount == zdoDiscConf.capacity)
+	{
+		zdoDiscStats.full++;
+		return NULL;
+	}
+
+	dev = &zdoDiscDevices[zdoDiscCount++];
+	memset(dev, 0, sizeof(zdoDiscDevice_t));
+	dev->ieeeAddr = ieeeAddr;
+	dev->nwkAddr = nwkAddr;
+	dev->capabilities = ZDO_DISC_UNKNOWN;
+	dev->epCount = ZDO_DISC_UNKNOWN;
+	zdoDiscIndex[pos] = zdoDiscCount;
+
+	return dev;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscGetDeviceNwk
+ *
+ * @brief   Device of a NWK address, its IEEE address taken from the
+ *          address cache. A device known to the address cache only is
+ *          added. Called with zdoDiscLock held.
+ *
+ * @return  the device, NULL if not cached
+ */
+static zdoDiscDevice_t *zdoDiscGetDeviceNwk(uint16_t nwkAddr)
+{
+	zdoAddrEntry_t entry;
+	zdoDiscDevice_t *dev;
+	uint32_t i;
+
+	if (zdoAddrGetEntry(nwkAddr, &entry) == MT_RPC_SUCCESS)
+	{
+		dev = zdoDiscGetDevice(entry.ieeeAddr, nwkAddr, 1);
+		if (dev && (dev->nwkAddr != nwkAddr))
+		{
+			zdoDiscReset(dev);
+			dev->nwkAddr = nwkAddr;
+		}
+		return dev;
+	}
+
+	for (i = 0; i < zdoDiscCount; i++)
+	{
+		if (zdoDiscDevices[i].nwkAddr == nwkAddr)
+		{
+			return &zdoDiscDevices[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscComplete
+ *
+ * @brief   Complete the request waiting for a response. A failed simple
+ *          descriptor response does not tell its endpoint, it completes
+ *          the first request to the device. Called with zdoDiscLock held.
+ *
+ * @param   status - ZDP status of the response
+ * @param   nwkAddr - device
+ * @param   endpoint - of the simple descriptor, 0 for the active endpoints,
+ *          ZDO_DISC_UNKNOWN for any simple descriptor
+ */
+static void zdoDiscComplete(uint8_t status, uint16_t nwkAddr,
+        uint8_t endpoint)
+{
+	zdoDiscWaiter_t *w;
+
+	for (w = zdoDiscWaiters; w; w = w->next)
+	{
+		if (w->done || (w->nwkAddr != nwkAddr))
+		{
+			continue;
+		}
+		if ((w->endpoint == endpoint)
+		        || ((endpoint == ZDO_DISC_UNKNOWN) && (w->endpoint != 0)))
+		{
+			w->done = 1;
+			w->status = status;
+			break;
+		}
+	}
+	pthread_cond_broadcast(&zdoDiscCond);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscUnwait
+ *
+ * @brief   Remove a request from the waiting ones. Called with
+ *          zdoDiscLock held.
+ */
+static void zdoDiscUnwait(zdoDiscWaiter_t *w)
+{
+	zdoDiscWaiter_t **p;
+
+	for (p = &zdoDiscWaiters; *p != w; p = &(*p)->next)
+		;
+	*p = w->next;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscWait
+ *
+ * @brief   Let the responses come in: read the transport if no thread
+ *          does, dispatch the queued messages, then wait a little for one.
+ *          Called with zdoDiscLock held.
+ */
+static void zdoDiscWait(void)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&zdoDiscLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&zdoDiscLock);
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += ZDO_DISC_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&zdoDiscCond, &zdoDiscLock, &ts);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscNowMs
+ *
+ * @brief   monotonic time in ms, used for the response deadlines
+ */
+static uint64_t zdoDiscNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscRequest
+ *
+ * @brief   Send the requests of some waiters, then wait for all their
+ *          responses. Called with zdoDiscLock held, released meanwhile.
+ *
+ * @param   w - waiters, with nwkAddr and endpoint set
+ * @param   count - number of waiters
+ *
+ * @return  MT_RPC_SUCCESS, else the first failure: status of a request or
+ *          response, MT_RPC_ERR_TIMEOUT
+ */
+static uint8_t zdoDiscRequest(zdoDiscWaiter_t *w, uint8_t count)
+{
+	uint64_t deadline = zdoDiscNowMs() + zdoDiscConf.rspTimeoutMs;
+	uint8_t status = MT_RPC_SUCCESS;
+	uint8_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		w[i].done = 0;
+		w[i].next = zdoDiscWaiters;
+		zdoDiscWaiters = &w[i];
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		StatusSrspFormat_t srsp;
+		uint8_t sent;
+
+		pthread_mutex_unlock(&zdoDiscLock);
+		if (w[i].endpoint == 0)
+		{
+			ActiveEpReqFormat_t req;
+			ActiveEpReqSrspFormat_t epSrsp;
+
+			req.DstAddr = w[i].nwkAddr;
+			req.NwkAddrOfInterest = w[i].nwkAddr;
+			sent = zdoActiveEpReqSync(&req, &epSrsp, 0);
+			srsp.Status = epSrsp.Status;
+		}
+		else
+		{
+			SimpleDescReqFormat_t req;
+
+			req.DstAddr = w[i].nwkAddr;
+			req.NwkAddrOfInterest = w[i].nwkAddr;
+			req.Endpoint = w[i].endpoint;
+			sent = zdoSimpleDescReqSync(&req, &srsp, 0);
+		}
+		pthread_mutex_lock(&zdoDiscLock);
+
+		if (w[i].endpoint == 0)
+		{
+			zdoDiscStats.activeEpReqs++;
+		}
+		else
+		{
+			zdoDiscStats.simpleDescReqs++;
+		}
+		if ((sent == MT_RPC_SUCCESS) && (srsp.Status != MT_RPC_SUCCESS))
+		{
+			sent = srsp.Status;
+		}
+		if ((sent != MT_RPC_SUCCESS) && !w[i].done)
+		{
+			w[i].done = 1;
+			w[i].status = sent;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		while (!w[i].done)
+		{
+			if (zdoDiscNowMs() >= deadline)
+			{
+				w[i].done = 1;
+				w[i].status = MT_RPC_ERR_TIMEOUT;
+				break;
+			}
+			zdoDiscWait();
+		}
+		if (w[i].status != MT_RPC_SUCCESS)
+		{
+			zdoDiscStats.failures++;
+			if (status == MT_RPC_SUCCESS)
+			{
+				status = w[i].status;
+			}
+		}
+		zdoDiscUnwait(&w[i]);
+	}
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscFnv
+ *
+ * @brief   FNV-1a hash of the file contents
+ */
+static uint32_t zdoDiscFnv(const uint8_t *buf, uint32_t len)
+{
+	uint32_t h = 2166136261u;
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		h = (h ^ buf[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscPut
+ *
+ * @brief   write a little endian value of len bytes
+ */
+static uint8_t *zdoDiscPut(uint8_t *p, uint64_t value, uint8_t len)
+{
+	uint8_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		*p++ = (uint8_t) (value >> (8 * i));
+	}
+
+	return p;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscTake
+ *
+ * @brief   read a little endian value of len bytes, 0 past the end
+ */
+static uint64_t zdoDiscTake(const uint8_t **p, const uint8_t *end, uint8_t len)
+{
+	uint64_t value = 0;
+	uint8_t i;
+
+	if (*p + len > end)
+	{
+		*p = end + 1;
+		return 0;
+	}
+	for (i = 0; i < len; i++)
+	{
+		value |= (uint64_t) (*p)[i] << (8 * i);
+	}
+	*p += len;
+
+	return value;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscParse
+ *
+ * @brief   Read one device record of the file.
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_DISC_ERR_FILE if it is malformed
+ */
+static uint8_t zdoDiscParse(const uint8_t **p, const uint8_t *end,
+        zdoDiscDevice_t *dev)
+{
+	uint8_t i, c;
+
+	memset(dev, 0, sizeof(zdoDiscDevice_t));
+	dev->ieeeAddr = zdoDiscTake(p, end, 8);
+	dev->nwkAddr = (uint16_t) zdoDiscTake(p, end, 2);
+	dev->capabilities = (uint8_t) zdoDiscTake(p, end, 1);
+	dev->epCount = (uint8_t) zdoDiscTake(p, end, 1);
+	if ((dev->epCount != ZDO_DISC_UNKNOWN)
+	        && (dev->epCount > ZDO_DISC_MAX_ENDPOINTS))
+	{
+		return ZDO_DISC_ERR_FILE;
+	}
+
+	for (i = 0; (dev->epCount != ZDO_DISC_UNKNOWN) && (i < dev->epCount); i++)
+	{
+		zdoDiscDesc_t *desc = &dev->descs[i];
+
+		desc->endpoint = (uint8_t) zdoDiscTake(p, end, 1);
+		if (zdoDiscTake(p, end, 1) == 0)
+		{
+			continue;
+		}
+		desc->profileId = (uint16_t) zdoDiscTake(p, end, 2);
+		desc->deviceId = (uint16_t) zdoDiscTake(p, end, 2);
+		desc->deviceVersion = (uint8_t) zdoDiscTake(p, end, 1);
+		desc->numInClusters = (uint8_t) zdoDiscTake(p, end, 1);
+		if (desc->numInClusters > ZDO_DISC_MAX_CLUSTERS)
+		{
+			return ZDO_DISC_ERR_FILE;
+		}
+		for (c = 0; c < desc->numInClusters; c++)
+		{
+			desc->inClusters[c] = (uint16_t) zdoDiscTake(p, end, 2);
+		}
+		desc->numOutClusters = (uint8_t) zdoDiscTake(p, end, 1);
+		if (desc->numOutClusters > ZDO_DISC_MAX_CLUSTERS)
+		{
+			return ZDO_DISC_ERR_FILE;
+		}
+		for (c = 0; c < desc->numOutClusters; c++)
+		{
+			desc->outClusters[c] = (uint16_t) zdoDiscTake(p, end, 2);
+		}
+		dev->descMask |= 1u << i;
+	}
+
+	return (*p > end) ? ZDO_DISC_ERR_FILE : MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoDiscEnable
+ *
+ * @brief   Start caching the discovered services. The address cache is
+ *          enabled with its defaults if it is not yet. Called again, it
+ *          applies the new timeout, the capacity is kept until the cache
+ *          is disabled.
+ *
+ * @param   cfg - configuration, NULL for the defaults
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_DISC_ERR_NO_MEMORY
+ */
+uint8_t zdoDiscEnable(const zdoDiscConfig_t *cfg)
+{
+	uint32_t capacity = (cfg && cfg->capacity) ?
+	        cfg->capacity : ZDO_DISC_DEFAULT_CAPACITY;
+	uint32_t size = 1;
+	uint8_t i;
+
+	if (!zdoAddrEnabled() && (zdoAddrEnable(NULL) != MT_RPC_SUCCESS))
+	{
+		return ZDO_DISC_ERR_NO_MEMORY;
+	}
+
+	pthread_mutex_lock(&zdoDiscLock);
+	zdoDiscConf.rspTimeoutMs = (cfg && cfg->rspTimeoutMs) ?
+	        cfg->rspTimeoutMs : ZDO_DISC_RSP_TIMEOUT_MS;
+	if (zdoDiscActive)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return MT_RPC_SUCCESS;
+	}
+
+	// index at most half full
+	while (size < capacity * 2)
+	{
+		size *= 2;
+	}
+	zdoDiscDevices = malloc(capacity * sizeof(zdoDiscDevice_t));
+	zdoDiscIndex = calloc(size, sizeof(uint32_t));
+	if (!zdoDiscDevices || !zdoDiscIndex)
+	{
+		free(zdoDiscDevices);
+		free(zdoDiscIndex);
+		zdoDiscDevices = NULL;
+		zdoDiscIndex = NULL;
+		pthread_mutex_unlock(&zdoDiscLock);
+		LOG_ERR("No memory for %u devices", capacity);
+		return ZDO_DISC_ERR_NO_MEMORY;
+	}
+	zdoDiscConf.capacity = capacity;
+	zdoDiscMask = size - 1;
+	zdoDiscCount = 0;
+	zdoDiscActive = 1;
+	pthread_mutex_unlock(&zdoDiscLock);
+
+	for (i = 0; i < sizeof(zdoDiscFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, zdoDiscFeeds[i], 1);
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscDisable
+ *
+ * @brief   Stop caching and forget the devices. Not to be called while a
+ *          discovery runs. The address cache stays enabled.
+ */
+void zdoDiscDisable(void)
+{
+	uint8_t i;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (!zdoDiscActive)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return;
+	}
+	zdoDiscActive = 0;
+	free(zdoDiscDevices);
+	free(zdoDiscIndex);
+	zdoDiscDevices = NULL;
+	zdoDiscIndex = NULL;
+	zdoDiscCount = 0;
+	pthread_mutex_unlock(&zdoDiscLock);
+
+	for (i = 0; i < sizeof(zdoDiscFeeds); i++)
+	{
+		mtSetWanted(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, zdoDiscFeeds[i], 0);
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoDiscEnabled
+ *
+ * @brief   Tell whether the message handlers must feed the cache
+ */
+uint8_t zdoDiscEnabled(void)
+{
+	return atomic_load_explicit(&zdoDiscActive, memory_order_relaxed);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscGetStats
+ *
+ * @brief   Read the cache counters.
+ *
+ * @param   stats - filled with the counters
+ */
+void zdoDiscGetStats(zdoDiscStats_t *stats)
+{
+	pthread_mutex_lock(&zdoDiscLock);
+	*stats = zdoDiscStats;
+	stats->devices = zdoDiscCount;
+	pthread_mutex_unlock(&zdoDiscLock);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscGet
+ *
+ * @brief   Read what the cache knows of a device, without any request.
+ *
+ * @param   ieeeAddr - device
+ * @param   dev - copy of its entry, possibly incomplete
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_DISC_NOT_FOUND
+ */
+uint8_t zdoDiscGet(uint64_t ieeeAddr, zdoDiscDevice_t *dev)
+{
+	uint8_t status = ZDO_DISC_NOT_FOUND;
+	zdoDiscDevice_t *cached;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (zdoDiscActive)
+	{
+		cached = zdoDiscGetDevice(ieeeAddr, 0, 0);
+		if (cached)
+		{
+			*dev = *cached;
+			status = MT_RPC_SUCCESS;
+		}
+	}
+	pthread_mutex_unlock(&zdoDiscLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscDiscover
+ *
+ * @brief   Active endpoints and simple descriptors of a device. Only what
+ *          the cache misses is requested: its IEEE address, its endpoint
+ *          list, then the descriptors of all its unknown endpoints at
+ *          once. Runs in the thread that dispatches the message queue,
+ *          like afDataRequestBatch().
+ *
+ * @param   nwkAddr - device
+ * @param   dev - copy of its entry, complete on success
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if the cache is not
+ *          enabled, ZDO_DISC_ERR_NO_MEMORY if it is full, else the first
+ *          failure: status of a request or response, MT_RPC_ERR_TIMEOUT
+ */
+uint8_t zdoDiscDiscover(uint16_t nwkAddr, zdoDiscDevice_t *dev)
+{
+	zdoDiscWaiter_t w[ZDO_DISC_MAX_ENDPOINTS];
+	zdoDiscDevice_t *cached;
+	uint64_t ieeeAddr;
+	uint8_t status, count, i;
+	uint8_t sent = 0;
+
+	if (!zdoDiscActive)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+	status = zdoAddrResolveIeee(nwkAddr, &ieeeAddr);
+	if (status != MT_RPC_SUCCESS)
+	{
+		return status;
+	}
+
+	pthread_mutex_lock(&zdoDiscLock);
+	cached = zdoDiscActive ? zdoDiscGetDevice(ieeeAddr, nwkAddr, 1) : NULL;
+	if (cached == NULL)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return ZDO_DISC_ERR_NO_MEMORY;
+	}
+	if (cached->nwkAddr != nwkAddr)
+	{
+		zdoDiscReset(cached);
+		cached->nwkAddr = nwkAddr;
+	}
+
+	if (cached->epCount == ZDO_DISC_UNKNOWN)
+	{
+		memset(w, 0, sizeof(w));
+		w[0].nwkAddr = nwkAddr;
+		status = zdoDiscRequest(w, 1);
+		sent = 1;
+		// the response filled the entry
+		cached = zdoDiscActive ? zdoDiscGetDevice(ieeeAddr, 0, 0) : NULL;
+		if ((status == MT_RPC_SUCCESS)
+		        && ((cached == NULL) || (cached->epCount == ZDO_DISC_UNKNOWN)))
+		{
+			status = MT_RPC_ERR_PARAMETER;
+		}
+	}
+
+	if (status == MT_RPC_SUCCESS)
+	{
+		count = 0;
+		for (i = 0; i < cached->epCount; i++)
+		{
+			if (!(cached->descMask & (1u << i)))
+			{
+				memset(&w[count], 0, sizeof(w[count]));
+				w[count].nwkAddr = nwkAddr;
+				w[count].endpoint = cached->descs[i].endpoint;
+				count++;
+			}
+		}
+		if (count)
+		{
+			status = zdoDiscRequest(w, count);
+			sent = 1;
+			cached = zdoDiscActive ? zdoDiscGetDevice(ieeeAddr, 0, 0) : NULL;
+		}
+	}
+
+	if (sent)
+	{
+		zdoDiscStats.misses++;
+	}
+	else
+	{
+		zdoDiscStats.hits++;
+	}
+	if (cached)
+	{
+		*dev = *cached;
+	}
+	pthread_mutex_unlock(&zdoDiscLock);
+
+	return cached ? status : MT_RPC_ERR_PARAMETER;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscInvalidate
+ *
+ * @brief   Forget the endpoints of a device, to discover them again.
+ *
+ * @param   ieeeAddr - device
+ */
+void zdoDiscInvalidate(uint64_t ieeeAddr)
+{
+	zdoDiscDevice_t *dev;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (zdoDiscActive)
+	{
+		dev = zdoDiscGetDevice(ieeeAddr, 0, 0);
+		if (dev)
+		{
+			zdoDiscReset(dev);
+		}
+	}
+	pthread_mutex_unlock(&zdoDiscLock);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscSave
+ *
+ * @brief   Write the cache to a file. It is written next to path first and
+ *          renamed over it, so that a crash leaves the old file.
+ *
+ * @param   path - file
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if the cache is not
+ *          enabled, ZDO_DISC_ERR_NO_MEMORY, ZDO_DISC_ERR_FILE
+ */
+uint8_t zdoDiscSave(const char *path)
+{
+	char tmp[FILENAME_MAX];
+	uint8_t *buf, *p;
+	uint32_t i, len;
+	uint8_t e, c;
+	FILE *file;
+	size_t written;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int) sizeof(tmp))
+	{
+		return ZDO_DISC_ERR_FILE;
+	}
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (!zdoDiscActive)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return MT_RPC_ERR_PARAMETER;
+	}
+	buf = malloc(ZDO_DISC_FILE_HDR_LEN + zdoDiscCount * ZDO_DISC_FILE_DEV_LEN
+	        + 4);
+	if (buf == NULL)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return ZDO_DISC_ERR_NO_MEMORY;
+	}
+
+	memcpy(buf, "ZDSC", 4);
+	p = zdoDiscPut(buf + 4, ZDO_DISC_FILE_VERSION, 1);
+	p = zdoDiscPut(p, zdoDiscCount, 4);
+	for (i = 0; i < zdoDiscCount; i++)
+	{
+		const zdoDiscDevice_t *dev = &zdoDiscDevices[i];
+
+		p = zdoDiscPut(p, dev->ieeeAddr, 8);
+		p = zdoDiscPut(p, dev->nwkAddr, 2);
+		p = zdoDiscPut(p, dev->capabilities, 1);
+		p = zdoDiscPut(p, dev->epCount, 1);
+		for (e = 0; (dev->epCount != ZDO_DISC_UNKNOWN) && (e < dev->epCount);
+		        e++)
+		{
+			const zdoDiscDesc_t *desc = &dev->descs[e];
+			uint8_t known = (dev->descMask >> e) & 1;
+
+			p = zdoDiscPut(p, desc->endpoint, 1);
+			p = zdoDiscPut(p, known, 1);
+			if (!known)
+			{
+				continue;
+			}
+			p = zdoDiscPut(p, desc->profileId, 2);
+			p = zdoDiscPut(p, desc->deviceId, 2);
+			p = zdoDiscPut(p, desc->deviceVersion, 1);
+			p = zdoDiscPut(p, desc->numInClusters, 1);
+			for (c = 0; c < desc->numInClusters; c++)
+			{
+				p = zdoDiscPut(p, desc->inClusters[c], 2);
+			}
+			p = zdoDiscPut(p, desc->numOutClusters, 1);
+			for (c = 0; c < desc->numOutClusters; c++)
+			{
+				p = zdoDiscPut(p, desc->outClusters[c], 2);
+			}
+		}
+	}
+	pthread_mutex_unlock(&zdoDiscLock);
+
+	len = p - buf;
+	p = zdoDiscPut(p, zdoDiscFnv(buf, len), 4);
+	len += 4;
+
+	file = fopen(tmp, "wb");
+	if (file == NULL)
+	{
+		LOG_ERR("Cannot write %s", tmp);
+		free(buf);
+		return ZDO_DISC_ERR_FILE;
+	}
+	written = fwrite(buf, 1, len, file);
+	free(buf);
+	if ((fclose(file) != 0) || (written != len) || (rename(tmp, path) != 0))
+	{
+		LOG_ERR("Cannot write %s", path);
+		remove(tmp);
+		return ZDO_DISC_ERR_FILE;
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscLoad
+ *
+ * @brief   Add the devices of a file written by zdoDiscSave() to the
+ *          cache, replacing the entries of the same devices. Their
+ *          address pairs go to the address cache. Devices that changed
+ *          since are discovered again once they announce themselves.
+ *
+ * @param   path - file
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if the cache is not
+ *          enabled, ZDO_DISC_ERR_NO_MEMORY, ZDO_DISC_ERR_FILE if it cannot
+ *          be read or is corrupt: the cache is then left unchanged
+ */
+uint8_t zdoDiscLoad(const char *path)
+{
+	const uint8_t *p, *end;
+	zdoDiscDevice_t dev, *cached;
+	uint8_t *buf = NULL;
+	uint8_t status = ZDO_DISC_ERR_FILE;
+	uint32_t count, hash, i;
+	long len;
+	FILE *file;
+
+	if (!zdoDiscActive)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return ZDO_DISC_ERR_FILE;
+	}
+	if ((fseek(file, 0, SEEK_END) == 0) && ((len = ftell(file)) > 0)
+	        && (fseek(file, 0, SEEK_SET) == 0))
+	{
+		buf = malloc(len);
+		if ((buf == NULL) || (fread(buf, 1, len, file) != (size_t) len))
+		{
+			status = buf ? ZDO_DISC_ERR_FILE : ZDO_DISC_ERR_NO_MEMORY;
+			free(buf);
+			buf = NULL;
+		}
+	}
+	fclose(file);
+	if (buf == NULL)
+	{
+		return status;
+	}
+
+	if (len < ZDO_DISC_FILE_HDR_LEN + 4)
+	{
+		LOG_ERR("%s is not a valid discovery cache", path);
+		free(buf);
+		return ZDO_DISC_ERR_FILE;
+	}
+	end = buf + len - 4;
+	p = end;
+	hash = (uint32_t) zdoDiscTake(&p, buf + len, 4);
+	p = buf + 4;
+	if (memcmp(buf, "ZDSC", 4)
+	        || (zdoDiscTake(&p, end, 1) != ZDO_DISC_FILE_VERSION)
+	        || (zdoDiscFnv(buf, len - 4) != hash))
+	{
+		LOG_ERR("%s is not a valid discovery cache", path);
+		free(buf);
+		return ZDO_DISC_ERR_FILE;
+	}
+	count = (uint32_t) zdoDiscTake(&p, end, 4);
+
+	// whole file checked before the cache is touched
+	status = MT_RPC_SUCCESS;
+	for (i = 0; (i < count) && (status == MT_RPC_SUCCESS); i++)
+	{
+		status = zdoDiscParse(&p, end, &dev);
+	}
+	if ((status != MT_RPC_SUCCESS) || (p != end))
+	{
+		LOG_ERR("%s is not a valid discovery cache", path);
+		free(buf);
+		return ZDO_DISC_ERR_FILE;
+	}
+
+	p = buf + ZDO_DISC_FILE_HDR_LEN;
+	for (i = 0; i < count; i++)
+	{
+		zdoDiscParse(&p, end, &dev);
+		zdoAddrUpdate(dev.nwkAddr, dev.ieeeAddr, ZDO_ADDR_SRC_APP);
+
+		pthread_mutex_lock(&zdoDiscLock);
+		cached = zdoDiscActive ?
+		        zdoDiscGetDevice(dev.ieeeAddr, dev.nwkAddr, 1) : NULL;
+		if (cached)
+		{
+			*cached = dev;
+		}
+		pthread_mutex_unlock(&zdoDiscLock);
+	}
+	free(buf);
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoDiscAnnce
+ *
+ * @brief   ZDO_END_DEVICE_ANNCE_IND decoded: a device that comes back
+ *          with another NWK address or other capabilities is to be
+ *          discovered again.
+ *
+ * @param   nwkAddr - NWK address announced
+ * @param   ieeeAddr - device
+ * @param   capabilities - MAC capabilities announced
+ */
+void zdoDiscAnnce(uint16_t nwkAddr, uint64_t ieeeAddr, uint8_t capabilities)
+{
+	zdoDiscDevice_t *dev;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (zdoDiscActive)
+	{
+		dev = zdoDiscGetDevice(ieeeAddr, nwkAddr, 1);
+		if (dev)
+		{
+			if ((dev->nwkAddr != nwkAddr)
+			        || ((dev->capabilities != ZDO_DISC_UNKNOWN)
+			                && (dev->capabilities != capabilities)))
+			{
+				zdoDiscReset(dev);
+			}
+			dev->nwkAddr = nwkAddr;
+			dev->capabilities = capabilities;
+		}
+	}
+	pthread_mutex_unlock(&zdoDiscLock);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscActiveEpRsp
+ *
+ * @brief   ZDO_ACTIVE_EP_RSP decoded: records the endpoint list. The
+ *          descriptors already known are kept if the list is unchanged.
+ *
+ * @param   status - ZDP status of the response
+ * @param   nwkAddr - device
+ * @param   count - number of endpoints
+ * @param   endpoints - endpoint list
+ */
+void zdoDiscActiveEpRsp(uint8_t status, uint16_t nwkAddr, uint8_t count,
+        const uint8_t *endpoints)
+{
+	zdoDiscDevice_t *dev;
+	uint8_t i;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (!zdoDiscActive)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return;
+	}
+
+	dev = (status == MT_RPC_SUCCESS) ? zdoDiscGetDeviceNwk(nwkAddr) : NULL;
+	if (dev)
+	{
+		if (count > ZDO_DISC_MAX_ENDPOINTS)
+		{
+			LOG_WARN("%04X has %d endpoints, %d cached", nwkAddr, count,
+			        ZDO_DISC_MAX_ENDPOINTS);
+			count = ZDO_DISC_MAX_ENDPOINTS;
+		}
+		if (dev->epCount != count)
+		{
+			dev->descMask = 0;
+		}
+		for (i = 0; i < count; i++)
+		{
+			if (dev->descs[i].endpoint != endpoints[i])
+			{
+				dev->descMask &= ~(1u << i);
+				memset(&dev->descs[i], 0, sizeof(zdoDiscDesc_t));
+				dev->descs[i].endpoint = endpoints[i];
+			}
+		}
+		dev->epCount = count;
+	}
+
+	zdoDiscComplete(status, nwkAddr, 0);
+	pthread_mutex_unlock(&zdoDiscLock);
+}
+
+/*********************************************************************
+ * @fn      zdoDiscSimpleDescRsp
+ *
+ * @brief   ZDO_SIMPLE_DESC_RSP decoded: records the descriptor of an
+ *          endpoint of the list.
+ *
+ * @param   status - ZDP status of the response
+ * @param   nwkAddr - device
+ * @param   desc - descriptor, only read on success
+ */
+void zdoDiscSimpleDescRsp(uint8_t status, uint16_t nwkAddr,
+        const zdoDiscDesc_t *desc)
+{
+	zdoDiscDevice_t *dev;
+	uint8_t i;
+
+	pthread_mutex_lock(&zdoDiscLock);
+	if (!zdoDiscActive)
+	{
+		pthread_mutex_unlock(&zdoDiscLock);
+		return;
+	}
+
+	dev = (status == MT_RPC_SUCCESS) ? zdoDiscGetDeviceNwk(nwkAddr) : NULL;
+	for (i = 0; dev && (dev->epCount != ZDO_DISC_UNKNOWN)
+	        && (i < dev->epCount); i++)
+	{
+		if (dev->descs[i].endpoint == desc->endpoint)
+		{
+			dev->descs[i] = *desc;
+			dev->descMask |= 1u << i;
+			break;
+		}
+	}
+
+	zdoDiscComplete(status, nwkAddr,
+	        (status == MT_RPC_SUCCESS) ? desc->endpoint : ZDO_DISC_UNKNOWN);
+	pthread_mutex_unlock(&zdoDiscLock);
+}
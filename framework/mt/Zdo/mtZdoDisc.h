@@ -0,0 +1,118 @@
+/*
+ * mtZdoDisc.h
+ *
+ * Service discovery cache. The active endpoints and simple descriptors of
+ * the devices are kept under their IEEE address, learned from every
+ * ZDO_ACTIVE_EP_RSP and ZDO_SIMPLE_DESC_RSP decoded while the cache is
+ * enabled. A device announcing itself with another NWK address or other
+ * capabilities is discovered again. The cache can be saved to a file and
+ * loaded at start, so that known devices need no discovery at all.
+ * IEEE addresses come from the address cache, see mtZdoAddr.h.
+ */
+
+#ifndef MTZDODISC_H
+#define MTZDODISC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ZDO_DISC_DEFAULT_CAPACITY  (256)
+// endpoints kept per device, the others are ignored
+#ifndef ZDO_DISC_MAX_ENDPOINTS
+#define ZDO_DISC_MAX_ENDPOINTS     (8)
+#endif
+// clusters per list, as in SimpleDescRspFormat_t
+#define ZDO_DISC_MAX_CLUSTERS      (16)
+// request -> ZDO_xxx_RSP
+#define ZDO_DISC_RSP_TIMEOUT_MS    (5000)
+
+// zdoDiscDevice_t epCount and capabilities before they are known
+#define ZDO_DISC_UNKNOWN           (0xFF)
+
+// status besides the MT_RPC_ERR_* codes and the ZDP ones
+#define ZDO_DISC_ERR_NO_MEMORY     (0x90)
+#define ZDO_DISC_NOT_FOUND         (0x91)
+#define ZDO_DISC_ERR_FILE          (0x92)  // unreadable or corrupt file
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t capacity;         // devices, 0 for ZDO_DISC_DEFAULT_CAPACITY.
+	                           // Further devices are not cached
+	uint32_t rspTimeoutMs;     // 0 for ZDO_DISC_RSP_TIMEOUT_MS
+} zdoDiscConfig_t;
+
+typedef struct
+{
+	uint8_t endpoint;
+	uint16_t profileId;
+	uint16_t deviceId;
+	uint8_t deviceVersion;
+	uint8_t numInClusters;
+	uint16_t inClusters[ZDO_DISC_MAX_CLUSTERS];
+	uint8_t numOutClusters;
+	uint16_t outClusters[ZDO_DISC_MAX_CLUSTERS];
+} zdoDiscDesc_t;
+
+typedef struct
+{
+	uint64_t ieeeAddr;
+	uint16_t nwkAddr;
+	uint8_t capabilities;      // of the last announce, ZDO_DISC_UNKNOWN
+	uint8_t epCount;           // ZDO_DISC_UNKNOWN until the active
+	                           // endpoints are known
+	uint32_t descMask;         // bit i set: descs[i] is known
+	zdoDiscDesc_t descs[ZDO_DISC_MAX_ENDPOINTS]; // endpoint set from
+	                           // the active endpoint list
+} zdoDiscDevice_t;
+
+typedef struct
+{
+	uint32_t devices;
+	uint32_t hits;             // zdoDiscDiscover() answered from the cache
+	uint32_t misses;           // of which sent at least one request
+	uint32_t activeEpReqs;
+	uint32_t simpleDescReqs;
+	uint32_t failures;         // requests without a successful response
+	uint32_t invalidations;    // devices to discover again
+	uint32_t full;             // devices not cached for lack of room
+} zdoDiscStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t zdoDiscEnable(const zdoDiscConfig_t *cfg);
+void zdoDiscDisable(void);
+uint8_t zdoDiscEnabled(void);
+void zdoDiscGetStats(zdoDiscStats_t *stats);
+
+uint8_t zdoDiscGet(uint64_t ieeeAddr, zdoDiscDevice_t *dev);
+uint8_t zdoDiscDiscover(uint16_t nwkAddr, zdoDiscDevice_t *dev);
+void zdoDiscInvalidate(uint64_t ieeeAddr);
+uint8_t zdoDiscSave(const char *path);
+uint8_t zdoDiscLoad(const char *path);
+
+// hooks of the mtZdo message handlers
+void zdoDiscAnnce(uint16_t nwkAddr, uint64_t ieeeAddr, uint8_t capabilities);
+void zdoDiscActiveEpRsp(uint8_t status, uint16_t nwkAddr, uint8_t count,
+        const uint8_t *endpoints);
+void zdoDiscSimpleDescRsp(uint8_t status, uint16_t nwkAddr,
+        const zdoDiscDesc_t *desc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTZDODISC_H */
@@ -0,0 +1,1139 @@
+/*
+ * mtZdoSched.c
+ *
+ * ZDP request scheduler, see mtZdoSched.h. Requests live in a pool,
+ * chained in one FIFO per priority while queued, then in the list of
+ * outstanding ones until their response. Destinations keep their token
+ * bucket and transaction count in a dense array indexed by NWK address
+ * with an open addressing hash table. Tokens are counted in thousandths
+ * so that a rate in requests per second refills them every millisecond.
+ * Responses are taken from subscribers to the response types submitted.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtZdoSched.h"
+#include "mtParser.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define ZDO_SCHED_POLL_MS       (1)
+// resend delay of a request the SREQ table had no room for
+#define ZDO_SCHED_BUSY_MS       (10)
+
+// NWK addresses above this are broadcast, no response is awaited
+#define ZDO_SCHED_MAX_NWK_ADDR  (0xFFF7)
+
+// cost of a request in tokens
+#define ZDO_SCHED_TOKEN         (1000)
+
+// zdoSchedEntry_t state
+#define ZDO_SCHED_FREE          (0)
+#define ZDO_SCHED_QUEUED        (1)
+#define ZDO_SCHED_OUTSTANDING   (2)
+#define ZDO_SCHED_DONE          (3)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct zdoSchedEntry
+{
+	struct zdoSchedEntry *next;
+	zdoSchedReq_t req;
+	zdoSchedCb_t cb;
+	void *cbArg;
+	uint64_t notBeforeMs;  // queued: time of the resend
+	uint64_t deadlineMs;   // outstanding: response deadline
+	uint16_t dstAddr;
+	uint16_t gen;          // told apart from a later use of the slot
+	uint8_t state;
+	uint8_t prio;
+	uint8_t tries;
+	uint8_t throttled;     // counted in the stats already
+	uint8_t status;        // done: status passed to cb
+} zdoSchedEntry_t;
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint16_t outstanding;
+	uint32_t queued;
+	uint32_t tokens;
+	uint64_t refillMs;
+} zdoSchedNode_t;
+
+// FIFO of entries
+typedef struct
+{
+	zdoSchedEntry_t *head;
+	zdoSchedEntry_t *tail;
+} zdoSchedList_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t zdoSchedLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zdoSchedCond = PTHREAD_COND_INITIALIZER;
+static uint8_t zdoSchedActive;
+static zdoSchedConfig_t zdoSchedConf;
+static zdoSchedStats_t zdoSchedStats;
+
+static zdoSchedEntry_t *zdoSchedPool;
+static zdoSchedEntry_t *zdoSchedFree;
+static zdoSchedList_t zdoSchedQueues[ZDO_SCHED_PRIOS];
+static zdoSchedList_t zdoSchedOutstanding;
+static zdoSchedList_t zdoSchedDone;
+
+static zdoSchedNode_t *zdoSchedNodes;
+static uint32_t zdoSchedNodeCount;
+// slots holding a node index + 1
+static uint32_t *zdoSchedIndex;
+static uint32_t zdoSchedMask;
+
+static uint32_t zdoSchedTokens;
+static uint64_t zdoSchedRefillMs;
+// time the pump must run again, UINT64_MAX if no request waits for it
+static uint64_t zdoSchedWakeMs;
+static uint32_t zdoSchedEvents;
+
+// [response cmd1] set once subscribed
+static uint8_t zdoSchedSubscribed[256];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoSchedNowMs
+ *
+ * @brief   monotonic time in ms
+ */
+static uint64_t zdoSchedNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedDst
+ *
+ * @brief   Destination of a request.
+ *
+ * @return  its NWK address, -1 if the request type is not supported
+ */
+static int32_t zdoSchedDst(const zdoSchedReq_t *req)
+{
+	switch (req->cmd1)
+	{
+	case MT_ZDO_IEEE_ADDR_REQ:
+		return req->u.ieeeAddr.ShortAddr;
+	case MT_ZDO_NODE_DESC_REQ:
+		return req->u.nodeDesc.DstAddr;
+	case MT_ZDO_POWER_DESC_REQ:
+		return req->u.powerDesc.DstAddr;
+	case MT_ZDO_SIMPLE_DESC_REQ:
+		return req->u.simpleDesc.DstAddr;
+	case MT_ZDO_ACTIVE_EP_REQ:
+		return req->u.activeEp.DstAddr;
+	case MT_ZDO_MATCH_DESC_REQ:
+		return req->u.matchDesc.DstAddr;
+	case MT_ZDO_BIND_REQ:
+		return req->u.bind.DstAddr;
+	case MT_ZDO_UNBIND_REQ:
+		return req->u.unbind.DstAddr;
+	case MT_ZDO_MGMT_LQI_REQ:
+		return req->u.mgmtLqi.DstAddr;
+	case MT_ZDO_MGMT_RTG_REQ:
+		return req->u.mgmtRtg.DstAddr;
+	case MT_ZDO_MGMT_BIND_REQ:
+		return req->u.mgmtBind.DstAddr;
+	case MT_ZDO_MGMT_LEAVE_REQ:
+		return req->u.mgmtLeave.DstAddr;
+	case MT_ZDO_MGMT_PERMIT_JOIN_REQ:
+		return req->u.mgmtPermitJoin.DstAddr;
+	default:
+		return -1;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedPush
+ *
+ * @brief   Append an entry to a list, or put it first. Called with
+ *          zdoSchedLock held.
+ */
+static void zdoSchedPush(zdoSchedList_t *list, zdoSchedEntry_t *e,
+        uint8_t first)
+{
+	if (first)
+	{
+		e->next = list->head;
+		list->head = e;
+		if (list->tail == NULL)
+		{
+			list->tail = e;
+		}
+		return;
+	}
+
+	e->next = NULL;
+	if (list->tail)
+	{
+		list->tail->next = e;
+	}
+	else
+	{
+		list->head = e;
+	}
+	list->tail = e;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedUnlink
+ *
+ * @brief   Remove an entry from a list, prev being the one before it or
+ *          NULL. Called with zdoSchedLock held.
+ */
+static void zdoSchedUnlink(zdoSchedList_t *list, zdoSchedEntry_t *prev,
+        zdoSchedEntry_t *e)
+{
+	if (prev)
+	{
+		prev->next = e->next;
+	}
+	else
+	{
+		list->head = e->next;
+	}
+	if (list->tail == e)
+	{
+		list->tail = prev;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedRemove
+ *
+ * @brief   Remove an entry from a list, searching the one before it.
+ *          Called with zdoSchedLock held.
+ */
+static void zdoSchedRemove(zdoSchedList_t *list, zdoSchedEntry_t *e)
+{
+	zdoSchedEntry_t *prev = NULL;
+	zdoSchedEntry_t *cur;
+
+	for (cur = list->head; cur && (cur != e); cur = cur->next)
+	{
+		prev = cur;
+	}
+	if (cur)
+	{
+		zdoSchedUnlink(list, prev, e);
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedHome
+ *
+ * @brief   first slot probed for a destination
+ */
+static uint32_t zdoSchedHome(uint16_t nwkAddr)
+{
+	return (uint32_t) ((nwkAddr * 2654435761u) >> 16) & zdoSchedMask;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedProbe
+ *
+ * @brief   Slot of a destination: the one holding it, else the empty slot
+ *          where it goes. Called with zdoSchedLock held.
+ */
+static uint32_t zdoSchedProbe(uint16_t nwkAddr)
+{
+	uint32_t pos = zdoSchedHome(nwkAddr);
+
+	while (zdoSchedIndex[pos]
+	        && (zdoSchedNodes[zdoSchedIndex[pos] - 1].nwkAddr != nwkAddr))
+	{
+		pos = (pos + 1) & zdoSchedMask;
+	}
+
+	return pos;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedDropNode
+ *
+ * @brief   Remove a destination, the last one takes its place. The index
+ *          entries probed after it move back so that no lookup stops
+ *          early. Called with zdoSchedLock held.
+ */
+static void zdoSchedDropNode(uint32_t idx)
+{
+	uint32_t hole = zdoSchedProbe(zdoSchedNodes[idx].nwkAddr);
+	uint32_t pos = hole;
+	uint32_t last = zdoSchedNodeCount - 1;
+
+	for (;;)
+	{
+		uint32_t home;
+
+		pos = (pos + 1) & zdoSchedMask;
+		if (zdoSchedIndex[pos] == 0)
+		{
+			break;
+		}
+
+		// an entry may fill the hole if the hole lies between its home
+		// slot and its slot
+		home = zdoSchedHome(zdoSchedNodes[zdoSchedIndex[pos] - 1].nwkAddr);
+		if (((pos - home) & zdoSchedMask) >= ((pos - hole) & zdoSchedMask))
+		{
+			zdoSchedIndex[hole] = zdoSchedIndex[pos];
+			hole = pos;
+		}
+	}
+	zdoSchedIndex[hole] = 0;
+
+	if (idx != last)
+	{
+		zdoSchedNodes[idx] = zdoSchedNodes[last];
+		zdoSchedIndex[zdoSchedProbe(zdoSchedNodes[idx].nwkAddr)] = idx + 1;
+	}
+	zdoSchedNodeCount--;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedGetNode
+ *
+ * @brief   State of a destination. A new one starts with a full bucket,
+ *          replacing the idle destination refilled the longest ago if the
+ *          table is full. Called with zdoSchedLock held.
+ *
+ * @param   nwkAddr - destination
+ * @param   add - 1 to add it if unknown
+ *
+ * @return  the destination, NULL if unknown or no room is left
+ */
+static zdoSchedNode_t *zdoSchedGetNode(uint16_t nwkAddr, uint8_t add,
+        uint64_t now)
+{
+	uint32_t pos = zdoSchedProbe(nwkAddr);
+	zdoSchedNode_t *node;
+
+	if (zdoSchedIndex[pos])
+	{
+		return &zdoSchedNodes[zdoSchedIndex[pos] - 1];
+	}
+	if (!add)
+	{
+		return NULL;
+	}
+
+	if (zdoSchedNodeCount == zdoSchedConf.maxNodes)
+	{
+		uint32_t idle = zdoSchedNodeCount, i;
+
+		for (i = 0; i < zdoSchedNodeCount; i++)
+		{
+			node = &zdoSchedNodes[i];
+			if ((node->outstanding == 0) && (node->queued == 0)
+			        && ((idle == zdoSchedNodeCount)
+			                || (node->refillMs < zdoSchedNodes[idle].refillMs)))
+			{
+				idle = i;
+			}
+		}
+		if (idle == zdoSchedNodeCount)
+		{
+			return NULL;
+		}
+		zdoSchedDropNode(idle);
+		pos = zdoSchedProbe(nwkAddr);
+	}
+
+	node = &zdoSchedNodes[zdoSchedNodeCount++];
+	memset(node, 0, sizeof(zdoSchedNode_t));
+	node->nwkAddr = nwkAddr;
+	node->tokens = zdoSchedConf.nodeBurst * ZDO_SCHED_TOKEN;
+	node->refillMs = now;
+	zdoSchedIndex[pos] = zdoSchedNodeCount;
+
+	return node;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedRefill
+ *
+ * @brief   Add the tokens earned since the last refill to a bucket.
+ *
+ * @return  ms until the bucket holds a token, 0 if it does
+ */
+static uint64_t zdoSchedRefill(uint32_t *tokens, uint64_t *refillMs,
+        uint16_t rate, uint16_t burst, uint64_t now)
+{
+	uint64_t level = *tokens + (now - *refillMs) * rate;
+
+	if (level > (uint64_t) burst * ZDO_SCHED_TOKEN)
+	{
+		level = (uint64_t) burst * ZDO_SCHED_TOKEN;
+	}
+	*tokens = (uint32_t) level;
+	*refillMs = now;
+
+	return (level >= ZDO_SCHED_TOKEN) ?
+	        0 : (ZDO_SCHED_TOKEN - level + rate - 1) / rate;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedFinish
+ *
+ * @brief   End the transaction of an entry already out of its list, its
+ *          callback is called by zdoSchedRunDone(). Called with
+ *          zdoSchedLock held.
+ */
+static void zdoSchedFinish(zdoSchedEntry_t *e, uint8_t status)
+{
+	e->state = ZDO_SCHED_DONE;
+	e->status = status;
+	zdoSchedPush(&zdoSchedDone, e, 0);
+	zdoSchedEvents++;
+	pthread_cond_broadcast(&zdoSchedCond);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedRunDone
+ *
+ * @brief   Call the callbacks of the ended transactions and free their
+ *          entries. Called with zdoSchedLock held, released during each
+ *          callback so that it may submit requests.
+ */
+static void zdoSchedRunDone(void)
+{
+	zdoSchedEntry_t *e;
+
+	while ((e = zdoSchedDone.head) != NULL)
+	{
+		zdoSchedCb_t cb = e->cb;
+		void *cbArg = e->cbArg;
+		uint8_t status = e->status;
+
+		zdoSchedUnlink(&zdoSchedDone, NULL, e);
+		e->state = ZDO_SCHED_FREE;
+		e->gen++;
+		e->next = zdoSchedFree;
+		zdoSchedFree = e;
+
+		if (cb)
+		{
+			pthread_mutex_unlock(&zdoSchedLock);
+			cb(status, cbArg);
+			pthread_mutex_lock(&zdoSchedLock);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedRequeue
+ *
+ * @brief   Queue an entry again, first of its priority, to be sent after
+ *          delayMs. Called with zdoSchedLock held.
+ */
+static void zdoSchedRequeue(zdoSchedEntry_t *e, zdoSchedNode_t *node,
+        uint32_t delayMs, uint64_t now)
+{
+	e->state = ZDO_SCHED_QUEUED;
+	e->notBeforeMs = now + delayMs;
+	zdoSchedPush(&zdoSchedQueues[e->prio], e, 1);
+	node->queued++;
+	zdoSchedStats.queued++;
+	if (e->notBeforeMs < zdoSchedWakeMs)
+	{
+		zdoSchedWakeMs = e->notBeforeMs;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedEnd
+ *
+ * @brief   Take an outstanding entry out of the transactions of its
+ *          destination. Called with zdoSchedLock held.
+ *
+ * @return  the destination
+ */
+static zdoSchedNode_t *zdoSchedEnd(zdoSchedEntry_t *e, uint64_t now)
+{
+	zdoSchedNode_t *node = zdoSchedGetNode(e->dstAddr, 0, now);
+
+	zdoSchedRemove(&zdoSchedOutstanding, e);
+	zdoSchedStats.outstanding--;
+	node->outstanding--;
+
+	return node;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedSrsp
+ *
+ * @brief   SRSP callback of a request. A refused request is queued again
+ *          until its retries are spent. A broadcast request ends here.
+ */
+static void zdoSchedSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	uint32_t idx = (uint32_t) ((uintptr_t) cbArg >> 16);
+	uint16_t gen = (uint16_t) (uintptr_t) cbArg;
+	uint64_t now = zdoSchedNowMs();
+	zdoSchedNode_t *node;
+	zdoSchedEntry_t *e;
+
+	if ((status == MT_RPC_SUCCESS)
+	        && (MT_CHECK_LEN(srsp, srspLen, 1) == MT_RPC_SUCCESS))
+	{
+		status = srsp[2];
+	}
+
+	pthread_mutex_lock(&zdoSchedLock);
+	e = zdoSchedActive ? &zdoSchedPool[idx] : NULL;
+	if (!e || (e->gen != gen) || (e->state != ZDO_SCHED_OUTSTANDING))
+	{
+		pthread_mutex_unlock(&zdoSchedLock);
+		return;
+	}
+
+	if (status != MT_RPC_SUCCESS)
+	{
+		LOG_DBG("ZDO request %02X to %04X refused: %02X", e->req.cmd1,
+		        e->dstAddr, status);
+		node = zdoSchedEnd(e, now);
+		zdoSchedStats.refusals++;
+		if (e->tries <= zdoSchedConf.retries)
+		{
+			zdoSchedRequeue(e, node, zdoSchedConf.retryDelayMs, now);
+		}
+		else
+		{
+			zdoSchedStats.failures++;
+			zdoSchedFinish(e, status);
+		}
+	}
+	else if (e->dstAddr > ZDO_SCHED_MAX_NWK_ADDR)
+	{
+		zdoSchedEnd(e, now);
+		zdoSchedFinish(e, MT_RPC_SUCCESS);
+	}
+
+	zdoSchedEvents++;
+	pthread_cond_broadcast(&zdoSchedCond);
+	zdoSchedRunDone();
+	pthread_mutex_unlock(&zdoSchedLock);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedRsp
+ *
+ * @brief   ZDO_xxx_RSP subscriber: ends the oldest outstanding request of
+ *          that type to the device that responded. Other responses are
+ *          ignored.
+ */
+static void zdoSchedRsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        void *cbArg __attribute__((unused)))
+{
+	uint8_t cmd1 = rpcBuff[1];
+	uint64_t now = zdoSchedNowMs();
+	zdoSchedEntry_t *e;
+	uint16_t srcAddr;
+	uint8_t status;
+
+	if (cmd1 == MT_ZDO_IEEE_ADDR_RSP)
+	{
+		// Status, IEEEAddr, NwkAddr
+		if (MT_CHECK_LEN(rpcBuff, rpcLen, 11) != MT_RPC_SUCCESS)
+		{
+			return;
+		}
+		status = rpcBuff[2];
+		srcAddr = BUILD_UINT16(rpcBuff[11], rpcBuff[12]);
+	}
+	else
+	{
+		// SrcAddr, Status
+		if (MT_CHECK_LEN(rpcBuff, rpcLen, 3) != MT_RPC_SUCCESS)
+		{
+			return;
+		}
+		srcAddr = BUILD_UINT16(rpcBuff[2], rpcBuff[3]);
+		status = rpcBuff[4];
+	}
+
+	pthread_mutex_lock(&zdoSchedLock);
+	for (e = zdoSchedActive ? zdoSchedOutstanding.head : NULL; e; e = e->next)
+	{
+		if (((e->req.cmd1 | 0x80) == cmd1) && (e->dstAddr == srcAddr))
+		{
+			break;
+		}
+	}
+	if (e)
+	{
+		zdoSchedEnd(e, now);
+		zdoSchedStats.responses++;
+		zdoSchedFinish(e, status);
+		zdoSchedRunDone();
+	}
+	pthread_mutex_unlock(&zdoSchedLock);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedExpire
+ *
+ * @brief   End the transactions whose response is late. Called with
+ *          zdoSchedLock held.
+ */
+static void zdoSchedExpire(uint64_t now)
+{
+	zdoSchedEntry_t *e = zdoSchedOutstanding.head;
+
+	while (e)
+	{
+		zdoSchedEntry_t *next = e->next;
+
+		if (e->deadlineMs <= now)
+		{
+			LOG_WARN("No response to ZDO request %02X from %04X",
+			        e->req.cmd1, e->dstAddr);
+			zdoSchedEnd(e, now);
+			zdoSchedStats.timeouts++;
+			zdoSchedStats.failures++;
+			zdoSchedFinish(e, MT_RPC_ERR_TIMEOUT);
+		}
+		e = next;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedNext
+ *
+ * @brief   First queued request the buckets and caps let through, highest
+ *          priority first. Its tokens are taken and it is moved to the
+ *          outstanding list. Records in zdoSchedWakeMs when the requests
+ *          held back may go. Called with zdoSchedLock held.
+ *
+ * @return  the request, NULL if none may be sent now
+ */
+static zdoSchedEntry_t *zdoSchedNext(uint64_t now)
+{
+	uint64_t globalWait;
+	uint64_t wait;
+	uint8_t prio;
+
+	globalWait = zdoSchedRefill(&zdoSchedTokens, &zdoSchedRefillMs,
+	        zdoSchedConf.globalRate, zdoSchedConf.globalBurst, now);
+
+	for (prio = 0; prio < ZDO_SCHED_PRIOS; prio++)
+	{
+		zdoSchedList_t *queue = &zdoSchedQueues[prio];
+		zdoSchedEntry_t *prev = NULL;
+		zdoSchedEntry_t *e;
+
+		for (e = queue->head; e; prev = e, e = e->next)
+		{
+			zdoSchedNode_t *node;
+
+			if (e->notBeforeMs > now)
+			{
+				if (e->notBeforeMs < zdoSchedWakeMs)
+				{
+					zdoSchedWakeMs = e->notBeforeMs;
+				}
+				continue;
+			}
+			node = zdoSchedGetNode(e->dstAddr, 0, now);
+			if (node->outstanding >= zdoSchedConf.maxPerNode)
+			{
+				// woken up by the end of a transaction
+				continue;
+			}
+			wait = zdoSchedRefill(&node->tokens, &node->refillMs,
+			        zdoSchedConf.nodeRate, zdoSchedConf.nodeBurst, now);
+			if (wait || globalWait)
+			{
+				if (!e->throttled)
+				{
+					e->throttled = 1;
+					zdoSchedStats.throttled++;
+				}
+				wait = (wait > globalWait) ? wait : globalWait;
+				if (now + wait < zdoSchedWakeMs)
+				{
+					zdoSchedWakeMs = now + wait;
+				}
+				if (!globalWait)
+				{
+					continue;
+				}
+				// nothing may go before it
+				return NULL;
+			}
+
+			zdoSchedTokens -= ZDO_SCHED_TOKEN;
+			node->tokens -= ZDO_SCHED_TOKEN;
+			zdoSchedUnlink(queue, prev, e);
+			node->queued--;
+			zdoSchedStats.queued--;
+			node->outstanding++;
+			zdoSchedStats.outstanding++;
+			e->state = ZDO_SCHED_OUTSTANDING;
+			e->tries++;
+			e->deadlineMs = now + zdoSchedConf.rspTimeoutMs;
+			zdoSchedPush(&zdoSchedOutstanding, e, 0);
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedPump
+ *
+ * @brief   Send the queued requests the buckets and caps let through.
+ *          Called with zdoSchedLock held, released while sending.
+ */
+static void zdoSchedPump(uint64_t now)
+{
+	zdoSchedEntry_t *e;
+
+	zdoSchedWakeMs = UINT64_MAX;
+	while (zdoSchedActive && ((e = zdoSchedNext(now)) != NULL))
+	{
+		uintptr_t arg = ((uintptr_t) (e - zdoSchedPool) << 16) | e->gen;
+		zdoSchedReq_t req = e->req;
+		uint16_t gen = e->gen;
+		zdoSchedNode_t *node;
+		uint8_t status;
+
+		zdoSchedStats.sent++;
+
+		// unlocked, the SRSP callback may run before this returns
+		pthread_mutex_unlock(&zdoSchedLock);
+		status = zdoSendReqCb(req.cmd1, &req.u, 0, zdoSchedSrsp,
+		        (void *) arg);
+		pthread_mutex_lock(&zdoSchedLock);
+
+		if ((status == MT_RPC_SUCCESS) || !zdoSchedActive || (e->gen != gen)
+		        || (e->state != ZDO_SCHED_OUTSTANDING))
+		{
+			continue;
+		}
+
+		// not sent, no SRSP callback and no response to come
+		node = zdoSchedEnd(e, now);
+		zdoSchedStats.sent--;
+		if (status == MT_RPC_ERR_BUSY)
+		{
+			// SREQ table or SRSP lane full, retry once some complete
+			e->tries--;
+			zdoSchedRequeue(e, node, ZDO_SCHED_BUSY_MS, now);
+			return;
+		}
+		LOG_ERR("ZDO request %02X to %04X not sent: %02X", req.cmd1,
+		        e->dstAddr, status);
+		zdoSchedStats.failures++;
+		zdoSchedFinish(e, status);
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedWait
+ *
+ * @brief   Let the requests make progress: read the transport if no
+ *          thread does, dispatch the queued messages, then wait a little
+ *          for an event. Called with zdoSchedLock held.
+ */
+static void zdoSchedWait(void)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&zdoSchedLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&zdoSchedLock);
+	if (zdoSchedEvents)
+	{
+		zdoSchedEvents = 0;
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += ZDO_SCHED_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&zdoSchedCond, &zdoSchedLock, &ts);
+	zdoSchedEvents = 0;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoSchedEnable
+ *
+ * @brief   Start the scheduler. Called again, it applies the new rates,
+ *          caps and timeouts; the queue and destination table sizes are
+ *          kept until it is disabled.
+ *
+ * @param   cfg - configuration, NULL for the defaults
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_SCHED_ERR_NO_MEMORY
+ */
+uint8_t zdoSchedEnable(const zdoSchedConfig_t *cfg)
+{
+	zdoSchedConfig_t conf;
+	uint32_t size = 1;
+	uint32_t i;
+
+	memset(&conf, 0, sizeof(conf));
+	if (cfg)
+	{
+		conf = *cfg;
+	}
+	conf.queueSize = conf.queueSize ? conf.queueSize : ZDO_SCHED_DEFAULT_QUEUE;
+	conf.maxNodes = conf.maxNodes ? conf.maxNodes : ZDO_SCHED_DEFAULT_NODES;
+	conf.globalRate = conf.globalRate ? conf.globalRate : ZDO_SCHED_GLOBAL_RATE;
+	conf.globalBurst = conf.globalBurst ?
+	        conf.globalBurst : ZDO_SCHED_GLOBAL_BURST;
+	conf.nodeRate = conf.nodeRate ? conf.nodeRate : ZDO_SCHED_NODE_RATE;
+	conf.nodeBurst = conf.nodeBurst ? conf.nodeBurst : ZDO_SCHED_NODE_BURST;
+	conf.maxPerNode = conf.maxPerNode ? conf.maxPerNode : ZDO_SCHED_MAX_PER_NODE;
+	conf.retries = conf.retries ? conf.retries : ZDO_SCHED_RETRIES;
+	conf.retryDelayMs = conf.retryDelayMs ?
+	        conf.retryDelayMs : ZDO_SCHED_RETRY_DELAY_MS;
+	conf.rspTimeoutMs = conf.rspTimeoutMs ?
+	        conf.rspTimeoutMs : ZDO_SCHED_RSP_TIMEOUT_MS;
+
+	pthread_mutex_lock(&zdoSchedLock);
+	if (zdoSchedActive)
+	{
+		conf.queueSize = zdoSchedConf.queueSize;
+		conf.maxNodes = zdoSchedConf.maxNodes;
+		zdoSchedConf = conf;
+		pthread_mutex_unlock(&zdoSchedLock);
+		return MT_RPC_SUCCESS;
+	}
+
+	// index at most half full
+	while (size < conf.maxNodes * 2)
+	{
+		size *= 2;
+	}
+	zdoSchedPool = calloc(conf.queueSize, sizeof(zdoSchedEntry_t));
+	zdoSchedNodes = malloc(conf.maxNodes * sizeof(zdoSchedNode_t));
+	zdoSchedIndex = calloc(size, sizeof(uint32_t));
+	if (!zdoSchedPool || !zdoSchedNodes || !zdoSchedIndex)
+	{
+		free(zdoSchedPool);
+		free(zdoSchedNodes);
+		free(zdoSchedIndex);
+		zdoSchedPool = NULL;
+		zdoSchedNodes = NULL;
+		zdoSchedIndex = NULL;
+		pthread_mutex_unlock(&zdoSchedLock);
+		LOG_ERR("No memory for %u requests", conf.queueSize);
+		return ZDO_SCHED_ERR_NO_MEMORY;
+	}
+
+	zdoSchedFree = NULL;
+	for (i = conf.queueSize; i > 0; i--)
+	{
+		zdoSchedPool[i - 1].next = zdoSchedFree;
+		zdoSchedFree = &zdoSchedPool[i - 1];
+	}
+	memset(zdoSchedQueues, 0, sizeof(zdoSchedQueues));
+	memset(&zdoSchedOutstanding, 0, sizeof(zdoSchedOutstanding));
+	memset(&zdoSchedDone, 0, sizeof(zdoSchedDone));
+	memset(&zdoSchedStats, 0, sizeof(zdoSchedStats));
+	zdoSchedConf = conf;
+	zdoSchedMask = size - 1;
+	zdoSchedNodeCount = 0;
+	zdoSchedTokens = conf.globalBurst * ZDO_SCHED_TOKEN;
+	zdoSchedRefillMs = zdoSchedNowMs();
+	zdoSchedWakeMs = UINT64_MAX;
+	zdoSchedActive = 1;
+	pthread_mutex_unlock(&zdoSchedLock);
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedDisable
+ *
+ * @brief   Stop the scheduler. The queued and outstanding requests end
+ *          with ZDO_SCHED_CANCELLED.
+ */
+void zdoSchedDisable(void)
+{
+	uint8_t subscribed[256];
+	zdoSchedEntry_t *e;
+	uint8_t prio;
+	uint16_t cmd1;
+
+	pthread_mutex_lock(&zdoSchedLock);
+	if (!zdoSchedActive)
+	{
+		pthread_mutex_unlock(&zdoSchedLock);
+		return;
+	}
+	zdoSchedActive = 0;
+
+	for (prio = 0; prio < ZDO_SCHED_PRIOS; prio++)
+	{
+		while ((e = zdoSchedQueues[prio].head) != NULL)
+		{
+			zdoSchedUnlink(&zdoSchedQueues[prio], NULL, e);
+			zdoSchedFinish(e, ZDO_SCHED_CANCELLED);
+		}
+	}
+	while ((e = zdoSchedOutstanding.head) != NULL)
+	{
+		zdoSchedUnlink(&zdoSchedOutstanding, NULL, e);
+		zdoSchedFinish(e, ZDO_SCHED_CANCELLED);
+	}
+	zdoSchedRunDone();
+
+	free(zdoSchedPool);
+	free(zdoSchedNodes);
+	free(zdoSchedIndex);
+	zdoSchedPool = NULL;
+	zdoSchedNodes = NULL;
+	zdoSchedIndex = NULL;
+	zdoSchedFree = NULL;
+	zdoSchedNodeCount = 0;
+	zdoSchedStats.queued = 0;
+	zdoSchedStats.outstanding = 0;
+	memcpy(subscribed, zdoSchedSubscribed, sizeof(subscribed));
+	memset(zdoSchedSubscribed, 0, sizeof(zdoSchedSubscribed));
+	pthread_cond_broadcast(&zdoSchedCond);
+	pthread_mutex_unlock(&zdoSchedLock);
+
+	for (cmd1 = 0; cmd1 < 256; cmd1++)
+	{
+		if (subscribed[cmd1])
+		{
+			mtUnsubscribe(MT_RPC_SYS_ZDO, cmd1, zdoSchedRsp, NULL);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoSchedGetStats
+ *
+ * @brief   Read the scheduler counters.
+ *
+ * @param   stats - filled with the counters
+ */
+void zdoSchedGetStats(zdoSchedStats_t *stats)
+{
+	pthread_mutex_lock(&zdoSchedLock);
+	*stats = zdoSchedStats;
+	pthread_mutex_unlock(&zdoSchedLock);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedSubmit
+ *
+ * @brief   Queue a ZDP request, sent as soon as the buckets and caps let
+ *          it through. The response types are subscribed to as they are
+ *          first submitted.
+ *
+ * @param   req - request, copied
+ * @param   prio - ZDO_SCHED_PRIO_xxx
+ * @param   cb - called once the transaction ends, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if the scheduler is not
+ *          enabled or the request type is not supported, ZDO_SCHED_ERR_FULL,
+ *          MT_RPC_ERR_BUSY if the response subscription failed
+ */
+uint8_t zdoSchedSubmit(const zdoSchedReq_t *req, uint8_t prio,
+        zdoSchedCb_t cb, void *cbArg)
+{
+	int32_t dstAddr = zdoSchedDst(req);
+	uint8_t rspCmd1 = req->cmd1 | 0x80;
+	uint64_t now = zdoSchedNowMs();
+	zdoSchedNode_t *node;
+	zdoSchedEntry_t *e;
+	uint8_t status;
+
+	if ((dstAddr < 0) || (prio >= ZDO_SCHED_PRIOS))
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	pthread_mutex_lock(&zdoSchedLock);
+	if (zdoSchedActive && !zdoSchedSubscribed[rspCmd1])
+	{
+		zdoSchedSubscribed[rspCmd1] = 1;
+		pthread_mutex_unlock(&zdoSchedLock);
+		status = mtSubscribe(MT_RPC_SYS_ZDO, rspCmd1, zdoSchedRsp, NULL);
+		pthread_mutex_lock(&zdoSchedLock);
+		if (status != MT_RPC_SUCCESS)
+		{
+			zdoSchedSubscribed[rspCmd1] = 0;
+			pthread_mutex_unlock(&zdoSchedLock);
+			return status;
+		}
+	}
+	if (!zdoSchedActive)
+	{
+		pthread_mutex_unlock(&zdoSchedLock);
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	node = zdoSchedFree ? zdoSchedGetNode(dstAddr, 1, now) : NULL;
+	if (node == NULL)
+	{
+		pthread_mutex_unlock(&zdoSchedLock);
+		return ZDO_SCHED_ERR_FULL;
+	}
+
+	e = zdoSchedFree;
+	zdoSchedFree = e->next;
+	e->req = *req;
+	e->cb = cb;
+	e->cbArg = cbArg;
+	e->notBeforeMs = 0;
+	e->dstAddr = dstAddr;
+	e->state = ZDO_SCHED_QUEUED;
+	e->prio = prio;
+	e->tries = 0;
+	e->throttled = 0;
+	zdoSchedPush(&zdoSchedQueues[prio], e, 0);
+	node->queued++;
+	zdoSchedStats.queued++;
+	zdoSchedStats.submitted++;
+
+	zdoSchedPump(now);
+	zdoSchedRunDone();
+	pthread_mutex_unlock(&zdoSchedLock);
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedPoll
+ *
+ * @brief   End the transactions whose response is overdue and send what
+ *          the buckets and caps let through. zdoSchedNextTimeout() tells
+ *          when to call it; after dispatching responses is a good time
+ *          too, as they free transaction slots.
+ */
+void zdoSchedPoll(void)
+{
+	uint64_t now = zdoSchedNowMs();
+
+	pthread_mutex_lock(&zdoSchedLock);
+	if (zdoSchedActive)
+	{
+		zdoSchedExpire(now);
+		zdoSchedPump(now);
+		zdoSchedRunDone();
+	}
+	pthread_mutex_unlock(&zdoSchedLock);
+}
+
+/*********************************************************************
+ * @fn      zdoSchedNextTimeout
+ *
+ * @brief   Time until zdoSchedPoll() has something to do: a request
+ *          earns its tokens or its resend delay ends, a response deadline
+ *          passes
+ *
+ * @return  timeout in ms, -1 if no request is queued or outstanding
+ */
+int32_t zdoSchedNextTimeout(void)
+{
+	uint64_t now = zdoSchedNowMs();
+	uint64_t next;
+	zdoSchedEntry_t *e;
+
+	pthread_mutex_lock(&zdoSchedLock);
+	if (!zdoSchedActive
+	        || ((zdoSchedStats.queued == 0) && (zdoSchedStats.outstanding == 0)))
+	{
+		pthread_mutex_unlock(&zdoSchedLock);
+		return -1;
+	}
+	next = zdoSchedWakeMs;
+	for (e = zdoSchedOutstanding.head; e; e = e->next)
+	{
+		if (e->deadlineMs < next)
+		{
+			next = e->deadlineMs;
+		}
+	}
+	pthread_mutex_unlock(&zdoSchedLock);
+
+	if (next == UINT64_MAX)
+	{
+		return -1;
+	}
+	return (next > now) ? (int32_t) (next - now) : 0;
+}
+
+/*********************************************************************
+ * @fn      zdoSchedWaitIdle
+ *
+ * @brief   Run the scheduler until every request submitted has ended.
+ *          Runs in the thread that dispatches the message queue, like
+ *          afDataRequestBatch().
+ *
+ * @param   timeoutMs - longest wait, 0 for none
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT
+ */
+uint8_t zdoSchedWaitIdle(uint32_t timeoutMs)
+{
+	uint64_t deadline = zdoSchedNowMs() + timeoutMs;
+	uint8_t status = MT_RPC_SUCCESS;
+	uint64_t now;
+
+	pthread_mutex_lock(&zdoSchedLock);
+	while (zdoSchedActive
+	        && (zdoSchedStats.queued || zdoSchedStats.outstanding))
+	{
+		now = zdoSchedNowMs();
+		if (timeoutMs && (now >= deadline))
+		{
+			status = MT_RPC_ERR_TIMEOUT;
+			break;
+		}
+		zdoSchedExpire(now);
+		zdoSchedPump(now);
+		zdoSchedRunDone();
+		zdoSchedWait();
+	}
+	pthread_mutex_unlock(&zdoSchedLock);
+
+	return status;
+}
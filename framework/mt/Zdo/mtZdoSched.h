@@ -0,0 +1,136 @@
+/*
+ * mtZdoSched.h
+ *
+ * ZDP request scheduler. Requests submitted to it are queued and sent
+ * only when a global token bucket, a token bucket of their destination
+ * and a cap on the transactions outstanding per destination all allow
+ * it, so that discovering many devices at once does not exhaust the ZNP
+ * buffers. Interactive requests are sent before background ones. A
+ * transaction ends with the ZDO_xxx_RSP of its destination; a request
+ * the ZNP refuses is sent again a little later.
+ *
+ * The scheduler sends from zdoSchedSubmit(), zdoSchedPoll() and
+ * zdoSchedWaitIdle(). An event loop calls zdoSchedPoll() once
+ * zdoSchedNextTimeout() elapsed or after dispatching messages.
+ */
+
+#ifndef MTZDOSCHED_H
+#define MTZDOSCHED_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtZdo.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ZDO_SCHED_DEFAULT_QUEUE      (1024)
+#define ZDO_SCHED_DEFAULT_NODES      (256)
+// requests per second and burst, all destinations together
+#define ZDO_SCHED_GLOBAL_RATE        (20)
+#define ZDO_SCHED_GLOBAL_BURST       (8)
+// requests per second and burst to one destination
+#define ZDO_SCHED_NODE_RATE          (4)
+#define ZDO_SCHED_NODE_BURST         (2)
+#define ZDO_SCHED_MAX_PER_NODE       (1)
+#define ZDO_SCHED_RETRIES            (3)
+#define ZDO_SCHED_RETRY_DELAY_MS     (250)
+// request -> ZDO_xxx_RSP
+#define ZDO_SCHED_RSP_TIMEOUT_MS     (5000)
+
+// priority classes
+#define ZDO_SCHED_PRIO_INTERACTIVE   (0)
+#define ZDO_SCHED_PRIO_BACKGROUND    (1)
+#define ZDO_SCHED_PRIOS              (2)
+
+// status besides the MT_RPC_ERR_* codes and the ZDP ones
+#define ZDO_SCHED_ERR_NO_MEMORY      (0x90)
+#define ZDO_SCHED_ERR_FULL           (0x91)  // queue or destination table full
+#define ZDO_SCHED_CANCELLED          (0x92)  // scheduler disabled first
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t queueSize;        // requests queued or outstanding, 0 for
+	                           // ZDO_SCHED_DEFAULT_QUEUE
+	uint32_t maxNodes;         // destinations with a token bucket, 0 for
+	                           // ZDO_SCHED_DEFAULT_NODES
+	uint16_t globalRate;       // 0 for the ZDO_SCHED_xxx defaults
+	uint16_t globalBurst;
+	uint16_t nodeRate;
+	uint16_t nodeBurst;
+	uint8_t maxPerNode;        // transactions outstanding per destination
+	uint8_t retries;           // resends of a refused request, 0 for the
+	                           // default
+	uint32_t retryDelayMs;     // 0 for ZDO_SCHED_RETRY_DELAY_MS
+	uint32_t rspTimeoutMs;     // 0 for ZDO_SCHED_RSP_TIMEOUT_MS
+} zdoSchedConfig_t;
+
+// request of one of the types zdoSendReqCb() sends
+typedef struct
+{
+	uint8_t cmd1;              // MT_ZDO_xxx_REQ, selects the member
+	union
+	{
+		IeeeAddrReqFormat_t ieeeAddr;
+		NodeDescReqFormat_t nodeDesc;
+		PowerDescReqFormat_t powerDesc;
+		SimpleDescReqFormat_t simpleDesc;
+		ActiveEpReqFormat_t activeEp;
+		MatchDescReqFormat_t matchDesc;
+		BindReqFormat_t bind;
+		UnbindReqFormat_t unbind;
+		MgmtLqiReqFormat_t mgmtLqi;
+		MgmtRtgReqFormat_t mgmtRtg;
+		MgmtBindReqFormat_t mgmtBind;
+		MgmtLeaveReqFormat_t mgmtLeave;
+		MgmtPermitJoinReqFormat_t mgmtPermitJoin;
+	} u;
+} zdoSchedReq_t;
+
+// end of a transaction: ZDP status of the response, the SRSP status of
+// a request refused more than the retries, MT_RPC_ERR_TIMEOUT or
+// ZDO_SCHED_CANCELLED. Requests to a broadcast address end with their
+// SRSP. The response itself reaches the mtZdo callbacks as usual.
+typedef void (*zdoSchedCb_t)(uint8_t status, void *cbArg);
+
+typedef struct
+{
+	uint32_t queued;           // waiting to be sent
+	uint32_t outstanding;      // sent, awaiting their response
+	uint32_t submitted;
+	uint32_t sent;             // requests written, resends included
+	uint32_t responses;
+	uint32_t timeouts;
+	uint32_t refusals;         // SRSPs with an error status
+	uint32_t failures;         // transactions ended without response
+	uint32_t throttled;        // sends deferred for lack of tokens
+} zdoSchedStats_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t zdoSchedEnable(const zdoSchedConfig_t *cfg);
+void zdoSchedDisable(void);
+void zdoSchedGetStats(zdoSchedStats_t *stats);
+
+uint8_t zdoSchedSubmit(const zdoSchedReq_t *req, uint8_t prio,
+        zdoSchedCb_t cb, void *cbArg);
+void zdoSchedPoll(void);
+int32_t zdoSchedNextTimeout(void);
+uint8_t zdoSchedWaitIdle(uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTZDOSCHED_H */
@@ -0,0 +1,756 @@
+/*
+ * mtZdoTopo.c
+ *
+ * Network topology crawler, see mtZdoTopo.h. Routers wait in node order
+ * for their next neighbor table page to be requested, so the crawl is
+ * breadth first. A router has one request outstanding at a time and its
+ * response is matched by source address and StartIndex.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mtZdoTopo.h"
+#include "mtSys.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// longest wait before the queue and the transport are polled again
+#define ZDO_TOPO_POLL_MS       (1)
+
+#define ZDO_TOPO_INIT_NODES    (64)
+#define ZDO_TOPO_INIT_LINKS    (256)
+
+// NWK addresses above this are broadcast or invalid
+#define ZDO_TOPO_MAX_NWK_ADDR  (0xFFF7)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef enum
+{
+	ZDO_TOPO_IDLE,      // nothing to request
+	ZDO_TOPO_QUEUED,    // next page to be requested
+	ZDO_TOPO_WAIT       // page requested, waiting for the response
+} zdoTopoState_t;
+
+// crawl state of a node, same index as in graph->nodes
+typedef struct
+{
+	uint8_t state;      // zdoTopoState_t
+	uint8_t tries;      // sends of the current page
+	uint8_t startIndex; // current page
+	uint64_t deadline;  // ZDO_TOPO_WAIT: response timeout
+} zdoTopoCrawl_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static pthread_mutex_t zdoTopoLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zdoTopoCond = PTHREAD_COND_INITIALIZER;
+static uint8_t zdoTopoActive;
+static zdoTopoGraph_t *zdoTopoGraph;
+static zdoTopoCrawl_t *zdoTopoCrawls;
+static zdoTopoConfig_t zdoTopoConf;
+
+// nodes in ZDO_TOPO_WAIT
+static uint32_t zdoTopoWaiting[ZDO_TOPO_MAX_WINDOW];
+static uint8_t zdoTopoWaitCount;
+// lowest node index that may be ZDO_TOPO_QUEUED
+static uint32_t zdoTopoNext;
+// SREQs whose SRSP callback has not run yet
+static uint32_t zdoTopoSrspPending;
+// responses handled since the crawl thread last looked
+static uint32_t zdoTopoEvents;
+static uint8_t zdoTopoNoMem;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoTopoNowMs
+ *
+ * @brief   monotonic time in ms, used for the response deadlines
+ */
+static uint64_t zdoTopoNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      zdoTopoHashSlot
+ *
+ * @brief   Slot of nwkAddr in the node index: the one holding it, else
+ *          the empty slot where it goes. Slots hold a node index + 1.
+ */
+static uint32_t *zdoTopoHashSlot(const zdoTopoGraph_t *graph,
+        uint16_t nwkAddr)
+{
+	uint32_t mask = graph->hashSize - 1;
+	uint32_t h = (uint32_t) nwkAddr * 2654435761u;
+	uint32_t *slot;
+
+	h = (h ^ (h >> 16)) & mask;
+	for (;;)
+	{
+		slot = &graph->hash[h];
+		if ((*slot == 0) || (graph->nodes[*slot - 1].nwkAddr == nwkAddr))
+		{
+			return slot;
+		}
+		h = (h + 1) & mask;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoTopoGrow
+ *
+ * @brief   Make room for one more node: double the node arrays when full
+ *          and keep the node index at most half full.
+ *
+ * @return  MT_RPC_SUCCESS, ZDO_TOPO_ERR_NO_MEMORY
+ */
+static uint8_t zdoTopoGrow(zdoTopoGraph_t *graph)
+{
+	if (graph->nodeCount == graph->nodeSize)
+	{
+		uint32_t size = graph->nodeSize * 2;
+		zdoTopoNode_t *nodes;
+		zdoTopoCrawl_t *crawls;
+
+		nodes = realloc(graph->nodes, size * sizeof(zdoTopoNode_t));
+		if (nodes == NULL)
+		{
+			return ZDO_TOPO_ERR_NO_MEMORY;
+		}
+		graph->nodes = nodes;
+		crawls = realloc(zdoTopoCrawls, size * sizeof(zdoTopoCrawl_t));
+		if (crawls == NULL)
+		{
+			return ZDO_TOPO_ERR_NO_MEMORY;
+		}
+		zdoTopoCrawls = crawls;
+		graph->nodeSize = size;
+	}
+
+	if ((graph->nodeCount + 1) * 2 > graph->hashSize)
+	{
+		uint32_t *old = graph->hash;
+		uint32_t idx;
+
+		graph->hash = calloc(graph->hashSize * 2, sizeof(uint32_t));
+		if (graph->hash == NULL)
+		{
+			graph->hash = old;
+			return ZDO_TOPO_ERR_NO_MEMORY;
+		}
+		graph->hashSize *= 2;
+		free(old);
+		for (idx = 0; idx < graph->nodeCount; idx++)
+		{
+			*zdoTopoHashSlot(graph, graph->nodes[idx].nwkAddr) = idx + 1;
+		}
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoAddNode
+ *
+ * @brief   Index of the node nwkAddr, added if it is new. Called with
+ *          zdoTopoLock held.
+ *
+ * @param   graph - graph being crawled
+ * @param   nwkAddr - node
+ * @param   added - set to 1 if the node is new
+ *
+ * @return  node index, -1 if the graph is full
+ */
+static int32_t zdoTopoAddNode(zdoTopoGraph_t *graph, uint16_t nwkAddr,
+        uint8_t *added)
+{
+	uint32_t *slot = zdoTopoHashSlot(graph, nwkAddr);
+	uint32_t idx;
+
+	*added = 0;
+	if (*slot)
+	{
+		return *slot - 1;
+	}
+
+	if (zdoTopoConf.maxNodes && (graph->nodeCount >= zdoTopoConf.maxNodes))
+	{
+		graph->truncated++;
+		return -1;
+	}
+	if (zdoTopoGrow(graph) != MT_RPC_SUCCESS)
+	{
+		LOG_ERR("No memory for node %d of the topology", graph->nodeCount);
+		zdoTopoNoMem = 1;
+		return -1;
+	}
+
+	idx = graph->nodeCount++;
+	memset(&graph->nodes[idx], 0, sizeof(zdoTopoNode_t));
+	memset(&zdoTopoCrawls[idx], 0, sizeof(zdoTopoCrawl_t));
+	graph->nodes[idx].nwkAddr = nwkAddr;
+	// the table may have moved
+	*zdoTopoHashSlot(graph, nwkAddr) = idx + 1;
+	*added = 1;
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoAddLink
+ *
+ * @brief   Record a neighbor table entry. Called with zdoTopoLock held.
+ */
+static void zdoTopoAddLink(zdoTopoGraph_t *graph, uint32_t from, uint32_t to,
+        const NeighborLqiListItemFormat_t *entry)
+{
+	zdoTopoLink_t *link;
+
+	if (graph->linkCount == graph->linkSize)
+	{
+		zdoTopoLink_t *links = realloc(graph->links,
+		        graph->linkSize * 2 * sizeof(zdoTopoLink_t));
+
+		if (links == NULL)
+		{
+			LOG_ERR("No memory for link %d of the topology",
+			        graph->linkCount);
+			zdoTopoNoMem = 1;
+			return;
+		}
+		graph->links = links;
+		graph->linkSize *= 2;
+	}
+
+	link = &graph->links[graph->linkCount++];
+	link->from = from;
+	link->to = to;
+	link->relation = (entry->DevTyp_RxOnWhenIdle_Relat >> 4) & 7;
+	link->lqi = entry->LQI;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoUnwait
+ *
+ * @brief   Remove a node from the ones waiting for a response. Called
+ *          with zdoTopoLock held.
+ */
+static void zdoTopoUnwait(uint8_t pos)
+{
+	zdoTopoWaiting[pos] = zdoTopoWaiting[--zdoTopoWaitCount];
+}
+
+/*********************************************************************
+ * @fn      zdoTopoFindWaiting
+ *
+ * @brief   Find the node waiting for a page of its neighbor table.
+ *          Called with zdoTopoLock held.
+ *
+ * @return  position in zdoTopoWaiting, -1 if no node waits for it
+ */
+static int32_t zdoTopoFindWaiting(uint16_t nwkAddr, uint8_t startIndex)
+{
+	uint8_t pos;
+
+	for (pos = 0; pos < zdoTopoWaitCount; pos++)
+	{
+		uint32_t idx = zdoTopoWaiting[pos];
+
+		if ((zdoTopoGraph->nodes[idx].nwkAddr == nwkAddr)
+		        && (zdoTopoCrawls[idx].startIndex == startIndex))
+		{
+			return pos;
+		}
+	}
+
+	return -1;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoQueue
+ *
+ * @brief   Queue the current page of a node for (re)sending. Called with
+ *          zdoTopoLock held.
+ */
+static void zdoTopoQueue(uint32_t idx)
+{
+	zdoTopoCrawls[idx].state = ZDO_TOPO_QUEUED;
+	if (idx < zdoTopoNext)
+	{
+		zdoTopoNext = idx;
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoTopoFail
+ *
+ * @brief   Give up on the neighbor table of a node. Called with
+ *          zdoTopoLock held.
+ */
+static void zdoTopoFail(uint32_t idx)
+{
+	zdoTopoCrawls[idx].state = ZDO_TOPO_IDLE;
+	zdoTopoGraph->nodes[idx].status = ZDO_TOPO_NODE_FAILED;
+	zdoTopoGraph->failed++;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoSrsp
+ *
+ * @brief   SRSP callback of a ZDO_MGMT_LQI_REQ. A request the ZNP refused
+ *          expires at once and is retried like a lost response.
+ */
+static void zdoTopoSrsp(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	uint32_t idx = (uint32_t) (uintptr_t) cbArg;
+
+	if ((status == MT_RPC_SUCCESS)
+	        && (MT_CHECK_LEN(srsp, srspLen, 1) == MT_RPC_SUCCESS))
+	{
+		status = srsp[2];
+	}
+
+	pthread_mutex_lock(&zdoTopoLock);
+	zdoTopoSrspPending--;
+	if ((status != MT_RPC_SUCCESS) && (idx < zdoTopoGraph->nodeCount)
+	        && (zdoTopoCrawls[idx].state == ZDO_TOPO_WAIT))
+	{
+		zdoTopoCrawls[idx].deadline = 0;
+	}
+	zdoTopoEvents++;
+	pthread_cond_signal(&zdoTopoCond);
+	pthread_mutex_unlock(&zdoTopoLock);
+}
+
+/*********************************************************************
+ * @fn      zdoTopoRsp
+ *
+ * @brief   ZDO_MGMT_LQI_RSP subscriber: adds the page to the graph and
+ *          queues the next page and the routers seen for the first time.
+ *          Responses no request is waiting for are ignored.
+ */
+static void zdoTopoRsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        void *cbArg __attribute__((unused)))
+{
+	MgmtLqiRspFormat_t rsp;
+	zdoTopoGraph_t *graph;
+	uint32_t idx;
+	int32_t pos;
+	uint16_t next;
+	uint8_t i;
+
+	if (zdoDecodeMgmtLqiRsp(rpcBuff, rpcLen, &rsp) != MT_RPC_SUCCESS)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&zdoTopoLock);
+	graph = zdoTopoGraph;
+	pos = zdoTopoActive ?
+	        zdoTopoFindWaiting(rsp.SrcAddr, rsp.StartIndex) : -1;
+	if (pos < 0)
+	{
+		pthread_mutex_unlock(&zdoTopoLock);
+		return;
+	}
+	idx = zdoTopoWaiting[pos];
+	zdoTopoUnwait(pos);
+
+	if (rsp.Status != MT_RPC_SUCCESS)
+	{
+		LOG_WARN("ZDO_MGMT_LQI_RSP from %04X: %02X", rsp.SrcAddr, rsp.Status);
+		zdoTopoFail(idx);
+	}
+	else
+	{
+		graph->nodes[idx].tableEntries = rsp.NeighborTableEntries;
+		for (i = 0; (i < rsp.NeighborLqiListCount) && !zdoTopoNoMem; i++)
+		{
+			const NeighborLqiListItemFormat_t *entry = &rsp.NeighborLqiList[i];
+			int32_t to;
+			uint8_t added;
+
+			if (entry->NetworkAddress > ZDO_TOPO_MAX_NWK_ADDR)
+			{
+				continue;
+			}
+			to = zdoTopoAddNode(graph, entry->NetworkAddress, &added);
+			if (to < 0)
+			{
+				continue;
+			}
+			if (added)
+			{
+				zdoTopoNode_t *node = &graph->nodes[to];
+
+				node->ieeeAddr = entry->ExtendedAddress;
+				node->devType = entry->DevTyp_RxOnWhenIdle_Relat & 3;
+				node->depth = entry->Depth;
+				if (node->devType != DEVICETYPE_ENDDEVICE)
+				{
+					node->status = ZDO_TOPO_NODE_PENDING;
+					zdoTopoQueue(to);
+				}
+			}
+			else if (graph->nodes[to].ieeeAddr == 0)
+			{
+				graph->nodes[to].ieeeAddr = entry->ExtendedAddress;
+			}
+			zdoTopoAddLink(graph, idx, to, entry);
+		}
+
+		// page through the table
+		next = rsp.StartIndex + rsp.NeighborLqiListCount;
+		if ((rsp.NeighborLqiListCount > 0)
+		        && (next < rsp.NeighborTableEntries))
+		{
+			zdoTopoCrawls[idx].startIndex = next;
+			zdoTopoCrawls[idx].tries = 0;
+			zdoTopoQueue(idx);
+		}
+		else
+		{
+			zdoTopoCrawls[idx].state = ZDO_TOPO_IDLE;
+			graph->nodes[idx].status = ZDO_TOPO_NODE_DONE;
+		}
+	}
+
+	zdoTopoEvents++;
+	pthread_cond_signal(&zdoTopoCond);
+	pthread_mutex_unlock(&zdoTopoLock);
+}
+
+/*********************************************************************
+ * @fn      zdoTopoWait
+ *
+ * @brief   Let the crawl make progress: read the transport if no thread
+ *          does, dispatch the queued messages, then wait a little for a
+ *          response. Called with zdoTopoLock held.
+ */
+static void zdoTopoWait(void)
+{
+	struct timespec ts;
+
+	pthread_mutex_unlock(&zdoTopoLock);
+	rpcProcessReady();
+	while (rpcGetMqClientMsg() == 0)
+		;
+	pthread_mutex_lock(&zdoTopoLock);
+	if (zdoTopoEvents)
+	{
+		zdoTopoEvents = 0;
+		return;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += ZDO_TOPO_POLL_MS * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&zdoTopoCond, &zdoTopoLock, &ts);
+	zdoTopoEvents = 0;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoExpire
+ *
+ * @brief   Resend the pages whose response is late, or give up on their
+ *          node once the retries are spent. Called with zdoTopoLock held.
+ */
+static void zdoTopoExpire(uint64_t now)
+{
+	uint8_t pos = 0;
+
+	while (pos < zdoTopoWaitCount)
+	{
+		uint32_t idx = zdoTopoWaiting[pos];
+
+		if (zdoTopoCrawls[idx].deadline > now)
+		{
+			pos++;
+			continue;
+		}
+
+		zdoTopoUnwait(pos);
+		if (zdoTopoCrawls[idx].tries <= zdoTopoConf.retries)
+		{
+			zdoTopoGraph->retries++;
+			zdoTopoQueue(idx);
+		}
+		else
+		{
+			LOG_WARN("No ZDO_MGMT_LQI_RSP from %04X",
+			        zdoTopoGraph->nodes[idx].nwkAddr);
+			zdoTopoFail(idx);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      zdoTopoSend
+ *
+ * @brief   Request the queued pages until the window is full. Called with
+ *          zdoTopoLock held.
+ */
+static void zdoTopoSend(uint64_t now)
+{
+	zdoTopoGraph_t *graph = zdoTopoGraph;
+
+	while (zdoTopoWaitCount < zdoTopoConf.window)
+	{
+		MgmtLqiReqFormat_t req;
+		uint32_t idx;
+		uint8_t status;
+
+		while ((zdoTopoNext < graph->nodeCount)
+		        && (zdoTopoCrawls[zdoTopoNext].state != ZDO_TOPO_QUEUED))
+		{
+			zdoTopoNext++;
+		}
+		if (zdoTopoNext == graph->nodeCount)
+		{
+			return;
+		}
+
+		idx = zdoTopoNext;
+		req.DstAddr = graph->nodes[idx].nwkAddr;
+		req.StartIndex = zdoTopoCrawls[idx].startIndex;
+		zdoTopoCrawls[idx].state = ZDO_TOPO_WAIT;
+		zdoTopoCrawls[idx].tries++;
+		zdoTopoCrawls[idx].deadline = now + zdoTopoConf.rspTimeoutMs;
+		zdoTopoWaiting[zdoTopoWaitCount++] = idx;
+		zdoTopoSrspPending++;
+
+		// unlocked, the SRSP callback may run before this returns
+		pthread_mutex_unlock(&zdoTopoLock);
+		status = zdoMgmtLqiReqCb(&req, 0, zdoTopoSrsp,
+		        (void *) (uintptr_t) idx);
+		pthread_mutex_lock(&zdoTopoLock);
+
+		if (status == MT_RPC_SUCCESS)
+		{
+			graph->requests++;
+			continue;
+		}
+
+		// not sent, no SRSP callback and no response to come
+		zdoTopoSrspPending--;
+		if (zdoTopoCrawls[idx].state == ZDO_TOPO_WAIT)
+		{
+			uint8_t pos;
+
+			for (pos = 0; zdoTopoWaiting[pos] != idx; pos++)
+				;
+			zdoTopoUnwait(pos);
+		}
+		if (status == MT_RPC_ERR_BUSY)
+		{
+			// SREQ table or SRSP lane full, retry once some complete
+			zdoTopoCrawls[idx].tries--;
+			zdoTopoQueue(idx);
+			return;
+		}
+		zdoTopoFail(idx);
+	}
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zdoTopoCrawl
+ *
+ * @brief   Map the network from root: read its neighbor table, then the
+ *          tables of the routers it lists, and so on, keeping up to
+ *          cfg->window ZDO_MGMT_LQI_REQs waiting for their response. Each
+ *          table is read page by page until NeighborTableEntries entries
+ *          are in. A page without response is requested again up to
+ *          cfg->retries times. Nodes are merged by NWK address.
+ *          Runs in the thread that dispatches the message queue, like
+ *          afDataRequestBatch(). One crawl runs at a time.
+ *
+ * @param   root - NWK address the crawl starts from, 0 for the
+ *          coordinator
+ * @param   cfg - window, timeout, retries and size limit, NULL for the
+ *          defaults
+ * @param   graph - filled with the nodes and links found, to be released
+ *          with zdoTopoFree(), also on failure
+ *
+ * @return  MT_RPC_SUCCESS once every router found has been crawled or
+ *          given up on, MT_RPC_ERR_BUSY if another crawl is running or the
+ *          subscription failed, ZDO_TOPO_ERR_NO_MEMORY if the graph could
+ *          not grow: it holds what was found until then
+ */
+uint8_t zdoTopoCrawl(uint16_t root, const zdoTopoConfig_t *cfg,
+        zdoTopoGraph_t *graph)
+{
+	uint64_t start = zdoTopoNowMs();
+	uint8_t status = MT_RPC_SUCCESS;
+	uint8_t added;
+
+	memset(graph, 0, sizeof(zdoTopoGraph_t));
+
+	pthread_mutex_lock(&zdoTopoLock);
+	if (zdoTopoActive)
+	{
+		pthread_mutex_unlock(&zdoTopoLock);
+		LOG_ERR("A topology crawl is already running");
+		return MT_RPC_ERR_BUSY;
+	}
+
+	memset(&zdoTopoConf, 0, sizeof(zdoTopoConf));
+	if (cfg)
+	{
+		zdoTopoConf = *cfg;
+	}
+	if ((zdoTopoConf.window == 0) || (zdoTopoConf.window > ZDO_TOPO_MAX_WINDOW))
+	{
+		zdoTopoConf.window = (zdoTopoConf.window == 0) ?
+		        ZDO_TOPO_DEFAULT_WINDOW : ZDO_TOPO_MAX_WINDOW;
+	}
+	if (zdoTopoConf.retries == 0)
+	{
+		zdoTopoConf.retries = ZDO_TOPO_DEFAULT_RETRIES;
+	}
+	if (zdoTopoConf.rspTimeoutMs == 0)
+	{
+		zdoTopoConf.rspTimeoutMs = ZDO_TOPO_RSP_TIMEOUT_MS;
+	}
+
+	graph->nodeSize = ZDO_TOPO_INIT_NODES;
+	graph->linkSize = ZDO_TOPO_INIT_LINKS;
+	graph->hashSize = ZDO_TOPO_INIT_NODES * 2;
+	graph->nodes = malloc(graph->nodeSize * sizeof(zdoTopoNode_t));
+	graph->links = malloc(graph->linkSize * sizeof(zdoTopoLink_t));
+	graph->hash = calloc(graph->hashSize, sizeof(uint32_t));
+	zdoTopoCrawls = malloc(graph->nodeSize * sizeof(zdoTopoCrawl_t));
+	if (!graph->nodes || !graph->links || !graph->hash || !zdoTopoCrawls)
+	{
+		pthread_mutex_unlock(&zdoTopoLock);
+		free(zdoTopoCrawls);
+		zdoTopoCrawls = NULL;
+		zdoTopoFree(graph);
+		return ZDO_TOPO_ERR_NO_MEMORY;
+	}
+
+	zdoTopoGraph = graph;
+	zdoTopoWaitCount = 0;
+	zdoTopoNext = 0;
+	zdoTopoSrspPending = 0;
+	zdoTopoEvents = 0;
+	zdoTopoNoMem = 0;
+	zdoTopoAddNode(graph, root, &added);
+	graph->nodes[0].devType = (root == 0) ?
+	        DEVICETYPE_COORDINATOR : DEVICETYPE_ROUTER;
+	graph->nodes[0].status = ZDO_TOPO_NODE_PENDING;
+	zdoTopoQueue(0);
+	zdoTopoActive = 1;
+	pthread_mutex_unlock(&zdoTopoLock);
+
+	if (mtSubscribe(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_LQI_RSP, zdoTopoRsp, NULL)
+	        != MT_RPC_SUCCESS)
+	{
+		pthread_mutex_lock(&zdoTopoLock);
+		zdoTopoActive = 0;
+		pthread_mutex_unlock(&zdoTopoLock);
+		free(zdoTopoCrawls);
+		zdoTopoCrawls = NULL;
+		return MT_RPC_ERR_BUSY;
+	}
+
+	pthread_mutex_lock(&zdoTopoLock);
+	while (!zdoTopoNoMem)
+	{
+		uint64_t now = zdoTopoNowMs();
+
+		zdoTopoExpire(now);
+		zdoTopoSend(now);
+		if ((zdoTopoWaitCount == 0) && (zdoTopoNext == graph->nodeCount))
+		{
+			break;
+		}
+		zdoTopoWait();
+	}
+	// the SRSP callbacks refer to the crawl state
+	while (zdoTopoSrspPending)
+	{
+		zdoTopoWait();
+	}
+	zdoTopoActive = 0;
+	if (zdoTopoNoMem)
+	{
+		status = ZDO_TOPO_ERR_NO_MEMORY;
+	}
+	free(zdoTopoCrawls);
+	zdoTopoCrawls = NULL;
+	zdoTopoGraph = NULL;
+	pthread_mutex_unlock(&zdoTopoLock);
+
+	mtUnsubscribe(MT_RPC_SYS_ZDO, MT_ZDO_MGMT_LQI_RSP, zdoTopoRsp, NULL);
+
+	graph->elapsedMs = (uint32_t) (zdoTopoNowMs() - start);
+	return status;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoFind
+ *
+ * @brief   Look a node up by NWK address.
+ *
+ * @param   graph - crawled graph
+ * @param   nwkAddr - node
+ *
+ * @return  its index in graph->nodes, -1 if it is not in the graph
+ */
+int32_t zdoTopoFind(const zdoTopoGraph_t *graph, uint16_t nwkAddr)
+{
+	uint32_t *slot;
+
+	if (graph->hash == NULL)
+	{
+		return -1;
+	}
+
+	slot = zdoTopoHashSlot(graph, nwkAddr);
+	return *slot ? (int32_t) (*slot - 1) : -1;
+}
+
+/*********************************************************************
+ * @fn      zdoTopoFree
+ *
+ * @brief   Release the memory of a graph filled by zdoTopoCrawl().
+ *
+ * @param   graph - crawled graph, emptied
+ */
+void zdoTopoFree(zdoTopoGraph_t *graph)
+{
+	free(graph->nodes);
+	free(graph->links);
+	free(graph->hash);
+	memset(graph, 0, sizeof(zdoTopoGraph_t));
+}
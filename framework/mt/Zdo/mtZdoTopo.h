@@ -0,0 +1,109 @@
+/*
+ * mtZdoTopo.h
+ *
+ * Network topology crawler. Starting from one router, the neighbor table
+ * of every router found is read with ZDO_MGMT_LQI_REQs, page by page,
+ * with a bounded number of requests awaiting their ZDO_MGMT_LQI_RSP. The
+ * result is a graph of the nodes and of the neighbor table entries
+ * linking them.
+ */
+
+#ifndef MTZDOTOPO_H
+#define MTZDOTOPO_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include "mtZdo.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define ZDO_TOPO_MAX_WINDOW        (16)
+#define ZDO_TOPO_DEFAULT_WINDOW    (4)
+// request -> ZDO_MGMT_LQI_RSP
+#define ZDO_TOPO_RSP_TIMEOUT_MS    (5000)
+#define ZDO_TOPO_DEFAULT_RETRIES   (2)
+
+// zdoTopoCrawl() status besides the MT_RPC_ERR_* codes
+#define ZDO_TOPO_ERR_NO_MEMORY     (0x90)
+
+// zdoTopoNode_t status
+#define ZDO_TOPO_NODE_LEAF         (0)  // end device, or not crawled
+#define ZDO_TOPO_NODE_DONE         (1)  // neighbor table read completely
+#define ZDO_TOPO_NODE_FAILED       (2)  // no answer after the retries, or
+                                        // an error status
+#define ZDO_TOPO_NODE_PENDING      (3)  // crawl in progress
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint8_t window;            // requests awaiting a response, 0 for the
+	                           // default
+	uint8_t retries;           // resends of a page without answer, 0 for
+	                           // the default
+	uint32_t rspTimeoutMs;     // 0 for ZDO_TOPO_RSP_TIMEOUT_MS
+	uint32_t maxNodes;         // graph size limit, 0 for none
+} zdoTopoConfig_t;
+
+typedef struct
+{
+	uint16_t nwkAddr;
+	uint64_t ieeeAddr;         // 0 if no neighbor table lists the node
+	uint8_t devType;           // DEVICETYPE_xxx
+	uint8_t depth;
+	uint8_t status;            // ZDO_TOPO_NODE_xxx
+	uint8_t tableEntries;      // neighbor table size reported by the node
+} zdoTopoNode_t;
+
+// neighbor table entry of node from listing node to
+typedef struct
+{
+	uint32_t from;             // index in nodes
+	uint32_t to;
+	uint8_t relation;          // 0 parent, 1 child, 2 sibling, 3 none,
+	                           // 4 previous child
+	uint8_t lqi;
+} zdoTopoLink_t;
+
+typedef struct
+{
+	zdoTopoNode_t *nodes;      // nodes[0] is the root
+	uint32_t nodeCount;
+	zdoTopoLink_t *links;
+	uint32_t linkCount;
+
+	uint32_t requests;         // ZDO_MGMT_LQI_REQs sent
+	uint32_t retries;          // of which resent after a timeout
+	uint32_t failed;           // routers whose table could not be read
+	uint32_t truncated;        // neighbor entries left out by maxNodes
+	uint32_t elapsedMs;
+
+	// private: index of nodes by NWK address
+	uint32_t *hash;
+	uint32_t hashSize;
+	uint32_t nodeSize;
+	uint32_t linkSize;
+} zdoTopoGraph_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+uint8_t zdoTopoCrawl(uint16_t root, const zdoTopoConfig_t *cfg,
+        zdoTopoGraph_t *graph);
+int32_t zdoTopoFind(const zdoTopoGraph_t *graph, uint16_t nwkAddr);
+void zdoTopoFree(zdoTopoGraph_t *graph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTZDOTOPO_H */
@@ -0,0 +1,475 @@
+/*
+ * mtCodec.c
+ *
+ * Table driven encoder and decoder for MT command payloads, see mtCodec.h.
+ * Multi-byte fields are little endian on the wire. On a little endian host
+ * they and the uint16_t lists are copied with memcpy.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+
+#include "mtCodec.h"
+#include "mtParser.h"
+#include "rpc.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define MT_CODEC_HOST_LE 1
+#else
+#define MT_CODEC_HOST_LE 0
+#endif
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      codecGetLe
+ *
+ * @brief   Read a little endian integer of len bytes into dst, which is a
+ *          host integer of the same size.
+ */
+static void codecGetLe(void *dst, const uint8_t *src, uint8_t len)
+{
+#if MT_CODEC_HOST_LE
+	memcpy(dst, src, len);
+#else
+	uint64_t v = 0;
+	uint8_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		v |= ((uint64_t) src[i]) << (i * 8);
+	}
+	switch (len)
+	{
+	case 2:
+		*(uint16_t *) dst = (uint16_t) v;
+		break;
+	case 4:
+		*(uint32_t *) dst = (uint32_t) v;
+		break;
+	default:
+		*(uint64_t *) dst = v;
+		break;
+	}
+#endif
+}
+
+/*********************************************************************
+ * @fn      codecPutLe
+ *
+ * @brief   Write the host integer of len bytes at src in little endian.
+ */
+static void codecPutLe(uint8_t *dst, const void *src, uint8_t len)
+{
+#if MT_CODEC_HOST_LE
+	memcpy(dst, src, len);
+#else
+	uint64_t v;
+	uint8_t i;
+
+	switch (len)
+	{
+	case 2:
+		v = *(const uint16_t *) src;
+		break;
+	case 4:
+		v = *(const uint32_t *) src;
+		break;
+	default:
+		v = *(const uint64_t *) src;
+		break;
+	}
+	for (i = 0; i < len; i++)
+	{
+		dst[i] = (uint8_t) (v >> (i * 8));
+	}
+#endif
+}
+
+/*********************************************************************
+ * @fn      codecScalarLen
+ *
+ * @brief   Wire length of a scalar field type, 0 for the others.
+ */
+static uint8_t codecScalarLen(uint8_t type)
+{
+	switch (type)
+	{
+	case MT_FIELD_U8:
+		return 1;
+	case MT_FIELD_U16:
+		return 2;
+	case MT_FIELD_U32:
+		return 4;
+	case MT_FIELD_U64:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/*********************************************************************
+ * @fn      codecListCount
+ *
+ * @brief   Element count of a list field, read from the structure at base.
+ */
+static uint16_t codecListCount(const mtField_t *field, const uint8_t *base)
+{
+	uint16_t n;
+
+	if (field->type == MT_FIELD_LIST_U8_LEN16)
+	{
+		memcpy(&n, base + field->countOffset, sizeof(n));
+		return n;
+	}
+
+	return base[field->countOffset];
+}
+
+/*********************************************************************
+ * @fn      codecDecodeFields
+ *
+ * @brief   Unpack the fields of desc from buf into out.
+ *
+ * @return  bytes consumed, -1 if the payload is too short or a list
+ *          count exceeds its array
+ */
+static int32_t codecDecodeFields(const mtCmdDesc_t *desc, const uint8_t *buf,
+        uint16_t len, uint8_t *out)
+{
+	uint16_t idx = 0;
+	uint8_t f;
+
+	for (f = 0; f < desc->numFields; f++)
+	{
+		const mtField_t *field = &desc->fields[f];
+		uint8_t *dst = out + field->offset;
+		uint16_t n, i;
+
+		switch (field->type)
+		{
+		case MT_FIELD_U8:
+			if (idx >= len)
+			{
+				return -1;
+			}
+			*dst = buf[idx++];
+			break;
+
+		case MT_FIELD_U16:
+		case MT_FIELD_U32:
+		case MT_FIELD_U64:
+			n = codecScalarLen(field->type);
+			if (idx + n > len)
+			{
+				return -1;
+			}
+			codecGetLe(dst, &buf[idx], n);
+			idx += n;
+			break;
+
+		case MT_FIELD_BYTES:
+			if (idx + field->maxCount > len)
+			{
+				return -1;
+			}
+			memcpy(dst, &buf[idx], field->maxCount);
+			idx += field->maxCount;
+			break;
+
+		case MT_FIELD_LIST_U8:
+		case MT_FIELD_LIST_U8_LEN16:
+		case MT_FIELD_LIST_U16:
+		case MT_FIELD_LIST:
+			n = codecListCount(field, out);
+			if (n > field->maxCount)
+			{
+				return -1;
+			}
+			if (field->type == MT_FIELD_LIST)
+			{
+				uint16_t wire = n * field->elem->wireLen;
+
+				if (idx + wire > len)
+				{
+					return -1;
+				}
+				for (i = 0; i < n; i++)
+				{
+					codecDecodeFields(field->elem, &buf[idx],
+					        field->elem->wireLen, dst + i * field->elem->size);
+					idx += field->elem->wireLen;
+				}
+			}
+			else if ((field->type == MT_FIELD_LIST_U8)
+			        || (field->type == MT_FIELD_LIST_U8_LEN16))
+			{
+				if (idx + n > len)
+				{
+					return -1;
+				}
+				memcpy(dst, &buf[idx], n);
+				idx += n;
+			}
+			else
+			{
+				if (idx + n * 2 > len)
+				{
+					return -1;
+				}
+#if MT_CODEC_HOST_LE
+				memcpy(dst, &buf[idx], n * 2);
+				idx += n * 2;
+#else
+				for (i = 0; i < n; i++)
+				{
+					codecGetLe(dst + i * 2, &buf[idx], 2);
+					idx += 2;
+				}
+#endif
+			}
+			break;
+
+		case MT_FIELD_OPTIONAL:
+			if (idx >= len)
+			{
+				// the rest is absent, report it zeroed
+				if (f + 1 < desc->numFields)
+				{
+					uint16_t from = desc->fields[f + 1].offset;
+
+					memset(out + from, 0, desc->size - from);
+				}
+				return idx;
+			}
+			break;
+
+		default:
+			return -1;
+		}
+	}
+
+	return idx;
+}
+
+/*********************************************************************
+ * @fn      codecEncodeFields
+ *
+ * @brief   Pack the fields of desc from in into buf.
+ *
+ * @return  bytes written, -1 if they do not fit or a list count exceeds
+ *          its array
+ */
+static int32_t codecEncodeFields(const mtCmdDesc_t *desc, const uint8_t *in,
+        uint8_t *buf, uint16_t maxLen)
+{
+	uint16_t idx = 0;
+	uint8_t f;
+
+	for (f = 0; f < desc->numFields; f++)
+	{
+		const mtField_t *field = &desc->fields[f];
+		const uint8_t *src = in + field->offset;
+		uint16_t n, i;
+
+		switch (field->type)
+		{
+		case MT_FIELD_U8:
+		case MT_FIELD_U16:
+		case MT_FIELD_U32:
+		case MT_FIELD_U64:
+			n = codecScalarLen(field->type);
+			if (idx + n > maxLen)
+			{
+				return -1;
+			}
+			if (n == 1)
+			{
+				buf[idx] = *src;
+			}
+			else
+			{
+				codecPutLe(&buf[idx], src, n);
+			}
+			idx += n;
+			break;
+
+		case MT_FIELD_BYTES:
+			if (idx + field->maxCount > maxLen)
+			{
+				return -1;
+			}
+			memcpy(&buf[idx], src, field->maxCount);
+			idx += field->maxCount;
+			break;
+
+		case MT_FIELD_LIST_U8:
+		case MT_FIELD_LIST_U8_LEN16:
+		case MT_FIELD_LIST_U16:
+		case MT_FIELD_LIST:
+			n = codecListCount(field, in);
+			if (n > field->maxCount)
+			{
+				return -1;
+			}
+			if (field->type == MT_FIELD_LIST)
+			{
+				if (idx + n * field->elem->wireLen > maxLen)
+				{
+					return -1;
+				}
+				for (i = 0; i < n; i++)
+				{
+					idx += codecEncodeFields(field->elem,
+					        src + i * field->elem->size, &buf[idx],
+					        field->elem->wireLen);
+				}
+			}
+			else if ((field->type == MT_FIELD_LIST_U8)
+			        || (field->type == MT_FIELD_LIST_U8_LEN16))
+			{
+				if (idx + n > maxLen)
+				{
+					return -1;
+				}
+				memcpy(&buf[idx], src, n);
+				idx += n;
+			}
+			else
+			{
+				if (idx + n * 2 > maxLen)
+				{
+					return -1;
+				}
+#if MT_CODEC_HOST_LE
+				memcpy(&buf[idx], src, n * 2);
+				idx += n * 2;
+#else
+				for (i = 0; i < n; i++)
+				{
+					codecPutLe(&buf[idx], src + i * 2, 2);
+					idx += 2;
+				}
+#endif
+			}
+			break;
+
+		case MT_FIELD_OPTIONAL:
+			break;
+
+		default:
+			return -1;
+		}
+	}
+
+	return idx;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      mtDecode
+ *
+ * @brief   Unpack a received frame into its command structure.
+ *
+ * @param   desc - command layout
+ * @param   rpcBuff - frame starting at Cmd0, as passed to mtProcess()
+ * @param   rpcLen - frame length, Cmd0, Cmd1, payload and FCS
+ * @param   out - command structure to fill
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH if the payload does not match
+ *          the layout
+ */
+uint8_t mtDecode(const mtCmdDesc_t *desc, const uint8_t *rpcBuff,
+        uint8_t rpcLen, void *out)
+{
+	if ((rpcLen < MT_FRAME_OVERHEAD)
+	        || (codecDecodeFields(desc, &rpcBuff[RPC_CMD0_FIELD_LEN
+	                + RPC_CMD1_FIELD_LEN], rpcLen - MT_FRAME_OVERHEAD,
+	                (uint8_t *) out) < 0))
+	{
+		return mtMalformed(rpcBuff, rpcLen);
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      mtEncode
+ *
+ * @brief   Pack a command structure into its wire format.
+ *
+ * @param   desc - command layout
+ * @param   in - command structure
+ * @param   buf - destination
+ * @param   maxLen - size of buf
+ *
+ * @return  payload length, -1 if it does not fit
+ */
+int32_t mtEncode(const mtCmdDesc_t *desc, const void *in, uint8_t *buf,
+        uint16_t maxLen)
+{
+	return codecEncodeFields(desc, (const uint8_t *) in, buf, maxLen);
+}
+
+/*********************************************************************
+ * @fn      mtSendReq
+ *
+ * @brief   Pack a request straight into a TX frame and send it.
+ *
+ * @param   desc - request layout
+ * @param   cmd0 - command type and subsystem
+ * @param   cmd1 - command ID
+ * @param   req - request structure
+ *
+ * @return  status, MT_RPC_ERR_LENGTH if the request does not fit a frame
+ */
+uint8_t mtSendReq(const mtCmdDesc_t *desc, uint8_t cmd0, uint8_t cmd1,
+        const void *req)
+{
+	return mtSendReqCb(desc, cmd0, cmd1, req, 0, NULL, NULL);
+}
+
+/*********************************************************************
+ * @fn      mtSendReqCb
+ *
+ * @brief   mtSendReq() with a completion callback for the SRSP, see
+ *          rpcFrameSendCb().
+ *
+ * @param   desc - request layout
+ * @param   cmd0 - command type and subsystem
+ * @param   cmd1 - command ID
+ * @param   req - request structure
+ * @param   timeoutMs - SRSP timeout, 0 for the default
+ * @param   cb - SRSP callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  status, MT_RPC_ERR_LENGTH if the request does not fit a frame
+ */
+uint8_t mtSendReqCb(const mtCmdDesc_t *desc, uint8_t cmd0, uint8_t cmd1,
+        const void *req, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg)
+{
+	rpcFrame_t frame;
+	uint8_t *payload = rpcFrameInit(&frame, RPC_MAX_PAYLOAD_LEN);
+	int32_t len;
+
+	len = mtEncode(desc, req, payload, RPC_MAX_PAYLOAD_LEN);
+	if (len < 0)
+	{
+		LOG_ERR("Command %02X:%02X too long for a frame", cmd0, cmd1);
+		return MT_RPC_ERR_LENGTH;
+	}
+
+	return rpcFrameSendCb(&frame, cmd0, cmd1, len, timeoutMs, cb, cbArg);
+}
@@ -0,0 +1,122 @@
+/*
+ * mtCodec.h
+ *
+ * Table driven encoder and decoder for MT command payloads. A command is
+ * described once as a list of fields of its C structure, and the engine
+ * packs or unpacks the little endian wire format from that description.
+ */
+
+#ifndef MTCODEC_H
+#define MTCODEC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rpc.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef enum
+{
+	MT_FIELD_U8,        // uint8_t
+	MT_FIELD_U16,       // uint16_t, 2 bytes
+	MT_FIELD_U32,       // uint32_t, 4 bytes
+	MT_FIELD_U64,       // uint64_t, 8 bytes (IEEE addresses)
+	MT_FIELD_BYTES,     // uint8_t array, all of it on the wire
+	MT_FIELD_LIST_U8,   // uint8_t array, length in a previous uint8_t field
+	MT_FIELD_LIST_U8_LEN16, // uint8_t array, length in a previous uint16_t field
+	MT_FIELD_LIST_U16,  // uint16_t array, length in a previous uint8_t field
+	MT_FIELD_LIST,      // struct array, length in a previous uint8_t field
+	MT_FIELD_OPTIONAL   // decoding: the fields after it may be absent
+} mtFieldType_t;
+
+typedef struct mtCmdDesc mtCmdDesc_t;
+
+typedef struct
+{
+	uint8_t type;              // mtFieldType_t
+	uint16_t offset;           // offset of the field in the C structure
+	uint16_t maxCount;         // arrays: number of elements
+	uint16_t countOffset;      // lists: offset of the element count
+	const mtCmdDesc_t *elem;   // MT_FIELD_LIST: element layout
+} mtField_t;
+
+struct mtCmdDesc
+{
+	const mtField_t *fields;
+	uint8_t numFields;
+	uint16_t size;             // size of the C structure
+	uint8_t wireLen;           // list elements: bytes on the wire
+};
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define MT_FIELD_SIZE(type, f)     (sizeof(((type *) 0)->f))
+#define MT_FIELD_COUNT(type, f)    (MT_FIELD_SIZE(type, f) / \
+		                            sizeof(((type *) 0)->f[0]))
+
+// compile time check that a field has the size its type implies
+#define MT_CHECK_SIZE(size, n)     (0 * sizeof(char[((size) == (n)) ? 1 : -1]))
+
+#define MT_U8(type, f)     { MT_FIELD_U8 + MT_CHECK_SIZE(MT_FIELD_SIZE(type, f), 1), \
+		                     offsetof(type, f), 1, 0, NULL }
+#define MT_U16(type, f)    { MT_FIELD_U16 + MT_CHECK_SIZE(MT_FIELD_SIZE(type, f), 2), \
+		                     offsetof(type, f), 1, 0, NULL }
+#define MT_U32(type, f)    { MT_FIELD_U32 + MT_CHECK_SIZE(MT_FIELD_SIZE(type, f), 4), \
+		                     offsetof(type, f), 1, 0, NULL }
+#define MT_U64(type, f)    { MT_FIELD_U64 + MT_CHECK_SIZE(MT_FIELD_SIZE(type, f), 8), \
+		                     offsetof(type, f), 1, 0, NULL }
+#define MT_BYTES(type, f)  { MT_FIELD_BYTES + MT_CHECK_SIZE(sizeof(((type *) 0)->f[0]), 1), \
+		                     offsetof(type, f), MT_FIELD_SIZE(type, f), 0, NULL }
+#define MT_LIST_U8(type, f, cnt) \
+		{ MT_FIELD_LIST_U8 + MT_CHECK_SIZE(sizeof(((type *) 0)->f[0]), 1) \
+		        + MT_CHECK_SIZE(MT_FIELD_SIZE(type, cnt), 1), offsetof(type, f), \
+		        MT_FIELD_COUNT(type, f), offsetof(type, cnt), NULL }
+#define MT_LIST_U8_LEN16(type, f, cnt) \
+		{ MT_FIELD_LIST_U8_LEN16 + MT_CHECK_SIZE(sizeof(((type *) 0)->f[0]), 1) \
+		        + MT_CHECK_SIZE(MT_FIELD_SIZE(type, cnt), 2), offsetof(type, f), \
+		        MT_FIELD_COUNT(type, f), offsetof(type, cnt), NULL }
+#define MT_LIST_U16(type, f, cnt) \
+		{ MT_FIELD_LIST_U16 + MT_CHECK_SIZE(sizeof(((type *) 0)->f[0]), 2) \
+		        + MT_CHECK_SIZE(MT_FIELD_SIZE(type, cnt), 1), offsetof(type, f), \
+		        MT_FIELD_COUNT(type, f), offsetof(type, cnt), NULL }
+#define MT_LIST(type, f, cnt, elemDesc) \
+		{ MT_FIELD_LIST + MT_CHECK_SIZE(MT_FIELD_SIZE(type, cnt), 1), \
+		        offsetof(type, f), MT_FIELD_COUNT(type, f), offsetof(type, cnt), \
+		        &(elemDesc) }
+#define MT_OPTIONAL        { MT_FIELD_OPTIONAL, 0, 0, 0, NULL }
+
+// descriptor of a command structure
+#define MT_DESC(type, fieldTable) \
+		{ fieldTable, sizeof(fieldTable) / sizeof(mtField_t), sizeof(type), 0 }
+
+// descriptor of a list element, wireLen is its size on the wire
+#define MT_ELEM_DESC(type, fieldTable, wireLen) \
+		{ fieldTable, sizeof(fieldTable) / sizeof(mtField_t), sizeof(type), wireLen }
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+uint8_t mtDecode(const mtCmdDesc_t *desc, const uint8_t *rpcBuff,
+        uint8_t rpcLen, void *out);
+int32_t mtEncode(const mtCmdDesc_t *desc, const void *in, uint8_t *buf,
+        uint16_t maxLen);
+uint8_t mtSendReq(const mtCmdDesc_t *desc, uint8_t cmd0, uint8_t cmd1,
+        const void *req);
+uint8_t mtSendReqCb(const mtCmdDesc_t *desc, uint8_t cmd0, uint8_t cmd1,
+        const void *req, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MTCODEC_H */
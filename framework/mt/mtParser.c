@@ -42,6 +42,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "mtParser.h"
 #include "rpc.h"
@@ -58,16 +60,179 @@
  * MACROS
  */
 
+#define MT_HANDLER_SUBSYS_COUNT    (MT_RPC_SUBSYSTEM_MASK + 1)
+
+// row of the handler table for a frame type, SRSP or AREQ
+#define MT_HANDLER_ROW(cmd0) \
+		((((cmd0) & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP) ? 1 : 0)
+
+// why an AREQ is wanted, see mtIsWanted()
+#define MT_INTEREST_HANDLER   0x01   // handler without callback, or the app's
+#define MT_INTEREST_CB        0x02   // module callback registered
+#define MT_INTEREST_SUB       0x04   // mtSubscribe() subscribers
+#define MT_INTEREST_HOOK      0x08   // framework module fed by the handler
+
+#define MT_SUBSCRIBERS_MAX    32
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 uint8_t srspRpcBuff[RPC_MAX_LEN];
 uint8_t srspRpcLen;
 
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// [AREQ/SRSP][subsystem][cmd1], filled with the module tables on first use
+static _Atomic(mtHandler_t) mtHandlers[2][MT_HANDLER_SUBSYS_COUNT][256];
+static pthread_once_t mtHandlersOnce = PTHREAD_ONCE_INIT;
+
+// [subsystem][cmd1] MT_INTEREST_xxx of the AREQs, 0 drops them unqueued
+static _Atomic uint8_t mtInterest[MT_HANDLER_SUBSYS_COUNT][256];
+// [subsystem][cmd1] modules wanting the AREQs, see mtSetWanted()
+static uint8_t mtHooks[MT_HANDLER_SUBSYS_COUNT][256];
+
+typedef struct
+{
+	mtMsgCb_t cb;            // NULL for a free entry
+	void *cbArg;
+	uint8_t subsys;
+	uint8_t cmd1;
+} mtSubscriber_t;
+
+static mtSubscriber_t mtSubscribers[MT_SUBSCRIBERS_MAX];
+
+static _Atomic uint32_t mtMalformedCount;
+// Cmd0 << 8 | Cmd1 of the latest malformed frame
+static _Atomic uint16_t mtMalformedLast;
+static pthread_mutex_t mtSubscribersLock = PTHREAD_MUTEX_INITIALIZER;
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
 
+/*********************************************************************
+ * @fn      mtSetHandlers
+ *
+ * @brief   Install a handler table in a subsystem.
+ */
+static void mtSetHandlers(uint8_t subsys, const mtHandlerEntry_t *table)
+{
+	const mtHandlerEntry_t *e;
+
+	subsys &= MT_RPC_SUBSYSTEM_MASK;
+	for (e = table; e->handler; e++)
+	{
+		atomic_store_explicit(&mtHandlers[MT_HANDLER_ROW(e->type)][subsys]
+		        [e->cmd1], e->handler, memory_order_release);
+		if ((e->type == MT_RPC_CMD_AREQ) && (e->cbOffset == 0))
+		{
+			atomic_fetch_or(&mtInterest[subsys][e->cmd1], MT_INTEREST_HANDLER);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      mtNotifySubscribers
+ *
+ * @brief   Pass an AREQ to its mtSubscribe() subscribers. They are copied
+ *          out of the lock so that they can unsubscribe from the callback.
+ */
+static void mtNotifySubscribers(uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	mtSubscriber_t match[MT_SUBSCRIBERS_MAX];
+	uint8_t subsys = rpcBuff[0] & MT_RPC_SUBSYSTEM_MASK;
+	uint8_t count = 0;
+	uint8_t i;
+
+	pthread_mutex_lock(&mtSubscribersLock);
+	for (i = 0; i < MT_SUBSCRIBERS_MAX; i++)
+	{
+		if (mtSubscribers[i].cb && (mtSubscribers[i].subsys == subsys)
+		        && (mtSubscribers[i].cmd1 == rpcBuff[1]))
+		{
+			match[count++] = mtSubscribers[i];
+		}
+	}
+	pthread_mutex_unlock(&mtSubscribersLock);
+
+	for (i = 0; i < count; i++)
+	{
+		match[i].cb(rpcBuff, rpcLen, match[i].cbArg);
+	}
+}
+
+/*********************************************************************
+ * @fn      mtInitHandlers
+ *
+ * @brief   Install the handlers of the framework modules.
+ */
+static void mtInitHandlers(void)
+{
+	mtSetHandlers(MT_RPC_SYS_SYS, sysHandlerTable);
+	mtSetHandlers(MT_RPC_SYS_AF, afHandlerTable);
+	mtSetHandlers(MT_RPC_SYS_ZDO, zdoHandlerTable);
+	mtSetHandlers(MT_RPC_SYS_SAPI, sapiHandlerTable);
+	mtSetHandlers(MT_RPC_SYS_UTIL, utilHandlerTable);
+}
+
+/*********************************************************************
+ * @fn      mtModuleTable
+ *
+ * @brief   Handler table of the framework module of a subsystem.
+ *
+ * @return  the table, NULL if the subsystem has no module
+ */
+static const mtHandlerEntry_t *mtModuleTable(uint8_t subsys)
+{
+	switch (subsys)
+	{
+	case MT_RPC_SYS_SYS:
+		return sysHandlerTable;
+	case MT_RPC_SYS_AF:
+		return afHandlerTable;
+	case MT_RPC_SYS_ZDO:
+		return zdoHandlerTable;
+	case MT_RPC_SYS_SAPI:
+		return sapiHandlerTable;
+	case MT_RPC_SYS_UTIL:
+		return utilHandlerTable;
+	default:
+		return NULL;
+	}
+}
+
+/*********************************************************************
+ * @fn      mtHandlerInterest
+ *
+ * @brief   MT_INTEREST_HANDLER if an AREQ handler uses its frames by
+ *          itself. A framework handler put back in place reports to the
+ *          module callbacks, its interest is MT_INTEREST_CB.
+ *
+ * @return  MT_INTEREST_HANDLER or 0
+ */
+static uint8_t mtHandlerInterest(uint8_t subsys, uint8_t cmd1,
+        mtHandler_t handler)
+{
+	const mtHandlerEntry_t *e = mtModuleTable(subsys);
+
+	if (!handler)
+	{
+		return 0;
+	}
+	for (; e && e->handler; e++)
+	{
+		if ((e->type == MT_RPC_CMD_AREQ) && (e->cmd1 == cmd1)
+		        && (e->handler == handler))
+		{
+			return (e->cbOffset == 0) ? MT_INTEREST_HANDLER : 0;
+		}
+	}
+
+	return MT_INTEREST_HANDLER;
+}
+
 /*********************************************************************
  * API FUNCTIONS
  */
@@ -75,35 +240,370 @@ uint8_t srspRpcLen;
 /*************************************************************************************************
  * @fn      mtProcess()
  *
- * @brief   read and process the RPC mt message from the ZB SoC
+ * @brief   process a RPC mt message from the ZB SoC: looks up the
+ *          handler of its type, subsystem and command in the dispatch table
  *
- * @param   none
+ * @param   rpcBuff - Cmd0, Cmd1 and payload of the frame
+ * @param   rpcLen - Cmd0 + Cmd1 + payload + FCS
  *
- * @return  length of current Rx Buffer
+ * @return  none
  *************************************************************************************************/
 void mtProcess(uint8_t *rpcBuff, uint8_t rpcLen)
 {
-    //Read CMD0
-    switch (rpcBuff[0] & MT_RPC_SUBSYSTEM_MASK)
-    {
-        case MT_RPC_SYS_ZDO:
-            zdoProcess(rpcBuff, rpcLen);
-            break;
-        case MT_RPC_SYS_SYS:
-            sysProcess(rpcBuff, rpcLen);
-            break;
-        case MT_RPC_SYS_AF:
-            afProcess(rpcBuff, rpcLen);
-            break;
-        case MT_RPC_SYS_SAPI:
-            sapiProcess(rpcBuff, rpcLen);
-            break;
-        case MT_RPC_SYS_UTIL:
-            utilProcess(rpcBuff, rpcLen);
-            break;
-        default:
-            LOG_DBG("CMD0:%x, CMD1:%x, not handled", rpcBuff[0], rpcBuff[1]);
-            break;
-    }
+	uint8_t row = MT_HANDLER_ROW(rpcBuff[0]);
+	mtHandler_t handler;
+
+	pthread_once(&mtHandlersOnce, mtInitHandlers);
+
+	LOG_DBG("CMD0:%x, CMD1:%x", rpcBuff[0], rpcBuff[1]);
+	if (row)
+	{
+		//copies sresp to local buffer
+		memcpy(srspRpcBuff, rpcBuff, rpcLen);
+	}
+
+	handler = atomic_load_explicit(&mtHandlers[row]
+	        [rpcBuff[0] & MT_RPC_SUBSYSTEM_MASK][rpcBuff[1]],
+	        memory_order_acquire);
+	if (handler)
+	{
+		handler(rpcBuff, rpcLen);
+	}
+
+	if (!row && (atomic_load_explicit(&mtInterest[rpcBuff[0]
+	        & MT_RPC_SUBSYSTEM_MASK][rpcBuff[1]], memory_order_relaxed)
+	        & MT_INTEREST_SUB))
+	{
+		mtNotifySubscribers(rpcBuff, rpcLen);
+	}
+	else if (!handler)
+	{
+		LOG_WARN("CMD0:%x, CMD1:%x, not handled", rpcBuff[0], rpcBuff[1]);
+	}
+}
+
+/*********************************************************************
+ * @fn      mtRegisterHandler
+ *
+ * @brief   Install the handler of one incoming command, replacing the
+ *          framework one if any. Use it to handle commands the framework
+ *          does not know or to take over a frequent one. Putting back
+ *          the previous handler restores the framework behaviour, its
+ *          AREQs are queued again only for the registered callbacks.
+ *
+ * @param   cmd0 - MT_RPC_CMD_AREQ or MT_RPC_CMD_SRSP | subsystem
+ * @param   cmd1 - command ID
+ * @param   handler - called with the frame, NULL to remove the handler
+ *
+ * @return  the previous handler
+ */
+mtHandler_t mtRegisterHandler(uint8_t cmd0, uint8_t cmd1, mtHandler_t handler)
+{
+	uint8_t subsys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+
+	pthread_once(&mtHandlersOnce, mtInitHandlers);
+
+	if (!MT_HANDLER_ROW(cmd0))
+	{
+		if (mtHandlerInterest(subsys, cmd1, handler))
+		{
+			atomic_fetch_or(&mtInterest[subsys][cmd1], MT_INTEREST_HANDLER);
+		}
+		else
+		{
+			atomic_fetch_and(&mtInterest[subsys][cmd1],
+			        (uint8_t) ~MT_INTEREST_HANDLER);
+		}
+	}
+
+	return atomic_exchange(&mtHandlers[MT_HANDLER_ROW(cmd0)][subsys][cmd1],
+	        handler);
+}
+
+/*********************************************************************
+ * @fn      mtRegisterHandlers
+ *
+ * @brief   Install a table of handlers in a subsystem, see
+ *          mtRegisterHandler().
+ *
+ * @param   subsys - MT_RPC_SYS_xxx
+ * @param   table - handlers, ended by an entry with a NULL handler
+ *
+ * @return  none
+ */
+void mtRegisterHandlers(uint8_t subsys, const mtHandlerEntry_t *table)
+{
+	pthread_once(&mtHandlersOnce, mtInitHandlers);
+
+	mtSetHandlers(subsys, table);
+}
+
+/*********************************************************************
+ * @fn      mtUpdateInterest
+ *
+ * @brief   Called by the modules when their callbacks change: the AREQs
+ *          of the handlers whose callback is not registered stop being
+ *          queued, unless they have subscribers.
+ *
+ * @param   subsys - MT_RPC_SYS_xxx
+ * @param   table - handler table of the subsystem
+ * @param   cbs - callback structure the cbOffset of the entries refer to
+ *
+ * @return  none
+ */
+void mtUpdateInterest(uint8_t subsys, const mtHandlerEntry_t *table,
+        const void *cbs)
+{
+	// a handler reporting to several callbacks has an entry per callback
+	uint8_t state[256] = { 0 }; // 1: no callback registered, 2: one is
+	const mtHandlerEntry_t *e;
+	uint16_t cmd1;
+
+	subsys &= MT_RPC_SUBSYSTEM_MASK;
+	for (e = table; e->handler; e++)
+	{
+		void (*cb)(void);
+
+		if ((e->type != MT_RPC_CMD_AREQ) || (e->cbOffset == 0))
+		{
+			continue;
+		}
+
+		memcpy(&cb, (const uint8_t *) cbs + e->cbOffset - 1, sizeof(cb));
+		if (cb)
+		{
+			state[e->cmd1] = 2;
+		}
+		else if (state[e->cmd1] == 0)
+		{
+			state[e->cmd1] = 1;
+		}
+	}
+
+	for (cmd1 = 0; cmd1 < 256; cmd1++)
+	{
+		if (state[cmd1] == 2)
+		{
+			atomic_fetch_or(&mtInterest[subsys][cmd1], MT_INTEREST_CB);
+		}
+		else if (state[cmd1] == 1)
+		{
+			atomic_fetch_and(&mtInterest[subsys][cmd1],
+			        (uint8_t) ~MT_INTEREST_CB);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      mtIsWanted
+ *
+ * @brief   Tell whether an AREQ has a handler that uses it or subscribers.
+ *          The RPC layer drops the others before queueing them.
+ *
+ * @param   cmd0 - Cmd0 of the frame
+ * @param   cmd1 - Cmd1 of the frame
+ *
+ * @return  1 if the frame is wanted
+ */
+uint8_t mtIsWanted(uint8_t cmd0, uint8_t cmd1)
+{
+	pthread_once(&mtHandlersOnce, mtInitHandlers);
+
+	return atomic_load_explicit(&mtInterest[cmd0 & MT_RPC_SUBSYSTEM_MASK][cmd1],
+	        memory_order_relaxed) != 0;
+}
+
+/*********************************************************************
+ * @fn      mtSetWanted
+ *
+ * @brief   Keep an AREQ queued without any callback registered, for a
+ *          framework module fed by its handler, see zdoAddrEnable().
+ *          Several modules may want the same AREQ, each call with wanted
+ *          set must be undone by one with wanted cleared.
+ *
+ * @param   cmd0 - Cmd0 of the AREQ
+ * @param   cmd1 - command ID
+ * @param   wanted - 1 to add a module wanting it, 0 to remove one
+ */
+void mtSetWanted(uint8_t cmd0, uint8_t cmd1, uint8_t wanted)
+{
+	uint8_t subsys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+
+	pthread_once(&mtHandlersOnce, mtInitHandlers);
+
+	pthread_mutex_lock(&mtSubscribersLock);
+	if (wanted)
+	{
+		mtHooks[subsys][cmd1]++;
+		atomic_fetch_or(&mtInterest[subsys][cmd1], MT_INTEREST_HOOK);
+	}
+	else if (mtHooks[subsys][cmd1] && (--mtHooks[subsys][cmd1] == 0))
+	{
+		atomic_fetch_and(&mtInterest[subsys][cmd1],
+		        (uint8_t) ~MT_INTEREST_HOOK);
+	}
+	pthread_mutex_unlock(&mtSubscribersLock);
+}
+
+/*********************************************************************
+ * @fn      mtSubscribe
+ *
+ * @brief   Subscribe to an AREQ. Any number of subscribers may share a
+ *          command, they are called after the framework handler with the
+ *          raw frame.
+ *
+ * @param   subsys - MT_RPC_SYS_xxx
+ * @param   cmd1 - command ID
+ * @param   cb - subscriber
+ * @param   cbArg - passed back to cb
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if cb is NULL,
+ *          MT_RPC_ERR_BUSY if MT_SUBSCRIBERS_MAX are already registered
+ */
+uint8_t mtSubscribe(uint8_t subsys, uint8_t cmd1, mtMsgCb_t cb, void *cbArg)
+{
+	uint8_t i;
+
+	if (cb == NULL)
+	{
+		return MT_RPC_ERR_PARAMETER;
+	}
+
+	subsys &= MT_RPC_SUBSYSTEM_MASK;
+	pthread_mutex_lock(&mtSubscribersLock);
+	for (i = 0; i < MT_SUBSCRIBERS_MAX; i++)
+	{
+		if (mtSubscribers[i].cb == NULL)
+		{
+			mtSubscribers[i].cb = cb;
+			mtSubscribers[i].cbArg = cbArg;
+			mtSubscribers[i].subsys = subsys;
+			mtSubscribers[i].cmd1 = cmd1;
+			atomic_fetch_or(&mtInterest[subsys][cmd1], MT_INTEREST_SUB);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mtSubscribersLock);
+
+	if (i == MT_SUBSCRIBERS_MAX)
+	{
+		LOG_ERR("No room for a subscriber to %02X:%02X", subsys, cmd1);
+		return MT_RPC_ERR_BUSY;
+	}
+
+	return MT_RPC_SUCCESS;
+}
+
+/*********************************************************************
+ * @fn      mtUnsubscribe
+ *
+ * @brief   Remove a subscriber added by mtSubscribe(). Once a command has
+ *          no subscriber and no callback left, its AREQs are dropped
+ *          before being queued.
+ *
+ * @param   subsys - MT_RPC_SYS_xxx
+ * @param   cmd1 - command ID
+ * @param   cb - subscriber
+ * @param   cbArg - as given to mtSubscribe()
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_PARAMETER if it is not subscribed
+ */
+uint8_t mtUnsubscribe(uint8_t subsys, uint8_t cmd1, mtMsgCb_t cb, void *cbArg)
+{
+	uint8_t status = MT_RPC_ERR_PARAMETER;
+	uint8_t others = 0;
+	uint8_t i;
+
+	subsys &= MT_RPC_SUBSYSTEM_MASK;
+	pthread_mutex_lock(&mtSubscribersLock);
+	for (i = 0; i < MT_SUBSCRIBERS_MAX; i++)
+	{
+		if ((mtSubscribers[i].cb == NULL) || (mtSubscribers[i].subsys != subsys)
+		        || (mtSubscribers[i].cmd1 != cmd1))
+		{
+			continue;
+		}
+
+		if ((status != MT_RPC_SUCCESS) && (mtSubscribers[i].cb == cb)
+		        && (mtSubscribers[i].cbArg == cbArg))
+		{
+			mtSubscribers[i].cb = NULL;
+			status = MT_RPC_SUCCESS;
+		}
+		else
+		{
+			others++;
+		}
+	}
+	if (!others)
+	{
+		atomic_fetch_and(&mtInterest[subsys][cmd1], (uint8_t) ~MT_INTEREST_SUB);
+	}
+	pthread_mutex_unlock(&mtSubscribersLock);
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      mtDecodeStatusSrsp
+ *
+ * @brief   Parses an SRSP made of a status byte only. SRSPs with no
+ *          payload at all are reported as a success.
+ *
+ * @param   rpcBuff - Cmd0, Cmd1 and payload of the SRSP
+ * @param   rpcLen - Cmd0 + Cmd1 + payload + FCS
+ * @param   rsp - Decoded response.
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_LENGTH for a truncated frame
+ */
+uint8_t mtDecodeStatusSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        StatusSrspFormat_t *rsp)
+{
+	if (rpcLen < MT_FRAME_OVERHEAD)
+	{
+		return mtMalformed(rpcBuff, rpcLen);
+	}
+
+	rsp->Status = (rpcLen > MT_FRAME_OVERHEAD) ? rpcBuff[2] : MT_RPC_SUCCESS;
+	return MT_RPC_SUCCESS;
 }
 
+/*********************************************************************
+ * @fn      mtMalformed
+ *
+ * @brief   Count a frame too short for its fields, the slow path of
+ *          MT_CHECK_LEN(). The frame is dropped by its decoder.
+ *
+ * @param   rpcBuff - Cmd0, Cmd1 and payload of the frame
+ * @param   rpcLen - Cmd0 + Cmd1 + payload + FCS
+ *
+ * @return  MT_RPC_ERR_LENGTH
+ */
+uint8_t mtMalformed(const uint8_t *rpcBuff, uint8_t rpcLen)
+{
+	atomic_fetch_add_explicit(&mtMalformedCount, 1, memory_order_relaxed);
+	atomic_store_explicit(&mtMalformedLast,
+	        (uint16_t) ((rpcBuff[0] << 8) | rpcBuff[1]), memory_order_relaxed);
+	LOG_WARN("MT_RPC_ERR_LENGTH %02X:%02X, %d bytes", rpcBuff[0], rpcBuff[1],
+	        rpcLen);
+
+	return MT_RPC_ERR_LENGTH;
+}
+
+/*********************************************************************
+ * @fn      mtGetStats
+ *
+ * @brief   Counters of the MT layer since start.
+ *
+ * @param   stats - filled with the counters
+ */
+void mtGetStats(mtStats_t *stats)
+{
+	uint16_t last = atomic_load_explicit(&mtMalformedLast,
+	        memory_order_relaxed);
+
+	stats->malformed = atomic_load_explicit(&mtMalformedCount,
+	        memory_order_relaxed);
+	stats->lastCmd0 = (uint8_t) (last >> 8);
+	stats->lastCmd1 = (uint8_t) last;
+}
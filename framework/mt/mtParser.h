@@ -44,6 +44,7 @@ extern "C"
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
 #include "rpc.h"
 
 ////MT SYS Commands
@@ -58,8 +59,112 @@ extern "C"
           + ((uint32_t)((Byte2) & 0x00FF) << 16) \
           + ((uint32_t)((Byte3) & 0x00FF) << 24)))
 
+// Cmd0, Cmd1 and FCS around the payload of a frame passed to a handler
+#define MT_FRAME_OVERHEAD    (RPC_CMD0_FIELD_LEN + RPC_CMD1_FIELD_LEN + \
+		                      RPC_UART_FCS_LEN)
+
+// MT_RPC_SUCCESS if the frame carries at least payloadLen bytes of payload,
+// else MT_RPC_ERR_LENGTH after counting it as malformed. Decoders compute
+// the size their fields need up front and check it once, a single compare
+// when the frame is well formed.
+#define MT_CHECK_LEN(rpcBuff, rpcLen, payloadLen) \
+		(((uint32_t) (rpcLen) >= (uint32_t) (payloadLen) + MT_FRAME_OVERHEAD) ? \
+		        MT_RPC_SUCCESS : mtMalformed(rpcBuff, rpcLen))
+
+// handler of an incoming frame, rpcBuff starts at Cmd0 and rpcLen counts
+// Cmd0, Cmd1, the payload and the FCS
+typedef void (*mtHandler_t)(uint8_t *rpcBuff, uint8_t rpcLen);
+
+// entry of a subsystem handler table, type is MT_RPC_CMD_AREQ or
+// MT_RPC_CMD_SRSP. Tables end with an entry whose handler is NULL.
+// cbOffset is MT_CB() of the callback an AREQ handler reports to: the AREQ
+// is only queued while that callback is registered. 0 queues it always.
+// A handler reporting to several callbacks has an entry for each of them.
+typedef struct
+{
+	uint8_t type;
+	uint8_t cmd1;
+	mtHandler_t handler;
+	uint16_t cbOffset;
+} mtHandlerEntry_t;
+
+#define MT_CB(cbType, f)    (offsetof(cbType, f) + 1)
+
+// subscriber of an AREQ, rpcBuff starts at Cmd0 as for mtHandler_t
+typedef void (*mtMsgCb_t)(uint8_t *rpcBuff, uint8_t rpcLen, void *cbArg);
+
+typedef struct
+{
+	uint32_t malformed;      // frames too short for their fields, dropped
+	uint8_t lastCmd0;        // Cmd0 and Cmd1 of the latest malformed frame
+	uint8_t lastCmd1;
+} mtStats_t;
+
+// SRSP carrying only a status byte
+typedef struct
+{
+	uint8_t Status;
+} StatusSrspFormat_t;
+
+// Defines fn##Sync(req, rsp, timeoutMs) for the SREQ builder fn: the SREQ
+// is sent synchronously, see rpcSyncArm(), and the SRSP decoded with
+// decodeFn(rpcBuff, rpcLen, rsp). A truncated SRSP fails with
+// MT_RPC_ERR_LENGTH.
+#define MT_SYNC_REQ(fn, reqType, rspType, decodeFn) \
+uint8_t fn##Sync(reqType *req, rspType *rsp, uint32_t timeoutMs) \
+{ \
+	rpcSync_t sync; \
+	uint8_t status; \
+	rpcSyncArm(&sync, timeoutMs); \
+	status = fn(req); \
+	if (status != MT_RPC_SUCCESS) \
+	{ \
+		rpcSyncArm(NULL, 0); \
+		return status; \
+	} \
+	status = rpcSyncWait(&sync); \
+	if (status == MT_RPC_SUCCESS) \
+	{ \
+		status = decodeFn(sync.srsp, sync.srspLen, rsp); \
+	} \
+	return status; \
+}
+
+// Same as MT_SYNC_REQ for SREQs without parameters
+#define MT_SYNC_REQ_VOID(fn, rspType, decodeFn) \
+uint8_t fn##Sync(rspType *rsp, uint32_t timeoutMs) \
+{ \
+	rpcSync_t sync; \
+	uint8_t status; \
+	rpcSyncArm(&sync, timeoutMs); \
+	status = fn(); \
+	if (status != MT_RPC_SUCCESS) \
+	{ \
+		rpcSyncArm(NULL, 0); \
+		return status; \
+	} \
+	status = rpcSyncWait(&sync); \
+	if (status == MT_RPC_SUCCESS) \
+	{ \
+		status = decodeFn(sync.srsp, sync.srspLen, rsp); \
+	} \
+	return status; \
+}
+
 void zbSendMtFrame(uint8_t cmd0, uint8_t cmd1, uint8_t * payload, uint8_t payload_len);
 void mtProcess(uint8_t *rpcBuff, uint8_t rpcLen);
+mtHandler_t mtRegisterHandler(uint8_t cmd0, uint8_t cmd1, mtHandler_t handler);
+void mtRegisterHandlers(uint8_t subsys, const mtHandlerEntry_t *table);
+void mtUpdateInterest(uint8_t subsys, const mtHandlerEntry_t *table,
+        const void *cbs);
+uint8_t mtIsWanted(uint8_t cmd0, uint8_t cmd1);
+void mtSetWanted(uint8_t cmd0, uint8_t cmd1, uint8_t wanted);
+uint8_t mtSubscribe(uint8_t subsys, uint8_t cmd1, mtMsgCb_t cb, void *cbArg);
+uint8_t mtUnsubscribe(uint8_t subsys, uint8_t cmd1, mtMsgCb_t cb, void *cbArg);
+uint8_t mtDecodeStatusSrsp(uint8_t *rpcBuff, uint8_t rpcLen,
+        StatusSrspFormat_t *rsp);
+uint8_t mtMalformed(const uint8_t *rpcBuff, uint8_t rpcLen);
+void mtGetStats(mtStats_t *stats);
 
 #ifdef __cplusplus
 }
@@ -39,6 +39,8 @@
 //Include the correct transport layer
 #if HAL_UART_IP
 #include "rpcTransportIp.c"
+#elif HAL_UART_SIM
+#include "rpcTransportSim.c"
 #elif (!HAL_UART_SPI)
 #include "rpcTransportUart.c"
 #else
@@ -50,8 +50,9 @@ extern "C"
 // ZigBee Soc API
 int32_t rpcTransportOpen(char *devicePath);
 void rpcTransportClose(void);
-void rpcTransportWrite(uint8_t* buf, uint8_t len);
-uint8_t rpcTransportRead(uint8_t* buf, uint8_t len);
+int32_t rpcTransportWrite(uint8_t* buf, uint8_t len);
+void rpcTransportSetPacing(uint8_t chunkLen, uint32_t gapUs);
+int32_t rpcTransportRead(uint8_t* buf, uint16_t len);
 uint8_t rpcTransportPoll(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,1074 @@
+/*
+ * rpcTransportSim.c
+ *
+ * This module contains a simulated ZNP behind the RPC transport API. The
+ * host side gets one end of a socket pair, so select/poll on the returned
+ * fd work as with a tty, and a device thread on the other end answers
+ * SREQs with SRSPs and emits scripted AREQs. SRSP latency and the link
+ * baud rate can be configured to model a real dongle.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "rpc.h"
+#include "mtParser.h"
+#include "rpcTransportSim.h"
+#include "mtSys.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+#include "mtSapi.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+#define SIM_MAX_EVENTS             (256)
+#define SIM_MAX_FRAME_LEN          (RPC_MAX_LEN + RPC_UART_HDR_LEN + \
+                                    RPC_UART_FCS_LEN)
+#define SIM_NV_ITEMS               (32)
+#define SIM_NV_ITEM_LEN            (128)
+
+// AF_DATA_REQUEST_EXT huge buffer, filled by AF_DATA_STORE
+#define SIM_HUGE_MAX_LEN           (8192)
+// AF_INCOMING_MSG_EXT data kept for AF_DATA_RETRIEVE
+#define SIM_INCOMING_BUFS          (4)
+
+#define SIM_HOST_FD                (0)
+#define SIM_DEV_FD                 (1)
+
+/************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+	uint64_t dueUs;
+	uint16_t len;
+	uint8_t buf[SIM_MAX_FRAME_LEN];
+} simEvent_t;
+
+typedef struct
+{
+	uint8_t active;      // request received, waiting for its data
+	uint8_t confirm;     // zero length store accepted, confirm to send
+	uint8_t endpoint;
+	uint8_t transId;
+	uint16_t len;
+	uint16_t stored;     // bytes written by AF_DATA_STORE
+	uint8_t data[SIM_HUGE_MAX_LEN];
+} simHuge_t;
+
+typedef struct
+{
+	uint8_t used;
+	uint32_t timeStamp;  // identifies the buffer in AF_DATA_RETRIEVE
+	uint16_t len;
+	uint8_t data[SIM_HUGE_MAX_LEN];
+} simIncoming_t;
+
+typedef struct
+{
+	uint16_t id;
+	uint8_t len;
+	uint8_t used;
+	uint8_t data[SIM_NV_ITEM_LEN];
+} simNvItem_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+uint8_t uartDebugPrintsEnabled = 0;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static int simFds[2] = { -1, -1 };
+static int simWakeFds[2] = { -1, -1 };
+static pthread_t simThread;
+static volatile int simRunning;
+static pthread_mutex_t simLock = PTHREAD_MUTEX_INITIALIZER;
+
+static rpcSimConfig_t simCfg;
+static rpcSimStats_t simStats;
+static rpcSimSrspHandler_t simSrspHandler;
+
+// events sorted by due time, simEvents[0] is the next to be sent
+static simEvent_t simEvents[SIM_MAX_EVENTS];
+static uint16_t simEventCnt;
+static uint64_t simLinkFreeUs;
+
+static simNvItem_t simNv[SIM_NV_ITEMS];
+static simHuge_t simHuge;
+static simIncoming_t simIncoming[SIM_INCOMING_BUFS];
+static uint32_t simTimeStamp;
+
+// partial frame received from the host
+static uint8_t simRxBuf[SIM_MAX_FRAME_LEN * 2];
+static uint16_t simRxLen;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint64_t simNowUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static uint8_t simFcs(const uint8_t *msg, uint16_t size)
+{
+	uint8_t result = 0;
+
+	while (size--)
+	{
+		result ^= *msg++;
+	}
+
+	return result;
+}
+
+static void simWake(void)
+{
+	uint8_t b = 0;
+
+	if (write(simWakeFds[1], &b, 1) < 0)
+	{
+		// pipe full, the device thread is already due to wake up
+	}
+}
+
+/*********************************************************************
+ * @fn      simQueue
+ *
+ * @brief   Schedule bytes to be sent to the host. When a baud rate is
+ *          configured the send time is pushed back so consecutive frames
+ *          never exceed the link rate. Called with simLock held.
+ *
+ * @param   buf - bytes to send
+ * @param   len - number of bytes
+ * @param   delayUs - delay from now before the bytes are sent
+ *
+ * @return  0 on success, -1 if the event table is full
+ */
+static int32_t simQueue(const uint8_t *buf, uint16_t len, uint32_t delayUs)
+{
+	uint64_t due = simNowUs() + delayUs;
+	uint16_t idx;
+
+	if ((simEventCnt >= SIM_MAX_EVENTS) || (len > SIM_MAX_FRAME_LEN))
+	{
+		simStats.eventOverflows++;
+		return -1;
+	}
+
+	if (simCfg.baudRate)
+	{
+		if (due < simLinkFreeUs)
+		{
+			due = simLinkFreeUs;
+		}
+		// the last byte reaches the host one frame time later
+		due += ((uint64_t) len * 10 * 1000000) / simCfg.baudRate;
+		simLinkFreeUs = due;
+	}
+
+	// insertion keeps the table sorted, equal times stay in FIFO order
+	idx = simEventCnt;
+	while ((idx > 0) && (simEvents[idx - 1].dueUs > due))
+	{
+		simEvents[idx] = simEvents[idx - 1];
+		idx--;
+	}
+	simEvents[idx].dueUs = due;
+	simEvents[idx].len = len;
+	memcpy(simEvents[idx].buf, buf, len);
+	simEventCnt++;
+
+	return 0;
+}
+
+static int32_t simQueueFrame(uint8_t cmd0, uint8_t cmd1,
+        const uint8_t *payload, uint8_t len, uint32_t delayUs)
+{
+	uint8_t frame[SIM_MAX_FRAME_LEN];
+
+	frame[0] = MT_RPC_SOF;
+	frame[1] = len;
+	frame[2] = cmd0;
+	frame[3] = cmd1;
+	if (len > 0)
+	{
+		memcpy(&frame[RPC_UART_HDR_LEN], payload, len);
+	}
+	frame[RPC_UART_HDR_LEN + len] = simFcs(&frame[1], RPC_HDR_LEN + len);
+
+	return simQueue(frame, RPC_UART_HDR_LEN + len + RPC_UART_FCS_LEN,
+	        delayUs);
+}
+
+static simNvItem_t *simNvFind(uint16_t id, uint8_t create)
+{
+	uint8_t i;
+
+	for (i = 0; i < SIM_NV_ITEMS; i++)
+	{
+		if (simNv[i].used && (simNv[i].id == id))
+		{
+			return &simNv[i];
+		}
+	}
+	if (create)
+	{
+		for (i = 0; i < SIM_NV_ITEMS; i++)
+		{
+			if (!simNv[i].used)
+			{
+				simNv[i].used = 1;
+				simNv[i].id = id;
+				simNv[i].len = 0;
+				return &simNv[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+/*********************************************************************
+ * @fn      simDefaultSrsp
+ *
+ * @brief   Built-in SRSP payloads. Commands not listed here get a single
+ *          success status byte, which is what most SREQs return.
+ *
+ * @return  SRSP payload length
+ */
+static int32_t simDefaultSrsp(uint8_t subSys, uint8_t cmd1, const uint8_t *req,
+        uint8_t reqLen, uint8_t *rsp)
+{
+	simNvItem_t *item;
+	uint16_t id;
+	uint8_t len;
+
+	rsp[0] = MT_RPC_SUCCESS;
+
+	if (subSys == MT_RPC_SYS_SYS)
+	{
+		switch (cmd1)
+		{
+		case MT_SYS_PING:
+			// capabilities: SYS, AF, ZDO, SAPI, UTIL
+			rsp[0] = 0x79;
+			rsp[1] = 0x00;
+			return 2;
+		case MT_SYS_VERSION:
+			rsp[0] = 2; // transport revision
+			rsp[1] = 0; // product
+			rsp[2] = 2; // major
+			rsp[3] = 6; // minor
+			rsp[4] = 3; // maintenance
+			return 5;
+		case MT_SYS_GET_EXTADDR:
+			for (len = 0; len < 8; len++)
+			{
+				rsp[len] = 0x11 * (len + 1);
+			}
+			return 8;
+		case MT_SYS_RANDOM:
+			rsp[0] = (uint8_t) rand();
+			rsp[1] = (uint8_t) rand();
+			return 2;
+		case MT_SYS_OSAL_NV_WRITE:
+		case MT_SYS_OSAL_NV_ITEM_INIT:
+			if (reqLen < 4)
+			{
+				rsp[0] = MT_RPC_ERR_LENGTH;
+				return 1;
+			}
+			id = BUILD_UINT16(req[0], req[1]);
+			item = simNvFind(id, 1);
+			if (item == NULL)
+			{
+				rsp[0] = 0x0A; // NV_OPER_FAILED
+				return 1;
+			}
+			if (cmd1 == MT_SYS_OSAL_NV_WRITE)
+			{
+				if (req[2] >= SIM_NV_ITEM_LEN)
+				{
+					rsp[0] = 0x0C; // NV_BAD_ITEM_LEN
+					return 1;
+				}
+				len = req[3];
+				if (req[2] + len > SIM_NV_ITEM_LEN)
+				{
+					len = SIM_NV_ITEM_LEN - req[2];
+				}
+				if (len > reqLen - 4)
+				{
+					len = reqLen - 4;
+				}
+				memcpy(&item->data[req[2]], &req[4], len);
+				if (req[2] + len > item->len)
+				{
+					item->len = req[2] + len;
+				}
+			}
+			else if (item->len == 0)
+			{
+				item->len = (req[2] < SIM_NV_ITEM_LEN) ?
+				        req[2] : SIM_NV_ITEM_LEN;
+			}
+			return 1;
+		case MT_SYS_OSAL_NV_READ:
+			item = (reqLen >= 2) ?
+			        simNvFind(BUILD_UINT16(req[0], req[1]), 0) : NULL;
+			if ((item == NULL) || ((reqLen > 2) && (req[2] > item->len)))
+			{
+				rsp[0] = 0x09; // NV_ITEM_UNINIT
+				rsp[1] = 0;
+				return 2;
+			}
+			len = item->len - ((reqLen > 2) ? req[2] : 0);
+			rsp[1] = len;
+			memcpy(&rsp[2], &item->data[item->len - len], len);
+			return 2 + len;
+		case MT_SYS_OSAL_NV_LENGTH:
+			item = (reqLen >= 2) ?
+			        simNvFind(BUILD_UINT16(req[0], req[1]), 0) : NULL;
+			rsp[0] = item ? item->len : 0;
+			rsp[1] = 0;
+			return 2;
+		default:
+			break;
+		}
+	}
+	else if (subSys == MT_RPC_SYS_SAPI)
+	{
+		switch (cmd1)
+		{
+		case MT_SAPI_READ_CONFIGURATION:
+			rsp[1] = (reqLen > 0) ? req[0] : 0;
+			rsp[2] = 1;
+			rsp[3] = 0;
+			return 4;
+		case MT_SAPI_GET_DEVICE_INFO:
+			rsp[0] = (reqLen > 0) ? req[0] : 0;
+			memset(&rsp[1], 0, 8);
+			return 9;
+		default:
+			break;
+		}
+	}
+	else if (subSys == MT_RPC_SYS_AF)
+	{
+		if (cmd1 == MT_AF_DATA_RETRIEVE)
+		{
+			simIncoming_t *buf = NULL;
+
+			rsp[1] = 0;
+			for (len = 0; (len < SIM_INCOMING_BUFS) && (reqLen >= 7); len++)
+			{
+				if (simIncoming[len].used && (simIncoming[len].timeStamp
+				        == BUILD_UINT32(req[0], req[1], req[2], req[3])))
+				{
+					buf = &simIncoming[len];
+					break;
+				}
+			}
+			if (buf == NULL)
+			{
+				rsp[0] = afStatus_INVALID_PARAMETER;
+				return 2;
+			}
+			id = BUILD_UINT16(req[4], req[5]);
+			len = req[6];
+			if (len == 0)
+			{
+				// message consumed, free its buffer
+				buf->used = 0;
+			}
+			else if ((id + len > buf->len) || (len > RPC_MAX_PAYLOAD_LEN - 2))
+			{
+				rsp[0] = afStatus_INVALID_PARAMETER;
+			}
+			else
+			{
+				rsp[1] = len;
+				memcpy(&rsp[2], &buf->data[id], len);
+				simStats.retrievedBytes += len;
+			}
+			return 2 + rsp[1];
+		}
+		if ((cmd1 == MT_AF_DATA_REQUEST_EXT) && (reqLen >= 20)
+		        && (BUILD_UINT16(req[18], req[19]) > reqLen - 20))
+		{
+			// data too long for the frame, it follows in AF_DATA_STOREs
+			id = BUILD_UINT16(req[18], req[19]);
+			if (id > SIM_HUGE_MAX_LEN)
+			{
+				rsp[0] = afStatus_MEM_FAIL;
+				return 1;
+			}
+			simHuge.active = 1;
+			simHuge.endpoint = req[12];
+			simHuge.transId = req[15];
+			simHuge.len = id;
+			simHuge.stored = 0;
+			return 1;
+		}
+		if (cmd1 == MT_AF_DATA_STORE)
+		{
+			if (reqLen < 3)
+			{
+				rsp[0] = MT_RPC_ERR_LENGTH;
+				return 1;
+			}
+			id = BUILD_UINT16(req[0], req[1]);
+			len = req[2];
+			if (!simHuge.active)
+			{
+				rsp[0] = afStatus_MEM_FAIL;
+			}
+			else if (len == 0)
+			{
+				// end of the data, send the message
+				simHuge.active = 0;
+				simHuge.confirm = 1;
+				simStats.hugeMsgs++;
+			}
+			else if ((id + len > simHuge.len) || (len > reqLen - 3))
+			{
+				rsp[0] = afStatus_INVALID_PARAMETER;
+			}
+			else
+			{
+				memcpy(&simHuge.data[id], &req[3], len);
+				simHuge.stored += len;
+				simStats.hugeBytes += len;
+			}
+			return 1;
+		}
+	}
+
+	return 1;
+}
+
+/*********************************************************************
+ * @fn      simFollowUp
+ *
+ * @brief   Queue the AREQs a real ZNP sends after some SREQs, such as
+ *          AF_DATA_CONFIRM after AF_DATA_REQUEST.
+ */
+static void simFollowUp(uint8_t subSys, uint8_t cmd1, const uint8_t *req,
+        uint8_t reqLen, uint32_t delayUs)
+{
+	uint8_t areq[8];
+
+	if (subSys == MT_RPC_SYS_AF)
+	{
+		uint8_t epIdx, transIdx;
+
+		switch (cmd1)
+		{
+		case MT_AF_DATA_REQUEST:
+		case MT_AF_DATA_REQUEST_SRC_RTG:
+			epIdx = 3;
+			transIdx = 6;
+			break;
+		case MT_AF_DATA_REQUEST_EXT:
+			if ((reqLen >= 20)
+			        && (BUILD_UINT16(req[18], req[19]) > reqLen - 20))
+			{
+				// confirmed once its data is stored
+				return;
+			}
+			epIdx = 12;
+			transIdx = 15;
+			break;
+		case MT_AF_DATA_STORE:
+			if (simHuge.confirm)
+			{
+				simHuge.confirm = 0;
+				areq[0] = afStatus_SUCCESS;
+				areq[1] = simHuge.endpoint;
+				areq[2] = simHuge.transId;
+				simQueueFrame(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF,
+				        MT_AF_DATA_CONFIRM, areq, 3, delayUs);
+			}
+			return;
+		default:
+			return;
+		}
+		if (reqLen <= transIdx)
+		{
+			return;
+		}
+		areq[0] = afStatus_SUCCESS;
+		areq[1] = req[epIdx];
+		areq[2] = req[transIdx];
+		simQueueFrame(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF, MT_AF_DATA_CONFIRM,
+		        areq, 3, delayUs);
+	}
+	else if ((subSys == MT_RPC_SYS_ZDO) && (cmd1 == MT_ZDO_STARTUP_FROM_APP))
+	{
+		areq[0] = DEV_COORD_STARTING;
+		simQueueFrame(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, MT_ZDO_STATE_CHANGE_IND,
+		        areq, 1, delayUs);
+		areq[0] = DEV_ZB_COORD;
+		simQueueFrame(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO, MT_ZDO_STATE_CHANGE_IND,
+		        areq, 1, delayUs);
+	}
+}
+
+/*********************************************************************
+ * @fn      simHandleFrame
+ *
+ * @brief   Process one frame received from the host.
+ *
+ * @param   frame - frame starting at the length byte
+ */
+static void simHandleFrame(const uint8_t *frame)
+{
+	uint8_t len = frame[0];
+	uint8_t cmd0 = frame[1];
+	uint8_t cmd1 = frame[2];
+	const uint8_t *req = &frame[3];
+	uint8_t subSys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+	uint8_t rsp[RPC_MAX_LEN];
+	int32_t rspLen = -1;
+	uint32_t latency;
+
+	simStats.framesIn++;
+
+	if ((cmd0 & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SREQ)
+	{
+		if (simSrspHandler)
+		{
+			// called unlocked so the handler may inject AREQs
+			pthread_mutex_unlock(&simLock);
+			rspLen = simSrspHandler(cmd0, cmd1, req, len, rsp);
+			pthread_mutex_lock(&simLock);
+		}
+		if (rspLen == RPC_SIM_NO_RSP)
+		{
+			// SREQ swallowed, lets the host run into its SRSP timeout
+			return;
+		}
+		if ((rspLen < 0) || (rspLen > RPC_MAX_LEN - RPC_HDR_LEN))
+		{
+			rspLen = simDefaultSrsp(subSys, cmd1, req, len, rsp);
+		}
+
+		simQueueFrame(MT_RPC_CMD_SRSP | subSys, cmd1, rsp, (uint8_t) rspLen,
+		        simCfg.latencyUs);
+		latency = simCfg.latencyUs + simCfg.areqLatencyUs;
+		simFollowUp(subSys, cmd1, req, len, latency);
+	}
+	else if ((cmd0 == (MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS))
+	        && (cmd1 == MT_SYS_RESET_REQ))
+	{
+		rsp[0] = 0x00; // reason: power up
+		rsp[1] = 2;    // transport revision
+		rsp[2] = 0;    // product
+		rsp[3] = 2;
+		rsp[4] = 6;
+		rsp[5] = 3;
+		simQueueFrame(MT_RPC_CMD_AREQ | MT_RPC_SYS_SYS, MT_SYS_RESET_IND, rsp,
+		        6, simCfg.latencyUs + simCfg.areqLatencyUs);
+	}
+}
+
+/*********************************************************************
+ * @fn      simParse
+ *
+ * @brief   Extract complete frames from the host byte stream. Bytes that
+ *          are not a SOF are skipped, frames failing the FCS are dropped.
+ *          Called with simLock held.
+ */
+static void simParse(void)
+{
+	uint16_t idx = 0;
+
+	while (idx < simRxLen)
+	{
+		uint16_t frameLen;
+
+		if (simRxBuf[idx] != MT_RPC_SOF)
+		{
+			// bootloader force-run byte or line noise
+			idx++;
+			continue;
+		}
+		if (simRxLen - idx < RPC_UART_HDR_LEN)
+		{
+			break;
+		}
+		frameLen = RPC_UART_HDR_LEN + simRxBuf[idx + 1] + RPC_UART_FCS_LEN;
+		if (simRxLen - idx < frameLen)
+		{
+			break;
+		}
+		if (simFcs(&simRxBuf[idx + 1], frameLen - 2)
+		        != simRxBuf[idx + frameLen - 1])
+		{
+			simStats.fcsErrors++;
+			idx++;
+			continue;
+		}
+		simHandleFrame(&simRxBuf[idx + 1]);
+		idx += frameLen;
+	}
+
+	memmove(simRxBuf, &simRxBuf[idx], simRxLen - idx);
+	simRxLen -= idx;
+}
+
+static void *simTask(void *arg __attribute__((unused)))
+{
+	struct pollfd fds[2];
+
+	fds[0].fd = simFds[SIM_DEV_FD];
+	fds[0].events = POLLIN;
+	fds[1].fd = simWakeFds[0];
+	fds[1].events = POLLIN;
+
+	while (simRunning)
+	{
+		int timeout = -1;
+		uint64_t now;
+
+		pthread_mutex_lock(&simLock);
+		now = simNowUs();
+		while ((simEventCnt > 0) && (simEvents[0].dueUs <= now))
+		{
+			simEvent_t *ev = &simEvents[0];
+			uint16_t off = 0;
+
+			while (off < ev->len)
+			{
+				ssize_t n = write(simFds[SIM_DEV_FD], ev->buf + off,
+				        ev->len - off);
+				if (n <= 0)
+				{
+					if ((n < 0) && (errno == EINTR))
+					{
+						continue;
+					}
+					break;
+				}
+				off += n;
+			}
+			simStats.framesOut++;
+			simStats.bytesOut += off;
+
+			simEventCnt--;
+			memmove(&simEvents[0], &simEvents[1],
+			        simEventCnt * sizeof(simEvent_t));
+		}
+		if (simEventCnt > 0)
+		{
+			// round up so we never wake up just before the event
+			timeout = (int) ((simEvents[0].dueUs - now + 999) / 1000);
+		}
+		pthread_mutex_unlock(&simLock);
+
+		if (poll(fds, 2, timeout) <= 0)
+		{
+			continue;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			uint8_t drain[16];
+			while (read(simWakeFds[0], drain, sizeof(drain)) > 0)
+				;
+		}
+
+		if (fds[0].revents & (POLLHUP | POLLERR))
+		{
+			break;
+		}
+		if (fds[0].revents & POLLIN)
+		{
+			ssize_t n;
+
+			pthread_mutex_lock(&simLock);
+			n = read(simFds[SIM_DEV_FD], &simRxBuf[simRxLen],
+			        sizeof(simRxBuf) - simRxLen);
+			if (n > 0)
+			{
+				simStats.bytesIn += n;
+				simRxLen += n;
+				simParse();
+				if (simRxLen == sizeof(simRxBuf))
+				{
+					// no SOF in a full buffer, nothing to salvage
+					simRxLen = 0;
+				}
+			}
+			pthread_mutex_unlock(&simLock);
+		}
+	}
+
+	return NULL;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      rpcTransportSimConfigure
+ *
+ * @brief   Set the latency and throttling of the simulated ZNP. Can be
+ *          called before or after rpcTransportOpen.
+ *
+ * @param   cfg - new configuration
+ */
+void rpcTransportSimConfigure(const rpcSimConfig_t *cfg)
+{
+	pthread_mutex_lock(&simLock);
+	simCfg = *cfg;
+	pthread_mutex_unlock(&simLock);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimSetSrspHandler
+ *
+ * @brief   Install a hook to answer SREQs, NULL restores the built-in
+ *          responses.
+ */
+void rpcTransportSimSetSrspHandler(rpcSimSrspHandler_t handler)
+{
+	pthread_mutex_lock(&simLock);
+	simSrspHandler = handler;
+	pthread_mutex_unlock(&simLock);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimInjectAreq
+ *
+ * @brief   Schedule an AREQ from the simulated ZNP to the host.
+ *
+ * @param   cmd0 - command type and subsystem, normally MT_RPC_CMD_AREQ | sys
+ * @param   cmd1 - command ID
+ * @param   payload - AREQ payload
+ * @param   len - payload length
+ * @param   delayUs - delay from now
+ *
+ * @return  0 on success, -1 if the event table is full
+ */
+int32_t rpcTransportSimInjectAreq(uint8_t cmd0, uint8_t cmd1,
+        const uint8_t *payload, uint8_t len, uint32_t delayUs)
+{
+	int32_t status;
+
+	if (len > RPC_MAX_LEN - RPC_HDR_LEN)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&simLock);
+	status = simQueueFrame(cmd0, cmd1, payload, len, delayUs);
+	pthread_mutex_unlock(&simLock);
+	simWake();
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimInjectRaw
+ *
+ * @brief   Schedule raw bytes to the host, used to feed line noise or
+ *          corrupted frames to the RPC parser.
+ */
+int32_t rpcTransportSimInjectRaw(const uint8_t *buf, uint16_t len,
+        uint32_t delayUs)
+{
+	int32_t status;
+
+	pthread_mutex_lock(&simLock);
+	status = simQueue(buf, len, delayUs);
+	pthread_mutex_unlock(&simLock);
+	simWake();
+
+	return status;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimInjectStateChange
+ *
+ * @brief   Schedule a ZDO_STATE_CHANGE_IND.
+ */
+int32_t rpcTransportSimInjectStateChange(uint8_t state, uint32_t delayUs)
+{
+	return rpcTransportSimInjectAreq(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO,
+	        MT_ZDO_STATE_CHANGE_IND, &state, 1, delayUs);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimInjectIncomingMsg
+ *
+ * @brief   Schedule an AF_INCOMING_MSG from a remote node.
+ */
+int32_t rpcTransportSimInjectIncomingMsg(uint16_t srcAddr, uint8_t srcEp,
+        uint8_t dstEp, uint16_t clusterId, const uint8_t *data, uint8_t len,
+        uint32_t delayUs)
+{
+	uint8_t areq[RPC_MAX_LEN];
+	uint8_t idx = 0;
+
+	if (len > RPC_MAX_LEN - RPC_HDR_LEN - 17)
+	{
+		return -1;
+	}
+
+	areq[idx++] = 0; // group ID
+	areq[idx++] = 0;
+	areq[idx++] = LO_UINT16(clusterId);
+	areq[idx++] = HI_UINT16(clusterId);
+	areq[idx++] = LO_UINT16(srcAddr);
+	areq[idx++] = HI_UINT16(srcAddr);
+	areq[idx++] = srcEp;
+	areq[idx++] = dstEp;
+	areq[idx++] = 0;   // was broadcast
+	areq[idx++] = 200; // link quality
+	areq[idx++] = 0;   // security use
+	memset(&areq[idx], 0, 4); // time stamp
+	idx += 4;
+	areq[idx++] = 0;   // trans seq num
+	areq[idx++] = len;
+	memcpy(&areq[idx], data, len);
+	idx += len;
+
+	return rpcTransportSimInjectAreq(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF,
+	        MT_AF_INCOMING_MSG, areq, idx, delayUs);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimInjectIncomingMsgExt
+ *
+ * @brief   Schedule an AF_INCOMING_MSG_EXT from a remote node. Data too
+ *          long for a frame is kept, like a ZNP does, until the host
+ *          fetches it with AF_DATA_RETRIEVE and frees it with a zero
+ *          length retrieve.
+ *
+ * @return  0 on success, -1 if the data is too long or no buffer is free
+ */
+int32_t rpcTransportSimInjectIncomingMsgExt(uint16_t srcAddr, uint8_t srcEp,
+        uint8_t dstEp, uint16_t clusterId, const uint8_t *data, uint16_t len,
+        uint32_t delayUs)
+{
+	uint8_t areq[RPC_MAX_LEN];
+	uint8_t idx = 0;
+	uint32_t timeStamp;
+	uint8_t inFrame = (len <= RPC_MAX_LEN - RPC_HDR_LEN - 27);
+	uint8_t buf;
+
+	if (len > SIM_HUGE_MAX_LEN)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&simLock);
+	timeStamp = ++simTimeStamp;
+	for (buf = 0; (buf < SIM_INCOMING_BUFS) && !inFrame; buf++)
+	{
+		if (!simIncoming[buf].used)
+		{
+			simIncoming[buf].used = 1;
+			simIncoming[buf].timeStamp = timeStamp;
+			simIncoming[buf].len = len;
+			memcpy(simIncoming[buf].data, data, len);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&simLock);
+	if (buf == SIM_INCOMING_BUFS)
+	{
+		return -1;
+	}
+
+	areq[idx++] = 0; // group ID
+	areq[idx++] = 0;
+	areq[idx++] = LO_UINT16(clusterId);
+	areq[idx++] = HI_UINT16(clusterId);
+	areq[idx++] = 2; // 16 bit source address
+	memset(&areq[idx], 0, 8);
+	areq[idx] = LO_UINT16(srcAddr);
+	areq[idx + 1] = HI_UINT16(srcAddr);
+	idx += 8;
+	areq[idx++] = srcEp;
+	areq[idx++] = 0; // source PAN ID
+	areq[idx++] = 0;
+	areq[idx++] = dstEp;
+	areq[idx++] = 0;   // was broadcast
+	areq[idx++] = 200; // link quality
+	areq[idx++] = 0;   // security use
+	areq[idx++] = (uint8_t) timeStamp;
+	areq[idx++] = (uint8_t) (timeStamp >> 8);
+	areq[idx++] = (uint8_t) (timeStamp >> 16);
+	areq[idx++] = (uint8_t) (timeStamp >> 24);
+	areq[idx++] = 0;   // trans seq num
+	areq[idx++] = LO_UINT16(len);
+	areq[idx++] = HI_UINT16(len);
+	if (inFrame)
+	{
+		memcpy(&areq[idx], data, len);
+		idx += len;
+	}
+
+	return rpcTransportSimInjectAreq(MT_RPC_CMD_AREQ | MT_RPC_SYS_AF,
+	        MT_AF_INCOMING_MSG_EXT, areq, idx, delayUs);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSimGetStats
+ *
+ * @brief   Copy the simulated ZNP counters.
+ */
+void rpcTransportSimGetStats(rpcSimStats_t *stats)
+{
+	pthread_mutex_lock(&simLock);
+	*stats = simStats;
+	pthread_mutex_unlock(&simLock);
+}
+
+/*********************************************************************
+ * @fn      rpcTransportOpen
+ *
+ * @brief   Start the simulated ZNP.
+ *
+ * @param   devicePath - ignored
+ *
+ * @return  host side file descriptor, -1 on failure
+ */
+int32_t rpcTransportOpen(char *_devicePath __attribute__((unused)))
+{
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, simFds) < 0)
+	{
+		LOG_CRI("socketpair failed - %s", strerror(errno));
+		return (-1);
+	}
+	if (pipe(simWakeFds) < 0)
+	{
+		LOG_CRI("pipe failed - %s", strerror(errno));
+		close(simFds[SIM_HOST_FD]);
+		close(simFds[SIM_DEV_FD]);
+		return (-1);
+	}
+	fcntl(simWakeFds[0], F_SETFL, O_NONBLOCK);
+	fcntl(simWakeFds[1], F_SETFL, O_NONBLOCK);
+
+	pthread_mutex_lock(&simLock);
+	simEventCnt = 0;
+	simRxLen = 0;
+	simLinkFreeUs = 0;
+	memset(&simStats, 0, sizeof(simStats));
+	pthread_mutex_unlock(&simLock);
+
+	simRunning = 1;
+	if (pthread_create(&simThread, NULL, simTask, NULL) != 0)
+	{
+		LOG_CRI("cannot start simulated ZNP");
+		simRunning = 0;
+		close(simFds[SIM_HOST_FD]);
+		close(simFds[SIM_DEV_FD]);
+		close(simWakeFds[0]);
+		close(simWakeFds[1]);
+		return (-1);
+	}
+
+	LOG_INF("simulated ZNP started");
+	return simFds[SIM_HOST_FD];
+}
+
+/*********************************************************************
+ * @fn      rpcTransportClose
+ *
+ * @brief   Stop the simulated ZNP.
+ */
+void rpcTransportClose(void)
+{
+	if (!simRunning)
+	{
+		return;
+	}
+	simRunning = 0;
+	simWake();
+	pthread_join(simThread, NULL);
+
+	close(simFds[SIM_HOST_FD]);
+	close(simFds[SIM_DEV_FD]);
+	close(simWakeFds[0]);
+	close(simWakeFds[1]);
+	simFds[SIM_HOST_FD] = simFds[SIM_DEV_FD] = -1;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportWrite
+ *
+ * @brief   Send bytes to the simulated ZNP.
+ *
+ * @return  number of bytes written, -1 on error
+ */
+int32_t rpcTransportWrite(uint8_t* buf, uint8_t len)
+{
+	uint8_t off = 0;
+
+	while (off < len)
+	{
+		ssize_t n = write(simFds[SIM_HOST_FD], buf + off, len - off);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			LOG_ERR("write failed - %s", strerror(errno));
+			return -1;
+		}
+		off += n;
+	}
+
+	return len;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSetPacing
+ *
+ * @brief   Pacing is a UART workaround, the simulated link ignores it.
+ */
+void rpcTransportSetPacing(uint8_t chunkLen __attribute__((unused)),
+        uint32_t gapUs __attribute__((unused)))
+{
+}
+
+/*********************************************************************
+ * @fn      rpcTransportRead
+ *
+ * @brief   Read bytes sent by the simulated ZNP.
+ */
+int32_t rpcTransportRead(uint8_t* buf, uint16_t len)
+{
+	int32_t ret = read(simFds[SIM_HOST_FD], buf, len);
+	if (ret > 0)
+	{
+		LOG_DBG("read %d bytes", ret);
+	}
+	return (ret);
+}
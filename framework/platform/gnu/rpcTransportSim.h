@@ -0,0 +1,79 @@
+/*
+ * rpcTransportSim.h
+ *
+ * This module contains the API for the simulated ZNP transport. It replaces
+ * the UART transport when the framework is built with HAL_UART_SIM, so the
+ * RPC and MT layers can be driven without a ZNP device attached.
+ */
+
+#ifndef RPCTRANSPORTSIM_H
+#define RPCTRANSPORTSIM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// SRSP handler return value: send no SRSP at all
+#define RPC_SIM_NO_RSP (-2)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+	uint32_t latencyUs;    // SREQ received -> SRSP sent turnaround
+	uint32_t areqLatencyUs;// SRSP sent -> follow-up AREQ (confirm, state)
+	uint32_t baudRate;     // 0: unthrottled, else 10 bits per byte
+} rpcSimConfig_t;
+
+typedef struct
+{
+	uint32_t framesIn;     // frames received from the host
+	uint32_t framesOut;    // frames sent to the host
+	uint32_t bytesIn;
+	uint32_t bytesOut;
+	uint32_t fcsErrors;    // host frames dropped on FCS mismatch
+	uint32_t eventOverflows; // injections dropped, event table full
+	uint32_t hugeMsgs;     // AF_DATA_REQUEST_EXT sent from the store buffer
+	uint32_t hugeBytes;    // bytes written by AF_DATA_STORE
+	uint32_t retrievedBytes; // bytes read by AF_DATA_RETRIEVE
+} rpcSimStats_t;
+
+// Application hook to answer an SREQ. rsp points to a RPC_MAX_LEN buffer
+// for the SRSP payload. Return the payload length, -1 to fall back to
+// the built-in response or RPC_SIM_NO_RSP to leave the SREQ unanswered.
+typedef int32_t (*rpcSimSrspHandler_t)(uint8_t cmd0, uint8_t cmd1,
+        const uint8_t *req, uint8_t reqLen, uint8_t *rsp);
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void rpcTransportSimConfigure(const rpcSimConfig_t *cfg);
+void rpcTransportSimSetSrspHandler(rpcSimSrspHandler_t handler);
+int32_t rpcTransportSimInjectAreq(uint8_t cmd0, uint8_t cmd1,
+        const uint8_t *payload, uint8_t len, uint32_t delayUs);
+int32_t rpcTransportSimInjectRaw(const uint8_t *buf, uint16_t len,
+        uint32_t delayUs);
+int32_t rpcTransportSimInjectStateChange(uint8_t state, uint32_t delayUs);
+int32_t rpcTransportSimInjectIncomingMsg(uint16_t srcAddr, uint8_t srcEp,
+        uint8_t dstEp, uint16_t clusterId, const uint8_t *data, uint8_t len,
+        uint32_t delayUs);
+int32_t rpcTransportSimInjectIncomingMsgExt(uint16_t srcAddr, uint8_t srcEp,
+        uint8_t dstEp, uint16_t clusterId, const uint8_t *data, uint16_t len,
+        uint32_t delayUs);
+void rpcTransportSimGetStats(rpcSimStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPCTRANSPORTSIM_H */
@@ -49,9 +49,13 @@
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <linux/serial.h>
 
 //#include "rpc.h"
 
+#include "rpcTransportUart.h"
 #include "dbgPrint.h"
 
 /*********************************************************************
@@ -67,6 +71,9 @@
 #define SB_FORCE_BOOT               0xF8
 #define SB_FORCE_RUN               (SB_FORCE_BOOT ^ 0xFF)
 
+// how long a frame write may wait for room in the tty output buffer
+#define UART_WRITE_TIMEOUT_MS      (1000)
+
 /************************************************************
  * TYPEDEFS
  */
@@ -79,7 +86,56 @@ uint8_t uartDebugPrintsEnabled = 0;
 /*********************************************************************
  * LOCAL VARIABLES
  */
-int serialPortFd;
+int serialPortFd = -1;
+
+// port settings, see rpcTransportUartConfigure()
+static rpcUartConfig_t uartCfg =
+{
+	.baudRate = 115200,
+#ifndef CC26xx
+	.flowControl = RPC_UART_FLOW_RTSCTS,
+#else
+	.flowControl = RPC_UART_FLOW_NONE,
+#endif //CC26xx
+	.vmin = 1,
+	.vtime = 0,
+	.lowLatency = 0
+};
+
+// baud rates with a termios constant, others go through termios2
+static const struct
+{
+	uint32_t rate;
+	speed_t speed;
+} uartBaudTable[] =
+{
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 },
+	{ 460800, B460800 },
+	{ 500000, B500000 },
+	{ 921600, B921600 },
+	{ 1000000, B1000000 },
+	{ 1500000, B1500000 },
+	{ 2000000, B2000000 },
+	{ 3000000, B3000000 }
+};
+
+// one frame at a time on the wire, application threads may send concurrently
+static pthread_mutex_t uartTxLock = PTHREAD_MUTEX_INITIALIZER;
+
+// pacing, off unless enabled with rpcTransportSetPacing()
+static uint8_t uartPacingChunk;
+static uint32_t uartPacingGapUs;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static int32_t uartWriteAll(uint8_t* buf, uint32_t len);
+static int32_t uartApplyConfig(int fd);
 
 /*********************************************************************
  * API FUNCTIONS
@@ -96,7 +152,6 @@ int serialPortFd;
  */
 int32_t rpcTransportOpen(char *_devicePath)
 {
-	struct termios tio;
 	static char lastUsedDevicePath[255];
 	char * devicePath;
 
@@ -124,28 +179,14 @@ int32_t rpcTransportOpen(char *_devicePath)
 		return (-1);
 	}
 
-	/* c-iflags
-	 B115200 : set board rate to 115200
-	 CRTSCTS : HW flow control
-	 CS8     : 8n1 (8bit,no parity,1 stopbit)
-	 CLOCAL  : local connection, no modem contol
-	 CREAD   : enable receiving characters*/
-	tio.c_cflag = B115200 | CS8 | CLOCAL | CREAD;
-#ifndef CC26xx
-	tio.c_cflag |= CRTSCTS;
-#endif //CC26xx
-	/* c-iflags
-	 ICRNL   : maps 0xD (CR) to 0x10 (LR), we do not want this.
-	 IGNPAR  : ignore bits with parity errors, I guess it is
-	 better to ignore an erroneous bit than interpret it incorrectly. */
-	tio.c_iflag = IGNPAR & ~ICRNL;
-	tio.c_oflag = 0;
-	tio.c_lflag = 0;
-	//Make it block
-	tio.c_cc[VMIN] = 1;
-
 	tcflush(serialPortFd, TCIFLUSH);
-	tcsetattr(serialPortFd, TCSANOW, &tio);
+	if (uartApplyConfig(serialPortFd) < 0)
+	{
+		LOG_CRI("%s configuration failed", devicePath);
+		close(serialPortFd);
+		serialPortFd = -1;
+		return (-1);
+	}
 
 	return serialPortFd;
 }
@@ -163,6 +204,7 @@ void rpcTransportClose(void)
 {
 	tcflush(serialPortFd, TCOFLUSH);
 	close(serialPortFd);
+	serialPortFd = -1;
 
 	return;
 }
@@ -170,29 +212,114 @@ void rpcTransportClose(void)
 /*********************************************************************
  * @fn      rpcTransportWrite
  *
- * @brief   Write to the the serial port to the CC253x.
+ * @brief   Write a frame to the serial port to the CC253x. The frame is
+ *          handed to the tty in as few write() calls as the driver
+ *          accepts. With pacing enabled the frame is sent in chunks,
+ *          each one drained to the wire before the gap.
  *
- * @param   fd - file descriptor of the UART device
+ * @param   buf - frame to send
+ * @param   len - frame length
  *
- * @return  status
+ * @return  number of bytes written, -1 on error
  */
-void rpcTransportWrite(uint8_t* buf, uint8_t len)
+int32_t rpcTransportWrite(uint8_t* buf, uint8_t len)
 {
-	int remain = len;
-	int offset = 0;
+	int32_t ret = len;
+
 	LOG_DBG("len = %d", len);
 
-	while (remain > 0)
+	pthread_mutex_lock(&uartTxLock);
+	if (uartPacingChunk == 0)
 	{
-		int sub = (remain >= 8 ? 8 : remain);
-		LOG_DBG("writing %d bytes (offset = %d, remain = %d)", sub, offset, remain);
-		write(serialPortFd, buf + offset, sub);
+		if (uartWriteAll(buf, len) < 0)
+		{
+			ret = -1;
+		}
+	}
+	else
+	{
+		uint8_t offset = 0;
 
-		tcflush(serialPortFd, TCOFLUSH);
-		remain -= 8;
-		offset += 8;
+		while (offset < len)
+		{
+			uint8_t sub = (len - offset > uartPacingChunk) ?
+			        uartPacingChunk : (len - offset);
+
+			LOG_DBG("writing %d bytes (offset = %d)", sub, offset);
+			if (uartWriteAll(buf + offset, sub) < 0)
+			{
+				ret = -1;
+				break;
+			}
+			offset += sub;
+
+			// wait for the chunk to leave the UART, never discard it
+			tcdrain(serialPortFd);
+			if (uartPacingGapUs)
+			{
+				usleep(uartPacingGapUs);
+			}
+		}
 	}
-	return;
+	pthread_mutex_unlock(&uartTxLock);
+
+	return ret;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportUartConfigure
+ *
+ * @brief   Set the port settings used by rpcTransportOpen(). If the port
+ *          is open they are applied right away, e.g. to switch to a
+ *          higher baud rate once the ZNP has been told to.
+ *
+ * @param   cfg - new settings
+ *
+ * @return  0, -1 if the open port could not be reconfigured
+ */
+int32_t rpcTransportUartConfigure(const rpcUartConfig_t *cfg)
+{
+	memcpy(&uartCfg, cfg, sizeof(rpcUartConfig_t));
+
+	if (serialPortFd >= 0)
+	{
+		return uartApplyConfig(serialPortFd);
+	}
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      rpcTransportUartGetConfig
+ *
+ * @brief   Get the current port settings.
+ *
+ * @param   cfg - destination
+ *
+ * @return  -
+ */
+void rpcTransportUartGetConfig(rpcUartConfig_t *cfg)
+{
+	memcpy(cfg, &uartCfg, sizeof(rpcUartConfig_t));
+}
+
+/*********************************************************************
+ * @fn      rpcTransportSetPacing
+ *
+ * @brief   Send frames in chunks of chunkLen bytes, waiting for each
+ *          chunk to be transmitted plus gapUs before the next one. Only
+ *          needed for dongles that lose bytes on back to back writes.
+ *
+ * @param   chunkLen - chunk size, 0 disables pacing
+ * @param   gapUs - idle time after each chunk
+ *
+ * @return  -
+ */
+void rpcTransportSetPacing(uint8_t chunkLen, uint32_t gapUs)
+{
+	pthread_mutex_lock(&uartTxLock);
+	uartPacingChunk = chunkLen;
+	uartPacingGapUs = gapUs;
+	pthread_mutex_unlock(&uartTxLock);
 }
 
 /*********************************************************************
@@ -204,9 +331,9 @@ void rpcTransportWrite(uint8_t* buf, uint8_t len)
  *
  * @return  status
  */
-uint8_t rpcTransportRead(uint8_t* buf, uint8_t len)
+int32_t rpcTransportRead(uint8_t* buf, uint16_t len)
 {
-	uint8_t ret = read(serialPortFd, buf, len);
+	int32_t ret = read(serialPortFd, buf, len);
 	if (ret > 0)
 	{
 		LOG_DBG("read %d bytes", ret);
@@ -214,3 +341,133 @@ uint8_t rpcTransportRead(uint8_t* buf, uint8_t len)
 	return (ret);
 
 }
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      uartWriteAll
+ *
+ * @brief   Write len bytes, resuming after short writes and signals.
+ *          If the port is non-blocking, waits for it to become writable
+ *          on EAGAIN.
+ *
+ * @return  0, -1 on error or timeout
+ */
+static int32_t uartWriteAll(uint8_t* buf, uint32_t len)
+{
+	uint32_t offset = 0;
+
+	while (offset < len)
+	{
+		ssize_t n = write(serialPortFd, buf + offset, len - offset);
+
+		if (n >= 0)
+		{
+			offset += n;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			struct pollfd pfd;
+
+			pfd.fd = serialPortFd;
+			pfd.events = POLLOUT;
+			if (poll(&pfd, 1, UART_WRITE_TIMEOUT_MS) == 0)
+			{
+				LOG_ERR("write timed out, %d of %d bytes sent", offset, len);
+				return -1;
+			}
+		}
+		else if (errno != EINTR)
+		{
+			LOG_ERR("write failed - %s", strerror(errno));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      uartApplyConfig
+ *
+ * @brief   Program the tty with uartCfg.
+ *
+ * @return  0, -1 on error
+ */
+static int32_t uartApplyConfig(int fd)
+{
+	struct termios tio;
+	speed_t speed = B0;
+	uint8_t idx;
+
+	for (idx = 0; idx < sizeof(uartBaudTable) / sizeof(uartBaudTable[0]); idx++)
+	{
+		if (uartBaudTable[idx].rate == uartCfg.baudRate)
+		{
+			speed = uartBaudTable[idx].speed;
+			break;
+		}
+	}
+
+	memset(&tio, 0, sizeof(tio));
+	/* c-cflags
+	 CS8     : 8n1 (8bit,no parity,1 stopbit)
+	 CLOCAL  : local connection, no modem contol
+	 CREAD   : enable receiving characters
+	 CRTSCTS : HW flow control, if configured */
+	tio.c_cflag = CS8 | CLOCAL | CREAD;
+	if (uartCfg.flowControl == RPC_UART_FLOW_RTSCTS)
+	{
+		tio.c_cflag |= CRTSCTS;
+	}
+	/* c-iflags
+	 ICRNL   : maps 0xD (CR) to 0x10 (LR), we do not want this.
+	 IGNPAR  : ignore bits with parity errors, I guess it is
+	 better to ignore an erroneous bit than interpret it incorrectly. */
+	tio.c_iflag = IGNPAR & ~ICRNL;
+	tio.c_oflag = 0;
+	tio.c_lflag = 0;
+	tio.c_cc[VMIN] = uartCfg.vmin;
+	tio.c_cc[VTIME] = uartCfg.vtime;
+
+	// a rate without constant is set through termios2 once the rest is in
+	cfsetispeed(&tio, (speed != B0) ? speed : B38400);
+	cfsetospeed(&tio, (speed != B0) ? speed : B38400);
+
+	if (tcsetattr(fd, TCSANOW, &tio) < 0)
+	{
+		LOG_ERR("tcsetattr failed - %s", strerror(errno));
+		return -1;
+	}
+	if ((speed == B0) && (uartSetCustomBaud(fd, uartCfg.baudRate) < 0))
+	{
+		return -1;
+	}
+
+	if (uartCfg.lowLatency)
+	{
+		struct serial_struct serial;
+
+		// USB CDC ports do not all support it, not fatal
+		if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+		{
+			serial.flags |= ASYNC_LOW_LATENCY;
+			if (ioctl(fd, TIOCSSERIAL, &serial) < 0)
+			{
+				LOG_WARN("cannot set low latency mode - %s", strerror(errno));
+			}
+		}
+		else
+		{
+			LOG_WARN("low latency mode not available - %s", strerror(errno));
+		}
+	}
+
+	LOG_INF("UART %u baud, flow control %d, VMIN %d, VTIME %d%s",
+	        uartCfg.baudRate, uartCfg.flowControl, uartCfg.vmin, uartCfg.vtime,
+	        uartCfg.lowLatency ? ", low latency" : "");
+
+	return 0;
+}
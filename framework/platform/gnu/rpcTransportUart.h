@@ -0,0 +1,52 @@
+/*
+ * rpcTransportUart.h
+ *
+ * This module contains the configuration API of the UART transport. The
+ * configuration is applied when the port is opened, or right away if it
+ * already is.
+ */
+
+#ifndef RPCTRANSPORTUART_H
+#define RPCTRANSPORTUART_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef enum
+{
+	RPC_UART_FLOW_NONE = 0,
+	RPC_UART_FLOW_RTSCTS = 1
+} rpcUartFlow_t;
+
+typedef struct
+{
+	uint32_t baudRate;     // any rate, non standard ones are set with termios2
+	uint8_t flowControl;   // rpcUartFlow_t
+	uint8_t vmin;          // termios VMIN, bytes a read waits for
+	uint8_t vtime;         // termios VTIME, inter-byte timeout in 0.1s
+	uint8_t lowLatency;    // ASYNC_LOW_LATENCY, skip the tty flip delay
+} rpcUartConfig_t;
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+int32_t rpcTransportUartConfigure(const rpcUartConfig_t *cfg);
+void rpcTransportUartGetConfig(rpcUartConfig_t *cfg);
+
+// rpcTransportUartBaud.c, kept apart as <asm/termbits.h> clashes with <termios.h>
+int32_t uartSetCustomBaud(int fd, uint32_t baudRate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPCTRANSPORTUART_H */
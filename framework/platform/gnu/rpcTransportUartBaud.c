@@ -0,0 +1,57 @@
+/*
+ * rpcTransportUartBaud.c
+ *
+ * Sets UART baud rates that have no Bxxx constant through the Linux
+ * termios2 interface. Lives in its own file because <asm/termbits.h>
+ * cannot be included along with <termios.h>.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rpcTransportUart.h"
+#include "dbgPrint.h"
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      uartSetCustomBaud
+ *
+ * @brief   Set an arbitrary input and output baud rate on a tty.
+ *
+ * @param   fd - file descriptor of the UART device
+ * @param   baudRate - rate in bits per second
+ *
+ * @return  0, -1 on error
+ */
+int32_t uartSetCustomBaud(int fd, uint32_t baudRate)
+{
+	struct termios2 tio2;
+
+	if (ioctl(fd, TCGETS2, &tio2) < 0)
+	{
+		LOG_ERR("TCGETS2 failed - %s", strerror(errno));
+		return -1;
+	}
+
+	tio2.c_cflag &= ~CBAUD;
+	tio2.c_cflag |= BOTHER;
+	tio2.c_ispeed = baudRate;
+	tio2.c_ospeed = baudRate;
+
+	if (ioctl(fd, TCSETS2, &tio2) < 0)
+	{
+		LOG_ERR("TCSETS2 %u failed - %s", baudRate, strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
@@ -1,7 +1,7 @@
 /*
- * mqueue.c
+ * queue.c
  *
- * This module contains the POSIX wrapper for Semaphore.
+ * This module contains the message queue between the RPC and APP tasks.
  *
  * Copyright (C) 2013 Texas Instruments Incorporated - http://www.ti.com/
  *
@@ -42,56 +42,227 @@
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
+#include <errno.h>
 #include "queue.h"
 
-static void addToHead(llq_t *hndl, char *data, int length)
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      ringInit
+ *
+ * @brief   Init an index ring, filled with ids first..first+cnt-1
+ */
+static void ringInit(llq_ring_t *ring, uint16_t first, uint16_t cnt)
 {
-	if (hndl->head == NULL)
+	uint32_t i;
+
+	for (i = 0; i < LLQ_DEPTH; i++)
 	{
-		hndl->head = (node_t *) malloc(1 * sizeof(node_t));
-		hndl->head->ptr = NULL;
-		hndl->head->data = (char *) malloc(length * (sizeof(char)));
-		hndl->head->length = length;
-		memcpy(hndl->head->data, data, length);
-		hndl->tail = hndl->head;
+		atomic_init(&ring->cell[i].seq, i);
+		ring->cell[i].id = 0;
 	}
-	else
+	atomic_init(&ring->enqPos, 0);
+	atomic_init(&ring->deqPos, 0);
+
+	for (i = 0; i < cnt; i++)
 	{
-		hndl->temp = (node_t *) malloc(1 * sizeof(node_t));
-		hndl->temp->ptr = hndl->head;
-		hndl->temp->data = (char *) malloc(length * (sizeof(char)));
-		hndl->temp->length = length;
-		memcpy(hndl->temp->data, data, length);
+		ring->cell[i].id = first + i;
+		atomic_store_explicit(&ring->cell[i].seq, i + 1, memory_order_relaxed);
+	}
+	atomic_store_explicit(&ring->enqPos, cnt, memory_order_release);
+}
 
-		hndl->head = hndl->temp;
+/*********************************************************************
+ * @fn      ringPush
+ *
+ * @brief   Append an id to the ring (bounded MPMC queue, D. Vyukov)
+ *
+ * @return  0, -1 if full
+ */
+static int ringPush(llq_ring_t *ring, uint16_t id)
+{
+	llq_cell_t *cell;
+	uint32_t pos = atomic_load_explicit(&ring->enqPos, memory_order_relaxed);
+
+	for (;;)
+	{
+		uint32_t seq;
+		int32_t dif;
+
+		cell = &ring->cell[pos & (LLQ_DEPTH - 1)];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		dif = (int32_t) seq - (int32_t) pos;
+		if (dif == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&ring->enqPos, &pos,
+			        pos + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (dif < 0)
+		{
+			return -1;
+		}
+		else
+		{
+			pos = atomic_load_explicit(&ring->enqPos, memory_order_relaxed);
+		}
 	}
+
+	cell->id = id;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	return 0;
 }
 
-static void addToTail(llq_t *hndl, char *data, int length)
+/*********************************************************************
+ * @fn      ringPop
+ *
+ * @brief   Remove the oldest id from the ring
+ *
+ * @return  id, -1 if empty
+ */
+static int ringPop(llq_ring_t *ring)
+{
+	llq_cell_t *cell;
+	uint32_t pos = atomic_load_explicit(&ring->deqPos, memory_order_relaxed);
+	uint16_t id;
+
+	for (;;)
+	{
+		uint32_t seq;
+		int32_t dif;
+
+		cell = &ring->cell[pos & (LLQ_DEPTH - 1)];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		dif = (int32_t) seq - (int32_t) (pos + 1);
+		if (dif == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&ring->deqPos, &pos,
+			        pos + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (dif < 0)
+		{
+			return -1;
+		}
+		else
+		{
+			pos = atomic_load_explicit(&ring->deqPos, memory_order_relaxed);
+		}
+	}
+
+	id = cell->id;
+	atomic_store_explicit(&cell->seq, pos + LLQ_DEPTH, memory_order_release);
+	return id;
+}
+
+/*********************************************************************
+ * @fn      slotTake
+ *
+ * @brief   Get a free slot for a message of the given lane
+ *
+ * @return  slot id, -1 if the lane is full
+ */
+static int slotTake(llq_t *hndl, int prio)
 {
+	int id;
+
+	if (prio)
+	{
+		return ringPop(&hndl->prioFreeRing);
+	}
 
-	if (hndl->tail == NULL)
+	// reserve a place below the capacity first
+	if (atomic_fetch_add(&hndl->normalCount, 1) >= hndl->capacity)
 	{
-		hndl->tail = (node_t *) malloc(1 * sizeof(node_t));
-		hndl->tail->ptr = NULL;
-		hndl->tail->data = (char *) malloc(length * (sizeof(char)));
-		hndl->tail->length = length;
-		memcpy(hndl->tail->data, data, length);
-		hndl->head = hndl->tail;
+		atomic_fetch_sub(&hndl->normalCount, 1);
+		return -1;
+	}
+	id = ringPop(&hndl->freeRing);
+	if (id < 0)
+	{
+		atomic_fetch_sub(&hndl->normalCount, 1);
+	}
+	return id;
+}
+
+/*********************************************************************
+ * @fn      slotRelease
+ *
+ * @brief   Return a slot to its free ring and wake a waiting writer
+ */
+static void slotRelease(llq_t *hndl, int id)
+{
+	atomic_fetch_sub_explicit(&hndl->count, 1, memory_order_relaxed);
+	if (id < LLQ_DEPTH)
+	{
+		ringPush(&hndl->freeRing, id);
+		atomic_fetch_sub(&hndl->normalCount, 1);
 	}
 	else
 	{
-		hndl->temp = (node_t *) malloc(1 * sizeof(node_t));
-		hndl->tail->ptr = hndl->temp;
-		hndl->temp->data = (char *) malloc(length * (sizeof(char)));
-		hndl->temp->length = length;
-		memcpy(hndl->temp->data, data, length);
-		hndl->temp->ptr = NULL;
+		ringPush(&hndl->prioFreeRing, id);
+	}
+
+	if (atomic_load(&hndl->waiters) > 0)
+	{
+		sem_post(&hndl->space);
+	}
+}
+
+/*********************************************************************
+ * @fn      slotFill
+ *
+ * @brief   Copy the message into the slot and make it visible to readers
+ */
+static void slotFill(llq_t *hndl, int id, char *buffer, int len, int prio)
+{
+	uint32_t count, hwm;
+
+	memcpy(hndl->slot[id].data, buffer, len);
+	hndl->slot[id].length = len;
+
+	count = atomic_fetch_add_explicit(&hndl->count, 1, memory_order_relaxed) + 1;
+	hwm = atomic_load_explicit(&hndl->hwm, memory_order_relaxed);
+	while ((count > hwm)
+	        && !atomic_compare_exchange_weak_explicit(&hndl->hwm, &hwm, count,
+	                memory_order_relaxed, memory_order_relaxed))
+		;
+
+	// a slot only comes from the matching free ring, so this cannot fail
+	ringPush(prio ? &hndl->prioReadyRing : &hndl->readyRing, id);
+}
+
+/*********************************************************************
+ * @fn      slotCopyOut
+ *
+ * @brief   Copy a slot out and release it
+ *
+ * @return  length copied
+ */
+static int slotCopyOut(llq_t *hndl, int id, char *buffer, int maxLength)
+{
+	int rLength = hndl->slot[id].length;
 
-		hndl->tail = hndl->temp;
+	if (rLength > maxLength)
+	{
+		rLength = maxLength;
 	}
+	memcpy(buffer, hndl->slot[id].data, rLength);
+	slotRelease(hndl, id);
+
+	return rLength;
 }
 
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
 /*********************************************************************
  * @fn      llq_open
  *
@@ -103,53 +274,125 @@ static void addToTail(llq_t *hndl, char *data, int length)
  */
 void llq_open(llq_t *hndl)
 {
-	hndl->head = hndl->tail = NULL;
+	ringInit(&hndl->freeRing, 0, LLQ_DEPTH);
+	ringInit(&hndl->readyRing, 0, 0);
+	ringInit(&hndl->prioFreeRing, LLQ_DEPTH, LLQ_PRIO_DEPTH);
+	ringInit(&hndl->prioReadyRing, 0, 0);
+	hndl->capacity = LLQ_DEPTH;
+	atomic_init(&hndl->normalCount, 0);
+	atomic_init(&hndl->count, 0);
+	atomic_init(&hndl->hwm, 0);
+	atomic_init(&hndl->overflows, 0);
+	atomic_init(&hndl->waiters, 0);
+	sem_init(&hndl->space, 0, 0);
 }
 
-void llq_close(llq_t *hndl __attribute__((unused)))
+/*********************************************************************
+ * @fn      llq_close
+ *
+ * @brief   Release a queue handle
+ *
+ * @param   llq_t *hndl - handle to queue
+ *
+ * @return   none
+ */
+void llq_close(llq_t *hndl)
 {
-
+	sem_destroy(&hndl->space);
 }
 
 /*********************************************************************
  * @fn      llq_receive
  *
- * @brief   Get next message in queue
+ * @brief   Get next message in queue, priority messages first
  *
  * @param   llq_t *hndl - handle to queue to read the message from
  * @Param	char *buffer - Pointer to buffer to read the message in to
  * @Param	int maxLength - Max length of message to read
  *
- * @return   length of message read from queue
- */
-int llq_receive(llq_t *hndl, char *buffer, int maxLength __attribute__((unused)))
-{
-	int rLength = -1;
-
-    if (hndl->head != NULL)
-    {
-        hndl->temp = hndl->head->ptr;
-        memcpy(buffer, hndl->head->data, hndl->head->length);
-        rLength = (int) hndl->head->length;
-
-        //did head point to another element
-        if (hndl->temp != NULL)
-        {
-            //free current head element and point head to next
-            free(hndl->head->data);
-            free(hndl->head);
-            hndl->head = hndl->temp;
-        }
-        else
-        {
-            //no elements left in queue
-            free(hndl->head->data);
-            free(hndl->head);
-            hndl->head = NULL;
-            hndl->tail = NULL;
-        }
-    }
-	return rLength;
+ * @return   length of message read from queue, -1 if empty
+ */
+int llq_receive(llq_t *hndl, char *buffer, int maxLength)
+{
+	llq_ref_t ref;
+
+	if (llq_peek(hndl, &ref) < 0)
+	{
+		return -1;
+	}
+
+	return slotCopyOut(hndl, ref.id, buffer, maxLength);
+}
+
+/*********************************************************************
+ * @fn      llq_peek
+ *
+ * @brief   Take the next message, priority messages first, without
+ *          copying it. The slot stays valid and owned by the caller until
+ *          llq_release(), and keeps counting against the queue capacity.
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_ref_t *ref - returns the slot id, data and length
+ *
+ * @return   length of the message, -1 if empty
+ */
+int llq_peek(llq_t *hndl, llq_ref_t *ref)
+{
+	int id;
+
+	id = ringPop(&hndl->prioReadyRing);
+	if (id < 0)
+	{
+		id = ringPop(&hndl->readyRing);
+		if (id < 0)
+		{
+			return -1;
+		}
+	}
+
+	ref->id = id;
+	ref->length = hndl->slot[id].length;
+	ref->data = hndl->slot[id].data;
+
+	return ref->length;
+}
+
+/*********************************************************************
+ * @fn      llq_release
+ *
+ * @brief   Give back a slot taken with llq_peek()
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_ref_t *ref - reference returned by llq_peek()
+ *
+ * @return   none
+ */
+void llq_release(llq_t *hndl, llq_ref_t *ref)
+{
+	slotRelease(hndl, ref->id);
+	ref->data = NULL;
+}
+
+/*********************************************************************
+ * @fn      llq_drop_oldest
+ *
+ * @brief   Remove the oldest normal message, priority ones are kept
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	char *buffer - receives the dropped message
+ * @Param	int maxLength - Max length of message to read
+ *
+ * @return   length of the dropped message, -1 if none is queued
+ */
+int llq_drop_oldest(llq_t *hndl, char *buffer, int maxLength)
+{
+	int id = ringPop(&hndl->readyRing);
+
+	if (id < 0)
+	{
+		return -1;
+	}
+	return slotCopyOut(hndl, id, buffer, maxLength);
 }
 
 /*********************************************************************
@@ -160,24 +403,148 @@ int llq_receive(llq_t *hndl, char *buffer, int maxLength __attribute__((unused))
  * @param   llq_t *hndl - handle to queue to read the message from
  * @Param	char *buffer - Pointer to buffer containing the message
  * @Param	int len - Length of message
- * @Param	int prio - 1 message has priority and should be added to
- * 			head of queue, 0 message assed to tail of queue
+ * @Param	int prio - 1 message has priority and is read before the
+ * 			normal messages, 0 message added to tail of queue
  *
- * @return   length of message read from queue
+ * @return   0, -1 if the queue is full or the message too long
  */
 int llq_add(llq_t *hndl, char *buffer, int len, int prio)
 {
-	int ret = 0;
+	int id;
 
-	if (prio == 1)
+	if ((len < 0) || (len > LLQ_SLOT_LEN))
 	{
-		addToHead(hndl, buffer, len);
+		return -1;
 	}
-	else
+
+	id = slotTake(hndl, prio);
+	if (id < 0)
 	{
-		addToTail(hndl, buffer, len);
+		atomic_fetch_add_explicit(&hndl->overflows, 1, memory_order_relaxed);
+		return -1;
 	}
+	slotFill(hndl, id, buffer, len, prio);
 
-	return ret;
+	return 0;
 }
 
+/*********************************************************************
+ * @fn      llq_add_timed
+ *
+ * @brief   write message to queue, waiting for room if it is full. Meant
+ *          as the retry after llq_add() failed, so a timeout is not
+ *          counted as another overflow.
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	char *buffer - Pointer to buffer containing the message
+ * @Param	int len - Length of message
+ * @Param	int prio - 1 for the priority lane
+ * @Param	uint32_t timeoutMs - max wait for a free slot
+ *
+ * @return   0, -1 on timeout
+ */
+int llq_add_timed(llq_t *hndl, char *buffer, int len, int prio,
+        uint32_t timeoutMs)
+{
+	struct timespec ts;
+	int id;
+
+	if ((len < 0) || (len > LLQ_SLOT_LEN))
+	{
+		return -1;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeoutMs / 1000;
+	ts.tv_nsec += (timeoutMs % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	atomic_fetch_add(&hndl->waiters, 1);
+	for (;;)
+	{
+		// registered as waiter before trying, a release cannot be missed
+		id = slotTake(hndl, prio);
+		if (id >= 0)
+		{
+			break;
+		}
+		if ((sem_timedwait(&hndl->space, &ts) < 0) && (errno == ETIMEDOUT))
+		{
+			id = slotTake(hndl, prio);
+			break;
+		}
+	}
+	atomic_fetch_sub(&hndl->waiters, 1);
+
+	// not an overflow, the llq_add() that came before counted it
+	if (id < 0)
+	{
+		return -1;
+	}
+	slotFill(hndl, id, buffer, len, prio);
+
+	return 0;
+}
+
+/*********************************************************************
+ * @fn      llq_set_capacity
+ *
+ * @brief   Limit the number of normal messages, at most LLQ_DEPTH
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	uint32_t capacity - 0 for LLQ_DEPTH
+ *
+ * @return   none
+ */
+void llq_set_capacity(llq_t *hndl, uint32_t capacity)
+{
+	if ((capacity == 0) || (capacity > LLQ_DEPTH))
+	{
+		capacity = LLQ_DEPTH;
+	}
+	hndl->capacity = capacity;
+}
+
+/*********************************************************************
+ * @fn      llq_count
+ *
+ * @brief   Number of messages queued in a lane
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	int prio - 1 for the priority lane
+ *
+ * @return   message count
+ */
+uint32_t llq_count(llq_t *hndl, int prio)
+{
+	uint32_t total = atomic_load(&hndl->count);
+	uint32_t normal = atomic_load(&hndl->normalCount);
+
+	if (prio)
+	{
+		return (total > normal) ? (total - normal) : 0;
+	}
+	return normal;
+}
+
+/*********************************************************************
+ * @fn      llq_get_stats
+ *
+ * @brief   Get the queue counters
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_stats_t *stats - destination
+ *
+ * @return   none
+ */
+void llq_get_stats(llq_t *hndl, llq_stats_t *stats)
+{
+	stats->count = atomic_load_explicit(&hndl->count, memory_order_relaxed);
+	stats->hwm = atomic_load_explicit(&hndl->hwm, memory_order_relaxed);
+	stats->overflows = atomic_load_explicit(&hndl->overflows,
+	        memory_order_relaxed);
+}
@@ -1,7 +1,7 @@
 /*
- * mqueue.h
+ * queue.h
  *
- * This module contains the POSIX wrapper for Semaphore.
+ * This module contains the message queue between the RPC and APP tasks.
  *
  * Copyright (C) 2013 Texas Instruments Incorporated - http://www.ti.com/
  *
@@ -47,22 +47,80 @@ extern "C"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <semaphore.h>
 
-struct node
+// frame slot size, a full RPC frame (RPC_MAX_LEN)
+#define LLQ_SLOT_LEN        (256)
+
+// slots for normal messages, power of 2
+#ifndef LLQ_DEPTH
+#define LLQ_DEPTH           (64)
+#endif
+
+// slots reserved for priority messages (SRSPs), at most LLQ_DEPTH
+#ifndef LLQ_PRIO_DEPTH
+#define LLQ_PRIO_DEPTH      (16)
+#endif
+
+#define LLQ_SLOT_CNT        (LLQ_DEPTH + LLQ_PRIO_DEPTH)
+
+typedef struct
 {
-	char *data;
 	int length;
-	struct node *ptr;
-};
-typedef struct node node_t;
+	char data[LLQ_SLOT_LEN];
+} llq_slot_t;
+
+// bounded MPMC ring of slot indexes
 typedef struct
 {
-	node_t *head;
-	node_t *tail;
-	node_t *temp;
+	_Atomic uint32_t seq;
+	uint16_t id;
+} llq_cell_t;
+
+typedef struct
+{
+	llq_cell_t cell[LLQ_DEPTH];
+	_Atomic uint32_t enqPos;
+	_Atomic uint32_t deqPos;
+} llq_ring_t;
+
+// Fixed capacity queue, no allocation per message. Slots are taken from
+// a free ring, filled, and their index pushed to a ready ring. Priority
+// messages have their own slots and ready ring, read before the others.
+// Any number of threads can add and receive concurrently.
+typedef struct
+{
+	llq_slot_t slot[LLQ_SLOT_CNT];
+	llq_ring_t freeRing;
+	llq_ring_t readyRing;
+	llq_ring_t prioFreeRing;
+	llq_ring_t prioReadyRing;
+	uint32_t capacity;             // normal messages allowed, <= LLQ_DEPTH
+	_Atomic uint32_t normalCount;  // normal messages queued
+	_Atomic uint32_t count;
+	_Atomic uint32_t hwm;
+	_Atomic uint32_t overflows;
+	_Atomic uint32_t waiters;      // threads in llq_add_timed()
+	sem_t space;                   // posted when a slot is released
 } llq_t;
 
+// message handed out by llq_peek(), valid until llq_release()
+typedef struct
+{
+	int id;
+	int length;
+	char *data;
+} llq_ref_t;
+
+typedef struct
+{
+	uint32_t count;     // messages queued
+	uint32_t hwm;       // highest count seen
+	uint32_t overflows; // llq_add() calls that found the queue full
+} llq_stats_t;
+
 /*********************************************************************
  * @fn      llq_open
  *
@@ -75,16 +133,13 @@ typedef struct
 extern void llq_open(llq_t *hndl);
 
 /*********************************************************************
- * @fn      llq_timedreceive
+ * @fn      llq_close
  *
- * @brief   Block until a message is recieved or timeout
+ * @brief   Release a queue handle
  *
- * @param   llq_t *hndl - handle to queue to read the message from
- * @Param	char *buffer - Pointer to buffer to read the message in to
- * @Param	int maxLength - Max length of message to read
- * @Param	struct timespec * timeout - Timeout value
+ * @param   llq_t *hndl - handle to queue
  *
- * @return   length of message read from queue
+ * @return   none
  */
 extern void llq_close(llq_t *hndl);
 
@@ -96,15 +151,33 @@ extern void llq_close(llq_t *hndl);
  * @param   llq_t *hndl - handle to queue to read the message from
  * @Param	char *buffer - Pointer to buffer containing the message
  * @Param	int len - Length of message
- * @Param	int prio - 1 message has priority and should be added to
- * 			head of queue, 0 message assed to tail of queue
+ * @Param	int prio - 1 message has priority and is read before the
+ * 			normal messages, 0 message added to tail of queue
  *
- * @return   length of message read from queue
+ * @return   0, -1 if the queue is full or the message too long
  */
 extern int llq_add(llq_t *hndl, char *buffer, int len, int prio);
 
 /*********************************************************************
- * @fn      llq_timedreceive
+ * @fn      llq_add_timed
+ *
+ * @brief   write message to queue, waiting for room if it is full. Meant
+ *          as the retry after llq_add() failed, so a timeout is not
+ *          counted as another overflow.
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	char *buffer - Pointer to buffer containing the message
+ * @Param	int len - Length of message
+ * @Param	int prio - 1 for the priority lane
+ * @Param	uint32_t timeoutMs - max wait for a free slot
+ *
+ * @return   0, -1 on timeout
+ */
+extern int llq_add_timed(llq_t *hndl, char *buffer, int len, int prio,
+        uint32_t timeoutMs);
+
+/*********************************************************************
+ * @fn      llq_receive
  *
  * @brief   Get next message in queue
  *
@@ -112,10 +185,85 @@ extern int llq_add(llq_t *hndl, char *buffer, int len, int prio);
  * @Param	char *buffer - Pointer to buffer to read the message in to
  * @Param	int maxLength - Max length of message to read
  *
- * @return   length of message read from queue
+ * @return   length of message read from queue, -1 if empty
  */
 extern int llq_receive(llq_t *hndl, char *buffer, int maxLength);
 
+/*********************************************************************
+ * @fn      llq_peek
+ *
+ * @brief   Take the next message, priority messages first, without
+ *          copying it. The slot stays valid and owned by the caller until
+ *          llq_release(), and keeps counting against the queue capacity.
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_ref_t *ref - returns the slot id, data and length
+ *
+ * @return   length of the message, -1 if empty
+ */
+extern int llq_peek(llq_t *hndl, llq_ref_t *ref);
+
+/*********************************************************************
+ * @fn      llq_release
+ *
+ * @brief   Give back a slot taken with llq_peek()
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_ref_t *ref - reference returned by llq_peek()
+ *
+ * @return   none
+ */
+extern void llq_release(llq_t *hndl, llq_ref_t *ref);
+
+/*********************************************************************
+ * @fn      llq_drop_oldest
+ *
+ * @brief   Remove the oldest normal message, priority ones are kept
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	char *buffer - receives the dropped message
+ * @Param	int maxLength - Max length of message to read
+ *
+ * @return   length of the dropped message, -1 if none is queued
+ */
+extern int llq_drop_oldest(llq_t *hndl, char *buffer, int maxLength);
+
+/*********************************************************************
+ * @fn      llq_set_capacity
+ *
+ * @brief   Limit the number of normal messages, at most LLQ_DEPTH
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	uint32_t capacity - 0 for LLQ_DEPTH
+ *
+ * @return   none
+ */
+extern void llq_set_capacity(llq_t *hndl, uint32_t capacity);
+
+/*********************************************************************
+ * @fn      llq_count
+ *
+ * @brief   Number of messages queued in a lane
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	int prio - 1 for the priority lane
+ *
+ * @return   message count
+ */
+extern uint32_t llq_count(llq_t *hndl, int prio);
+
+/*********************************************************************
+ * @fn      llq_get_stats
+ *
+ * @brief   Get the queue counters
+ *
+ * @param   llq_t *hndl - handle to queue
+ * @Param	llq_stats_t *stats - destination
+ *
+ * @return   none
+ */
+extern void llq_get_stats(llq_t *hndl, llq_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -51,6 +51,8 @@
 #include <signal.h>
 #include <semaphore.h>
 #include <time.h>
+#include <poll.h>
+#include <pthread.h>
 #include "queue.h"
 #include <sys/time.h>
 
@@ -71,6 +73,41 @@
 #define SB_FORCE_RUN               (SB_FORCE_BOOT ^ 0xFF)
 
 #define SRSP_TIMEOUT_MS            (2000) // 2000ms timeout
+
+// maximum number of SREQs waiting for their SRSP
+#define RPC_MAX_PENDING_SREQ       (16)
+
+// ZDO_STATE_CHANGE_IND, merged in the queue when coalescing is enabled
+#define RPC_STATE_IND_CMD0         (MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO)
+#define RPC_STATE_IND_CMD1         (0xC0)
+
+// Rx buffer, holds several frames so one read can drain a burst
+#define RPC_RX_BUFF_LEN            (4 * RPC_MAX_LEN)
+
+#ifdef HAL_UART_IP //No SOF or FCS for IP
+#define RPC_RX_SOF_LEN             (0)
+#define RPC_RX_FCS_LEN             (0)
+#else
+#define RPC_RX_SOF_LEN             (RPC_UART_SOF_LEN)
+#define RPC_RX_FCS_LEN             (RPC_UART_FCS_LEN)
+#endif
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// SREQ waiting for its SRSP
+typedef struct
+{
+	uint8_t inUse;
+	uint8_t subSys;
+	uint8_t cmd1;
+	uint32_t seq;       // send order, oldest entry matches first
+	uint64_t deadline;  // ms, monotonic clock
+	uint8_t queueSrsp;  // also pass the SRSP to the MT callbacks
+	rpcSrspCb_t cb;
+	void *cbArg;
+} rpcPendingSreq_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -79,12 +116,47 @@
  * LOCAL VARIABLES
  */
 
-// expected SRSP command ID
-static uint8_t expectedSrspCmdId;
+// file descriptor returned by the transport layer
+static int rpcFd = -1;
+
+// SREQs sent and not yet answered, keyed on (subsystem, cmd1)
+static rpcPendingSreq_t rpcPending[RPC_MAX_PENDING_SREQ];
+static uint32_t rpcPendingSeq;
+// SRSPs matched and not queued yet, their lane slot stays reserved
+static uint8_t rpcSrspLaneHeld;
+static pthread_mutex_t rpcPendingLock = PTHREAD_MUTEX_INITIALIZER;
+
+// held by whoever is reading the transport
+static pthread_mutex_t rpcRxLock = PTHREAD_MUTEX_INITIALIZER;
+
+// synchronous requests: the SREQ sent next by this thread completes sync
+static __thread rpcSync_t *rpcSyncArmed;
+static pthread_mutex_t rpcSyncLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rpcSyncCond = PTHREAD_COND_INITIALIZER;
+
+// SRSPs hidden from the MT callbacks, see rpcSrspHide(). Queued SRSPs
+// carry the flag in a byte after the FCS.
+static __thread uint8_t rpcSrspHideReq;
+static __thread uint8_t rpcSrspHiddenCur;
 
 // RPC message queue for passing RPC frame from RPC process to APP process
 static llq_t rpcLlq;
 
+// bytes read from the transport and not yet parsed
+static uint8_t rpcRxBuff[RPC_RX_BUFF_LEN];
+static uint16_t rpcRxLen;
+
+static rpcStats_t rpcStats;
+
+// AREQ admission, see rpcQueueConfigure()
+static rpcQueueConfig_t rpcQueueCfg =
+{ 0, RPC_QUEUE_FULL_DROP_NEW, 0, 0, 0, 0 };
+
+// a ZDO_STATE_CHANGE_IND is queued, later ones only update the state
+static pthread_mutex_t rpcStateIndLock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t rpcStateIndQueued;
+static uint8_t rpcStateIndLatest;
+
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -99,6 +171,24 @@ static uint8_t calcFcs(uint8_t *msg, uint8_t len);
 // function for printing out RPC frames
 static void printRpcMsg(char* preMsg, uint8_t sof, uint8_t len, uint8_t *msg);
 
+// functions for extracting frames from the Rx buffer
+static int32_t rpcParseRxBuff(void);
+static void rpcQueueFrame(uint8_t *rpcBuff);
+static void rpcQueueAreq(uint8_t *frame, uint16_t len);
+static uint8_t rpcIsStateInd(uint8_t *frame);
+
+// functions for SREQ/SRSP correlation
+static uint64_t rpcNowMs(void);
+static int32_t rpcPendingNextTimeout(void);
+static void rpcPendingExpire(void);
+static void rpcPendingRemove(void *cbArg);
+
+// functions for synchronous requests
+static int32_t rpcProcessRx(void);
+static int32_t rpcReadRx(int32_t *bytesRead);
+static void rpcSyncDone(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg);
+
 /*********************************************************************
  * API FUNCTIONS
  */
@@ -124,6 +214,7 @@ int32_t rpcOpen(char *_devicePath)
 		LOG_CRI("%s device open failed", _devicePath);
 		return (-1);
 	}
+	rpcFd = fd;
 
 	return fd;
 }
@@ -138,6 +229,7 @@ int32_t rpcOpen(char *_devicePath)
 void rpcClose(void)
 {
     rpcTransportClose();
+    rpcFd = -1;
 }
 
 
@@ -169,24 +261,47 @@ int32_t rpcInitMq(void)
  */
 int32_t rpcGetMqClientMsg(void)
 {
-	uint8_t rpcFrame[RPC_MAX_LEN + 1];
+	llq_ref_t ref;
+	uint8_t *rpcFrame;
 	int32_t rpcLen;
 
 	LOG_DBG("Retrieving new message from queue");
 
-	// wait for incoming message queue
-	rpcLen = llq_receive(&rpcLlq, (char *) rpcFrame, RPC_MAX_LEN + 1);
+	// the frame is processed in place, its slot is released afterwards
+	rpcLen = llq_peek(&rpcLlq, &ref);
 
 	if (rpcLen != -1)
 	{
+		rpcFrame = (uint8_t *) ref.data;
 		LOG_DBG("processing MT[%d]", rpcLen);
 
+		if (rpcIsStateInd(rpcFrame))
+		{
+			// report the newest state merged into this indication
+			pthread_mutex_lock(&rpcStateIndLock);
+			if (rpcStateIndQueued)
+			{
+				rpcFrame[2] = rpcStateIndLatest;
+				rpcStateIndQueued = 0;
+			}
+			pthread_mutex_unlock(&rpcStateIndLock);
+		}
+
+		if ((rpcFrame[0] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
+		{
+			// strip the flag appended by rpcQueueFrame()
+			rpcLen--;
+			rpcSrspHiddenCur = rpcFrame[rpcLen];
+		}
+
 		// process incoming message
 		mtProcess(rpcFrame, rpcLen);
+		rpcSrspHiddenCur = 0;
+		llq_release(&rpcLlq, &ref);
 	}
 	else
 	{
-		LOG_ERR("No message in queue");
+		LOG_DBG("No message in queue");
 		return -1;
 	}
 
@@ -213,161 +328,384 @@ void rpcForceRun(void)
 /*************************************************************************************************
  * @fn      rpcProcess()
  *
- * @brief   Read bytes from transport layer and form an RPC frame
+ * @brief   Read the bytes available from the transport layer into the Rx
+ *          buffer and queue every complete RPC frame found in it. A partial
+ *          frame is kept for the next call.
  *
  * @param   none
  *
- * @return  length of current Rx Buffer
+ * @return  number of frames queued, -1 on transport error
  *************************************************************************************************/
 int32_t rpcProcess(void)
 {
-	uint8_t rpcLen, rpcTempLen, bytesRead, sofByte, rpcBuffIdx;
-	uint8_t retryAttempts = 0, len, rpcBuff[RPC_MAX_LEN];
-	uint8_t fcs;
+	int32_t frames;
 
-#ifndef HAL_UART_IP //No SOF for IP	//read first byte and check it is a SOF
-	bytesRead = rpcTransportRead(&sofByte, 1);
+	pthread_mutex_lock(&rpcRxLock);
+	frames = rpcProcessRx();
+	pthread_mutex_unlock(&rpcRxLock);
 
-	if ((sofByte == MT_RPC_SOF) && (bytesRead == 1))
-#endif
-	{
-		// clear retry counter
-		retryAttempts = 0;
+	return frames;
+}
+
+/*************************************************************************************************
+ * @fn      rpcProcessReady()
+ *
+ * @brief   Non-blocking rpcProcess() for event loops. Reads every byte the
+ *          transport has ready, queues the complete frames and returns as
+ *          soon as no more data is pending. A partial frame is kept for
+ *          the next call. If another thread is reading the transport, it
+ *          only reports the expired SREQs and returns 0, that thread
+ *          queues the frames.
+ *
+ * @param   none
+ *
+ * @return  number of frames queued, -1 on transport error
+ *************************************************************************************************/
+int32_t rpcProcessReady(void)
+{
+	struct pollfd pfd;
+	int32_t frames = 0;
+	int32_t bytesRead, ret;
 
-		// read length byte
-		bytesRead = rpcTransportRead(&rpcLen, 1);
+	if (pthread_mutex_trylock(&rpcRxLock) != 0)
+	{
+		// the reader may be blocked past a deadline, report it from here
+		rpcPendingExpire();
+		return 0;
+	}
 
-		if (bytesRead == 1)
+	pfd.fd = rpcFd;
+	pfd.events = POLLIN;
+	while ((rpcFd >= 0) && (poll(&pfd, 1, 0) > 0))
+	{
+		if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))
 		{
-			len = rpcLen;
-			rpcBuff[0] = rpcLen;
+			frames = -1;
+			break;
+		}
+		ret = rpcReadRx(&bytesRead);
+		if (ret < 0)
+		{
+			frames = -1;
+			break;
+		}
+		frames += ret;
+		if (bytesRead <= 0)
+		{
+			// readable but nothing read: end of file or spurious wakeup
+			break;
+		}
+	}
+	rpcPendingExpire();
+	pthread_mutex_unlock(&rpcRxLock);
 
-#ifdef HAL_UART_IP //No FCS for IP			//allocating RPC payload (+ cmd0, cmd1)
-			rpcLen += RPC_CMD0_FIELD_LEN + RPC_CMD1_FIELD_LEN;
-#else
-			//allocating RPC payload (+ cmd0, cmd1 and fcs)
-			rpcLen +=
-			RPC_CMD0_FIELD_LEN + RPC_CMD1_FIELD_LEN + RPC_UART_FCS_LEN;
-#endif
+	return frames;
+}
 
-			//non blocking read, so we need to wait for the rpc to be read
-			rpcBuffIdx = 1;
-			rpcTempLen = rpcLen;
-			while (rpcTempLen > 0)
-			{
-				// read RPC frame
-				bytesRead = rpcTransportRead(&(rpcBuff[rpcBuffIdx]),
-				        rpcTempLen);
+/*********************************************************************
+ * @fn      rpcSyncArm
+ *
+ * @brief   Make the next SREQ sent by the calling thread synchronous.
+ *          Its SRSP is stored in sync and not passed to the MT
+ *          callbacks. Must be followed by rpcSyncWait() once the SREQ
+ *          has been sent, or by rpcSyncArm(NULL, 0) if sending failed.
+ *
+ * @param   sync - completion context, NULL to disarm
+ * @param   timeoutMs - SRSP timeout, 0 for the default SRSP_TIMEOUT_MS
+ *
+ * @return  -
+ */
+void rpcSyncArm(rpcSync_t *sync, uint32_t timeoutMs)
+{
+	if (sync)
+	{
+		sync->timeoutMs = timeoutMs ? timeoutMs : SRSP_TIMEOUT_MS;
+		sync->done = 0;
+		sync->status = MT_RPC_ERR_TIMEOUT;
+		sync->srspLen = 0;
+	}
+	rpcSyncArmed = sync;
+}
 
-				// check for error
-				if (bytesRead > rpcTempLen)
-				{
-					//there was an error
-					LOG_ERR("read of %d bytes failed - %s", rpcTempLen, strerror(errno));
-
-					// check whether retry limits has been reached
-					if (retryAttempts++ < 5)
-					{
-						// sleep for 10ms
-						usleep(10000);
-
-						// try again
-						bytesRead = 0;
-					}
-					else
-					{
-						// something went wrong, abort
-						LOG_CRI("transport read failed too many times");
-
-						return -1;
-					}
-				}
+/*********************************************************************
+ * @fn      rpcSyncWait
+ *
+ * @brief   Wait for the SRSP of the SREQ sent with rpcSyncArm(). If no
+ *          other thread is reading the transport the caller reads it
+ *          itself, otherwise it sleeps until the reader hands over the
+ *          SRSP. Either way it wakes on the SRSP, not on a polling
+ *          period.
+ *
+ * @param   sync - completion context passed to rpcSyncArm()
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_TIMEOUT or MT_RPC_ERR_TRANSPORT
+ */
+uint8_t rpcSyncWait(rpcSync_t *sync)
+{
+	uint64_t deadline = rpcNowMs() + sync->timeoutMs;
+	uint8_t done;
 
-				// update counters
-				if (rpcTempLen > bytesRead)
-				{
-					rpcTempLen -= bytesRead;
-				}
-				else
-				{
-					rpcTempLen = 0;
-				}
-				rpcBuffIdx += bytesRead;
-			}
+	if (rpcSyncArmed == sync)
+	{
+		// no SREQ went out
+		rpcSyncArmed = NULL;
+		return MT_RPC_ERR_TRANSPORT;
+	}
 
-			// print out incoming RPC frame
-			printRpcMsg("SOC IN  <--", MT_RPC_SOF, len, &rpcBuff[1]);
+	pthread_mutex_lock(&rpcSyncLock);
+	done = sync->done;
+	pthread_mutex_unlock(&rpcSyncLock);
 
-			//Verify FCS of incoming MT frames
-			fcs = calcFcs(&rpcBuff[0], (len + 3));
-			if (rpcBuff[len + 3] != fcs)
+	while (!done)
+	{
+		if (pthread_mutex_trylock(&rpcRxLock) == 0)
+		{
+			// nobody reading, pump the transport until our SRSP arrives
+			int32_t frames = rpcProcessRx();
+			pthread_mutex_unlock(&rpcRxLock);
+			if (frames < 0)
 			{
-				LOG_ERR("fcs error %x:%x", rpcBuff[len + 3], fcs);
-				return -1;
+				rpcPendingRemove(sync);
+				return MT_RPC_ERR_TRANSPORT;
 			}
+		}
+		else
+		{
+			struct timespec ts;
+			uint64_t now = rpcNowMs();
 
-			if ((rpcBuff[1] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
+			if (now >= deadline)
+			{
+				rpcPendingExpire();
+			}
+			else
 			{
-				// SRSP command ID deteced
-				if (expectedSrspCmdId == (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK))
+				// wait for the reading thread to complete us
+				clock_gettime(CLOCK_REALTIME, &ts);
+				ts.tv_sec += (deadline - now) / 1000;
+				ts.tv_nsec += ((deadline - now) % 1000) * 1000000;
+				if (ts.tv_nsec >= 1000000000)
 				{
-					LOG_DBG( "Processing expected srsp [%02X]", rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK);
-					LOG_DBG( "Writing %d bytes SRSP to head of the queue", rpcLen);
-
-					// send message to queue
-					llq_add(&rpcLlq, (char*) &rpcBuff[1], rpcLen, 1);
-                    expectedSrspCmdId = 0xFF;
+					ts.tv_sec++;
+					ts.tv_nsec -= 1000000000;
 				}
-				else
+				pthread_mutex_lock(&rpcSyncLock);
+				if (!sync->done)
 				{
-					// unexpected SRSP discard
-					LOG_ERR( "UNEXPECTED SREQ!: %02X:%02X", expectedSrspCmdId, (rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK));
-                    expectedSrspCmdId = 0xFF;
-					return 0;
+					pthread_cond_timedwait(&rpcSyncCond, &rpcSyncLock, &ts);
 				}
+				pthread_mutex_unlock(&rpcSyncLock);
 			}
-			else
-			{
-				// should be AREQ frame
-				LOG_DBG("writing %d bytes AREQ to tail of the queue", rpcLen);
-
-				// send message to queue
-				llq_add(&rpcLlq, (char*) &rpcBuff[1], rpcLen, 0);
-			}
-
-			return 0;
-		}
-		else
-		{
-			LOG_ERR("Len Not read [%x]", bytesRead);
 		}
+
+		pthread_mutex_lock(&rpcSyncLock);
+		done = sync->done;
+		pthread_mutex_unlock(&rpcSyncLock);
 	}
-	else
-	{
-		LOG_ERR("No valid Start Of Frame found [%x:%x]", sofByte, bytesRead);
-	}
 
-	return -1;
+	return sync->status;
+}
+
+/*********************************************************************
+ * @fn      rpcSrspHide
+ *
+ * @brief   Called from an SRSP completion callback: the SRSP is queued
+ *          marked hidden, so that the MT callbacks can tell it belongs
+ *          to the framework, see rpcSrspHidden().
+ *
+ * @return  -
+ */
+void rpcSrspHide(void)
+{
+	rpcSrspHideReq = 1;
+}
+
+/*********************************************************************
+ * @fn      rpcSrspHidden
+ *
+ * @brief   Called from the MT callbacks of an SRSP
+ *
+ * @return  1 if the completion callback of the SRSP being dispatched
+ *          called rpcSrspHide(), else 0
+ */
+uint8_t rpcSrspHidden(void)
+{
+	return rpcSrspHiddenCur;
+}
+
+/*********************************************************************
+ * @fn      rpcGetStats
+ *
+ * @brief   Copy the RPC layer counters
+ *
+ * @param   stats - destination
+ *
+ * @return  -
+ */
+void rpcGetStats(rpcStats_t *stats)
+{
+	llq_stats_t qStats;
+
+	memcpy(stats, &rpcStats, sizeof(rpcStats_t));
+
+	llq_get_stats(&rpcLlq, &qStats);
+	stats->queueCount = qStats.count;
+	stats->queueHwm = qStats.hwm;
+	stats->queueOverflows = qStats.overflows;
+}
+
+/*********************************************************************
+ * @fn      rpcQueueConfigure
+ *
+ * @brief   Set the message queue capacity and what to drop when the
+ *          application does not keep up. Only AREQs are subject to it,
+ *          SRSPs always get into the queue.
+ *
+ * @param   cfg - queue configuration
+ *
+ * @return  -
+ */
+void rpcQueueConfigure(const rpcQueueConfig_t *cfg)
+{
+	rpcQueueCfg = *cfg;
+	llq_set_capacity(&rpcLlq, cfg->capacity);
 }
 
 /*************************************************************************************************
- * @fn      sendRpcFrame()
+ * @fn      rpcSendFrame()
  *
  * @brief   builds the Frame and sends it to the transport layer - usually called by the
- *          application thread(s)
+ *          application thread(s). The SRSP of an SREQ is passed to the MT
+ *          callbacks through the message queue.
  *
  * @param   cmd0 System, cmd1 subsystem, ptr to payload, lenght of payload
  *
- * @return  length of current Rx Buffer
+ * @return  status
  *************************************************************************************************/
 uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
         uint8_t payload_len)
 {
-	uint8_t buf[RPC_MAX_LEN];
+	return rpcSendFrameCb(cmd0, cmd1, payload, payload_len, SRSP_TIMEOUT_MS,
+	        NULL, NULL);
+}
+
+/*************************************************************************************************
+ * @fn      rpcSendFrameCb()
+ *
+ * @brief   rpcFrameSendCb() for a payload held in a separate buffer, which
+ *          is copied into the frame.
+ *
+ * @param   cmd0 - command type and subsystem
+ * @param   cmd1 - command ID
+ * @param   payload - frame payload
+ * @param   payload_len - payload length
+ * @param   timeoutMs - SRSP timeout, 0 for the default SRSP_TIMEOUT_MS
+ * @param   cb - completion callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  see rpcFrameSendCb()
+ *************************************************************************************************/
+uint8_t rpcSendFrameCb(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
+        uint8_t payload_len, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg)
+{
+	rpcFrame_t frame;
+	uint8_t *data = rpcFrameInit(&frame, payload_len);
+
+	if (data == NULL)
+	{
+		LOG_ERR("Payload of %02X:%02X too long", cmd0, cmd1);
+		return MT_RPC_ERR_LENGTH;
+	}
+	if (payload_len > 0)
+	{
+		memcpy(data, payload, payload_len);
+	}
+
+	return rpcFrameSendCb(&frame, cmd0, cmd1, payload_len, timeoutMs, cb,
+	        cbArg);
+}
+
+/*************************************************************************************************
+ * @fn      rpcFrameInit()
+ *
+ * @brief   reserves room for a frame of payloadLen bytes. The caller
+ *          serializes the payload at the returned address, then sends it
+ *          with rpcFrameSend(), which fills in the header and FCS around
+ *          it without copying the payload.
+ *
+ * @param   frame - frame to build, usually on the caller stack
+ * @param   payloadLen - payload length
+ *
+ * @return  where to write the payload, NULL if it does not fit a frame
+ *************************************************************************************************/
+uint8_t *rpcFrameInit(rpcFrame_t *frame, uint32_t payloadLen)
+{
+	if (payloadLen > RPC_MAX_PAYLOAD_LEN)
+	{
+		return NULL;
+	}
+	return &frame->buf[RPC_UART_HDR_LEN];
+}
+
+/*************************************************************************************************
+ * @fn      rpcFrameSend()
+ *
+ * @brief   sends a frame built with rpcFrameInit(). The SRSP of an SREQ is
+ *          passed to the MT callbacks through the message queue.
+ *
+ * @param   frame - frame whose payload has been written
+ * @param   cmd0 - command type and subsystem
+ * @param   cmd1 - command ID
+ * @param   payload_len - payload length
+ *
+ * @return  status
+ *************************************************************************************************/
+uint8_t rpcFrameSend(rpcFrame_t *frame, uint8_t cmd0, uint8_t cmd1,
+        uint8_t payload_len)
+{
+	return rpcFrameSendCb(frame, cmd0, cmd1, payload_len, SRSP_TIMEOUT_MS,
+	        NULL, NULL);
+}
+
+/*************************************************************************************************
+ * @fn      rpcFrameSendCb()
+ *
+ * @brief   completes a frame built with rpcFrameInit() and sends it to the
+ *          transport layer. For an SREQ
+ *          an entry is added to the pending table before the frame is
+ *          written, so several SREQs can be outstanding at once. When the
+ *          SRSP with the same subsystem and command ID arrives, or the
+ *          timeout expires first, cb is called from the context running
+ *          rpcProcess(). The SRSP still goes to the MT callbacks, marked
+ *          hidden if cb calls rpcSrspHide().
+ *
+ * @param   frame - frame whose payload has been written
+ * @param   cmd0 - command type and subsystem
+ * @param   cmd1 - command ID
+ * @param   payload_len - payload length
+ * @param   timeoutMs - SRSP timeout, 0 for the default SRSP_TIMEOUT_MS
+ * @param   cb - completion callback, can be NULL
+ * @param   cbArg - passed back to cb
+ *
+ * @return  MT_RPC_SUCCESS, MT_RPC_ERR_BUSY when too many SREQs are
+ *          outstanding
+ *************************************************************************************************/
+uint8_t rpcFrameSendCb(rpcFrame_t *frame, uint8_t cmd0, uint8_t cmd1,
+        uint8_t payload_len, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg)
+{
+	uint8_t *buf = frame->buf;
 	int32_t status = MT_RPC_SUCCESS;
+	int32_t written;
+	uint8_t idx = RPC_MAX_PENDING_SREQ;
 
 	LOG_DBG("Sending RPC");
 
+	if (payload_len > RPC_MAX_PAYLOAD_LEN)
+	{
+		LOG_ERR("Payload of %02X:%02X too long", cmd0, cmd1);
+		return MT_RPC_ERR_LENGTH;
+	}
+
 	// fill in header bytes
 	buf[0] = MT_RPC_SOF;
 	buf[1] = payload_len;
@@ -376,15 +714,65 @@ uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
 
 	if ((cmd0 & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SREQ)
 	{
-		// calculate expected SRSP
-		expectedSrspCmdId = (cmd0 & MT_RPC_SUBSYSTEM_MASK);
-        LOG_DBG("Expecting SRSP %02X", expectedSrspCmdId);
-	}
+		uint8_t queueSrsp = 1;
 
-	if (payload_len > 0)
-	{
-		// copy payload to buffer
-		memcpy(buf + RPC_UART_HDR_LEN, payload, payload_len);
+		if (rpcSyncArmed && (cb == NULL))
+		{
+			// synchronous request, the waiter consumes the SRSP
+			cb = rpcSyncDone;
+			cbArg = rpcSyncArmed;
+			timeoutMs = rpcSyncArmed->timeoutMs;
+			queueSrsp = 0;
+		}
+
+		// register the expected SRSP before it can possibly arrive
+		pthread_mutex_lock(&rpcPendingLock);
+		if (queueSrsp)
+		{
+			// the SRSP must find a slot in the priority lane
+			uint32_t lane = llq_count(&rpcLlq, 1) + rpcSrspLaneHeld;
+
+			for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+			{
+				lane += rpcPending[idx].inUse && rpcPending[idx].queueSrsp;
+			}
+			if (lane >= LLQ_PRIO_DEPTH)
+			{
+				pthread_mutex_unlock(&rpcPendingLock);
+				LOG_ERR("SRSP lane full, %02X:%02X not sent", cmd0, cmd1);
+				return MT_RPC_ERR_BUSY;
+			}
+		}
+		for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+		{
+			if (!rpcPending[idx].inUse)
+			{
+				break;
+			}
+		}
+		if (idx == RPC_MAX_PENDING_SREQ)
+		{
+			pthread_mutex_unlock(&rpcPendingLock);
+			LOG_ERR("Too many outstanding SREQs, %02X:%02X not sent", cmd0,
+			        cmd1);
+			return MT_RPC_ERR_BUSY;
+		}
+		rpcPending[idx].inUse = 1;
+		rpcPending[idx].subSys = cmd0 & MT_RPC_SUBSYSTEM_MASK;
+		rpcPending[idx].cmd1 = cmd1;
+		rpcPending[idx].seq = rpcPendingSeq++;
+		rpcPending[idx].deadline = rpcNowMs()
+		        + (timeoutMs ? timeoutMs : SRSP_TIMEOUT_MS);
+		rpcPending[idx].queueSrsp = queueSrsp;
+		rpcPending[idx].cb = cb;
+		rpcPending[idx].cbArg = cbArg;
+		pthread_mutex_unlock(&rpcPendingLock);
+		if (!queueSrsp)
+		{
+			rpcSyncArmed = NULL;
+		}
+
+		LOG_DBG("Expecting SRSP %02X:%02X", cmd0 & MT_RPC_SUBSYSTEM_MASK, cmd1);
 	}
 
 	// calculate FCS field
@@ -393,23 +781,527 @@ uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
 
 #ifdef HAL_UART_IP
 	// No SOF or FCS
-	rpcTransportWrite(buf+1, payload_len + RPC_HDR_LEN + RPC_UART_FCS_LEN);
+	written = rpcTransportWrite(buf+1, payload_len + RPC_HDR_LEN + RPC_UART_FCS_LEN);
 #else
 	// send out RPC  message
-	rpcTransportWrite(buf, payload_len + RPC_UART_HDR_LEN + RPC_UART_FCS_LEN);
+	written = rpcTransportWrite(buf, payload_len + RPC_UART_HDR_LEN + RPC_UART_FCS_LEN);
 #endif
+	if (written < 0)
+	{
+		// no SRSP will come for a frame that did not go out
+		if (idx < RPC_MAX_PENDING_SREQ)
+		{
+			pthread_mutex_lock(&rpcPendingLock);
+			rpcPending[idx].inUse = 0;
+			pthread_mutex_unlock(&rpcPendingLock);
+		}
+		LOG_ERR("Failed to send %02X:%02X", cmd0, cmd1);
+		return MT_RPC_ERR_TRANSPORT;
+	}
 
 	// print out message to be sent
 	printRpcMsg("SOC OUT -->", buf[0], payload_len, &buf[2]);
-    status = MT_RPC_SUCCESS;
 
 	return status;
 }
 
+/*********************************************************************
+ * @fn      rpcGetNextTimeout
+ *
+ * @brief   Time until the earliest SRSP deadline, for callers that wait
+ *          on the transport file descriptor themselves
+ *
+ * @param   -
+ *
+ * @return  timeout in ms, -1 if no SREQ is outstanding
+ */
+int32_t rpcGetNextTimeout(void)
+{
+	return rpcPendingNextTimeout();
+}
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
 
+/*********************************************************************
+ * @fn      rpcProcessRx
+ *
+ * @brief   Body of rpcProcess(), called with rpcRxLock held. Polls
+ *          the transport up to the next SRSP deadline.
+ */
+static int32_t rpcProcessRx(void)
+{
+	int32_t bytesRead, frames, timeout;
+
+	// do not block past the deadline of an outstanding SREQ
+	timeout = rpcPendingNextTimeout();
+	if ((timeout >= 0) && (rpcFd >= 0))
+	{
+		struct pollfd pfd;
+
+		pfd.fd = rpcFd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeout) == 0)
+		{
+			rpcPendingExpire();
+			return 0;
+		}
+	}
+
+	frames = rpcReadRx(&bytesRead);
+	rpcPendingExpire();
+
+	return frames;
+}
+
+/*********************************************************************
+ * @fn      rpcReadRx
+ *
+ * @brief   Read as much as the transport has ready, at least 1 byte
+ *          (blocking unless the port is ready), and queue the complete
+ *          frames. Called with rpcRxLock held.
+ *
+ * @param   bytesRead - returns the number of bytes read
+ *
+ * @return  number of frames queued, -1 on transport error
+ */
+static int32_t rpcReadRx(int32_t *bytesRead)
+{
+	*bytesRead = rpcTransportRead(&rpcRxBuff[rpcRxLen],
+	        sizeof(rpcRxBuff) - rpcRxLen);
+	if (*bytesRead < 0)
+	{
+		if ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		LOG_ERR("read of %d bytes failed - %s",
+		        (int) (sizeof(rpcRxBuff) - rpcRxLen), strerror(errno));
+		return -1;
+	}
+	rpcStats.reads++;
+	rpcRxLen += *bytesRead;
+
+	return rpcParseRxBuff();
+}
+
+/*********************************************************************
+ * @fn      rpcParseRxBuff
+ *
+ * @brief   Extract all complete frames from the Rx buffer. Bytes before a
+ *          SOF are skipped. A SOF with an invalid length or a frame failing
+ *          the FCS only costs its SOF byte: scanning resumes right after
+ *          it, so a real frame starting inside the corrupted one is kept.
+ *
+ * @param   -
+ *
+ * @return  number of frames queued
+ */
+static int32_t rpcParseRxBuff(void)
+{
+	uint16_t idx = 0;
+	int32_t frames = 0;
+
+	while (idx < rpcRxLen)
+	{
+		uint16_t frameLen;
+		uint8_t len;
+
+#ifndef HAL_UART_IP //No SOF for IP
+		if (rpcRxBuff[idx] != MT_RPC_SOF)
+		{
+			uint8_t *sof = memchr(&rpcRxBuff[idx], MT_RPC_SOF, rpcRxLen - idx);
+			uint16_t next = sof ? (uint16_t) (sof - rpcRxBuff) : rpcRxLen;
+
+			LOG_ERR("No valid Start Of Frame found, %d bytes skipped",
+			        next - idx);
+			rpcStats.bytesDiscarded += next - idx;
+			idx = next;
+			continue;
+		}
+#endif
+		if (rpcRxLen - idx < RPC_RX_SOF_LEN + RPC_LEN_FIELD_LEN)
+		{
+			break;
+		}
+
+		len = rpcRxBuff[idx + RPC_RX_SOF_LEN];
+		if (len > RPC_MAX_LEN - RPC_HDR_LEN - RPC_UART_FCS_LEN)
+		{
+			LOG_ERR("invalid frame length %d", len);
+			rpcStats.bytesDiscarded += RPC_RX_SOF_LEN ? RPC_RX_SOF_LEN : 1;
+			idx++;
+			continue;
+		}
+
+		frameLen = RPC_RX_SOF_LEN + RPC_HDR_LEN + len + RPC_RX_FCS_LEN;
+		if (rpcRxLen - idx < frameLen)
+		{
+			// wait for the rest of the frame
+			break;
+		}
+
+		// print out incoming RPC frame
+		printRpcMsg("SOC IN  <--", MT_RPC_SOF, len,
+		        &rpcRxBuff[idx + RPC_RX_SOF_LEN + RPC_LEN_FIELD_LEN]);
+
+#ifndef HAL_UART_IP //No FCS for IP
+		//Verify FCS of incoming MT frames
+		{
+			uint8_t fcs = calcFcs(&rpcRxBuff[idx + RPC_RX_SOF_LEN],
+			        RPC_HDR_LEN + len);
+			if (rpcRxBuff[idx + frameLen - 1] != fcs)
+			{
+				LOG_ERR("fcs error %x:%x", rpcRxBuff[idx + frameLen - 1], fcs);
+				rpcStats.fcsErrors++;
+				rpcStats.bytesDiscarded++;
+				idx++;
+				continue;
+			}
+		}
+#endif
+
+		rpcQueueFrame(&rpcRxBuff[idx + RPC_RX_SOF_LEN]);
+		rpcStats.framesRx++;
+		frames++;
+		idx += frameLen;
+	}
+
+	// keep the partial frame at the start of the buffer, frames are
+	// always contiguous for the parser
+	if (idx > 0)
+	{
+		memmove(rpcRxBuff, &rpcRxBuff[idx], rpcRxLen - idx);
+		rpcRxLen -= idx;
+	}
+
+	return frames;
+}
+
+/*********************************************************************
+ * @fn      rpcQueueFrame
+ *
+ * @brief   Pass a received frame to the application message queue, SRSP
+ *          to the head and AREQ to the tail.
+ *
+ * @param   rpcBuff - frame starting at the length byte
+ *
+ * @return  -
+ */
+static void rpcQueueFrame(uint8_t *rpcBuff)
+{
+	// cmd0, cmd1, payload and fcs
+	uint16_t rpcLen = rpcBuff[0] + RPC_CMD0_FIELD_LEN + RPC_CMD1_FIELD_LEN
+	        + RPC_UART_FCS_LEN;
+
+	if ((rpcBuff[1] & MT_RPC_CMD_TYPE_MASK) == MT_RPC_CMD_SRSP)
+	{
+		uint8_t subSys = rpcBuff[1] & MT_RPC_SUBSYSTEM_MASK;
+		rpcPendingSreq_t *match = NULL;
+		rpcPendingSreq_t done;
+		uint8_t srsp[RPC_MAX_LEN + 1];
+		uint8_t idx;
+
+		// oldest outstanding SREQ with the same subsystem and command ID
+		pthread_mutex_lock(&rpcPendingLock);
+		for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+		{
+			if (rpcPending[idx].inUse && (rpcPending[idx].subSys == subSys)
+			        && (rpcPending[idx].cmd1 == rpcBuff[2])
+			        && ((match == NULL)
+			                || ((int32_t) (rpcPending[idx].seq - match->seq) < 0)))
+			{
+				match = &rpcPending[idx];
+			}
+		}
+		if (match)
+		{
+			done = *match;
+			match->inUse = 0;
+			// an SREQ sent by the callback must not take its room
+			rpcSrspLaneHeld += done.queueSrsp;
+		}
+		pthread_mutex_unlock(&rpcPendingLock);
+
+		if (match == NULL)
+		{
+			// unexpected SRSP discard
+			LOG_ERR("UNEXPECTED SRSP!: %02X:%02X", rpcBuff[1], rpcBuff[2]);
+			rpcStats.srspUnexpected++;
+			return;
+		}
+
+		LOG_DBG( "Processing expected srsp [%02X:%02X]", subSys, rpcBuff[2]);
+		rpcSrspHideReq = 0;
+		if (done.cb)
+		{
+			done.cb(MT_RPC_SUCCESS, &rpcBuff[1], rpcLen, done.cbArg);
+		}
+		if (!done.queueSrsp)
+		{
+			return;
+		}
+
+		LOG_DBG( "Writing %d bytes SRSP to the priority lane", rpcLen);
+
+		// the frame and whether it is hidden, see rpcGetMqClientMsg()
+		memcpy(srsp, &rpcBuff[1], rpcLen);
+		srsp[rpcLen] = rpcSrspHideReq;
+		rpcSrspHideReq = 0;
+
+		// send message to queue, room was reserved by rpcSendFrameCb()
+		if (llq_add(&rpcLlq, (char*) srsp, rpcLen + 1, 1) < 0)
+		{
+			LOG_ERR("Queue full, SRSP %02X:%02X dropped", rpcBuff[1], rpcBuff[2]);
+		}
+		pthread_mutex_lock(&rpcPendingLock);
+		rpcSrspLaneHeld--;
+		pthread_mutex_unlock(&rpcPendingLock);
+	}
+	else
+	{
+		// should be AREQ frame
+		LOG_DBG("writing %d bytes AREQ to tail of the queue", rpcLen);
+
+		rpcQueueAreq(&rpcBuff[1], rpcLen);
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcIsStateInd
+ *
+ * @brief   check for a ZDO_STATE_CHANGE_IND, frame starts at Cmd0
+ *
+ * @return  1 if it is one
+ */
+static uint8_t rpcIsStateInd(uint8_t *frame)
+{
+	return (frame[0] == RPC_STATE_IND_CMD0) && (frame[1] == RPC_STATE_IND_CMD1);
+}
+
+/*********************************************************************
+ * @fn      rpcQueueAreq
+ *
+ * @brief   add an AREQ to the tail of the queue. AREQs nobody handles or
+ *          subscribed to are dropped first, see mtIsWanted(), then the
+ *          policies of rpcQueueConfigure() apply in order: subsystem
+ *          shedding, state indication coalescing, then the queue full
+ *          policy.
+ *
+ * @param   frame - Cmd0, Cmd1, payload and FCS
+ * @param   len - frame length
+ *
+ * @return  -
+ */
+static void rpcQueueAreq(uint8_t *frame, uint16_t len)
+{
+	uint8_t stateInd = rpcIsStateInd(frame);
+	uint8_t dropped[RPC_MAX_LEN + 1];
+
+	if (!mtIsWanted(frame[0], frame[1]))
+	{
+		LOG_DBG("No listener for AREQ %02X:%02X", frame[0], frame[1]);
+		rpcStats.areqIgnored++;
+		return;
+	}
+
+	if ((rpcQueueCfg.shedSubsysMask & (1UL << (frame[0] & MT_RPC_SUBSYSTEM_MASK)))
+	        && (llq_count(&rpcLlq, 0) >= rpcQueueCfg.shedThreshold))
+	{
+		LOG_DBG("Shedding AREQ %02X:%02X", frame[0], frame[1]);
+		rpcStats.queueShed++;
+		return;
+	}
+
+	if (stateInd && rpcQueueCfg.coalesceStateInd)
+	{
+		pthread_mutex_lock(&rpcStateIndLock);
+		rpcStateIndLatest = frame[2];
+		if (rpcStateIndQueued)
+		{
+			pthread_mutex_unlock(&rpcStateIndLock);
+			rpcStats.queueCoalesced++;
+			return;
+		}
+		rpcStateIndQueued = 1;
+		pthread_mutex_unlock(&rpcStateIndLock);
+	}
+
+	if (llq_add(&rpcLlq, (char*) frame, len, 0) == 0)
+	{
+		return;
+	}
+
+	switch (rpcQueueCfg.fullPolicy)
+	{
+	case RPC_QUEUE_FULL_BLOCK:
+		rpcStats.queueBlocked++;
+		if (llq_add_timed(&rpcLlq, (char*) frame, len, 0,
+		        rpcQueueCfg.blockTimeoutMs) == 0)
+		{
+			return;
+		}
+		rpcStats.queueBlockTimeouts++;
+		break;
+
+	case RPC_QUEUE_FULL_DROP_OLDEST:
+		// the consumer may have made room meanwhile, just retry then
+		if (llq_drop_oldest(&rpcLlq, (char*) dropped, sizeof(dropped)) > 0)
+		{
+			LOG_WARN("Queue full, AREQ %02X:%02X dropped", dropped[0],
+			        dropped[1]);
+			rpcStats.queueDroppedOldest++;
+			if (rpcIsStateInd(dropped))
+			{
+				pthread_mutex_lock(&rpcStateIndLock);
+				rpcStateIndQueued = 0;
+				pthread_mutex_unlock(&rpcStateIndLock);
+			}
+		}
+		if (llq_add(&rpcLlq, (char*) frame, len, 0) == 0)
+		{
+			return;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	LOG_WARN("Queue full, AREQ %02X:%02X dropped", frame[0], frame[1]);
+	if (stateInd && rpcQueueCfg.coalesceStateInd)
+	{
+		pthread_mutex_lock(&rpcStateIndLock);
+		rpcStateIndQueued = 0;
+		pthread_mutex_unlock(&rpcStateIndLock);
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcNowMs
+ *
+ * @brief   monotonic time in ms, used for SRSP deadlines
+ */
+static uint64_t rpcNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @fn      rpcPendingNextTimeout
+ *
+ * @brief   Time until the earliest SRSP deadline
+ *
+ * @return  timeout in ms, -1 if no SREQ is outstanding
+ */
+static int32_t rpcPendingNextTimeout(void)
+{
+	uint64_t now = rpcNowMs();
+	uint64_t next = 0;
+	uint8_t idx;
+
+	pthread_mutex_lock(&rpcPendingLock);
+	for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+	{
+		if (rpcPending[idx].inUse
+		        && ((next == 0) || (rpcPending[idx].deadline < next)))
+		{
+			next = rpcPending[idx].deadline;
+		}
+	}
+	pthread_mutex_unlock(&rpcPendingLock);
+
+	if (next == 0)
+	{
+		return -1;
+	}
+	return (next > now) ? (int32_t) (next - now) : 0;
+}
+
+/*********************************************************************
+ * @fn      rpcPendingExpire
+ *
+ * @brief   Drop the SREQs whose deadline has passed and report
+ *          MT_RPC_ERR_TIMEOUT to their callback
+ */
+static void rpcPendingExpire(void)
+{
+	rpcPendingSreq_t expired[RPC_MAX_PENDING_SREQ];
+	uint8_t cnt = 0, idx;
+	uint64_t now = rpcNowMs();
+
+	pthread_mutex_lock(&rpcPendingLock);
+	for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+	{
+		if (rpcPending[idx].inUse && (rpcPending[idx].deadline <= now))
+		{
+			expired[cnt++] = rpcPending[idx];
+			rpcPending[idx].inUse = 0;
+		}
+	}
+	pthread_mutex_unlock(&rpcPendingLock);
+
+	// callbacks are called unlocked, they may send a new SREQ
+	for (idx = 0; idx < cnt; idx++)
+	{
+		LOG_WARN("SRSP timeout for %02X:%02X", expired[idx].subSys,
+		        expired[idx].cmd1);
+		rpcStats.srspTimeouts++;
+		if (expired[idx].cb)
+		{
+			expired[idx].cb(MT_RPC_ERR_TIMEOUT, NULL, 0, expired[idx].cbArg);
+		}
+	}
+}
+
+/*********************************************************************
+ * @fn      rpcPendingRemove
+ *
+ * @brief   Drop the outstanding SREQs registered with cbArg, without
+ *          calling their callback
+ */
+static void rpcPendingRemove(void *cbArg)
+{
+	uint8_t idx;
+
+	pthread_mutex_lock(&rpcPendingLock);
+	for (idx = 0; idx < RPC_MAX_PENDING_SREQ; idx++)
+	{
+		if (rpcPending[idx].inUse && (rpcPending[idx].cbArg == cbArg))
+		{
+			rpcPending[idx].inUse = 0;
+		}
+	}
+	pthread_mutex_unlock(&rpcPendingLock);
+}
+
+/*********************************************************************
+ * @fn      rpcSyncDone
+ *
+ * @brief   Completion callback of synchronous requests, hands the SRSP
+ *          over to the thread waiting in rpcSyncWait()
+ */
+static void rpcSyncDone(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg)
+{
+	rpcSync_t *sync = (rpcSync_t *) cbArg;
+
+	pthread_mutex_lock(&rpcSyncLock);
+	sync->status = status;
+	if (srsp)
+	{
+		memcpy(sync->srsp, srsp, srspLen);
+		sync->srspLen = srspLen;
+	}
+	sync->done = 1;
+	pthread_cond_broadcast(&rpcSyncCond);
+	pthread_mutex_unlock(&rpcSyncLock);
+}
+
 /*********************************************************************
  * @fn      calcFcs
  *
@@ -89,6 +89,10 @@ extern "C"
 
 #define RPC_UART_HDR_LEN           (RPC_UART_SOF_LEN + RPC_HDR_LEN)
 
+// largest payload that fits in a frame buffer
+#define RPC_MAX_PAYLOAD_LEN        (RPC_MAX_LEN - RPC_UART_HDR_LEN - \
+		                            RPC_UART_FCS_LEN)
+
 /***********************************************************************************
  * TYPEDEFS
  */
@@ -133,9 +137,73 @@ typedef enum
 	MT_RPC_ERR_SUBSYSTEM = 1,   // invalid subsystem
 	MT_RPC_ERR_COMMAND_ID = 2,  // invalid command ID
 	MT_RPC_ERR_PARAMETER = 3,   // invalid parameter
-	MT_RPC_ERR_LENGTH = 4       // invalid length
+	MT_RPC_ERR_LENGTH = 4,      // invalid length
+	MT_RPC_ERR_TIMEOUT = 0x80,  // host side: no SRSP before the deadline
+	MT_RPC_ERR_BUSY = 0x81,     // host side: too many outstanding SREQs
+	MT_RPC_ERR_TRANSPORT = 0x82 // host side: SREQ not sent or read failed
 } mtRpcErrorCode_t;
 
+// SRSP completion callback. On MT_RPC_SUCCESS srsp points to Cmd0, Cmd1
+// and the payload, and srspLen counts them plus the FCS. On
+// MT_RPC_ERR_TIMEOUT srsp is NULL.
+typedef void (*rpcSrspCb_t)(uint8_t status, uint8_t *srsp, uint8_t srspLen,
+        void *cbArg);
+
+// completion context of a synchronous request, see rpcSyncArm()
+typedef struct
+{
+	uint32_t timeoutMs;
+	uint8_t done;
+	uint8_t status;
+	uint8_t srspLen;         // Cmd0 + Cmd1 + payload + FCS
+	uint8_t srsp[RPC_MAX_LEN];
+} rpcSync_t;
+
+// outgoing frame, the payload is serialized in place, see rpcFrameInit()
+typedef struct
+{
+	uint8_t buf[RPC_MAX_LEN]; // SOF, length, Cmd0, Cmd1, payload, FCS
+} rpcFrame_t;
+
+// RPC layer counters
+typedef struct
+{
+	uint32_t reads;          // transport read calls
+	uint32_t framesRx;       // valid frames received
+	uint32_t fcsErrors;      // frames dropped on FCS mismatch
+	uint32_t bytesDiscarded; // bytes skipped while looking for a SOF
+	uint32_t srspTimeouts;   // SREQs not answered before their deadline
+	uint32_t srspUnexpected; // SRSPs matching no outstanding SREQ
+	uint32_t queueCount;     // frames waiting for rpcGetMqClientMsg()
+	uint32_t queueHwm;       // highest queueCount seen
+	uint32_t queueOverflows; // AREQs that found the queue full
+	uint32_t queueDroppedOldest; // queued AREQs dropped for a newer one
+	uint32_t queueShed;      // AREQs of a shed subsystem dropped
+	uint32_t queueCoalesced; // ZDO_STATE_CHANGE_IND merged into a queued one
+	uint32_t queueBlocked;   // AREQs that waited for room in the queue
+	uint32_t queueBlockTimeouts; // of which dropped when the wait expired
+	uint32_t areqIgnored;    // AREQs without handler or subscriber, not queued
+} rpcStats_t;
+
+// what happens to an AREQ when the message queue is full
+typedef enum
+{
+	RPC_QUEUE_FULL_DROP_NEW = 0,  // drop the incoming AREQ
+	RPC_QUEUE_FULL_BLOCK = 1,     // stop reading until the app catches up
+	RPC_QUEUE_FULL_DROP_OLDEST = 2 // drop the oldest queued AREQ
+} rpcQueueFullPolicy_t;
+
+// message queue limits, SRSPs have their own lane and are never dropped
+typedef struct
+{
+	uint16_t capacity;        // AREQs queued at most, 0 for the maximum
+	uint8_t fullPolicy;       // rpcQueueFullPolicy_t
+	uint32_t blockTimeoutMs;  // RPC_QUEUE_FULL_BLOCK: wait before dropping
+	uint32_t shedSubsysMask;  // bit n set: subsystem n may be shed
+	uint16_t shedThreshold;   // shed once this many AREQs are queued
+	uint8_t coalesceStateInd; // keep one ZDO_STATE_CHANGE_IND, the latest
+} rpcQueueConfig_t;
+
 /***********************************************************************************
  * GLOBAL VARIABLES
  */
@@ -147,11 +215,26 @@ typedef enum
 int32_t rpcOpen(char *devicePath);
 void rpcClose(void);
 int32_t rpcProcess(void);
+int32_t rpcProcessReady(void);
 uint8_t rpcSendFrame(uint8_t cmd0, uint8_t cmd1, uint8_t * payload,
         uint8_t payload_len);
+uint8_t rpcSendFrameCb(uint8_t cmd0, uint8_t cmd1, uint8_t *payload,
+        uint8_t payload_len, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg);
+uint8_t *rpcFrameInit(rpcFrame_t *frame, uint32_t payloadLen);
+uint8_t rpcFrameSend(rpcFrame_t *frame, uint8_t cmd0, uint8_t cmd1,
+        uint8_t payload_len);
+uint8_t rpcFrameSendCb(rpcFrame_t *frame, uint8_t cmd0, uint8_t cmd1,
+        uint8_t payload_len, uint32_t timeoutMs, rpcSrspCb_t cb, void *cbArg);
+int32_t rpcGetNextTimeout(void);
+void rpcSyncArm(rpcSync_t *sync, uint32_t timeoutMs);
+uint8_t rpcSyncWait(rpcSync_t *sync);
 void rpcForceRun(void);
 int32_t rpcInitMq(void);
 int32_t rpcGetMqClientMsg(void);
+void rpcSrspHide(void);
+uint8_t rpcSrspHidden(void);
+void rpcGetStats(rpcStats_t *stats);
+void rpcQueueConfigure(const rpcQueueConfig_t *cfg);
 
 #ifdef __cplusplus
 }
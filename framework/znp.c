@@ -6,7 +6,6 @@
 #define DEFAULT_DEVICE      "/dev/ttyACM0"
 
 //          TODO :
-//          * add typedef on cb
 //          * standard message structure to send
 
 
@@ -65,7 +64,7 @@ static uint8_t _status_list_len = sizeof(_status_list)/sizeof(ZNPStatusString);
 typedef struct
 {
     int socket_fd;
-    ZnpCallback_t message_cb;
+    int nonblock;
 } Znp_Private_Data;
 
 static Znp_Private_Data *priv = NULL;
@@ -112,19 +111,49 @@ int znp_socket_get()
     return -1;
 }
 
+int znp_nonblock_set(int enable)
+{
+    if(!priv)
+        return 1;
+    priv->nonblock = enable;
+    return 0;
+}
+
 void znp_loop_read()
 {
-    if(rpcProcess() < 0)
+    int ret;
+
+    // in non blocking mode only the bytes already received are handled,
+    // a partial frame stays buffered until the socket is readable again
+    if(priv && priv->nonblock)
+        ret = rpcProcessReady();
+    else
+        ret = rpcProcess();
+    if(ret < 0)
     {
         LOG_WARN("Failed to retrieve message from serial");
         return;
     }
-    rpcGetMqClientMsg();
+    // one read can bring several frames, dispatch them all
+    while(rpcGetMqClientMsg() == 0);
 }
 
-int znp_message_cb_set(ZnpCallback_t cb __attribute__((unused)))
+// cb is called with every AREQ subsys/cmd1 received, along with any other
+// callback set on it. AREQs without callback or handler are dropped before
+// being queued.
+int znp_message_cb_set(uint8_t subsys, uint8_t cmd1, ZnpCallback_t cb,
+        void *arg)
 {
-    // TODO : add first param as message type, second message as callback
+    if(mtSubscribe(subsys, cmd1, cb, arg) != MT_RPC_SUCCESS)
+        return 1;
+    return 0;
+}
+
+int znp_message_cb_unset(uint8_t subsys, uint8_t cmd1, ZnpCallback_t cb,
+        void *arg)
+{
+    if(mtUnsubscribe(subsys, cmd1, cb, arg) != MT_RPC_SUCCESS)
+        return 1;
     return 0;
 }
 
@@ -8,7 +8,8 @@
 #include "mtSapi.h"
 #include "dbgPrint.h"
 
-typedef void (*ZnpCallback_t)(void);
+// raw AREQ, rpcBuff starts at Cmd0, see mtSubscribe()
+typedef mtMsgCb_t ZnpCallback_t;
 
 typedef enum
 {
@@ -58,8 +59,12 @@ typedef enum
 int znp_init();
 void znp_shutdown();
 int znp_socket_get();
+int znp_nonblock_set(int enable);
 void znp_loop_read();
-int znp_message_cb_set(ZnpCallback_t cb);
+int znp_message_cb_set(uint8_t subsys, uint8_t cmd1, ZnpCallback_t cb,
+        void *arg);
+int znp_message_cb_unset(uint8_t subsys, uint8_t cmd1, ZnpCallback_t cb,
+        void *arg);
 const char *znp_strerror(ZNPStatus status);
 
 #endif
@@ -0,0 +1,116 @@
+/*
+ * simAfBatch.c
+ *
+ * Check of afDataRequestBatch(): every message completes once with the
+ * status of its own confirm or SRSP, at any window, and the application
+ * still gets the AF_DATA_CONFIRMs.
+ */
+
+#include <string.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+#include "rpcTransportSim.h"
+#include "mtAf.h"
+#include "mtAfBatch.h"
+
+#define BATCH_COUNT      (300)
+// destination the simulated ZNP refuses in the SRSP
+#define BATCH_REFUSED    (7)
+
+static DataRequestFormat_t reqs[BATCH_COUNT];
+static afBatchResult_t results[BATCH_COUNT];
+static uint8_t completions[BATCH_COUNT];
+static volatile int confirms;
+
+static int32_t srspHandler(uint8_t cmd0 __attribute__((unused)),
+        uint8_t cmd1, const uint8_t *req, uint8_t reqLen, uint8_t *rsp)
+{
+	uint16_t dst;
+
+	if ((cmd1 != MT_AF_DATA_REQUEST) || (reqLen < 2))
+	{
+		return -1;
+	}
+	dst = req[0] | (req[1] << 8);
+	if (dst == reqs[BATCH_REFUSED].DstAddr)
+	{
+		rsp[0] = 0x02; // afStatus_INVALID_PARAMETER
+		return 1;
+	}
+	return -1;
+}
+
+static void batchCb(uint16_t index, uint8_t status __attribute__((unused)),
+        void *cbArg __attribute__((unused)))
+{
+	if (index < BATCH_COUNT)
+	{
+		completions[index]++;
+	}
+}
+
+static uint8_t dataConfirm(DataConfirmFormat_t *msg __attribute__((unused)))
+{
+	confirms++;
+	return 0;
+}
+
+int main(void)
+{
+	mtAfCb_t afCbs;
+	uint8_t windows[] = { 1, 8, 32 };
+	uint16_t idx;
+	uint8_t w;
+
+	simCheckOpen(1);
+	rpcTransportSimSetSrspHandler(srspHandler);
+
+	memset(&afCbs, 0, sizeof(afCbs));
+	afCbs.pfnAfDataConfirm = dataConfirm;
+	afRegisterCallbacks(afCbs);
+
+	for (idx = 0; idx < BATCH_COUNT; idx++)
+	{
+		reqs[idx].DstAddr = 0x1000 + idx;
+		reqs[idx].DstEndpoint = 1;
+		reqs[idx].SrcEndpoint = 1 + (idx & 1);
+		reqs[idx].ClusterID = 6;
+		reqs[idx].Radius = 5;
+		reqs[idx].Len = 20;
+	}
+
+	for (w = 0; w < sizeof(windows); w++)
+	{
+		afBatchConfig_t cfg;
+		int32_t delivered;
+
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.window = windows[w];
+		cfg.cb = batchCb;
+		memset(completions, 0, sizeof(completions));
+		memset(results, 0, sizeof(results));
+
+		delivered = afDataRequestBatch(reqs, BATCH_COUNT, &cfg, results);
+		SIM_CHECK(delivered == BATCH_COUNT - 1);
+		for (idx = 0; idx < BATCH_COUNT; idx++)
+		{
+			SIM_CHECK(results[idx].done);
+			SIM_CHECK(completions[idx] == 1);
+			if (idx == BATCH_REFUSED)
+			{
+				SIM_CHECK(results[idx].status == 0x02);
+			}
+			else
+			{
+				SIM_CHECK(results[idx].status == MT_RPC_SUCCESS);
+			}
+		}
+	}
+
+	// the confirms of the batches also went to the application
+	SIM_CHECK(simCheckDispatch(&confirms, 3 * (BATCH_COUNT - 1), 2000));
+
+	simCheckExit();
+	return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * simAfReasm.c
+ *
+ * Check of the AF_INCOMING_MSG_EXT reassembly: messages longer than a
+ * frame are retrieved and delivered intact at any window, the copying
+ * callback gets at most sizeof(Data) bytes, the SRSPs of the retrieves
+ * stay away from the application and a retrieve refused for a full SRSP
+ * lane is retried or fails the message, never stalls it.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+#include "rpcTransportSim.h"
+#include "mtAf.h"
+#include "mtAfReasm.h"
+#include "mtSys.h"
+
+#define REASM_DATA_LEN     (5000)
+// retrieves sent from a full SRSP lane, see reasmBusy()
+#define REASM_BUSY_LEN     (300)
+#define REASM_BUSY_CHUNK   (100)
+
+static uint8_t data[REASM_DATA_LEN];
+static volatile int views;
+static volatile int copies;
+static volatile int retrieveSrsps;
+static int badViews;
+static int nullViews;
+static uint16_t lastViewLen;
+static IncomingMsgExtFormat_t lastCopy;
+// answer the next retrieve of data late, from an injected SRSP
+static uint8_t delayNextRetrieve;
+
+static int32_t srspHandler(uint8_t cmd0, uint8_t cmd1, const uint8_t *req,
+        uint8_t reqLen, uint8_t *rsp __attribute__((unused)))
+{
+	uint8_t srsp[2 + REASM_BUSY_CHUNK];
+	uint16_t index;
+
+	if (((cmd0 & MT_RPC_SUBSYSTEM_MASK) == MT_RPC_SYS_SYS)
+	        && (cmd1 == MT_SYS_VERSION))
+	{
+		// fills the SREQ table until it times out
+		return RPC_SIM_NO_RSP;
+	}
+	if (((cmd0 & MT_RPC_SUBSYSTEM_MASK) != MT_RPC_SYS_AF)
+	        || (cmd1 != MT_AF_DATA_RETRIEVE) || (reqLen < 7) || (req[6] == 0)
+	        || (req[6] > REASM_BUSY_CHUNK) || !delayNextRetrieve)
+	{
+		return -1;
+	}
+	delayNextRetrieve = 0;
+	index = req[4] | (req[5] << 8);
+	srsp[0] = MT_RPC_SUCCESS;
+	srsp[1] = req[6];
+	memcpy(&srsp[2], &data[index], req[6]);
+	rpcTransportSimInjectAreq(MT_RPC_CMD_SRSP | MT_RPC_SYS_AF,
+	        MT_AF_DATA_RETRIEVE, srsp, 2 + req[6], 50000);
+	return RPC_SIM_NO_RSP;
+}
+
+static uint8_t incomingMsgExtView(const IncomingMsgExtView_t *msg)
+{
+	lastViewLen = msg->Len;
+	if (msg->Data == NULL)
+	{
+		nullViews++;
+	}
+	else if (memcmp(msg->Data, data, msg->Len) != 0)
+	{
+		badViews++;
+	}
+	views++;
+	return 0;
+}
+
+static uint8_t incomingMsgExt(IncomingMsgExtFormat_t *msg)
+{
+	lastCopy = *msg;
+	copies++;
+	return 0;
+}
+
+static uint8_t dataRetrieveSrsp(DataRetrieveSrspFormat_t *msg
+        __attribute__((unused)))
+{
+	retrieveSrsps++;
+	return 0;
+}
+
+// message of len bytes from data, delivered and checked
+static void reasmDeliver(uint16_t len)
+{
+	int expected = views + 1;
+
+	SIM_CHECK(rpcTransportSimInjectIncomingMsgExt(0x1234, 1, 1, 0x19, data,
+	        len, 0) == 0);
+	SIM_CHECK(simCheckDispatch(&views, expected, 2000));
+	SIM_CHECK(simCheckDispatch(&copies, expected, 100));
+	SIM_CHECK(lastViewLen == len);
+	SIM_CHECK(lastCopy.Len == ((len > sizeof(lastCopy.Data)) ?
+	        sizeof(lastCopy.Data) : len));
+	SIM_CHECK(memcmp(lastCopy.Data, data, lastCopy.Len) == 0);
+}
+
+// a retrieve refused for a full SRSP lane, stuff to also fill the lane
+// when the SRSP that would retry it is dispatched
+static void reasmBusy(uint8_t stuff)
+{
+	afReasmConfig_t cfg = { REASM_BUSY_CHUNK, 1, 0 };
+	afReasmStats_t before, after;
+	int expected = views + 1;
+	uint8_t idx;
+
+	afReasmConfigure(&cfg);
+	afReasmGetStats(&before);
+
+	// the first retrieve goes out, its SRSP comes after 15 pings
+	delayNextRetrieve = 1;
+	SIM_CHECK(rpcTransportSimInjectIncomingMsgExt(0x1234, 1, 1, 0x19, data,
+	        REASM_BUSY_LEN, 0) == 0);
+	usleep(20000);
+	SIM_CHECK(rpcGetMqClientMsg() == 0);
+	for (idx = 0; idx < 15; idx++)
+	{
+		SIM_CHECK(sysPing() == MT_RPC_SUCCESS);
+	}
+	usleep(150000);
+
+	if (stuff)
+	{
+		for (idx = 0; idx < 15; idx++)
+		{
+			SIM_CHECK(rpcGetMqClientMsg() == 0);
+		}
+		for (idx = 0; idx < 15; idx++)
+		{
+			SIM_CHECK(rpcSendFrameCb(MT_RPC_CMD_SREQ | MT_RPC_SYS_SYS,
+			        MT_SYS_VERSION, NULL, 0, 300, NULL, NULL)
+			        == MT_RPC_SUCCESS);
+		}
+		simCheckDispatch(NULL, 0, 500);
+		afReasmGetStats(&after);
+		SIM_CHECK(after.failed == before.failed + 1);
+		SIM_CHECK(views == expected - 1);
+	}
+	else
+	{
+		SIM_CHECK(simCheckDispatch(&views, expected, 2000));
+		SIM_CHECK(lastViewLen == REASM_BUSY_LEN);
+		afReasmGetStats(&after);
+		SIM_CHECK(after.messages == before.messages + 1);
+		SIM_CHECK(after.failed == before.failed);
+	}
+
+	afReasmConfigure(NULL);
+}
+
+int main(void)
+{
+	mtAfCb_t afCbs;
+	uint16_t lens[] = { 150, 230, 1000, 4000 };
+	uint8_t windows[] = { 1, 4, 8 };
+	afReasmStats_t stats;
+	DataRetrieveFormat_t req;
+	uint16_t idx;
+	uint8_t w, l;
+
+	simCheckOpen(1);
+	rpcTransportSimSetSrspHandler(srspHandler);
+
+	memset(&afCbs, 0, sizeof(afCbs));
+	afCbs.pfnAfIncomingMsgExtView = incomingMsgExtView;
+	afCbs.pfnAfIncomingMsgExt = incomingMsgExt;
+	afCbs.pfnAfDataRetrieveSrsp = dataRetrieveSrsp;
+	afRegisterCallbacks(afCbs);
+
+	for (idx = 0; idx < REASM_DATA_LEN; idx++)
+	{
+		data[idx] = (uint8_t) (idx * 13 + 1);
+	}
+
+	// in the frame and retrieved, one at a time
+	for (w = 0; w < sizeof(windows); w++)
+	{
+		afReasmConfig_t cfg = { 0, windows[w], 0 };
+
+		afReasmConfigure(&cfg);
+		for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+		{
+			reasmDeliver(lens[l]);
+		}
+	}
+	afReasmConfigure(NULL);
+
+	// several at once, once the ZNP freed the buffers of the others
+	simCheckDispatch(NULL, 0, 50);
+	for (l = 0; l < AF_REASM_POOL_SIZE; l++)
+	{
+		SIM_CHECK(rpcTransportSimInjectIncomingMsgExt(0x1234, 1, 1, 0x19,
+		        data, 3000, 0) == 0);
+	}
+	SIM_CHECK(simCheckDispatch(&views, views + AF_REASM_POOL_SIZE, 2000));
+	SIM_CHECK(badViews == 0);
+	SIM_CHECK(nullViews == 0);
+
+	// the retrieves of the framework are not reported
+	SIM_CHECK(retrieveSrsps == 0);
+
+	// too long for the pool: delivered without data, the application
+	// retrieves it itself
+	SIM_CHECK(rpcTransportSimInjectIncomingMsgExt(0x1234, 1, 1, 0x19, data,
+	        REASM_DATA_LEN, 0) == 0);
+	SIM_CHECK(simCheckDispatch(&copies, copies + 1, 2000));
+	SIM_CHECK(nullViews == 1);
+	SIM_CHECK(lastCopy.Len == 0);
+	memset(&req, 0, sizeof(req));
+	req.TimeStamp[0] = (uint8_t) lastCopy.TimeStamp;
+	req.TimeStamp[1] = (uint8_t) (lastCopy.TimeStamp >> 8);
+	req.TimeStamp[2] = (uint8_t) (lastCopy.TimeStamp >> 16);
+	req.TimeStamp[3] = (uint8_t) (lastCopy.TimeStamp >> 24);
+	req.Length = 0;
+	SIM_CHECK(afDataRetrieve(&req) == MT_RPC_SUCCESS);
+	SIM_CHECK(simCheckDispatch(&retrieveSrsps, 1, 1000));
+
+	// full SRSP lane: retried once a queued SRSP is dispatched, failed if
+	// none is left to retry it, and the next message goes through
+	reasmBusy(0);
+	reasmBusy(1);
+	reasmDeliver(1000);
+	SIM_CHECK(badViews == 0);
+
+	afReasmGetStats(&stats);
+	SIM_CHECK(stats.noBuffer == 1);
+	SIM_CHECK(stats.failed == 1);
+
+	simCheckExit();
+	return 0;
+}
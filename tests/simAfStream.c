@@ -0,0 +1,150 @@
+/*
+ * simAfStream.c
+ *
+ * Check of afDataRequestStream(): the data of a message larger than a
+ * frame reaches the ZNP huge buffer intact at any window and chunk size,
+ * and its AF_DATA_CONFIRM comes back.
+ */
+
+#include <string.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+#include "rpcTransportSim.h"
+#include "mtAf.h"
+#include "mtAfStream.h"
+
+#define STREAM_LEN     (6000)
+// more than the simulated ZNP can hold
+#define STREAM_TOO_BIG (9000)
+
+static uint8_t data[STREAM_TOO_BIG];
+// what the ZNP received through AF_DATA_STORE
+static uint8_t stored[STREAM_LEN];
+static uint32_t storedBytes;
+static uint32_t progressCalls;
+static uint32_t progressLast;
+static uint8_t progressBackwards;
+static volatile int confirms;
+static DataConfirmFormat_t lastConfirm;
+
+static int32_t srspHandler(uint8_t cmd0 __attribute__((unused)),
+        uint8_t cmd1, const uint8_t *req, uint8_t reqLen,
+        uint8_t *rsp __attribute__((unused)))
+{
+	uint16_t index;
+
+	if ((cmd1 == MT_AF_DATA_STORE) && (reqLen >= 3) && (req[2] > 0))
+	{
+		index = req[0] | (req[1] << 8);
+		if ((index + req[2] <= STREAM_LEN) && (req[2] <= reqLen - 3))
+		{
+			memcpy(&stored[index], &req[3], req[2]);
+			storedBytes += req[2];
+		}
+	}
+	// the simulated ZNP answers
+	return -1;
+}
+
+static void progress(uint32_t done, uint32_t total __attribute__((unused)),
+        void *cbArg __attribute__((unused)))
+{
+	if (done < progressLast)
+	{
+		progressBackwards = 1;
+	}
+	progressLast = done;
+	progressCalls++;
+}
+
+static uint8_t dataConfirm(DataConfirmFormat_t *msg)
+{
+	lastConfirm = *msg;
+	confirms++;
+	return 0;
+}
+
+int main(void)
+{
+	mtAfCb_t afCbs;
+	DataRequestExtFormat_t req;
+	afStreamConfig_t cfg;
+	afStreamStats_t stats;
+	uint8_t windows[] = { 1, 4, 8 };
+	uint8_t chunks[] = { 0, 100 };
+	uint16_t idx;
+	uint8_t w, c;
+	int expected = 0;
+
+	simCheckOpen(1);
+	rpcTransportSimSetSrspHandler(srspHandler);
+
+	memset(&afCbs, 0, sizeof(afCbs));
+	afCbs.pfnAfDataConfirm = dataConfirm;
+	afRegisterCallbacks(afCbs);
+
+	for (idx = 0; idx < STREAM_TOO_BIG; idx++)
+	{
+		data[idx] = (uint8_t) (idx * 7 + 1);
+	}
+	memset(&req, 0, sizeof(req));
+	req.DstAddrMode = afAddr16Bit;
+	req.DstAddr[0] = 0x34;
+	req.DstAddr[1] = 0x12;
+	req.DstEndpoint = 1;
+	req.SrcEndpoint = 1;
+	req.ClusterId = 0x19;
+	req.Radius = 5;
+
+	for (c = 0; c < sizeof(chunks); c++)
+	{
+		for (w = 0; w < sizeof(windows); w++)
+		{
+			uint8_t chunkLen = chunks[c] ? chunks[c] : AF_STREAM_MAX_CHUNK;
+
+			memset(&cfg, 0, sizeof(cfg));
+			cfg.chunkLen = chunks[c];
+			cfg.window = windows[w];
+			cfg.progressCb = progress;
+			memset(stored, 0, sizeof(stored));
+			storedBytes = 0;
+			progressCalls = 0;
+			progressLast = 0;
+			progressBackwards = 0;
+			req.TransId = (uint8_t) (10 * c + w + 1);
+
+			SIM_CHECK(afDataRequestStream(&req, data, STREAM_LEN, &cfg,
+			        &stats) == MT_RPC_SUCCESS);
+			SIM_CHECK(stats.bytes == STREAM_LEN);
+			SIM_CHECK(stats.stores == (STREAM_LEN + chunkLen - 1) / chunkLen);
+			SIM_CHECK(storedBytes == STREAM_LEN);
+			SIM_CHECK(memcmp(stored, data, STREAM_LEN) == 0);
+			SIM_CHECK(progressCalls > 0);
+			SIM_CHECK(!progressBackwards);
+			SIM_CHECK(progressLast == STREAM_LEN);
+
+			expected++;
+			SIM_CHECK(simCheckDispatch(&confirms, expected, 1000));
+			SIM_CHECK(lastConfirm.Status == afStatus_SUCCESS);
+			SIM_CHECK(lastConfirm.TransId == req.TransId);
+		}
+	}
+
+	// fits in a frame, no store needed
+	storedBytes = 0;
+	req.TransId = 99;
+	SIM_CHECK(afDataRequestStream(&req, data, 100, NULL, &stats)
+	        == MT_RPC_SUCCESS);
+	SIM_CHECK(stats.bytes == 100);
+	SIM_CHECK(storedBytes == 0);
+	expected++;
+	SIM_CHECK(simCheckDispatch(&confirms, expected, 1000));
+
+	// larger than the huge buffer of the simulated ZNP
+	SIM_CHECK(afDataRequestStream(&req, data, STREAM_TOO_BIG, NULL, &stats)
+	        == afStatus_MEM_FAIL);
+
+	simCheckExit();
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * simCheck.c
+ *
+ * Helpers of the checks run against the simulated ZNP, see simCheck.h.
+ */
+
+/*********************************************************************
+ * INCLUDES
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static int simCheckFailures;
+static pthread_t simCheckReader;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void *simCheckReaderTask(void *arg __attribute__((unused)))
+{
+	for (;;)
+	{
+		rpcProcess();
+	}
+	return NULL;
+}
+
+static uint64_t simCheckNowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*********************************************************************
+ * API FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      simCheck
+ *
+ * @brief   Report a condition that does not hold, see SIM_CHECK().
+ */
+void simCheck(int ok, const char *expr, const char *file, int line)
+{
+	if (!ok)
+	{
+		printf("%s:%d: check failed: %s\n", file, line, expr);
+		simCheckFailures++;
+	}
+}
+
+/*********************************************************************
+ * @fn      simCheckOpen
+ *
+ * @brief   Open the simulated ZNP and the message queue.
+ *
+ * @param   reader - 1 to read the transport from a thread, 0 if the
+ *          check calls rpcProcess() itself
+ */
+void simCheckOpen(uint8_t reader)
+{
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	if ((rpcOpen("sim") < 0) || (rpcInitMq() < 0))
+	{
+		printf("simulated ZNP not available\n");
+		exit(1);
+	}
+	if (reader && (pthread_create(&simCheckReader, NULL, simCheckReaderTask,
+	        NULL) != 0))
+	{
+		printf("no reader thread\n");
+		exit(1);
+	}
+}
+
+/*********************************************************************
+ * @fn      simCheckDispatch
+ *
+ * @brief   Dispatch the queued messages until a counter updated by the
+ *          callbacks reaches a value.
+ *
+ * @param   count - counter, NULL to dispatch for timeoutMs
+ * @param   target - value to reach
+ * @param   timeoutMs - time to give up after
+ *
+ * @return  1 if the target was reached, else 0
+ */
+uint8_t simCheckDispatch(volatile int *count, int target, uint32_t timeoutMs)
+{
+	uint64_t deadline = simCheckNowMs() + timeoutMs;
+
+	for (;;)
+	{
+		while (rpcGetMqClientMsg() == 0)
+		{
+			if (count && (*count >= target))
+			{
+				return 1;
+			}
+		}
+		if (count && (*count >= target))
+		{
+			return 1;
+		}
+		if (simCheckNowMs() >= deadline)
+		{
+			return (count == NULL);
+		}
+		usleep(1000);
+	}
+}
+
+/*********************************************************************
+ * @fn      simCheckExit
+ *
+ * @brief   Print the outcome and exit. The reader thread is left
+ *          blocked in the transport.
+ */
+void simCheckExit(void)
+{
+	printf("%s: %d failed\n", simCheckFailures ? "FAIL" : "PASS",
+	        simCheckFailures);
+	_exit(simCheckFailures ? 1 : 0);
+}
@@ -0,0 +1,39 @@
+/*
+ * simCheck.h
+ *
+ * Helpers of the checks run against the simulated ZNP. They are built and
+ * registered with meson test when the framework is configured with
+ * -Dtransport=sim. A check reports every failed condition and exits with
+ * a non-zero status if there was any.
+ */
+
+#ifndef SIMCHECK_H
+#define SIMCHECK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define SIM_CHECK(cond) simCheck((cond) != 0, #cond, __FILE__, __LINE__)
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+void simCheck(int ok, const char *expr, const char *file, int line);
+void simCheckOpen(uint8_t reader);
+uint8_t simCheckDispatch(volatile int *count, int target, uint32_t timeoutMs);
+void simCheckExit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMCHECK_H */
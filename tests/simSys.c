@@ -0,0 +1,88 @@
+/*
+ * simSys.c
+ *
+ * Check of the simulated ZNP itself: an SREQ gets its SRSP, injected
+ * AREQs reach the MT callbacks and a synchronous request completes.
+ */
+
+#include <string.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+#include "rpcTransportSim.h"
+#include "mtSys.h"
+#include "mtZdo.h"
+#include "mtAf.h"
+
+static volatile int pings;
+static volatile int states;
+static volatile int incoming;
+static uint8_t lastState;
+static IncomingMsgFormat_t lastMsg;
+
+static uint8_t pingSrsp(PingSrspFormat_t *msg __attribute__((unused)))
+{
+	pings++;
+	return 0;
+}
+
+static uint8_t stateChangeInd(uint8_t state)
+{
+	lastState = state;
+	states++;
+	return 0;
+}
+
+static uint8_t incomingMsg(IncomingMsgFormat_t *msg)
+{
+	lastMsg = *msg;
+	incoming++;
+	return 0;
+}
+
+int main(void)
+{
+	mtSysCb_t sysCbs;
+	mtZdoCb_t zdoCbs;
+	mtAfCb_t afCbs;
+	uint8_t data[5] = { 1, 2, 3, 4, 5 };
+	PingSrspFormat_t ping;
+
+	simCheckOpen(1);
+
+	memset(&sysCbs, 0, sizeof(sysCbs));
+	sysCbs.pfnSysPingSrsp = pingSrsp;
+	sysRegisterCallbacks(sysCbs);
+	memset(&zdoCbs, 0, sizeof(zdoCbs));
+	zdoCbs.pfnmtZdoStateChangeInd = stateChangeInd;
+	zdoRegisterCallbacks(zdoCbs);
+	memset(&afCbs, 0, sizeof(afCbs));
+	afCbs.pfnAfIncomingMsg = incomingMsg;
+	afRegisterCallbacks(afCbs);
+
+	// SREQ answered through the MT callbacks
+	SIM_CHECK(sysPing() == MT_RPC_SUCCESS);
+	SIM_CHECK(simCheckDispatch(&pings, 1, 1000));
+
+	// AREQs from the device
+	SIM_CHECK(rpcTransportSimInjectStateChange(9, 0) == 0);
+	SIM_CHECK(simCheckDispatch(&states, 1, 1000));
+	SIM_CHECK(lastState == 9);
+
+	SIM_CHECK(rpcTransportSimInjectIncomingMsg(0x1234, 2, 1, 6, data,
+	        sizeof(data), 0) == 0);
+	SIM_CHECK(simCheckDispatch(&incoming, 1, 1000));
+	SIM_CHECK(lastMsg.SrcAddr == 0x1234);
+	SIM_CHECK(lastMsg.SrcEndpoint == 2);
+	SIM_CHECK(lastMsg.ClusterId == 6);
+	SIM_CHECK(lastMsg.Len == sizeof(data));
+	SIM_CHECK(memcmp(lastMsg.Data, data, sizeof(data)) == 0);
+
+	// synchronous request, its SRSP does not reach the callbacks
+	SIM_CHECK(sysPingSync(&ping, 0) == MT_RPC_SUCCESS);
+	simCheckDispatch(NULL, 0, 50);
+	SIM_CHECK(pings == 1);
+
+	simCheckExit();
+	return 0;
+}
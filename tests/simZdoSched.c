@@ -0,0 +1,218 @@
+/*
+ * simZdoSched.c
+ *
+ * Check of the ZDO request scheduler: the global and per destination
+ * rates hold, interactive requests pass background ones, refused and
+ * unanswered requests end with their status and disabling cancels what
+ * is left.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "simCheck.h"
+#include "rpc.h"
+#include "rpcTransportSim.h"
+#include "mtZdo.h"
+#include "mtZdoSched.h"
+
+// destination refusing the request in the SRSP, and one never answering
+#define SCHED_REFUSED      (0xBAD0)
+#define SCHED_SILENT       (0xDEAD)
+#define SCHED_REFUSAL      (0x10)
+#define SCHED_MAX_ORDER    (64)
+
+static uint8_t inflight[0x10000];
+static uint8_t maxInflight;
+static uint8_t ends[0x10000];
+static uint8_t lastStatus[0x10000];
+static uint16_t order[SCHED_MAX_ORDER];
+static uint8_t orderLen;
+
+static int32_t srspHandler(uint8_t cmd0, uint8_t cmd1, const uint8_t *req,
+        uint8_t reqLen, uint8_t *rsp)
+{
+	uint8_t areq[6];
+	uint16_t dst;
+
+	if (((cmd0 & MT_RPC_SUBSYSTEM_MASK) != MT_RPC_SYS_ZDO)
+	        || (cmd1 != MT_ZDO_ACTIVE_EP_REQ) || (reqLen < 2))
+	{
+		return -1;
+	}
+	dst = req[0] | (req[1] << 8);
+	if (orderLen < SCHED_MAX_ORDER)
+	{
+		order[orderLen++] = dst;
+	}
+	if (++inflight[dst] > maxInflight)
+	{
+		maxInflight = inflight[dst];
+	}
+
+	if (dst == SCHED_REFUSED)
+	{
+		rsp[0] = SCHED_REFUSAL;
+		return 1;
+	}
+	if (dst != SCHED_SILENT)
+	{
+		// ZDO_ACTIVE_EP_RSP from the destination, no endpoint
+		areq[0] = (uint8_t) dst;
+		areq[1] = (uint8_t) (dst >> 8);
+		areq[2] = 0;
+		areq[3] = (uint8_t) dst;
+		areq[4] = (uint8_t) (dst >> 8);
+		areq[5] = 0;
+		rpcTransportSimInjectAreq(MT_RPC_CMD_AREQ | MT_RPC_SYS_ZDO,
+		        MT_ZDO_ACTIVE_EP_RSP, areq, sizeof(areq), 5000);
+	}
+	return -1;
+}
+
+static void schedCb(uint8_t status, void *cbArg)
+{
+	uint16_t dst = (uint16_t) (uintptr_t) cbArg;
+
+	if (inflight[dst])
+	{
+		inflight[dst]--;
+	}
+	lastStatus[dst] = status;
+	ends[dst]++;
+}
+
+static uint8_t submit(uint16_t dst, uint8_t prio)
+{
+	zdoSchedReq_t req;
+
+	memset(&req, 0, sizeof(req));
+	req.cmd1 = MT_ZDO_ACTIVE_EP_REQ;
+	req.u.activeEp.DstAddr = dst;
+	req.u.activeEp.NwkAddrOfInterest = dst;
+	return zdoSchedSubmit(&req, prio, schedCb, (void *) (uintptr_t) dst);
+}
+
+static uint64_t nowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main(void)
+{
+	rpcSimConfig_t simCfg = { 200, 0, 0 };
+	zdoSchedConfig_t cfg;
+	zdoSchedStats_t stats;
+	uint64_t start;
+	uint16_t idx;
+
+	simCheckOpen(1);
+	rpcTransportSimConfigure(&simCfg);
+	rpcTransportSimSetSrspHandler(srspHandler);
+
+	SIM_CHECK(submit(0x1000, ZDO_SCHED_PRIO_BACKGROUND)
+	        == MT_RPC_ERR_PARAMETER);
+
+	// global rate: 10 requests at 20/s after a burst of 4
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.globalRate = 20;
+	cfg.globalBurst = 4;
+	cfg.nodeRate = 1000;
+	cfg.nodeBurst = 10;
+	cfg.rspTimeoutMs = 200;
+	cfg.retryDelayMs = 20;
+	SIM_CHECK(zdoSchedEnable(&cfg) == MT_RPC_SUCCESS);
+	start = nowMs();
+	for (idx = 0; idx < 10; idx++)
+	{
+		SIM_CHECK(submit(0x1000 + idx, ZDO_SCHED_PRIO_BACKGROUND)
+		        == MT_RPC_SUCCESS);
+	}
+	SIM_CHECK(zdoSchedWaitIdle(5000) == MT_RPC_SUCCESS);
+	SIM_CHECK(nowMs() - start >= 250);
+	for (idx = 0; idx < 10; idx++)
+	{
+		SIM_CHECK(ends[0x1000 + idx] == 1);
+		SIM_CHECK(lastStatus[0x1000 + idx] == 0);
+	}
+	zdoSchedGetStats(&stats);
+	SIM_CHECK(stats.responses == 10);
+	SIM_CHECK(stats.throttled > 0);
+
+	// one transaction at a time to a destination
+	cfg.globalRate = 1000;
+	cfg.globalBurst = 100;
+	SIM_CHECK(zdoSchedEnable(&cfg) == MT_RPC_SUCCESS);
+	maxInflight = 0;
+	for (idx = 0; idx < 5; idx++)
+	{
+		SIM_CHECK(submit(0x2000, ZDO_SCHED_PRIO_BACKGROUND)
+		        == MT_RPC_SUCCESS);
+	}
+	SIM_CHECK(zdoSchedWaitIdle(5000) == MT_RPC_SUCCESS);
+	SIM_CHECK(ends[0x2000] == 5);
+	SIM_CHECK(maxInflight == 1);
+
+	// an interactive request goes before the background ones queued
+	cfg.globalRate = 10;
+	cfg.globalBurst = 1;
+	SIM_CHECK(zdoSchedEnable(&cfg) == MT_RPC_SUCCESS);
+	usleep(200000);
+	orderLen = 0;
+	SIM_CHECK(submit(0x3001, ZDO_SCHED_PRIO_BACKGROUND) == MT_RPC_SUCCESS);
+	SIM_CHECK(submit(0x3002, ZDO_SCHED_PRIO_BACKGROUND) == MT_RPC_SUCCESS);
+	SIM_CHECK(submit(0x3003, ZDO_SCHED_PRIO_BACKGROUND) == MT_RPC_SUCCESS);
+	SIM_CHECK(submit(0x3004, ZDO_SCHED_PRIO_INTERACTIVE) == MT_RPC_SUCCESS);
+	SIM_CHECK(zdoSchedWaitIdle(5000) == MT_RPC_SUCCESS);
+	SIM_CHECK(orderLen == 4);
+	SIM_CHECK((order[0] == 0x3001) && (order[1] == 0x3004));
+
+	// refused beyond the retries, and without response
+	cfg.globalRate = 1000;
+	cfg.globalBurst = 100;
+	SIM_CHECK(zdoSchedEnable(&cfg) == MT_RPC_SUCCESS);
+	zdoSchedGetStats(&stats);
+	SIM_CHECK(submit(SCHED_REFUSED, ZDO_SCHED_PRIO_INTERACTIVE)
+	        == MT_RPC_SUCCESS);
+	SIM_CHECK(submit(SCHED_SILENT, ZDO_SCHED_PRIO_INTERACTIVE)
+	        == MT_RPC_SUCCESS);
+	SIM_CHECK(zdoSchedWaitIdle(5000) == MT_RPC_SUCCESS);
+	SIM_CHECK(ends[SCHED_REFUSED] == 1);
+	SIM_CHECK(lastStatus[SCHED_REFUSED] == SCHED_REFUSAL);
+	SIM_CHECK(ends[SCHED_SILENT] == 1);
+	SIM_CHECK(lastStatus[SCHED_SILENT] == MT_RPC_ERR_TIMEOUT);
+	{
+		zdoSchedStats_t after;
+
+		zdoSchedGetStats(&after);
+		SIM_CHECK(after.refusals == stats.refusals + ZDO_SCHED_RETRIES + 1);
+		SIM_CHECK(after.timeouts == stats.timeouts + 1);
+		SIM_CHECK(after.failures == stats.failures + 2);
+	}
+
+	// disabled with requests left: each ends once, cancelled if unsent
+	cfg.nodeRate = 1;
+	cfg.nodeBurst = 1;
+	SIM_CHECK(zdoSchedEnable(&cfg) == MT_RPC_SUCCESS);
+	for (idx = 0; idx < 3; idx++)
+	{
+		SIM_CHECK(submit(0x4000, ZDO_SCHED_PRIO_BACKGROUND)
+		        == MT_RPC_SUCCESS);
+	}
+	usleep(50000);
+	zdoSchedPoll();
+	zdoSchedDisable();
+	SIM_CHECK(ends[0x4000] == 3);
+	SIM_CHECK(lastStatus[0x4000] == ZDO_SCHED_CANCELLED);
+	zdoSchedGetStats(&stats);
+	SIM_CHECK((stats.queued == 0) && (stats.outstanding == 0));
+	SIM_CHECK(submit(0x1000, ZDO_SCHED_PRIO_BACKGROUND)
+	        == MT_RPC_ERR_PARAMETER);
+
+	simCheckExit();
+	return 0;
+}